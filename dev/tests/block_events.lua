@@ -0,0 +1,33 @@
+-- Block events emitted on blocks placement and destruction. Every block
+-- destruction emits on_block_broken event of the base pack world script
+local util = require "core:tests_util"
+
+app.set_setting("chunks.load-distance", 3)
+util.create_demo_world()
+
+local X, Y, Z = 0, 200, 0
+local COUNT = 1000
+
+local pid = player.create("Observer")
+player.set_pos(pid, X, Y, Z)
+util.wait_for_chunk(X, Y, Z)
+
+local emitted = 0
+events.on("base:.blockbroken", function()
+    emitted = emitted + 1
+end)
+
+local stone = block.index("base:stone")
+local start = time.uptime()
+for _ = 1, COUNT do
+    block.place(X, Y, Z, stone, 0, pid)
+    block.destruct(X, Y, Z, pid)
+end
+local elapsed = time.uptime() - start
+
+assert(emitted == COUNT, string.format("%s ~= %s", emitted, COUNT))
+assert(block.get(X, Y, Z) == 0)
+debug.log(string.format("%s block events in %.3fs", COUNT, elapsed))
+
+app.close_world(false)
+app.delete_world("demo")
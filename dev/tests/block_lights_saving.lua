@@ -0,0 +1,46 @@
+-- Saved block lights are updated when changed from the neighbour chunk
+local util = require "core:tests_util"
+
+app.set_setting("chunks.load-distance", 6)
+app.set_setting("chunks.server-lighting", true)
+util.create_demo_world()
+
+-- lamp is placed at the chunk border, its light spreads to the next chunk
+local X, Y, Z = 15, 120, 0
+
+local function wait_lights()
+    local pid = player.create("Lighting")
+    player.set_pos(pid, X, Y, Z)
+    util.wait_for_chunk(X + 1, Y, Z)
+    for _ = 1, 20 do
+        app.tick()
+    end
+end
+
+local function reopen()
+    app.close_world(true)
+    app.open_world("demo")
+    wait_lights()
+end
+
+wait_lights()
+
+local lamp = block.index("base:lamp")
+block.set(X, Y, Z, lamp)
+app.tick()
+assert(block.get_light(X + 1, Y, Z) == 14)
+
+reopen()
+assert(block.get(X, Y, Z) == lamp)
+assert(block.get_light(X + 1, Y, Z) == 14)
+
+block.set(X, Y, Z, 0)
+app.tick()
+assert(block.get_light(X + 1, Y, Z) == 0)
+
+reopen()
+assert(block.get_light(X + 1, Y, Z) == 0)
+
+app.close_world(false)
+app.delete_world("demo")
+app.set_setting("chunks.server-lighting", false)
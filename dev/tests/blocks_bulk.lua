@@ -0,0 +1,33 @@
+-- Bulk block operations in a box crossing chunk borders
+local util = require "core:tests_util"
+
+app.set_setting("chunks.load-distance", 3)
+util.create_demo_world()
+
+local pid = player.create("Builder")
+player.set_pos(pid, 0, 200, 0)
+util.wait_for_chunk(0, 200, 0)
+
+local stone = block.index("base:stone")
+local pos = {-20, 150, -20}
+local size = {40, 30, 40}
+local volume = size[1] * size[2] * size[3]
+
+local start = time.uptime()
+assert(block.fill(pos, size, stone) == volume)
+print(string.format("filled %s blocks in %.3fs", volume, time.uptime() - start))
+assert(block.count(pos, size, stone) == volume)
+assert(block.get(19, 179, 19) == stone)
+assert(block.fill(pos, size, stone) == 0)
+
+local data = block.get_region(pos, size)
+assert(#data == volume * 4)
+
+assert(block.replace(pos, size, stone, 0) == volume)
+assert(block.count(pos, size, 0) == volume)
+
+assert(block.set_region(pos, size, data) == volume)
+assert(block.count(pos, size, stone) == volume)
+
+app.close_world(false)
+app.delete_world("demo")
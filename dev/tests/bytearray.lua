@@ -34,3 +34,24 @@ arr:insert(2, {5, 6})
 assert(arr[#arr] == 25)
 assert(arr[2] == 5)
 assert(arr[3] == 6)
+
+-- engine functions accept and return Bytearrays without copying via strings
+local packed = byteutil.pack("<iH", 123456, 65000)
+assert(Bytearray_is(packed))
+local a, b = byteutil.unpack("<iH", packed)
+assert(a == 123456 and b == 65000)
+
+local source = Bytearray(1000)
+for i=1,#source do
+    source[i] = i % 7
+end
+local decoded = compression.decode(compression.encode(source))
+assert(#decoded == #source)
+for i=1,#source do
+    assert(decoded[i] == source[i])
+end
+assert(#compression.decode(compression.encode("text")) == 4)
+
+local value = bjson.frombytes(bjson.tobytes({bytes=source}))
+assert(#value.bytes == #source)
+assert(value.bytes[7] == source[7])
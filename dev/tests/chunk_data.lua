@@ -0,0 +1,50 @@
+-- Full, delta and saved (passthrough) chunk data
+local util = require "core:tests_util"
+
+app.set_setting("chunks.load-distance", 3)
+util.create_demo_world()
+
+local pid = player.create("Observer")
+local stone = block.index("base:stone")
+
+local function visit(x)
+    player.set_pos(pid, x, 100, 0)
+    util.wait_for_chunk(x, 100, 0)
+end
+
+visit(0)
+local data, revision = world.get_chunk_data(0, 0)
+assert(data and revision)
+
+local empty = world.get_chunk_data(0, 0, revision)
+assert(#empty < #data)
+
+block.set(0, 100, 0, stone)
+local delta, next_revision = world.get_chunk_data(0, 0, revision)
+assert(next_revision > revision)
+assert(#delta < #data)
+print(string.format("full: %s B, delta: %s B", #data, #delta))
+
+-- revision from another session is unknown, so full data is sent
+local full = world.get_chunk_data(0, 0, next_revision + 1000000)
+assert(#full > #delta)
+
+block.set(0, 100, 0, 0)
+assert(world.set_chunk_data(0, 0, delta))
+assert(block.get(0, 100, 0) == stone)
+
+app.save_world()
+player.set_pos(pid, 1000, 100, 0)
+util.wait_until(function()
+    return block.get(0, 100, 0) == -1
+end, nil, "chunk is not unloaded")
+local saved, saved_revision = world.get_chunk_data(0, 0)
+assert(saved and saved_revision == nil)
+
+visit(0)
+block.set(0, 100, 0, 0)
+assert(world.set_chunk_data(0, 0, saved))
+assert(block.get(0, 100, 0) == stone)
+
+app.close_world(false)
+app.delete_world("demo")
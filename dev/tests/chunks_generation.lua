@@ -0,0 +1,47 @@
+-- Chunks generation throughput benchmark (chunks per second) depending on
+-- number of generator workers
+local util = require "core:tests_util"
+
+app.set_setting("chunks.load-distance", 12)
+app.set_setting("chunks.load-speed", 16)
+
+local STABLE_TICKS = 20
+
+local function generate_area()
+    local start = time.uptime()
+    local last_count = world.count_chunks()
+    local last_time = start
+    local initial_count = last_count
+    local stable_ticks = 0
+    while stable_ticks < STABLE_TICKS do
+        app.tick()
+        local count = world.count_chunks()
+        if count ~= last_count then
+            last_count = count
+            last_time = time.uptime()
+            stable_ticks = 0
+        else
+            stable_ticks = stable_ticks + 1
+        end
+    end
+    return last_count - initial_count, last_time - start
+end
+
+for _, workers in ipairs({0, 1, 2, 4, 8}) do
+    app.set_setting("chunks.generator-workers", workers)
+    util.create_demo_world()
+
+    local pid = player.create("Benchmark")
+    player.set_pos(pid, 10000, 100, 10000)
+
+    local count, elapsed = generate_area()
+    assert(count > 0)
+    print(string.format(
+        "workers: %s, chunks: %s, time: %.3fs, %.1f chunks/s",
+        workers, count, elapsed, count / math.max(elapsed, 1e-6)
+    ))
+
+    app.close_world(false)
+    app.delete_world("demo")
+end
+app.set_setting("chunks.generator-workers", 0)
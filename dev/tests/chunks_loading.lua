@@ -0,0 +1,39 @@
+-- Saved chunks loading with background region reading enabled and disabled
+local util = require "core:tests_util"
+
+app.set_setting("chunks.load-distance", 12)
+app.set_setting("chunks.load-speed", 16)
+
+local X, Y, Z = 5000, 100, 5000
+
+local function wait_loaded()
+    local start = time.uptime()
+    util.wait_for_chunk(X, Y, Z)
+    return time.uptime() - start
+end
+
+for _, workers in ipairs({0, 2}) do
+    app.set_setting("chunks.loader-workers", workers)
+    util.create_demo_world()
+
+    local pid = player.create("Loader")
+    player.set_pos(pid, X, Y, Z)
+    wait_loaded()
+
+    local stone = block.index("base:stone")
+    block.set(X, Y, Z, stone)
+    app.close_world(true)
+
+    app.open_world("demo")
+    pid = player.create("Loader2")
+    player.set_pos(pid, X, Y, Z)
+    local elapsed = wait_loaded()
+    assert(block.get(X, Y, Z) == stone)
+    print(string.format(
+        "workers: %s, loaded in %.3fs", workers, elapsed
+    ))
+
+    app.close_world(false)
+    app.delete_world("demo")
+end
+app.set_setting("chunks.loader-workers", 2)
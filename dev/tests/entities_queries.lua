@@ -0,0 +1,61 @@
+-- Entities area queries after spawn, moving between grid cells and despawn
+local util = require "core:tests_util"
+
+app.set_setting("chunks.load-distance", 3)
+util.create_demo_world()
+
+local X, Y, Z = 0, 200, 0
+local pid = player.create("Observer")
+player.set_pos(pid, X, Y, Z)
+util.wait_for_chunk(X, Y, Z)
+
+local function spawn(x, y, z)
+    local entity = entities.spawn("base:falling_block", {x, y, z}, {
+        base__falling_block={block="base:stone"}
+    })
+    entity.rigidbody:set_enabled(false)
+    return entity
+end
+
+local function contains(list, uid)
+    for _, value in ipairs(list) do
+        if value == uid then
+            return true
+        end
+    end
+    return false
+end
+
+local a = spawn(X + 0.5, Y, Z + 0.5)
+local b = spawn(X + 40.5, Y, Z + 0.5)
+
+local found = entities.get_all_in_box({X, Y - 1, Z}, {2, 2, 2})
+assert(contains(found, a:get_uid()))
+assert(not contains(found, b:get_uid()))
+
+found = entities.get_all_in_radius({X + 40, Y, Z}, 2)
+assert(contains(found, b:get_uid()))
+assert(not contains(found, a:get_uid()))
+
+-- move to another cell
+a.transform:set_pos({X - 100.5, Y, Z - 33.5})
+found = entities.get_all_in_box({X, Y - 1, Z}, {2, 2, 2})
+assert(not contains(found, a:get_uid()))
+found = entities.get_all_in_radius({X - 100, Y, Z - 33}, 1.5)
+assert(contains(found, a:get_uid()))
+
+-- large area covers all entities
+found = entities.get_all_in_box({X - 1000, 0, Z - 1000}, {2000, 256, 2000})
+assert(contains(found, a:get_uid()))
+assert(contains(found, b:get_uid()))
+
+local ray = entities.raycast({X + 30.5, Y, Z + 0.5}, {1, 0, 0}, 20)
+assert(ray and ray.entity == b:get_uid())
+
+b:despawn()
+app.tick()
+found = entities.get_all_in_radius({X + 40, Y, Z}, 2)
+assert(not contains(found, b:get_uid()))
+
+app.close_world(false)
+app.delete_world("demo")
@@ -0,0 +1,39 @@
+-- Many concurrent clients of a single server
+local CLIENTS = 200
+local PORT = 7646
+
+local text = ""
+for i = 1, 1000 do
+    text = text .. math.random(0, 9)
+end
+
+local received = 0
+local server = network.tcp_open(PORT, function (client)
+    start_coroutine(function()
+        local received_text = ""
+        while client:is_alive() and #received_text < #text do
+            local bytes = client:recv(4096)
+            if bytes then
+                received_text = received_text .. utf8.tostring(bytes)
+            end
+            coroutine.yield()
+        end
+        asserts.equals(text, received_text)
+        received = received + 1
+    end, "client-listener")
+end)
+
+local connected = 0
+for i = 1, CLIENTS do
+    network.tcp_connect("localhost", PORT, function (socket)
+        connected = connected + 1
+        -- data is sent in background, close waits for it
+        socket:send(text)
+        socket:close()
+    end)
+end
+
+app.sleep_until(function () return received == CLIENTS end, nil, 10)
+debug.log(string.format("%s clients connected, %s received", connected, received))
+assert(received == CLIENTS)
+server:close()
@@ -0,0 +1,69 @@
+-- Async routes found by workers are the same as sync routes
+local util = require "core:tests_util"
+
+app.set_setting("chunks.load-distance", 3)
+app.set_setting("pathfinding.workers", 2)
+util.create_demo_world()
+
+local X, Z = 0, 0
+local pid = player.create("Observer")
+player.set_pos(pid, X, 200, Z)
+util.wait_for_chunk(X, 0, Z)
+
+local function surface(x, z)
+    for y = 255, 1, -1 do
+        if block.is_solid_at(x, y - 1, z) then
+            return y
+        end
+    end
+    return 0
+end
+
+local function assert_routes_equal(a, b)
+    assert(a and b)
+    assert(#a == #b, string.format("%s ~= %s", #a, #b))
+    for i = 1, #a do
+        assert(a[i][1] == b[i][1] and a[i][2] == b[i][2] and a[i][3] == b[i][3])
+    end
+end
+
+local function find_async(agent, start, target)
+    pathfinding.make_route_async(agent, start, target)
+    local route
+    repeat
+        app.tick()
+        route = pathfinding.pull_route(agent)
+    until route
+    return route
+end
+
+local agent = pathfinding.create_agent()
+pathfinding.set_max_visited(agent, 5000)
+
+local start = {X, surface(X, Z), Z}
+local target = {X + 20, surface(X + 20, Z + 20), Z + 20}
+
+local syncRoute = pathfinding.make_route(agent, start, target)
+local asyncRoute = find_async(agent, start, target)
+assert_routes_equal(syncRoute, asyncRoute)
+print("route length", #syncRoute, "visited", syncRoute.total_visited)
+
+-- modified chunks snapshots are rebuilt
+for y = 0, 255 do
+    for z = -10, 30 do
+        block.set(X + 10, y, z, block.index("base:stone"))
+    end
+end
+asyncRoute = find_async(agent, start, target)
+syncRoute = pathfinding.make_route(agent, start, target)
+assert_routes_equal(syncRoute, asyncRoute)
+for _, pos in ipairs(asyncRoute) do
+    assert(pos[1] ~= X + 10 or pos[3] < -10 or pos[3] > 30)
+end
+
+-- search restarted before finish delivers the last route only
+pathfinding.make_route_async(agent, start, {X - 20, 0, Z})
+asyncRoute = find_async(agent, start, target)
+assert_routes_equal(syncRoute, asyncRoute)
+
+pathfinding.remove_agent(agent)
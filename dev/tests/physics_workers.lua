@@ -0,0 +1,71 @@
+-- Entities physics with solid bodies crowded in clusters.
+-- Results must not depend on physics workers count
+local util = require "core:tests_util"
+
+app.set_setting("chunks.load-distance", 3)
+
+local X, Y, Z = 0, 200, 0
+local CLUSTERS = 4
+local CLUSTER_SIDE = 4
+local CLUSTER_STEP = 12
+local TICKS = 20
+
+local function spawn_cluster(cx, cz, first)
+    for i = 0, CLUSTER_SIDE * CLUSTER_SIDE - 1 do
+        local x = X + cx * CLUSTER_STEP + (i % CLUSTER_SIDE) * 1.2
+        local z = Z + cz * CLUSTER_STEP + math.floor(i / CLUSTER_SIDE) * 1.2
+        local body = entities.spawn("base:falling_block", {x, Y, z}, {
+            base__falling_block={block="base:stone"}
+        }).rigidbody
+        local n = first + i
+        body:set_gravity_scale(0.0)
+        body:set_vel({math.sin(n * 12.9898) * 2, 0, math.cos(n * 78.233) * 2})
+    end
+end
+
+local function run(workers)
+    app.set_setting("physics.workers", workers)
+    util.create_demo_world()
+
+    local pid = player.create("Observer")
+    player.set_pos(pid, X, Y, Z)
+    util.wait_for_chunk(X, Y, Z)
+
+    local bodies = {}
+    local count = 0
+    for cz = 0, CLUSTERS - 1 do
+        for cx = 0, CLUSTERS - 1 do
+            spawn_cluster(cx, cz, count)
+            count = count + CLUSTER_SIDE * CLUSTER_SIDE
+        end
+    end
+    app.tick()
+
+    local start = time.uptime()
+    for _ = 1, TICKS do
+        app.tick()
+    end
+    local elapsed = time.uptime() - start
+    debug.log(string.format(
+        "workers: %s, %s bodies, %.3f ms per tick",
+        workers, count, elapsed / TICKS * 1000
+    ))
+
+    local positions = {}
+    for _, entity in pairs(entities.get_all()) do
+        positions[entity:get_uid()] = entity.transform:get_pos()
+    end
+    app.close_world(false)
+    app.delete_world("demo")
+    return positions
+end
+
+local prev_workers = app.get_setting("physics.workers")
+local expected = run(0)
+local actual = run(4)
+for uid, pos in pairs(expected) do
+    local other = actual[uid]
+    assert(other ~= nil)
+    assert(pos[1] == other[1] and pos[2] == other[2] and pos[3] == other[3])
+end
+app.set_setting("physics.workers", prev_workers)
@@ -0,0 +1,45 @@
+-- In-memory regions cache limited by a small budget
+local util = require "core:tests_util"
+
+app.set_setting("chunks.load-distance", 3)
+app.set_setting("chunks.regions-cache-size", 1)
+util.create_demo_world()
+
+local info = world.get_regions_cache_info()
+assert(info.budget == 1024 * 1024)
+
+local pid = player.create("Explorer")
+local stone = block.index("base:stone")
+local REGION_BLOCKS = 512
+
+local function visit(x)
+    player.set_pos(pid, x, 100, 0)
+    util.wait_for_chunk(x, 100, 0)
+end
+
+for i = 0, 7 do
+    local x = i * REGION_BLOCKS
+    visit(x)
+    block.set(x, 100, 0, stone)
+end
+app.save_world()
+
+info = world.get_regions_cache_info()
+print(string.format(
+    "regions cache: %s B resident, %s evictions",
+    info.resident, info.evictions
+))
+assert(info.resident <= info.budget)
+assert(info.evictions > 0)
+
+-- evicted regions are read from files again
+for i = 0, 7 do
+    local x = i * REGION_BLOCKS
+    visit(x)
+    assert(block.get(x, 100, 0) == stone)
+end
+assert(world.get_regions_cache_info().misses > info.misses)
+
+app.close_world(false)
+app.delete_world("demo")
+app.set_setting("chunks.regions-cache-size", 256)
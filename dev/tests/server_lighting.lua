@@ -0,0 +1,50 @@
+-- Chunks lighting in headless mode with lights saved to regions
+local util = require "core:tests_util"
+
+app.set_setting("chunks.load-distance", 6)
+app.set_setting("chunks.server-lighting", true)
+util.create_demo_world()
+
+local X, Y, Z = 0, 120, 0
+local pid = player.create("Lighting")
+player.set_pos(pid, X, Y, Z)
+util.wait_for_chunk(X, Y, Z)
+for _ = 1, 20 do
+    app.tick()
+end
+
+-- lights are built for loaded chunks
+local _, _, _, sky = block.get_light(X, Y, Z)
+assert(sky == 15)
+
+-- incremental lights update on block changes
+local lamp = block.index("base:lamp")
+block.set(X, Y, Z, lamp)
+app.tick()
+assert(block.get_light(X + 1, Y, Z) == 14)
+
+block.set(X, Y, Z, 0)
+app.tick()
+assert(block.get_light(X + 1, Y, Z) == 0)
+
+block.set(X, Y, Z, lamp)
+app.tick()
+local lights = {block.get_light(X + 1, Y, Z)}
+
+-- saved lights are loaded back
+app.close_world(true)
+app.open_world("demo")
+pid = player.create("Lighting2")
+player.set_pos(pid, X, Y, Z)
+util.wait_for_chunk(X, Y, Z)
+for _ = 1, 20 do
+    app.tick()
+end
+assert(block.get(X, Y, Z) == lamp)
+local loaded = {block.get_light(X + 1, Y, Z)}
+for i = 1, 4 do
+    assert(loaded[i] == lights[i])
+end
+app.close_world(false)
+app.delete_world("demo")
+app.set_setting("chunks.server-lighting", false)
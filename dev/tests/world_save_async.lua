@@ -0,0 +1,39 @@
+-- Background world saving
+local util = require "core:tests_util"
+util.create_demo_world()
+
+app.set_setting("chunks.load-distance", 8)
+
+local pid = player.create("Saver")
+player.set_pos(pid, 0, 100, 0)
+util.wait_for_chunk(0, 100, 0)
+local stone = block.index("base:stone")
+block.set(0, 100, 0, stone)
+
+local finished = false
+assert(app.save_world_async(function(success)
+    assert(success)
+    finished = true
+end))
+assert(not app.save_world_async())
+
+-- modified while saving
+block.set(1, 100, 0, stone)
+
+while not finished do
+    local progress = app.get_save_progress()
+    assert(progress == nil or (progress >= 0.0 and progress <= 1.0))
+    app.tick()
+end
+assert(app.get_save_progress() == nil)
+
+app.close_world(true)
+app.open_world("demo")
+pid = player.create("Saver2")
+player.set_pos(pid, 0, 100, 0)
+util.wait_for_chunk(0, 100, 0)
+assert(block.get(0, 100, 0) == stone)
+assert(block.get(1, 100, 0) == stone)
+
+app.close_world(false)
+app.delete_world("demo")
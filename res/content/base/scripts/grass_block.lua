@@ -18,3 +18,13 @@ function on_random_update(x, y, z)
         end
     end
 end
+
+function on_random_update_batch(positions)
+    local grassblockid = block.index('base:grass_block')
+    for i=1, #positions, 3 do
+        local x, y, z = positions[i], positions[i + 1], positions[i + 2]
+        if block.get(x, y, z) == grassblockid then
+            on_random_update(x, y, z)
+        end
+    end
+end
@@ -215,6 +215,10 @@ FFIBytearray = {
 }
 table.merge(FFIBytearray, bytearray_methods)
 
+local function FFIBytearray_is(value)
+    return FFI.istype(bytearray_type, value)
+end
+
 local function FFIBytearray_as_string(bytes)
     local t = type(bytes)
     if t == "cdata" then
@@ -283,6 +287,7 @@ local FFIU32view = create_FFIview_class("FFIU32view", "uint32_t", 4)
 return {
     FFIBytearray = setmetatable(FFIBytearray, FFIBytearray),
     FFIBytearray_as_string = FFIBytearray_as_string,
+    FFIBytearray_is = FFIBytearray_is,
     FFIU16view = FFIU16view,
     FFII16view = FFII16view,
     FFIU32view = FFIU32view,
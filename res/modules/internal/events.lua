@@ -36,7 +36,7 @@ function events.remove_by_prefix(prefix)
     end
 end
 
-function events.emit(event, ...)
+local function emit(event, ...)
     local result = nil
     local handlers = events.handlers[event]
     if handlers == nil then
@@ -52,4 +52,14 @@ function events.emit(event, ...)
     end
     return result
 end
+events.emit = emit
+
+--- Get function emitting the event. Used by the engine to resolve
+--- events once instead of passing event name on every emit
+function events.handle(event)
+    return function(...)
+        return emit(event, ...)
+    end
+end
+
 return events
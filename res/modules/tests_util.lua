@@ -5,4 +5,25 @@ function util.create_demo_world(generator)
     app.new_world("demo", "2019", generator or "core:default")
 end
 
+--- Tick until the condition is met. Raises an error on timeout.
+--- @param condition function returning true when the wait is over
+--- @param timeout limit in seconds (30 by default)
+--- @param what description used in the timeout error message
+function util.wait_until(condition, timeout, what)
+    local deadline = time.uptime() + (timeout or 30)
+    while not condition() do
+        if time.uptime() > deadline then
+            error("timeout: " .. (what or "condition is not met"))
+        end
+        app.tick()
+    end
+end
+
+--- Tick until the chunk containing the block position is loaded
+function util.wait_for_chunk(x, y, z, timeout)
+    util.wait_until(function()
+        return block.get(x, y, z) ~= -1
+    end, timeout, string.format("chunk at %s, %s, %s is not loaded", x, y, z))
+end
+
 return util
@@ -38,6 +38,8 @@ end
 
 local Socket = {__index={
     send=function(self, ...) return network.__send(self.id, ...) end,
+    queue=function(self, ...) return network.__queue(self.id, ...) end,
+    flush=function(self) return network.__flush(self.id) end,
     recv=function(self, ...) return network.__recv(self.id, ...) end,
     recv_async=function(self, length, usetable)
         while self:is_alive() do
@@ -60,6 +62,8 @@ local Socket = {__index={
 
 local WriteableSocket = {__index={
     send=function(self, ...) return network.__send(self.id, ...) end,
+    queue=function(self, ...) return network.__queue(self.id, ...) end,
+    flush=function(self) return network.__flush(self.id) end,
     close=function(self) return network.__close(self.id) end,
     is_open=function(self) return network.__is_alive(self.id) end,
     get_address=function(self) return network.__get_address(self.id) end,
@@ -75,7 +79,9 @@ local DatagramServerSocket = {__index={
     close=function(self) return network.__closeserver(self.id) end,
     is_open=function(self) return network.__is_serveropen(self.id) end,
     get_port=function(self) return network.__get_serverport(self.id) end,
-    send=function(self, ...) return network.__udp_server_send_to(self.id, ...) end
+    send=function(self, ...) return network.__udp_server_send_to(self.id, ...) end,
+    queue=function(self, ...) return network.__udp_server_queue_to(self.id, ...) end,
+    flush=function(self) return network.__flushserver(self.id) end,
 }}
 
 local _tcp_server_callbacks = {}
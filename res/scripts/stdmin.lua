@@ -280,6 +280,7 @@ require "core:internal/extensions/string"
 local bytearray = require "core:internal/bytearray"
 Bytearray = bytearray.FFIBytearray
 Bytearray_as_string = bytearray.FFIBytearray_as_string
+Bytearray_is = bytearray.FFIBytearray_is
 U16view = bytearray.FFIU16view
 I16view = bytearray.FFII16view
 U32view = bytearray.FFIU32view
@@ -0,0 +1,35 @@
+#ifndef CHUNK_VERTEX_GLSL_
+#define CHUNK_VERTEX_GLSL_
+
+// Chunk vertex attributes decoding.
+// Compact vertices (COMPACT_CHUNK_VERTEX) have position multiplied by 64
+// and normal with emission packed into position w component:
+// 4 bits per normal axis (n * 7 + 7) and 4 bits of emission (e * 15).
+// The w component is read as a signed short, so the highest emission bit
+// makes it negative.
+
+#ifdef COMPACT_CHUNK_VERTEX
+#define CHUNK_POSITION_SCALE 64.0
+
+vec3 chunk_vertex_position(vec4 position) {
+    return position.xyz / CHUNK_POSITION_SCALE;
+}
+
+// Returns normal in the same form as the regular vertex attribute
+// (xyz in range [0, 1], w is emission)
+vec4 chunk_vertex_normal(vec4 position, vec4 normal) {
+    float value = position.w < 0.0 ? position.w + 65536.0 : position.w;
+    vec3 axes = mod(floor(value / vec3(1.0, 16.0, 256.0)), 16.0);
+    return vec4(axes / 14.0, floor(value / 4096.0) / 15.0);
+}
+#else
+vec3 chunk_vertex_position(vec4 position) {
+    return position.xyz;
+}
+
+vec4 chunk_vertex_normal(vec4 position, vec4 normal) {
+    return normal;
+}
+#endif
+
+#endif // CHUNK_VERTEX_GLSL_
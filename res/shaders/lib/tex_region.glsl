@@ -0,0 +1,51 @@
+#ifndef TEX_REGION_GLSL_
+#define TEX_REGION_GLSL_
+
+// Merged (greedy meshed) chunk quads have negative u coordinate with
+// the atlas region packed as pixel coordinates:
+// u = -(u1 * 4096 + u2) - 1, v = v1 * 4096 + v2
+// Texture is tiled once per block along the face axes.
+
+#define TEX_REGION_BASE 4096.0
+
+// Returns (u1, v1, u2, v2) or vec4(-1.0) if texture coord is not packed
+vec4 decode_tex_region(vec2 texCoord, ivec2 atlasSize) {
+    if (texCoord.x >= 0.0) {
+        return vec4(-1.0);
+    }
+    vec2 value = vec2(-texCoord.x - 1.0, texCoord.y);
+    vec2 first = floor(value / TEX_REGION_BASE);
+    vec2 second = value - first * TEX_REGION_BASE;
+    vec2 size = vec2(atlasSize);
+    return vec4(first / size, second / size);
+}
+
+// Block face coordinates along the face texture axes
+vec2 face_coord(vec3 pos, vec3 normal) {
+    if (abs(normal.y) > 0.5) {
+        return vec2(pos.x, -sign(normal.y) * pos.z);
+    } else if (abs(normal.x) > 0.5) {
+        return vec2(-sign(normal.x) * pos.z, pos.y);
+    }
+    return vec2(sign(normal.z) * pos.x, pos.y);
+}
+
+#ifdef TEX_REGION_SAMPLING
+vec4 sample_tex_region(
+    sampler2D tex, vec2 texCoord, vec4 region, vec3 facePos, vec3 normal
+) {
+    if (region.x < 0.0) {
+        return texture(tex, texCoord);
+    }
+    vec2 local = face_coord(facePos, normal);
+    vec2 size = region.zw - region.xy;
+    return textureGrad(
+        tex,
+        region.xy + fract(local) * size,
+        dFdx(local) * size,
+        dFdy(local) * size
+    );
+}
+#endif
+
+#endif // TEX_REGION_GLSL_
@@ -152,7 +152,7 @@ size_t extrle::decode16(const ubyte* src, size_t srclen, ubyte* dst8, size_t dst
         if (widechar) {
             c |= ((static_cast<uint>(src[i++])) << 8);
         }
-        if (offset + len >= dstLength) {
+        if (offset + len >= dstLength / 2) {
             throw std::runtime_error("buffer overflow");
         }
         for (size_t j = 0; j <= len; j++) {
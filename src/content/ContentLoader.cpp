@@ -442,7 +442,8 @@ static void load_script(const Content& content, T& def) {
             scriptfile,
             def.scriptFile,
             def.rt.funcsset,
-            def.rt.eventNames
+            def.rt.eventNames,
+            def.rt.eventHandles
         );
     }
 }
@@ -472,7 +473,8 @@ void ContentLoader::loadWorldScript(ContentPackRuntime& runtime) {
             pack.id,
             scriptFile,
             pack.id + ":scripts/world.lua",
-            runtime.worldfuncsset
+            runtime.worldfuncsset,
+            runtime.worldeventhandles
         );
     }
 }
@@ -129,12 +129,28 @@ struct WorldFuncsSet {
     bool oninventoryclosed;
 };
 
+/// @brief Pre-resolved world script events handles
+/// (see lua::get_event_handle). 0 - event is not defined by the script
+struct WorldEventHandles {
+    int blockplaced = 0;
+    int blockreplaced = 0;
+    int blockbreaking = 0;
+    int blockbroken = 0;
+    int blockinteract = 0;
+    int playertick = 0;
+    int chunkpresent = 0;
+    int chunkremove = 0;
+    int inventoryopen = 0;
+    int inventoryclosed = 0;
+};
+
 class ContentPackRuntime {
     ContentPack info;
     ContentPackStats stats {};
     scriptenv env;
 public:
     WorldFuncsSet worldfuncsset {};
+    WorldEventHandles worldeventhandles {};
 
     ContentPackRuntime(ContentPack info, scriptenv env);
     ~ContentPackRuntime();
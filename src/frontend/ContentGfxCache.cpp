@@ -7,6 +7,7 @@
 #include "content/Content.hpp"
 #include "content/ContentPack.hpp"
 #include "graphics/core/Atlas.hpp"
+#include "graphics/core/Texture.hpp"
 #include "maths/UVRegion.hpp"
 #include "voxels/Block.hpp"
 #include "debug/Logger.hpp"
@@ -85,6 +86,8 @@ void ContentGfxCache::refresh() {
 
     sideregions = std::make_unique<UVRegion[]>(size);
     const auto& atlas = assets.require<Atlas>("blocks");
+    const auto& texture = *atlas.getTexture();
+    atlasSize = {texture.getWidth(), texture.getHeight()};
 
     const auto& blocks = indices->blocks.getIterable();
     for (blockid_t i = 0; i < blocks.size(); i++) {
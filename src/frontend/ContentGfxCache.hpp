@@ -28,6 +28,8 @@ class ContentGfxCache {
     // array of block sides uv regions (6 per block)
     std::unique_ptr<UVRegion[]> sideregions;
     std::unordered_map<uint64_t, model::Model> models;
+    /// @brief Blocks atlas size in pixels
+    glm::ivec2 atlasSize {};
     
     static inline uint64_t modelKey(blockid_t id, uint8_t variant) {
         return (uint64_t(id) << 8) | uint64_t(variant & 0xFF);
@@ -59,6 +61,10 @@ public:
 
     const model::Model& getModel(blockid_t id, uint8_t variant) const;
 
+    const glm::ivec2& getAtlasSize() const {
+        return atlasSize;
+    }
+
     void refresh(const Block& block, const Atlas& atlas);
 
     void refresh();
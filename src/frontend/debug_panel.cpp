@@ -30,6 +30,7 @@
 #include "voxels/GlobalChunks.hpp"
 #include "world/Level.hpp"
 #include "world/World.hpp"
+#include "world/files/WorldFiles.hpp"
 
 #include <bitset>
 #include <memory>
@@ -175,7 +176,17 @@ std::shared_ptr<UINode> create_debug_panel(
     }));
     panel->add(create_label(gui, [&]() {
         return L"chunks: " + std::to_wstring(level.chunks->size()) +
-               L" visible: " + std::to_wstring(ChunksRenderer::visibleChunks);
+               L" visible: " + std::to_wstring(ChunksRenderer::visibleChunks) +
+               L" meshes: " +
+               std::to_wstring(ChunksRenderer::meshesMemory / 1024) + L" KB";
+    }));
+    panel->add(create_label(gui, [&]() {
+        const auto& stats =
+            level.getWorld()->wfile->getRegions().getCacheStats();
+        return L"regions: " + std::to_wstring(stats.residentBytes / 1024) +
+               L" KB hits: " + std::to_wstring(stats.hits) +
+               L" misses: " + std::to_wstring(stats.misses) +
+               L" evicted: " + std::to_wstring(stats.evictions);
     }));
     panel->add(create_label(gui, [&]() {
         return L"entities: " + std::to_wstring(level.entities->size()) +
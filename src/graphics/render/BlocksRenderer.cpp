@@ -1,5 +1,7 @@
 #include "BlocksRenderer.hpp"
 
+#include <algorithm>
+
 #include "graphics/core/Mesh.hpp"
 #include "graphics/commons/Model.hpp"
 #include "maths/UVRegion.hpp"
@@ -12,19 +14,99 @@
 const glm::vec3 BlocksRenderer::SUN_VECTOR(0.528265, 0.833149, -0.163704);
 const float DIRECTIONAL_LIGHT_FACTOR = 0.3f;
 
+/// @brief Max atlas pixel coordinate that may be packed to tiling UV
+static constexpr int MAX_PACKED_COORD = 4095;
+
+struct CubeFace {
+    glm::ivec3 X, Y, Z;
+    int texture;
+};
+
+/// @brief Faces of not rotated cube as emitted by blockCube
+static const CubeFace CUBE_FACES[6] {
+    {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}, 5},
+    {{-1, 0, 0}, {0, 1, 0}, {0, 0, -1}, 4},
+    {{1, 0, 0}, {0, 0, -1}, {0, 1, 0}, 3},
+    {{1, 0, 0}, {0, 0, 1}, {0, -1, 0}, 2},
+    {{0, 0, -1}, {0, 1, 0}, {1, 0, 0}, 1},
+    {{0, 0, 1}, {0, 1, 0}, {-1, 0, 0}, 0},
+};
+
+static inline std::array<uint8_t, 4> pack_color(const glm::vec4& light) {
+    return {
+        static_cast<uint8_t>(light.r * 255),
+        static_cast<uint8_t>(light.g * 255),
+        static_cast<uint8_t>(light.b * 255),
+        static_cast<uint8_t>(light.a * 255),
+    };
+}
+
+static inline std::array<uint8_t, 4> pack_normal(
+    const glm::vec3& normal, float emission
+) {
+    return {
+        static_cast<uint8_t>(normal.x * 127 + 128),
+        static_cast<uint8_t>(normal.y * 127 + 128),
+        static_cast<uint8_t>(normal.z * 127 + 128),
+        static_cast<uint8_t>(emission * 255)
+    };
+}
+
+static inline int16_t pack_coord(float value) {
+    return static_cast<int16_t>(std::clamp(
+        std::round(value * CompactChunkVertex::POSITION_SCALE),
+        -32768.0f,
+        32767.0f
+    ));
+}
+
+static inline int16_t pack_compact_normal(
+    const glm::vec3& normal, float emission
+) {
+    auto axis = [](float value) {
+        return static_cast<int>(std::round(value * 7.0f)) + 7;
+    };
+    // emission takes the sign bit
+    return static_cast<int16_t>(static_cast<uint16_t>(
+        axis(normal.x) | axis(normal.y) << 4 | axis(normal.z) << 8 |
+        static_cast<int>(std::round(emission * 15.0f)) << 12
+    ));
+}
+
+static inline uint16_t pack_uv(float value) {
+    return static_cast<uint16_t>(
+        std::clamp(value, 0.0f, 1.0f) * 65535.0f + 0.5f
+    );
+}
+
+static inline bool is_greedy_candidate(const Block& def, blockstate state) {
+    if (!def.rotatable) {
+        return true;
+    }
+    const auto& axes = def.rotations.variants[state.rotation].axes;
+    return axes[0] == glm::ivec3(1, 0, 0) && axes[1] == glm::ivec3(0, 1, 0);
+}
+
 BlocksRenderer::BlocksRenderer(
     size_t capacity,
     const Content& content,
     const ContentGfxCache& cache,
-    const EngineSettings& settings
+    const EngineSettings& settings,
+    bool compactVertices
 ) : content(content),
     vertexBuffer(std::make_unique<ChunkVertex[]>(capacity)),
+    compactVertexBuffer(
+        compactVertices ? std::make_unique<CompactChunkVertex[]>(capacity)
+                        : nullptr
+    ),
     indexBuffer(std::make_unique<uint32_t[]>(capacity)),
     denseIndexBuffer(std::make_unique<uint32_t[]>(capacity)),
+    chunkVoxels(std::make_unique<voxel[]>(CHUNK_SECTION_VOL)),
     vertexCount(0),
     vertexOffset(0),
     indexCount(0),
     capacity(capacity),
+    compactVertices(compactVertices),
     cache(cache),
     settings(settings)
 {
@@ -42,21 +124,18 @@ void BlocksRenderer::vertex(
     const glm::vec3& normal,
     float emission
 ) {
-
+    if (compactPass) {
+        compactVertexBuffer[vertexCount++] = {
+            {pack_coord(coord.x),
+             pack_coord(coord.y),
+             pack_coord(coord.z),
+             pack_compact_normal(normal, emission)},
+            {pack_uv(u), pack_uv(v)},
+            pack_color(light)};
+        return;
+    }
     vertexBuffer[vertexCount++] = {
-        coord,
-        {u, v},
-        {
-            static_cast<uint8_t>(light.r * 255),
-            static_cast<uint8_t>(light.g * 255),
-            static_cast<uint8_t>(light.b * 255),
-            static_cast<uint8_t>(light.a * 255),
-        }, {
-            static_cast<uint8_t>(normal.x * 127 + 128),
-            static_cast<uint8_t>(normal.y * 127 + 128),
-            static_cast<uint8_t>(normal.z * 127 + 128),
-            static_cast<uint8_t>(emission * 255)
-        }
+        coord, {u, v}, pack_color(light), pack_normal(normal, emission)
     };
 }
 
@@ -451,6 +530,214 @@ void BlocksRenderer::blockCube(
     }
 }
 
+void BlocksRenderer::blockCubeGreedy(
+    const glm::ivec3& coord,
+    const UVRegion(&texfaces)[6],
+    const Block& block,
+    blockstate states,
+    bool lights,
+    bool ao
+) {
+    const auto& variant = block.getVariantByBits(states.userbits);
+    for (int i = 0; i < 6; i++) {
+        const auto& cubeFace = CUBE_FACES[i];
+        if (!isOpen(coord + cubeFace.Z, block, variant)) {
+            continue;
+        }
+        const auto& region = texfaces[cubeFace.texture];
+        if (recordGreedyFace(i, coord, region, lights, ao)) {
+            continue;
+        }
+        glm::vec3 X(cubeFace.X);
+        glm::vec3 Y(cubeFace.Y);
+        glm::vec3 Z(cubeFace.Z);
+        if (ao) {
+            faceAO(coord, X, Y, Z, region, lights);
+        } else {
+            face(
+                coord,
+                X,
+                Y,
+                Z,
+                region,
+                lights ? pickLight(coord + cubeFace.Z) : glm::vec4(1, 1, 1, 0),
+                lights
+            );
+        }
+    }
+}
+
+bool BlocksRenderer::packRegion(const UVRegion& region, glm::vec2& dst) const {
+    const auto& size = cache.getAtlasSize();
+    int u1 = std::round(region.u1 * size.x);
+    int u2 = std::round(region.u2 * size.x);
+    int v1 = std::round(region.v1 * size.y);
+    int v2 = std::round(region.v2 * size.y);
+    if (std::min({u1, u2, v1, v2}) < 0 ||
+        std::max({u1, u2, v1, v2}) > MAX_PACKED_COORD) {
+        return false;
+    }
+    // both values are exact in float (24 bits)
+    constexpr int base = MAX_PACKED_COORD + 1;
+    dst = glm::vec2(-(u1 * base + u2) - 1, v1 * base + v2);
+    return true;
+}
+
+bool BlocksRenderer::recordGreedyFace(
+    int direction,
+    const glm::ivec3& coord,
+    const UVRegion& region,
+    bool lights,
+    bool ao
+) {
+    const auto& cubeFace = CUBE_FACES[direction];
+    glm::vec3 X(cubeFace.X);
+    glm::vec3 Y(cubeFace.Y);
+    glm::vec3 Z(cubeFace.Z);
+
+    GreedyFace greedyFace {greedyGeneration};
+    if (!packRegion(region, greedyFace.uv)) {
+        return false;
+    }
+    // same light calculation as in faceAO and face
+    if (ao && lights) {
+        float d = glm::dot(Z, SUN_VECTOR);
+        d = (1.0f - DIRECTIONAL_LIGHT_FACTOR) + d * DIRECTIONAL_LIGHT_FACTOR;
+        const glm::vec3 corners[4] {
+            -X - Y + Z, X - Y + Z, X + Y + Z, -X + Y + Z
+        };
+        for (int i = 0; i < 4; i++) {
+            auto pos = glm::vec3(coord) + corners[i] * 0.5f + Z * 0.5f +
+                       (X + Y) * 0.5f;
+            auto light = pickSoftLight(
+                glm::ivec3(
+                    std::round(pos.x), std::round(pos.y), std::round(pos.z)
+                ),
+                cubeFace.X,
+                cubeFace.Y
+            );
+            auto color = pack_color(light * d);
+            if (i == 0) {
+                greedyFace.color = color;
+            } else if (color != greedyFace.color) {
+                return false;
+            }
+        }
+        greedyFace.normal = pack_normal(Z, 0.0f);
+    } else if (ao) {
+        greedyFace.color = pack_color(glm::vec4(1.0f));
+        greedyFace.normal = pack_normal(Z, 1.0f);
+    } else {
+        glm::vec4 tint =
+            lights ? pickLight(coord + cubeFace.Z) : glm::vec4(1, 1, 1, 0);
+        if (lights) {
+            float d = glm::dot(Z, SUN_VECTOR);
+            tint *= (1.0f - DIRECTIONAL_LIGHT_FACTOR) +
+                    d * DIRECTIONAL_LIGHT_FACTOR;
+        }
+        greedyFace.color = pack_color(tint);
+        greedyFace.normal = pack_normal(Z, lights ? 0.0f : 1.0f);
+    }
+    int index = ((coord.y - sectionY) * CHUNK_D + coord.z) * CHUNK_W + coord.x;
+    greedyFaces[direction * CHUNK_SECTION_VOL + index] = greedyFace;
+    return true;
+}
+
+void BlocksRenderer::flushGreedyFaces() {
+    const int sizes[3] {CHUNK_W, CHUNK_SECTION_H, CHUNK_D};
+    auto faceAt = [this](int direction, const glm::ivec3& pos) -> GreedyFace& {
+        int index = (pos.y * CHUNK_D + pos.z) * CHUNK_W + pos.x;
+        return greedyFaces[direction * CHUNK_SECTION_VOL + index];
+    };
+    auto matches = [this](const GreedyFace& a, const GreedyFace& b) {
+        return a.generation == greedyGeneration && a.uv == b.uv &&
+               a.color == b.color && a.normal == b.normal;
+    };
+    for (int direction = 0; direction < 6; direction++) {
+        const auto& cubeFace = CUBE_FACES[direction];
+        int normalAxis = cubeFace.Z.x ? 0 : (cubeFace.Z.y ? 1 : 2);
+        int axisA = (normalAxis + 1) % 3;
+        int axisB = (normalAxis + 2) % 3;
+        glm::ivec3 stepA {};
+        glm::ivec3 stepB {};
+        stepA[axisA] = 1;
+        stepB[axisB] = 1;
+
+        for (int slice = 0; slice < sizes[normalAxis]; slice++) {
+            for (int b = 0; b < sizes[axisB]; b++) {
+                for (int a = 0; a < sizes[axisA]; a++) {
+                    glm::ivec3 pos {};
+                    pos[normalAxis] = slice;
+                    pos[axisA] = a;
+                    pos[axisB] = b;
+                    auto& first = faceAt(direction, pos);
+                    if (first.generation != greedyGeneration) {
+                        continue;
+                    }
+                    GreedyFace greedyFace = first;
+                    int width = 1;
+                    while (a + width < sizes[axisA] &&
+                           matches(
+                               faceAt(direction, pos + stepA * width),
+                               greedyFace
+                           )) {
+                        width++;
+                    }
+                    int height = 1;
+                    for (; b + height < sizes[axisB]; height++) {
+                        bool rowMatches = true;
+                        for (int i = 0; i < width && rowMatches; i++) {
+                            rowMatches = matches(
+                                faceAt(
+                                    direction, pos + stepA * i + stepB * height
+                                ),
+                                greedyFace
+                            );
+                        }
+                        if (!rowMatches) {
+                            break;
+                        }
+                    }
+                    for (int j = 0; j < height; j++) {
+                        for (int i = 0; i < width; i++) {
+                            faceAt(direction, pos + stepA * i + stepB * j)
+                                .generation = 0;
+                        }
+                    }
+                    if (vertexCount + 4 >= capacity ||
+                        indexCount + 6 >= capacity) {
+                        overflow = true;
+                        return;
+                    }
+                    glm::ivec3 min = pos + glm::ivec3(0, sectionY, 0);
+                    glm::ivec3 max =
+                        min + stepA * (width - 1) + stepB * (height - 1);
+                    const glm::ivec3 signs[4] {
+                        -cubeFace.X - cubeFace.Y,
+                        cubeFace.X - cubeFace.Y,
+                        cubeFace.X + cubeFace.Y,
+                        -cubeFace.X + cubeFace.Y,
+                    };
+                    for (const auto& sign : signs) {
+                        glm::ivec3 corner(
+                            sign.x > 0 ? max.x : min.x,
+                            sign.y > 0 ? max.y : min.y,
+                            sign.z > 0 ? max.z : min.z
+                        );
+                        vertexBuffer[vertexCount++] = {
+                            glm::vec3(corner) +
+                                glm::vec3(sign + cubeFace.Z) * 0.5f,
+                            greedyFace.uv,
+                            greedyFace.color,
+                            greedyFace.normal};
+                    }
+                    index(0, 1, 2, 0, 2, 3);
+                }
+            }
+        }
+    }
+}
+
 glm::vec4 BlocksRenderer::pickLight(int x, int y, int z) const {
     light_t light = voxelsBuffer->pickLight(
         chunk->x * CHUNK_W + x, y, chunk->z * CHUNK_D + z
@@ -493,6 +780,9 @@ void BlocksRenderer::render(
             continue;
         }
         int end = beginEnds[drawGroup][1];
+        if (greedyMeshing && ++greedyGeneration == 0) {
+            greedyGeneration = 1;
+        }
         for (int i = begin-1; i <= end; i++) {
             const voxel& vox = voxels[i];
             blockid_t id = vox.id;
@@ -518,10 +808,16 @@ void BlocksRenderer::render(
                 cache.getRegion(id, variantId, 5, densePass)
             };
             int x = i % CHUNK_W;
-            int y = i / (CHUNK_D * CHUNK_W);
+            int y = i / (CHUNK_D * CHUNK_W) + sectionY;
             int z = (i / CHUNK_D) % CHUNK_W;
             switch (def.getModel(state.userbits).type) {
                 case BlockModelType::BLOCK:
+                    if (greedyMeshing && is_greedy_candidate(def, vox.state)) {
+                        blockCubeGreedy({x, y, z}, texfaces, def, vox.state,
+                                        !def.shadeless,
+                                        def.ambientOcclusion && enableAO);
+                        break;
+                    }
                     blockCube({x, y, z}, texfaces, def, vox.state, !def.shadeless,
                               def.ambientOcclusion && enableAO);
                     break;
@@ -555,6 +851,12 @@ void BlocksRenderer::render(
                 return;
             }
         }
+        if (greedyMeshing) {
+            flushGreedyFaces();
+            if (overflow) {
+                return;
+            }
+        }
     }
 }
 
@@ -597,7 +899,7 @@ SortingMeshData BlocksRenderer::renderTranslucent(
                 cache.getRegion(id, variantId, 5, densePass)
             };
             int x = i % CHUNK_W;
-            int y = i / (CHUNK_D * CHUNK_W);
+            int y = i / (CHUNK_D * CHUNK_W) + sectionY;
             int z = (i / CHUNK_D) % CHUNK_W;
             switch (def.getModel(state.userbits).type) {
                 case BlockModelType::BLOCK:
@@ -695,21 +997,39 @@ SortingMeshData BlocksRenderer::renderTranslucent(
 }
 
 void BlocksRenderer::build(
-    const Chunk* chunk, const VoxelsRenderVolume& volume
+    const Chunk* chunk, const VoxelsRenderVolume& volume, int section
 ) {
-    meshAABB = AABB(glm::vec3(CHUNK_W, CHUNK_H, CHUNK_D));
+    sectionY = section * CHUNK_SECTION_H;
+    meshAABB = AABB(
+        glm::vec3(0, sectionY, 0),
+        glm::vec3(CHUNK_W, sectionY + CHUNK_SECTION_H, CHUNK_D)
+    );
     this->chunk = chunk;
     this->voxelsBuffer = &volume;
+    const auto& atlasSize = cache.getAtlasSize();
+    // packed tiling UV does not fit into compact vertex
+    greedyMeshing = settings.graphics.greedyMeshing.get() && !compactVertices &&
+                    atlasSize.x <= MAX_PACKED_COORD + 1 &&
+                    atlasSize.y <= MAX_PACKED_COORD + 1;
+    if (greedyMeshing && greedyFaces == nullptr) {
+        greedyFaces = std::make_unique<GreedyFace[]>(6 * CHUNK_SECTION_VOL);
+    }
     if (voxelsBuffer->pickBlockId(
-        chunk->x * CHUNK_W, 0, chunk->z * CHUNK_D
+        chunk->x * CHUNK_W, volume.getY(), chunk->z * CHUNK_D
     ) == BLOCK_VOID) {
         cancelled = true;
         return;
     }
-    const voxel* voxels = chunk->voxels;
+    voxel* voxels = chunkVoxels.get();
+    const voxel* src = chunk->voxels.getSection(section, voxels);
+    if (src != voxels) {
+        std::memcpy(voxels, src, CHUNK_SECTION_VOL * sizeof(voxel));
+    }
 
-    int totalBegin = chunk->bottom * (CHUNK_W * CHUNK_D);
-    int totalEnd = chunk->top * (CHUNK_W * CHUNK_D);
+    constexpr int LAYER_SIZE = CHUNK_W * CHUNK_D;
+    int totalBegin = std::max(chunk->bottom - sectionY, 0) * LAYER_SIZE;
+    int totalEnd =
+        std::min(chunk->top - sectionY, CHUNK_SECTION_H) * LAYER_SIZE;
     bool hasTranslucent = false;
     int beginEnds[256][2] {};
     for (int i = totalBegin; i < totalEnd; i++) {
@@ -747,6 +1067,7 @@ void BlocksRenderer::build(
 
     denseRender = false;
     densePass = false;
+    compactPass = compactVertices;
     render(voxels, beginEnds);
 
     size_t endIndex = indexCount;
@@ -763,44 +1084,97 @@ void BlocksRenderer::build(
     indexCount = endIndex;
     densePass = false;
     render(voxels, beginEnds);
+    compactPass = false;
+}
+
+template <typename VertexStructure>
+static MeshData<VertexStructure> create_mesh_data(
+    const VertexStructure* vertices,
+    size_t vertexCount,
+    const uint32_t* indices,
+    size_t indexCount,
+    const uint32_t* denseIndices,
+    size_t denseIndexCount
+) {
+    return MeshData(
+        util::Buffer(vertices, vertexCount),
+        std::vector<util::Buffer<uint32_t>> {
+            util::Buffer(indices, indexCount),
+            util::Buffer(denseIndices, denseIndexCount),
+        },
+        util::Buffer(
+            VertexStructure::ATTRIBUTES,
+            sizeof(VertexStructure::ATTRIBUTES) / sizeof(VertexAttribute)
+        )
+    );
 }
 
 ChunkMeshData BlocksRenderer::createMesh() {
-    return ChunkMeshData {
-        MeshData(
-            util::Buffer(vertexBuffer.get(), vertexCount),
-            std::vector<util::Buffer<uint32_t>> {
-                util::Buffer(indexBuffer.get(), indexCount),
-                util::Buffer(denseIndexBuffer.get(), denseIndexCount),
-            },
-            util::Buffer(
-                ChunkVertex::ATTRIBUTES,
-                sizeof(ChunkVertex::ATTRIBUTES) / sizeof(VertexAttribute)
-            )
-        ),
-        std::move(sortingMesh),
-        std::move(meshAABB)
-    };
+    ChunkMeshData data {};
+    if (compactVertices) {
+        data.compactMesh = create_mesh_data(
+            compactVertexBuffer.get(),
+            vertexCount,
+            indexBuffer.get(),
+            indexCount,
+            denseIndexBuffer.get(),
+            denseIndexCount
+        );
+    } else {
+        data.mesh = create_mesh_data(
+            vertexBuffer.get(),
+            vertexCount,
+            indexBuffer.get(),
+            indexCount,
+            denseIndexBuffer.get(),
+            denseIndexCount
+        );
+    }
+    data.sortingMesh = std::move(sortingMesh);
+    data.meshAABB = std::move(meshAABB);
+    return data;
 }
 
-ChunkMesh BlocksRenderer::render(
-    const Chunk* chunk, const VoxelsRenderVolume& volume
+ChunkSectionMesh BlocksRenderer::render(
+    const Chunk* chunk, const VoxelsRenderVolume& volume, int section
 ) {
-    build(chunk, volume);
+    build(chunk, volume, section);
+    if (cancelled) {
+        return ChunkSectionMesh {};
+    }
     
     assert(vertexCount <= capacity);
     assert(indexCount <= capacity);
     assert(denseIndexCount <= capacity);
 
-    return ChunkMesh{std::make_unique<Mesh<ChunkVertex>>(
-        vertexBuffer.get(), vertexCount, 
-        std::vector<IndexBufferData> {
+    ChunkSectionMesh result {};
+    if (vertexCount) {
+        std::vector<IndexBufferData> indices {
             IndexBufferData {indexBuffer.get(), indexCount},
             IndexBufferData {denseIndexBuffer.get(), denseIndexCount},
+        };
+        if (compactVertices) {
+            result.compactMesh = std::make_unique<Mesh<CompactChunkVertex>>(
+                compactVertexBuffer.get(), vertexCount, std::move(indices)
+            );
+        } else {
+            result.mesh = std::make_unique<Mesh<ChunkVertex>>(
+                vertexBuffer.get(), vertexCount, std::move(indices)
+            );
         }
-    ), std::move(sortingMesh), nullptr, std::move(meshAABB)};
+    }
+    result.sortingMeshData = std::move(sortingMesh);
+    result.meshAABB = std::move(meshAABB);
+    result.memoryUsage =
+        vertexCount * (compactVertices ? sizeof(CompactChunkVertex)
+                                       : sizeof(ChunkVertex)) +
+        (indexCount + denseIndexCount) * sizeof(uint32_t);
+    return result;
 }
 
 size_t BlocksRenderer::getMemoryConsumption() const {
-    return capacity * (sizeof(ChunkVertex) + sizeof(uint32_t) * 2);
+    return capacity * (sizeof(ChunkVertex) + sizeof(uint32_t) * 2) +
+           (compactVertexBuffer ? capacity * sizeof(CompactChunkVertex) : 0) +
+           CHUNK_SECTION_VOL * sizeof(voxel) +
+           (greedyFaces ? 6 * CHUNK_SECTION_VOL * sizeof(GreedyFace) : 0);
 }
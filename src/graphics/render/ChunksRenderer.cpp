@@ -18,6 +18,7 @@
 static debug::Logger logger("chunks-render");
 
 size_t ChunksRenderer::visibleChunks = 0;
+size_t ChunksRenderer::meshesMemory = 0;
 
 static constexpr inline size_t MAX_CHUNKS_ENQUEUED_IN_FRAME = 4;
 
@@ -27,7 +28,8 @@ public:
     RendererWorker(
         const Level& level,
         const ContentGfxCache& cache,
-        const EngineSettings& settings
+        const EngineSettings& settings,
+        bool compactVertices
     )
         : renderer(
               settings.graphics.denseRender.get()
@@ -35,24 +37,70 @@ public:
                   : settings.graphics.chunkMaxVertices.get(),
               level.content,
               cache,
-              settings
+              settings,
+              compactVertices
           ) {
     }
 
     RendererResult operator()(const RendererJob& job) override {
         auto chunk = job.chunk;
         auto volume = job.volume;
-        renderer.build(chunk.get(), *volume);
-        if (renderer.isCancelled()) {
-            return RendererResult {
-                glm::ivec2(chunk->x, chunk->z), true, ChunkMeshData {}};
+        glm::ivec2 key(chunk->x, chunk->z);
+        RendererResult result {key, false, job.sectionsMask, {}};
+        for (int i = 0; i < CHUNK_SECTIONS; i++) {
+            if ((job.sectionsMask & (1 << i)) == 0) {
+                continue;
+            }
+            renderer.build(chunk.get(), *volume, i);
+            if (renderer.isCancelled()) {
+                return RendererResult {key, true, job.sectionsMask, {}};
+            }
+            result.sections.push_back(renderer.createMesh());
         }
-        auto meshData = renderer.createMesh();
-        return RendererResult {
-            glm::ivec2(chunk->x, chunk->z), false, std::move(meshData)};
+        return result;
     }
 };
 
+template <typename VertexStructure>
+static size_t calc_memory_usage(const MeshData<VertexStructure>& data) {
+    size_t size = data.vertices.size() * sizeof(VertexStructure);
+    for (const auto& indices : data.indices) {
+        size += indices.size() * sizeof(uint32_t);
+    }
+    return size;
+}
+
+static ChunkSectionMesh create_section_mesh(ChunkMeshData&& meshData) {
+    ChunkSectionMesh section {};
+    if (meshData.mesh.vertices.size()) {
+        section.mesh = std::make_unique<Mesh<ChunkVertex>>(meshData.mesh);
+        section.memoryUsage = calc_memory_usage(meshData.mesh);
+    } else if (meshData.compactMesh.vertices.size()) {
+        section.compactMesh =
+            std::make_unique<Mesh<CompactChunkVertex>>(meshData.compactMesh);
+        section.memoryUsage = calc_memory_usage(meshData.compactMesh);
+    }
+    section.sortingMeshData = std::move(meshData.sortingMesh);
+    section.meshAABB = std::move(meshData.meshAABB);
+    return section;
+}
+
+static inline void draw_section(const ChunkSectionMesh& section, bool dense) {
+    if (section.mesh) {
+        section.mesh->draw(GL_TRIANGLES, dense);
+    } else {
+        section.compactMesh->draw(GL_TRIANGLES, dense);
+    }
+}
+
+static size_t calc_memory_usage(const ChunkMesh& mesh) {
+    size_t size = 0;
+    for (const auto& section : mesh.sections) {
+        size += section.memoryUsage;
+    }
+    return size;
+}
+
 static util::ObjectsPool<VoxelsRenderVolume> voxelsVolumesPool {};
 
 ChunksRenderer::ChunksRenderer(
@@ -67,34 +115,53 @@ ChunksRenderer::ChunksRenderer(
       assets(assets),
       frustum(frustum),
       settings(settings),
+      compactVertices(settings.graphics.compactVertices.get()),
       threadPool(
           "chunks-render-pool",
           [&]() {
               return std::make_unique<RendererWorker>(
-                  level, cache, settings
+                  level, cache, settings, compactVertices
               );
           },
           [&](RendererResult&& result) {
-                if (!result.cancelled) {
-                    auto meshData = std::move(result.meshData);
-                    auto chunk = std::make_unique<Mesh<ChunkVertex>>(meshData.mesh);
-                    meshes[result.key] = ChunkMesh {
-                        std::move(chunk),
-                        std::move(meshData.sortingMesh),
-                        nullptr,
-                        std::move(meshData.meshAABB)
-                    };
-                }
                 inwork.erase(result.key);
+                if (result.cancelled) {
+                    return;
+                }
+                auto found = meshes.find(result.key);
+                if (found == meshes.end()) {
+                    // partial rebuild of an unloaded chunk mesh
+                    if (result.sectionsMask != Chunk::ALL_SECTIONS) {
+                        return;
+                    }
+                    found = meshes.emplace(result.key, ChunkMesh {}).first;
+                }
+                auto& mesh = found->second;
+                size_t index = 0;
+                for (int i = 0; i < CHUNK_SECTIONS; i++) {
+                    if (result.sectionsMask & (1 << i)) {
+                        setSection(
+                            mesh,
+                            i,
+                            create_section_mesh(
+                                std::move(result.sections[index++])
+                            )
+                        );
+                    }
+                }
+                mesh.sortedMesh = nullptr;
           },
           settings.graphics.chunkMaxRenderers.get()
       ) {
     threadPool.setStopOnFail(false);
     renderer = std::make_unique<BlocksRenderer>(
         settings.graphics.chunkMaxVertices.get(), 
-        level.content, cache, settings
+        level.content, cache, settings, compactVertices
     );
     logger.info() << "created " << threadPool.getWorkersCount() << " workers";
+    if (compactVertices) {
+        logger.info() << "using compact vertices";
+    }
     logger.info() << "memory consumption is "
                   << renderer->getMemoryConsumption() *
                              threadPool.getWorkersCount() +
@@ -106,18 +173,47 @@ ChunksRenderer::ChunksRenderer(
                   << " B";
 }
 
-ChunksRenderer::~ChunksRenderer() = default;
+ChunksRenderer::~ChunksRenderer() {
+    meshesMemory = 0;
+}
+
+void ChunksRenderer::setSection(
+    ChunkMesh& mesh, int index, ChunkSectionMesh&& section
+) {
+    meshesMemory -= mesh.sections[index].memoryUsage;
+    meshesMemory += section.memoryUsage;
+    mesh.sections[index] = std::move(section);
+}
 
 std::shared_ptr<VoxelsRenderVolume> ChunksRenderer::prepareVoxelsVolume(
-    const Chunk& chunk
+    const Chunk& chunk, uint16_t sectionsMask
 ) {
+    int firstSection = 0;
+    while ((sectionsMask & (1 << firstSection)) == 0) {
+        firstSection++;
+    }
+    int lastSection = CHUNK_SECTIONS - 1;
+    while ((sectionsMask & (1 << lastSection)) == 0) {
+        lastSection--;
+    }
+    // only layers of the rebuilt sections and their neighbours are sampled
+    int bottom = std::max(
+        firstSection * CHUNK_SECTION_H - VOXELS_BUFFER_PADDING, 0
+    );
+    int top = std::min(
+        {(lastSection + 1) * CHUNK_SECTION_H + VOXELS_BUFFER_PADDING,
+         chunk.top + 1,
+         CHUNK_H}
+    );
     auto voxelsBuffer = voxelsVolumesPool.create();
     voxelsBuffer->setPosition(
-        chunk.x * CHUNK_W - VOXELS_BUFFER_PADDING, 0,
+        chunk.x * CHUNK_W - VOXELS_BUFFER_PADDING, bottom,
         chunk.z * CHUNK_D - VOXELS_BUFFER_PADDING
     );
     chunks.getVoxels(
-        *voxelsBuffer, settings.graphics.backlight.get(), chunk.top + 1
+        *voxelsBuffer,
+        settings.graphics.backlight.get(),
+        std::max(top - bottom, 1)
     );
     return voxelsBuffer;
 }
@@ -126,13 +222,24 @@ const ChunkMesh* ChunksRenderer::render(
     const std::shared_ptr<Chunk>& chunk, bool important, bool lowPriority
 ) {
     glm::ivec2 key(chunk->x, chunk->z);
+    uint16_t sectionsMask = chunk->modifiedSections;
+    if (sectionsMask == 0 || meshes.find(key) == meshes.end()) {
+        sectionsMask = Chunk::ALL_SECTIONS;
+    }
     if (important) {
-        ChunkMesh mesh {};
-        auto voxelsBuffer = prepareVoxelsVolume(*chunk);
-        mesh = renderer->render(chunk.get(), *voxelsBuffer);
-        meshes[key] = std::move(mesh);
+        auto voxelsBuffer = prepareVoxelsVolume(*chunk, sectionsMask);
+        auto& mesh = meshes[key];
+        for (int i = 0; i < CHUNK_SECTIONS; i++) {
+            if (sectionsMask & (1 << i)) {
+                setSection(
+                    mesh, i, renderer->render(chunk.get(), *voxelsBuffer, i)
+                );
+            }
+        }
+        mesh.sortedMesh = nullptr;
         chunk->flags.modified = false;
-        return &meshes[key];
+        chunk->modifiedSections = 0;
+        return &mesh;
     }
     if (inwork.find(key) != inwork.end() ||
         ((inwork.size() >= threadPool.getWorkersCount() ||
@@ -141,9 +248,10 @@ const ChunkMesh* ChunksRenderer::render(
         return nullptr;
     }
     chunk->flags.modified = false;
+    chunk->modifiedSections = 0;
     enqueuedInFrame++;
-    auto voxelsBuffer = prepareVoxelsVolume(*chunk);
-    threadPool.enqueueJob({chunk, std::move(voxelsBuffer)});
+    auto voxelsBuffer = prepareVoxelsVolume(*chunk, sectionsMask);
+    threadPool.enqueueJob({chunk, std::move(voxelsBuffer), sectionsMask});
     inwork[key] = true;
     return nullptr;
 }
@@ -151,12 +259,14 @@ const ChunkMesh* ChunksRenderer::render(
 void ChunksRenderer::unload(const Chunk* chunk) {
     auto found = meshes.find(glm::ivec2(chunk->x, chunk->z));
     if (found != meshes.end()) {
+        meshesMemory -= calc_memory_usage(found->second);
         meshes.erase(found);
     }
 }
 
 void ChunksRenderer::clear() {
     meshes.clear();
+    meshesMemory = 0;
     inwork.clear();
     threadPool.clearQueue();
 }
@@ -179,8 +289,8 @@ void ChunksRenderer::update() {
     enqueuedInFrame = 0;
 }
 
-const Mesh<ChunkVertex>* ChunksRenderer::retrieveChunk(
-    size_t index, const Camera& camera, bool culling
+const ChunkMesh* ChunksRenderer::retrieveChunk(
+    size_t index, const Camera& camera
 ) {
     auto chunk = chunks.getChunks()[index];
     if (chunk == nullptr) {
@@ -191,7 +301,7 @@ const Mesh<ChunkVertex>* ChunksRenderer::retrieveChunk(
         if (found == meshes.end()) {
             return nullptr;
         } else {
-            return found->second.mesh.get();
+            return &found->second;
         }
     }
     float distance = glm::distance(
@@ -213,24 +323,7 @@ const Mesh<ChunkVertex>* ChunksRenderer::retrieveChunk(
     if (chunk->flags.dirtyHeights) {
         chunk->updateHeights();
     }
-    if (culling) {
-        const auto& meshAABB = mesh->meshAABB;
-        auto aabbMin = meshAABB.min();
-        auto aabbMax = meshAABB.max();
-        glm::vec3 min(
-            chunk->x * CHUNK_W + std::min(0.0f, aabbMin.x),
-            chunk->bottom,
-            chunk->z * CHUNK_D + std::min(0.0f, aabbMin.z)
-        );
-        glm::vec3 max(
-            chunk->x * CHUNK_W + aabbMax.x,
-            chunk->top,
-            chunk->z * CHUNK_D + aabbMax.z
-        );
-
-        if (!frustum.isBoxVisible(min, max)) return nullptr;
-    }
-    return mesh->mesh.get();
+    return mesh;
 }
 
 void ChunksRenderer::drawShadowsPass(
@@ -259,22 +352,29 @@ void ChunksRenderer::drawShadowsPass(
         glm::vec3 coord(
             pos.x * CHUNK_W + 0.5f, 0.5f, pos.y * CHUNK_D + 0.5f
         );
-
-        glm::vec3 min(pos.x * CHUNK_W, chunk->bottom, pos.y * CHUNK_D);
-        glm::vec3 max(
-            pos.x * CHUNK_W + CHUNK_W,
-            chunk->top,
-            pos.y * CHUNK_D + CHUNK_D
-        );
-
-        if (!frustum.isBoxVisible(min, max)) {
-            continue;
+        glm::vec3 chunkPos(pos.x * CHUNK_W, 0, pos.y * CHUNK_D);
+        glm::vec3 center =
+            chunkPos + glm::vec3(CHUNK_W * 0.5f, 0.0f, CHUNK_D * 0.5f);
+        bool dense =
+            glm::distance2(playerCamera.position * glm::vec3(1, 0, 1), center) <
+            denseDistance2;
+
+        bool modelSet = false;
+        for (const auto& section : found->second.sections) {
+            if (!section.hasMesh() ||
+                !frustum.isBoxVisible(
+                    chunkPos + section.meshAABB.min(),
+                    chunkPos + section.meshAABB.max()
+                )) {
+                continue;
+            }
+            if (!modelSet) {
+                glm::mat4 model = glm::translate(glm::mat4(1.0f), coord);
+                shader.uniformMatrix("u_model", model);
+                modelSet = true;
+            }
+            draw_section(section, dense);
         }
-        glm::mat4 model = glm::translate(glm::mat4(1.0f), coord);
-        shader.uniformMatrix("u_model", model);
-        found->second.mesh->draw(GL_TRIANGLES, 
-            glm::distance2(playerCamera.position * glm::vec3(1, 0, 1), 
-                           (min + max) * 0.5f * glm::vec3(1, 0, 1)) < denseDistance2);
     }
 }
 
@@ -317,26 +417,46 @@ void ChunksRenderer::drawChunks(
     // TODO: minimize draw calls number
     for (int i = indices.size()-1; i >= 0; i--) {
         auto& chunk = chunks.getChunks()[indices[i].index];
-        auto mesh = retrieveChunk(indices[i].index, camera, culling);
+        auto mesh = retrieveChunk(indices[i].index, camera);
         if (mesh == nullptr) {
             continue;
         }
         glm::vec3 coord(
             chunk->x * CHUNK_W + 0.5f, 0.5f, chunk->z * CHUNK_D + 0.5f
         );
-        glm::mat4 model = glm::translate(glm::mat4(1.0f), coord);
-        shader.uniformMatrix("u_model", model);
-        mesh->draw(GL_TRIANGLES, glm::distance2(camera.position * glm::vec3(1, 0, 1), 
-            (coord + glm::vec3(CHUNK_W * 0.5f, 0.0f, CHUNK_D * 0.5f))) < denseDistance2);
-        visibleChunks++;
+        glm::vec3 chunkPos(chunk->x * CHUNK_W, 0, chunk->z * CHUNK_D);
+        bool dense = glm::distance2(camera.position * glm::vec3(1, 0, 1), 
+            (coord + glm::vec3(CHUNK_W * 0.5f, 0.0f, CHUNK_D * 0.5f))) < denseDistance2;
+
+        bool visible = false;
+        for (const auto& section : mesh->sections) {
+            if (!section.hasMesh()) {
+                continue;
+            }
+            if (culling && !frustum.isBoxVisible(
+                               chunkPos + section.meshAABB.min(),
+                               chunkPos + section.meshAABB.max()
+                           )) {
+                continue;
+            }
+            if (!visible) {
+                glm::mat4 model = glm::translate(glm::mat4(1.0f), coord);
+                shader.uniformMatrix("u_model", model);
+                visible = true;
+            }
+            draw_section(section, dense);
+        }
+        if (visible) {
+            visibleChunks++;
+        }
     }
 }
 
 static inline void write_sorting_mesh_entries(
-    ChunkVertex* buffer, const std::vector<SortingMeshEntry>& chunkEntries
+    ChunkVertex* buffer, const std::vector<SortingMeshEntry*>& chunkEntries
 ) {
     for (const auto& entry : chunkEntries) {
-        const auto& vertexData = entry.vertexData;
+        const auto& vertexData = entry->vertexData;
         std::memcpy(
             buffer,
             vertexData.data(),
@@ -367,7 +487,7 @@ void ChunksRenderer::drawSortedMeshes(const Camera& camera, Shader& shader) {
             continue;
         }
         const auto& found = meshes.find(glm::ivec2(chunk->x, chunk->z));
-        if (found == meshes.end() || found->second.sortingMeshData.entries.empty()) {
+        if (found == meshes.end()) {
             continue;
         }
 
@@ -382,29 +502,43 @@ void ChunksRenderer::drawSortedMeshes(const Camera& camera, Shader& shader) {
             if (!frustum.isBoxVisible(min, max)) continue;
         }
 
-        auto& chunkEntries = found->second.sortingMeshData.entries;
+        auto& mesh = found->second;
+        auto& chunkEntries = sortingEntries;
+        chunkEntries.clear();
+        for (auto& section : mesh.sections) {
+            for (auto& entry : section.sortingMeshData.entries) {
+                chunkEntries.push_back(&entry);
+            }
+        }
+        if (chunkEntries.empty()) {
+            continue;
+        }
 
         if (chunkEntries.size() == 1) {
-            auto& entry = chunkEntries.at(0);
-            if (found->second.sortedMesh == nullptr) {
-                found->second.sortedMesh = std::make_unique<Mesh<ChunkVertex>>(
+            auto& entry = *chunkEntries.at(0);
+            if (mesh.sortedMesh == nullptr) {
+                mesh.sortedMesh = std::make_unique<Mesh<ChunkVertex>>(
                     entry.vertexData.data(), entry.vertexData.size()
                 );
             }
-            found->second.sortedMesh->draw();
+            mesh.sortedMesh->draw();
             continue;
         }
-        for (auto& entry : chunkEntries) {
-            entry.distance = static_cast<long long>(
-                glm::distance2(entry.position, cameraPos)
+        for (auto entry : chunkEntries) {
+            entry->distance = static_cast<long long>(
+                glm::distance2(entry->position, cameraPos)
             );
         }
-        if (found->second.sortedMesh == nullptr ||
+        if (mesh.sortedMesh == nullptr ||
             (frameid + chunk->x) % sortInterval == 0) {
-            std::sort(chunkEntries.begin(), chunkEntries.end());
+            std::sort(
+                chunkEntries.begin(),
+                chunkEntries.end(),
+                [](const auto a, const auto b) { return *a < *b; }
+            );
             size_t size = 0;
             for (const auto& entry : chunkEntries) {
-                size += entry.vertexData.size();
+                size += entry->vertexData.size();
             }
 
             static util::Buffer<ChunkVertex> buffer;
@@ -412,10 +546,10 @@ void ChunksRenderer::drawSortedMeshes(const Camera& camera, Shader& shader) {
                 buffer = util::Buffer<ChunkVertex>(size);
             }
             write_sorting_mesh_entries(buffer.data(), chunkEntries);
-            found->second.sortedMesh = std::make_unique<Mesh<ChunkVertex>>(
+            mesh.sortedMesh = std::make_unique<Mesh<ChunkVertex>>(
                 buffer.data(), size
             );
         }
-        found->second.sortedMesh->draw();
+        mesh.sortedMesh->draw();
     }
 }
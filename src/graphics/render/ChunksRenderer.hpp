@@ -35,12 +35,17 @@ struct ChunksSortEntry {
 struct RendererResult {
     glm::ivec2 key;
     bool cancelled;
-    ChunkMeshData meshData;
+    /// @brief Rebuilt sections bit mask
+    uint16_t sectionsMask;
+    /// @brief Rebuilt sections meshes data in ascending sections order
+    std::vector<ChunkMeshData> sections;
 };
 
 struct RendererJob {
     std::shared_ptr<Chunk> chunk;
     std::shared_ptr<VoxelsRenderVolume> volume;
+    /// @brief Sections to rebuild bit mask
+    uint16_t sectionsMask;
 };
 
 class ChunksRenderer {
@@ -48,18 +53,25 @@ class ChunksRenderer {
     const Assets& assets;
     const Frustum& frustum;
     const EngineSettings& settings;
+    /// @brief Build meshes of CompactChunkVertex (fixed for renderer lifetime)
+    bool compactVertices;
 
     std::unique_ptr<BlocksRenderer> renderer;
     std::unordered_map<glm::ivec2, ChunkMesh> meshes;
     std::unordered_map<glm::ivec2, bool> inwork;
     std::vector<ChunksSortEntry> indices;
+    /// @brief Translucent entries buffer reused in drawSortedMeshes
+    std::vector<SortingMeshEntry*> sortingEntries;
     util::ThreadPool<RendererJob, RendererResult> threadPool;
-    const Mesh<ChunkVertex>* retrieveChunk(
-        size_t index, const Camera& camera, bool culling
+    const ChunkMesh* retrieveChunk(size_t index, const Camera& camera);
+    /// @brief Sample voxels required to build given sections
+    std::shared_ptr<VoxelsRenderVolume> prepareVoxelsVolume(
+        const Chunk& chunk, uint16_t sectionsMask
     );
-    std::shared_ptr<VoxelsRenderVolume> prepareVoxelsVolume(const Chunk& chunk);
 
     size_t enqueuedInFrame = 0;
+
+    void setSection(ChunkMesh& mesh, int index, ChunkSectionMesh&& section);
 public:
     ChunksRenderer(
         const Level& level,
@@ -91,5 +103,11 @@ public:
 
     void update();
 
+    bool isCompactVertices() const {
+        return compactVertices;
+    }
+
     static size_t visibleChunks;
+    /// @brief Size of resident chunk sections vertices and indices in bytes
+    static size_t meshesMemory;
 };
@@ -286,17 +286,20 @@ void WorldRenderer::refreshSettings(Shader** shaders) {
     CompileTimeShaderSettings currentSettings {
         gbufferPipeline,
         shadowsQuality != 0,
-        graphics.ssao.get() && gbufferPipeline
+        graphics.ssao.get() && gbufferPipeline,
+        chunksRenderer->isCompactVertices()
     };
     if (
         prevCTShaderSettings.advancedRender != currentSettings.advancedRender ||
         prevCTShaderSettings.shadows != currentSettings.shadows ||
-        prevCTShaderSettings.ssao != currentSettings.ssao
+        prevCTShaderSettings.ssao != currentSettings.ssao ||
+        prevCTShaderSettings.compactVertices != currentSettings.compactVertices
     ) {
         std::vector<std::string> defines;
         if (currentSettings.shadows) defines.emplace_back("ENABLE_SHADOWS");
         if (currentSettings.ssao) defines.emplace_back("ENABLE_SSAO");
         if (currentSettings.advancedRender) defines.emplace_back("ADVANCED_RENDER");
+        if (currentSettings.compactVertices) defines.emplace_back("COMPACT_CHUNK_VERTEX");
 
         for (size_t i = 0; shaders[i]; i++) {
             shaders[i]->recompile(defines);
@@ -329,6 +332,7 @@ void WorldRenderer::renderFrame(
     auto& cloudsShader = assets.require<Shader>("clouds");
     auto& translucentShader = assets.require<Shader>("translucent");
     auto& deferredShader = assets.require<PostEffect>("deferred_lighting").getShader();
+    auto& shadowsShader = assets.require<Shader>("shadows");
 
     const auto& settings = engine.getSettings();
 
@@ -338,6 +342,7 @@ void WorldRenderer::renderFrame(
         &cloudsShader,
         &translucentShader,
         &deferredShader,
+        &shadowsShader,
         nullptr
     };
 
@@ -4,6 +4,7 @@
 #include "graphics/core/MeshData.hpp"
 #include "maths/aabb.hpp"
 #include "util/Buffer.hpp"
+#include "voxels/ChunkVoxels.hpp"
 
 #include <vector>
 #include <array>
@@ -26,6 +27,23 @@ struct ChunkVertex {
         {{}, 0}};
 };
 
+/// @brief Quantized chunk mesh vertex format (see graphics.compact-vertices)
+struct CompactChunkVertex {
+    /// @brief Chunk-local position multiplied by POSITION_SCALE, w is packed
+    /// normal (4 bits per axis) and emission (4 bits, 16 levels)
+    std::array<int16_t, 4> position;
+    std::array<uint16_t, 2> uv;
+    std::array<uint8_t, 4> color;
+
+    static constexpr float POSITION_SCALE = 64.0f;
+
+    static constexpr VertexAttribute ATTRIBUTES[] = {
+        {VertexAttribute::Type::SHORT, false, 4},
+        {VertexAttribute::Type::UNSIGNED_SHORT, true, 2},
+        {VertexAttribute::Type::UNSIGNED_BYTE, true, 4},
+        {{}, 0}};
+};
+
 template<typename VertexStructure>
 class Mesh;
 
@@ -43,17 +61,37 @@ struct SortingMeshData {
     std::vector<SortingMeshEntry> entries;
 };
 
+/// @brief Chunk section mesh data built by a renderer worker
 struct ChunkMeshData {
     MeshData<ChunkVertex> mesh;
+    /// @brief Used instead of mesh if compact vertices are enabled
+    MeshData<CompactChunkVertex> compactMesh;
     SortingMeshData sortingMesh;
     AABB meshAABB;
 };
 
-struct ChunkMesh {
+struct ChunkSectionMesh {
+    /// @brief Opaque geometry mesh or nullptr if section has no geometry
     std::unique_ptr<Mesh<ChunkVertex>> mesh;
+    /// @brief Used instead of mesh if compact vertices are enabled
+    std::unique_ptr<Mesh<CompactChunkVertex>> compactMesh;
     SortingMeshData sortingMeshData;
-    std::unique_ptr<Mesh<ChunkVertex> > sortedMesh;
+    /// @brief Section geometry bounds in chunk coordinates
     AABB meshAABB;
+    /// @brief Opaque geometry vertices and indices size in bytes
+    size_t memoryUsage = 0;
+
+    bool hasMesh() const {
+        return mesh != nullptr || compactMesh != nullptr;
+    }
+};
+
+/// @brief Chunk mesh split to sections (see CHUNK_SECTION_H) rebuilt
+/// separately
+struct ChunkMesh {
+    ChunkSectionMesh sections[CHUNK_SECTIONS];
+    /// @brief Translucent geometry of all sections sorted by distance
+    std::unique_ptr<Mesh<ChunkVertex> > sortedMesh;
 };
 
 inline constexpr int VOXELS_BUFFER_PADDING = 2;
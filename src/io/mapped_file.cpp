@@ -0,0 +1,103 @@
+#include "mapped_file.hpp"
+
+#include <stdexcept>
+#include <string>
+
+#include "io.hpp"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+io::mapped_file::mapped_file(const path& filename) {
+    auto file = CreateFileW(
+        io::resolve(filename).wstring().c_str(),
+        GENERIC_READ,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        nullptr,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS,
+        nullptr
+    );
+    if (file == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("could not open file " + filename.string());
+    }
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize)) {
+        CloseHandle(file);
+        throw std::runtime_error("could not open file " + filename.string());
+    }
+    length = static_cast<size_t>(fileSize.QuadPart);
+    if (length == 0) {
+        CloseHandle(file);
+        return;
+    }
+    auto mapping =
+        CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (mapping == nullptr) {
+        throw std::runtime_error("could not map file " + filename.string());
+    }
+    // the view keeps the mapping alive
+    bytes = static_cast<const ubyte*>(
+        MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0)
+    );
+    CloseHandle(mapping);
+    if (bytes == nullptr) {
+        throw std::runtime_error("could not map file " + filename.string());
+    }
+}
+
+io::mapped_file::~mapped_file() {
+    if (bytes) {
+        UnmapViewOfFile(bytes);
+    }
+}
+#else
+io::mapped_file::mapped_file(const path& filename) {
+    int fd = open(io::resolve(filename).u8string().c_str(), O_RDONLY);
+    if (fd == -1) {
+        throw std::runtime_error("could not open file " + filename.string());
+    }
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        close(fd);
+        throw std::runtime_error("could not open file " + filename.string());
+    }
+    length = static_cast<size_t>(st.st_size);
+    if (length == 0) {
+        close(fd);
+        return;
+    }
+    void* ptr = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+    // the mapping stays valid after closing the descriptor
+    close(fd);
+    if (ptr == MAP_FAILED) {
+        length = 0;
+        throw std::runtime_error("could not map file " + filename.string());
+    }
+    bytes = static_cast<const ubyte*>(ptr);
+}
+
+io::mapped_file::~mapped_file() {
+    if (bytes) {
+        munmap(const_cast<ubyte*>(bytes), length);
+    }
+}
+#endif
+
+util::span<ubyte> io::mapped_file::span(size_t offset, size_t size) const {
+    if (offset > length || size > length - offset) {
+        throw std::out_of_range(
+            "range " + std::to_string(offset) + "+" + std::to_string(size) +
+            " is out of file bounds"
+        );
+    }
+    return util::span<ubyte>(bytes + offset, size);
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "typedefs.hpp"
+#include "util/span.hpp"
+#include "path.hpp"
+
+namespace io {
+    /// @brief Read-only memory-mapped file. File content is accessed
+    /// directly in the page cache without read calls.
+    /// @attention File must not be truncated while mapped
+    class mapped_file {
+        const ubyte* bytes = nullptr;
+        size_t length = 0;
+    public:
+        /// @throws std::runtime_error if file could not be mapped
+        mapped_file(const path& filename);
+        mapped_file(const mapped_file&) = delete;
+        mapped_file& operator=(const mapped_file&) = delete;
+        ~mapped_file();
+
+        const ubyte* data() const {
+            return bytes;
+        }
+
+        size_t size() const {
+            return length;
+        }
+
+        /// @brief Get file content span
+        /// @throws std::out_of_range if range is out of the file bounds
+        util::span<ubyte> span(size_t offset, size_t size) const;
+    };
+}
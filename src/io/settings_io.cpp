@@ -66,6 +66,12 @@ SettingsHandler::SettingsHandler(EngineSettings& settings) {
     builder.add("load-distance", &settings.chunks.loadDistance);
     builder.add("load-speed", &settings.chunks.loadSpeed);
     builder.add("padding", &settings.chunks.padding);
+    builder.add("generator-workers", &settings.chunks.generatorWorkers);
+    builder.add("loader-workers", &settings.chunks.loaderWorkers);
+    builder.add("lighting-workers", &settings.chunks.lightingWorkers);
+    builder.add("server-lighting", &settings.chunks.serverLighting);
+    builder.add("compact-voxels", &settings.chunks.compactVoxels);
+    builder.add("regions-cache-size", &settings.chunks.regionsCacheSize);
 
     builder.addSection("graphics");
     builder.add("fog-curve", &settings.graphics.fogCurve);
@@ -83,6 +89,8 @@ SettingsHandler::SettingsHandler(EngineSettings& settings) {
     builder.add("shadows-quality", &settings.graphics.shadowsQuality);
     builder.add("dense-render-distance", &settings.graphics.denseRenderDistance);
     builder.add("soft-lighting", &settings.graphics.softLighting);
+    builder.add("greedy-meshing", &settings.graphics.greedyMeshing);
+    builder.add("compact-vertices", &settings.graphics.compactVertices);
     builder.add("clouds-quality", &settings.graphics.cloudsQuality);
 
     builder.addSection("ui");
@@ -91,6 +99,10 @@ SettingsHandler::SettingsHandler(EngineSettings& settings) {
 
     builder.addSection("pathfinding");
     builder.add("steps-per-async-agent", &settings.pathfinding.stepsPerAsyncAgent);
+    builder.add("workers", &settings.pathfinding.workers);
+
+    builder.addSection("physics");
+    builder.add("workers", &settings.physics.workers);
 
     builder.addSection("debug");
     builder.add("generator-test-mode", &settings.debug.generatorTestMode);
@@ -18,6 +18,14 @@ struct ItemFuncsSet {
 struct ItemFuncNamesCache {
 };
 
+/// @brief Pre-resolved item events handles (see lua::get_event_handle).
+/// 0 - event is not defined by the item script
+struct ItemEventHandles {
+    int use = 0;
+    int useOnBlock = 0;
+    int blockBreakBy = 0;
+};
+
 enum class ItemIconType {
     NONE,    // invisible (core:empty) must not be rendered
     SPRITE,  // textured quad: icon is `atlas_name:texture_name`
@@ -80,6 +88,8 @@ struct ItemDef {
         std::set<int> tags;
 
         ItemFuncNamesCache eventNames;
+
+        ItemEventHandles eventHandles;
     } rt {};
 
     ItemDef(const std::string& name);
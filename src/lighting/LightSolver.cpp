@@ -1,14 +1,14 @@
 #include "LightSolver.hpp"
 #include "Lightmap.hpp"
 #include "content/Content.hpp"
-#include "voxels/Chunks.hpp"
+#include "voxels/GlobalChunks.hpp"
 #include "voxels/Chunk.hpp"
 #include "voxels/voxel.hpp"
 #include "voxels/Block.hpp"
 
 #include <assert.h>
 
-LightSolver::LightSolver(const ContentIndices& contentIds, Chunks& chunks, int channel) 
+LightSolver::LightSolver(const ContentIndices& contentIds, GlobalChunks& chunks, int channel) 
     : blockDefs(contentIds.blocks.getDefs()),
       chunks(chunks), 
       channel(channel) {
@@ -22,16 +22,27 @@ void LightSolver::add(int x, int y, int z, int emission) {
     if (chunk == nullptr) {
         return;
     }
-    assert(chunk->lightmap != nullptr);
-    auto& lightmap = *chunk->lightmap;
+    add(*chunk, x-chunk->x*CHUNK_W, y, z-chunk->z*CHUNK_D, emission);
+}
 
-    ubyte light = lightmap.get(x-chunk->x*CHUNK_W, y, z-chunk->z*CHUNK_D, channel);
+void LightSolver::add(Chunk& chunk, int lx, int y, int lz, int emission) {
+    if (emission <= 1) {
+        return;
+    }
+    assert(chunk.lightmap != nullptr);
+    auto& lightmap = *chunk.lightmap;
+
+    ubyte light = lightmap.get(lx, y, lz, channel);
     if (emission < light) return;
 
-    addqueue.push(lightentry {x, y, z, ubyte(emission)});
+    addqueue.push(lightentry {
+        lx + chunk.x * CHUNK_W, y, lz + chunk.z * CHUNK_D, ubyte(emission)});
 
-    chunk->flags.modified = true;
-    lightmap.set(x-chunk->x*CHUNK_W, y, z-chunk->z*CHUNK_D, channel, emission);
+    chunk.setModified(y);
+    if (emission != light) {
+        chunk.flags.lightsUnsaved = true;
+    }
+    lightmap.set(lx, y, lz, channel, emission);
 }
 
 void LightSolver::add(int x, int y, int z) {
@@ -52,6 +63,7 @@ void LightSolver::remove(int x, int y, int z) {
     }
     remqueue.push(lightentry {x, y, z, light});
     lightmap.set(x-chunk->x*CHUNK_W, y, z-chunk->z*CHUNK_D, channel, 0);
+    chunk->flags.lightsUnsaved = true;
 }
 
 void LightSolver::solve(Chunk* prevailingChunk) {
@@ -86,16 +98,16 @@ void LightSolver::solve(Chunk* prevailingChunk) {
 
             int lx = x - chunk->x * CHUNK_W;
             int lz = z - chunk->z * CHUNK_D;
-            chunk->flags.modified = true;
+            chunk->setModified(y);
 
             assert(chunk->lightmap != nullptr);
             auto& lightmap = *chunk->lightmap;
 
             ubyte light = lightmap.get(lx,y,lz, channel);
             if (light != 0 && light == entry.light-1) {
-                voxel* vox = chunks.get(x, y, z);
-                if (vox && vox->id != 0) {
-                    const Block* block = blockDefs[vox->id];
+                const voxel& vox = chunk->voxels.get(vox_index(lx, y, lz));
+                if (vox.id != 0) {
+                    const Block* block = blockDefs[vox.id];
                     if (uint8_t emission = block->emission[channel]) {
                         addqueue.push(lightentry {x, y, z, emission});
                         lightmap.set(lx, y, lz, channel, emission);
@@ -103,6 +115,7 @@ void LightSolver::solve(Chunk* prevailingChunk) {
                     else lightmap.set(lx, y, lz, channel, 0);
                 }
                 else lightmap.set(lx, y, lz, channel, 0);
+                chunk->flags.lightsUnsaved = true;
                 remqueue.push(lightentry {x, y, z, light});
             }
             else if (light >= entry.light) {
@@ -135,16 +148,17 @@ void LightSolver::solve(Chunk* prevailingChunk) {
             auto& lightmap = *chunk->lightmap;
             int lx = x - chunk->x * CHUNK_W;
             int lz = z - chunk->z * CHUNK_D;
-            chunk->flags.modified = true;
+            chunk->setModified(y);
 
             ubyte light = lightmap.get(lx, y, lz, channel);
-            voxel& v = chunk->voxels[vox_index(lx, y, lz)];
+            const voxel& v = chunk->voxels.get(vox_index(lx, y, lz));
             const Block* block = blockDefs[v.id];
             if (block->lightPassing && light+2 <= entry.light){
                 lightmap.set(
                     x-chunk->x*CHUNK_W, y, z-chunk->z*CHUNK_D, 
                     channel, 
                     entry.light-1);
+                chunk->flags.lightsUnsaved = true;
                 addqueue.push(lightentry {x, y, z, ubyte(entry.light-1)});
             }
         }
@@ -3,7 +3,7 @@
 #include "util/array_queue.hpp"
 
 class Chunk;
-class Chunks;
+class GlobalChunks;
 class ContentIndices;
 class Block;
 
@@ -18,13 +18,17 @@ class LightSolver {
     util::array_queue<lightentry> addqueue;
     util::array_queue<lightentry> remqueue;
     const Block* const* blockDefs;
-    Chunks& chunks;
+    GlobalChunks& chunks;
     int channel;
 public:
-    LightSolver(const ContentIndices& contentIds, Chunks& chunks, int channel);
+    LightSolver(const ContentIndices& contentIds, GlobalChunks& chunks, int channel);
 
     void add(int x, int y, int z);
     void add(int x, int y, int z, int emission);
+    /// @brief Add light source inside of the known chunk skipping
+    /// the chunk lookup
+    /// @param lx,y,lz voxel position local to the chunk
+    void add(Chunk& chunk, int lx, int y, int lz, int emission);
     void remove(int x, int y, int z);
     void solve(Chunk* prevailingChunk = nullptr);
 };
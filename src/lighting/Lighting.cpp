@@ -1,8 +1,10 @@
 #include "Lighting.hpp"
 #include "LightSolver.hpp"
+#include "LightingPool.hpp"
 #include "Lightmap.hpp"
 #include "content/Content.hpp"
-#include "voxels/Chunks.hpp"
+#include "voxels/GlobalChunks.hpp"
+#include "voxels/blocks_agent.hpp"
 #include "voxels/Chunk.hpp"
 #include "voxels/voxel.hpp"
 #include "voxels/Block.hpp"
@@ -14,64 +16,30 @@
 
 static debug::Logger logger("lighting");
 
-Lighting::Lighting(const Content& content, Chunks& chunks) 
+Lighting::Lighting(const Content& content, GlobalChunks& chunks, int maxWorkers)
   : content(content), chunks(chunks) {
     auto& indices = *content.getIndices();
     solverR = std::make_unique<LightSolver>(indices, chunks, 0);
     solverG = std::make_unique<LightSolver>(indices, chunks, 1);
     solverB = std::make_unique<LightSolver>(indices, chunks, 2);
     solverS = std::make_unique<LightSolver>(indices, chunks, 3);
+    flags = light_kernels::build_flags(indices);
+    if (maxWorkers != 0) {
+        pool = std::make_unique<LightingPool>(content, chunks, maxWorkers);
+    }
 }
 
 Lighting::~Lighting() = default;
 
-void Lighting::clear(){
-    const auto& chunks = this->chunks.getChunks();
-    for (size_t index = 0; index < chunks.size(); index++){
-        auto chunk = chunks[index];
-        if (chunk == nullptr) {
-            continue;
-        }
-        auto& lightmap = chunk->lightmap;
-        if (lightmap == nullptr) {
-            continue;
-        }
-        std::memset(lightmap->map, 0, sizeof(Lightmap::map));
-    }
-}
-
-void Lighting::prebuildSkyLight(Chunk& chunk, const ContentIndices& indices) {
+void Lighting::prebuildSkyLight(Chunk& chunk) const {
     assert(chunk.lightmap != nullptr);
     auto& lightmap = *chunk.lightmap;
-    
-    const auto* blockDefs = indices.blocks.getDefs();
-
-    int highestPoint = 0;
-    for (int z = 0; z < CHUNK_D; z++){
-        for (int x = 0; x < CHUNK_W; x++){
-            for (int y = CHUNK_H-1; y >= 0; y--){
-                int index = (y * CHUNK_D + z) * CHUNK_W + x;
-                voxel& vox = chunk.voxels[index];
-                const Block* block = blockDefs[vox.id];
-                if (!block->skyLightPassing) {
-                    if (highestPoint < y) {
-                        highestPoint = y;
-                    }
-                    break;
-                }
-                lightmap.setS(x, y, z, 15);
-            }
-        }
-    }
-    if (highestPoint < CHUNK_H-1) {
-        highestPoint++;
-    }
-    lightmap.highestPoint = highestPoint;
+    lightmap.highestPoint = light_kernels::prebuild_sky_light(
+        chunk.voxels, lightmap.map, flags.data()
+    );
 }
 
 void Lighting::buildSkyLight(int cx, int cz){
-    const auto blockDefs = content.getIndices()->blocks.getDefs();
-
     Chunk* chunk = chunks.getChunk(cx, cz);
     if (chunk == nullptr) {
         logger.error() << "attempted to build sky lights to chunk missing in local matrix";
@@ -79,13 +47,15 @@ void Lighting::buildSkyLight(int cx, int cz){
     }
     assert(chunk->lightmap != nullptr);
     auto& lightmap = *chunk->lightmap;
+    const ubyte* flags = this->flags.data();
 
     for (int z = 0; z < CHUNK_D; z++){
         for (int x = 0; x < CHUNK_W; x++){
             int gx = x + cx * CHUNK_W;
             int gz = z + cz * CHUNK_D;
             for (int y = lightmap.highestPoint; y >= 0; y--){
-                while (y > 0 && !blockDefs[chunk->voxels[vox_index(x, y, z)].id]->lightPassing) {
+                while (y > 0 && !(flags[chunk->voxels.get(vox_index(x, y, z)).id] &
+                                  light_kernels::LIGHT_PASSING)) {
                     y--;
                 }
                 if (lightmap.getS(x, y, z) != 15) {
@@ -117,54 +87,40 @@ void Lighting::onChunkLoaded(int cx, int cz, bool expand) {
         return;
     }
     assert(chunk->lightmap != nullptr);
-    auto& lightmap = *chunk->lightmap;
+    const ubyte* flags = this->flags.data();
 
     for (uint y = 0; y < CHUNK_H; y++){
+        if (y % CHUNK_SECTION_H == 0) {
+            auto uniform = chunk->voxels.getUniform(y / CHUNK_SECTION_H);
+            if (uniform && !(flags[uniform->id] & light_kernels::EMISSIVE)) {
+                y += CHUNK_SECTION_H - 1;
+                continue;
+            }
+        }
         for (uint z = 0; z < CHUNK_D; z++){
             for (uint x = 0; x < CHUNK_W; x++){
-                const voxel& vox = chunk->voxels[(y * CHUNK_D + z) * CHUNK_W + x];
-                const Block* block = blockDefs[vox.id];
-                int gx = x + cx * CHUNK_W;
-                int gz = z + cz * CHUNK_D;
-                if (block->rt.emissive){
-                    solverR.add(gx,y,gz,block->emission[0]);
-                    solverG.add(gx,y,gz,block->emission[1]);
-                    solverB.add(gx,y,gz,block->emission[2]);
+                const voxel& vox = chunk->voxels.get((y * CHUNK_D + z) * CHUNK_W + x);
+                if (!(flags[vox.id] & light_kernels::EMISSIVE)) {
+                    continue;
                 }
+                const Block* block = blockDefs[vox.id];
+                solverR.add(*chunk, x, y, z, block->emission[0]);
+                solverG.add(*chunk, x, y, z, block->emission[1]);
+                solverB.add(*chunk, x, y, z, block->emission[2]);
             }
         }
     }
 
     if (expand) {
-        for (int x = 0; x < CHUNK_W; x += CHUNK_W-1) {
-            for (int y = 0; y < CHUNK_H; y++) {
-                for (int z = 0; z < CHUNK_D; z++) {
-                    int gx = x + cx * CHUNK_W;
-                    int gz = z + cz * CHUNK_D;
-                    int rgbs = lightmap.get(x, y, z);
-                    if (rgbs){
-                        solverR.add(gx,y,gz, Lightmap::extract(rgbs, 0));
-                        solverG.add(gx,y,gz, Lightmap::extract(rgbs, 1));
-                        solverB.add(gx,y,gz, Lightmap::extract(rgbs, 2));
-                        solverS.add(gx,y,gz, Lightmap::extract(rgbs, 3));
-                    }
-                }
-            }
-        }
-        for (int z = 0; z < CHUNK_D; z += CHUNK_D-1) {
-            for (int y = 0; y < CHUNK_H; y++) {
-                for (int x = 0; x < CHUNK_W; x++) {
-                    int gx = x + cx * CHUNK_W;
-                    int gz = z + cz * CHUNK_D;
-                    int rgbs = lightmap.get(x, y, z);
-                    if (rgbs){
-                        solverR.add(gx,y,gz, Lightmap::extract(rgbs, 0));
-                        solverG.add(gx,y,gz, Lightmap::extract(rgbs, 1));
-                        solverB.add(gx,y,gz, Lightmap::extract(rgbs, 2));
-                        solverS.add(gx,y,gz, Lightmap::extract(rgbs, 3));
-                    }
-                }
-            }
+        light_kernels::extract_border(chunk->lightmap->map, borderLights);
+        for (const auto& [index, rgbs] : borderLights) {
+            int x = index % CHUNK_W;
+            int z = index / CHUNK_W % CHUNK_D;
+            int y = index / (CHUNK_W * CHUNK_D);
+            solverR.add(*chunk, x, y, z, Lightmap::extract(rgbs, 0));
+            solverG.add(*chunk, x, y, z, Lightmap::extract(rgbs, 1));
+            solverB.add(*chunk, x, y, z, Lightmap::extract(rgbs, 2));
+            solverS.add(*chunk, x, y, z, Lightmap::extract(rgbs, 3));
         }
     }
     solverR.solve(chunk);
@@ -173,6 +129,48 @@ void Lighting::onChunkLoaded(int cx, int cz, bool expand) {
     solverS.solve(chunk);
 }
 
+void Lighting::spreadCachedLights(Chunk& chunk) {
+    light_kernels::extract_border(chunk.lightmap->map, borderLights);
+    for (const auto& [index, rgbs] : borderLights) {
+        int x = index % CHUNK_W;
+        int z = index / CHUNK_W % CHUNK_D;
+        int y = index / (CHUNK_W * CHUNK_D);
+        solverR->add(chunk, x, y, z, Lightmap::extract(rgbs, 0));
+        solverG->add(chunk, x, y, z, Lightmap::extract(rgbs, 1));
+        solverB->add(chunk, x, y, z, Lightmap::extract(rgbs, 2));
+    }
+    solverR->solve(&chunk);
+    solverG->solve(&chunk);
+    solverB->solve(&chunk);
+}
+
+void Lighting::buildChunkLights(int cx, int cz, bool cached) {
+    if (cached) {
+        auto chunk = chunks.getChunk(cx, cz);
+        if (chunk && chunk->flags.loadedBlockLights) {
+            spreadCachedLights(*chunk);
+            return;
+        }
+    } else {
+        buildSkyLight(cx, cz);
+    }
+    onChunkLoaded(cx, cz, !cached);
+}
+
+void Lighting::buildChunksLights(const std::vector<LightingJob>& jobs) {
+    if (pool) {
+        pool->build(jobs);
+        return;
+    }
+    for (const auto& job : jobs) {
+        buildChunkLights(job.pos.x, job.pos.y, job.cached);
+    }
+}
+
+uint Lighting::getWorkersCount() const {
+    return pool ? pool->getWorkersCount() : 0;
+}
+
 void Lighting::onBlockSet(int x, int y, int z, blockid_t id){
     const auto& block = content.getIndices()->blocks.require(id);
     solverR->remove(x,y,z);
@@ -180,13 +178,13 @@ void Lighting::onBlockSet(int x, int y, int z, blockid_t id){
     solverB->remove(x,y,z);
 
     if (id == 0){
-        auto chunk = chunks.getChunkByVoxel(glm::ivec3{x, y, z});
+        auto chunk = chunks.getChunkByVoxel(x, y, z);
         solverR->solve(chunk);
         solverG->solve(chunk);
         solverB->solve(chunk);
         if (chunks.getLight(x,y+1,z, 3) == 0xF){
             for (int i = y; i >= 0; i--){
-                voxel* vox = chunks.get(x,i,z);
+                const voxel* vox = chunks.get(x,i,z);
                 if ((vox == nullptr || vox->id != 0) && block.skyLightPassing)
                     break;
                 solverS->add(x,i,z, 0xF);
@@ -215,7 +213,7 @@ void Lighting::onBlockSet(int x, int y, int z, blockid_t id){
             solverS->solve(chunk);
         }
     } else {
-        auto chunk = chunks.getChunkByVoxel(glm::ivec3{x, y, z});
+        auto chunk = chunks.getChunkByVoxel(x, y, z);
         if (!block.skyLightPassing){
             solverS->remove(x,y,z);
             for (int i = y-1; i >= 0; i--){
@@ -240,3 +238,98 @@ void Lighting::onBlockSet(int x, int y, int z, blockid_t id){
         }
     }
 }
+
+void Lighting::onBlocksSet(const glm::ivec3& pos, const glm::ivec3& size) {
+    auto blockDefs = content.getIndices()->blocks.getDefs();
+    const ubyte* flags = this->flags.data();
+    LightSolver* solvers[] {
+        solverR.get(), solverG.get(), solverB.get(), solverS.get()
+    };
+    int y1 = std::max(pos.y, 0);
+    int y2 = std::min(pos.y + size.y, CHUNK_H);
+    if (y1 >= y2 || size.x <= 0 || size.z <= 0) {
+        return;
+    }
+    glm::ivec3 min(pos.x, y1, pos.z);
+    glm::ivec3 max(pos.x + size.x, y2, pos.z + size.z);
+
+    // remove lights of the box and direct sky light below it
+    for (int y = min.y; y < max.y; y++) {
+        for (int z = min.z; z < max.z; z++) {
+            for (int x = min.x; x < max.x; x++) {
+                for (auto solver : solvers) {
+                    solver->remove(x, y, z);
+                }
+            }
+        }
+    }
+    for (int z = min.z; z < max.z; z++) {
+        for (int x = min.x; x < max.x; x++) {
+            for (int y = min.y - 1;
+                 y >= 0 && chunks.getLight(x, y, z, 3) == 0xF;
+                 y--) {
+                solverS->remove(x, y, z);
+            }
+        }
+    }
+    for (auto solver : solvers) {
+        solver->solve();
+    }
+
+    // restore direct sky light, blocks emission and light coming
+    // from outside of the box
+    for (int z = min.z; z < max.z; z++) {
+        for (int x = min.x; x < max.x; x++) {
+            if (max.y < CHUNK_H && chunks.getLight(x, max.y, z, 3) != 0xF) {
+                continue;
+            }
+            for (int y = max.y - 1; y >= 0; y--) {
+                const voxel* vox = blocks_agent::get(chunks, x, y, z);
+                if (vox == nullptr ||
+                    !(flags[vox->id] & light_kernels::SKY_LIGHT_PASSING)) {
+                    break;
+                }
+                solverS->add(x, y, z, 0xF);
+            }
+        }
+    }
+    for (int y = min.y; y < max.y; y++) {
+        for (int z = min.z; z < max.z; z++) {
+            for (int x = min.x; x < max.x; x++) {
+                const voxel* vox = blocks_agent::get(chunks, x, y, z);
+                if (vox == nullptr ||
+                    !(flags[vox->id] & light_kernels::EMISSIVE)) {
+                    continue;
+                }
+                const Block* block = blockDefs[vox->id];
+                solverR->add(x, y, z, block->emission[0]);
+                solverG->add(x, y, z, block->emission[1]);
+                solverB->add(x, y, z, block->emission[2]);
+            }
+        }
+    }
+    auto addBorder = [&](int x, int y, int z) {
+        for (auto solver : solvers) {
+            solver->add(x, y, z);
+        }
+    };
+    for (int y = min.y; y < max.y; y++) {
+        for (int x = min.x; x < max.x; x++) {
+            addBorder(x, y, min.z - 1);
+            addBorder(x, y, max.z);
+        }
+        for (int z = min.z; z < max.z; z++) {
+            addBorder(min.x - 1, y, z);
+            addBorder(max.x, y, z);
+        }
+    }
+    for (int z = min.z; z < max.z; z++) {
+        for (int x = min.x; x < max.x; x++) {
+            addBorder(x, min.y - 1, z);
+            addBorder(x, max.y, z);
+        }
+    }
+    for (auto solver : solvers) {
+        solver->solve();
+    }
+}
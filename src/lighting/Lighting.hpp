@@ -1,28 +1,70 @@
 #pragma once
 
+#include <glm/vec3.hpp>
+#include <memory>
+#include <vector>
+
 #include "typedefs.hpp"
+#include "light_kernels.hpp"
 
 class Content;
 class ContentIndices;
 class Chunk;
-class Chunks;
+class GlobalChunks;
 class LightSolver;
+class LightingPool;
+struct LightingJob;
 
 class Lighting {
     const Content& content;
-    Chunks& chunks;
+    GlobalChunks& chunks;
     std::unique_ptr<LightSolver> solverR;
     std::unique_ptr<LightSolver> solverG;
     std::unique_ptr<LightSolver> solverB;
     std::unique_ptr<LightSolver> solverS;
+    /// @brief Per block id lighting flags used by light kernels
+    light_kernels::LightingFlags flags;
+    /// @brief Chunk border lights buffer reused between chunks
+    std::vector<light_kernels::BorderLight> borderLights;
+    /// @brief Chunks lights building workers (nullptr if disabled)
+    std::unique_ptr<LightingPool> pool;
+
+    /// @brief Spread blocks light of the chunk border to neighbours
+    /// without emitters propagation (chunk lights are fully cached)
+    void spreadCachedLights(Chunk& chunk);
 public:
-    Lighting(const Content& content, Chunks& chunks);
+    /// @param maxWorkers max number of lights building workers
+    /// (see util::ThreadPool), 0 - build lights in the main thread
+    Lighting(const Content& content, GlobalChunks& chunks, int maxWorkers = 0);
     ~Lighting();
 
-    void clear();
     void buildSkyLight(int cx, int cz);
     void onChunkLoaded(int cx, int cz, bool expand);
+
+    /// @brief Build lights of the loaded chunk surrounded by neighbours
+    /// @param cached chunk lights are loaded from the lights cache
+    void buildChunkLights(int cx, int cz, bool cached);
+
+    /// @brief Build lights of multiple chunks using workers if enabled
+    /// @attention Chunks 3x3 neighbourhoods must not overlap
+    void buildChunksLights(const std::vector<LightingJob>& jobs);
+
+    /// @return true if chunks lights are built by workers
+    bool isParallel() const {
+        return pool != nullptr;
+    }
+
+    /// @return number of lights building workers (0 if disabled)
+    uint getWorkersCount() const;
     void onBlockSet(int x, int y, int z, blockid_t id);
 
-    static void prebuildSkyLight(Chunk& chunk, const ContentIndices& indices);
+    /// @brief Update lights after blocks in the box changed. Lights are
+    /// removed and propagated again for the whole box at once
+    /// @param pos box minimal position
+    /// @param size box size
+    void onBlocksSet(const glm::ivec3& pos, const glm::ivec3& size);
+
+    /// @brief Fill the chunk lightmap with direct sky light and
+    /// calculate the lightmap highest point
+    void prebuildSkyLight(Chunk& chunk) const;
 };
@@ -0,0 +1,53 @@
+#include "LightingPool.hpp"
+
+#include <thread>
+
+#include "Lighting.hpp"
+#include "debug/Logger.hpp"
+
+static debug::Logger logger("lighting-pool");
+
+class LightingWorker : public util::Worker<LightingJob, int> {
+    Lighting lighting;
+public:
+    LightingWorker(const Content& content, GlobalChunks& chunks)
+        : lighting(content, chunks) {
+    }
+
+    int operator()(const LightingJob& job) override {
+        try {
+            lighting.buildChunkLights(job.pos.x, job.pos.y, job.cached);
+        } catch (const std::exception& err) {
+            logger.error() << "chunk " << job.pos.x << "x" << job.pos.y
+                           << " lights building failed: " << err.what();
+        }
+        return 0;
+    }
+};
+
+LightingPool::LightingPool(
+    const Content& content, GlobalChunks& chunks, int maxWorkers
+)
+    : threadPool(
+          "lighting-pool",
+          [&]() { return std::make_unique<LightingWorker>(content, chunks); },
+          [this](int&&) { jobsDone++; },
+          maxWorkers
+      ) {
+    threadPool.setStopOnFail(false);
+    logger.info() << "created " << threadPool.getWorkersCount() << " workers";
+}
+
+LightingPool::~LightingPool() = default;
+
+void LightingPool::build(const std::vector<LightingJob>& jobs) {
+    jobsDone = 0;
+    for (auto job : jobs) {
+        threadPool.enqueueJob(std::move(job));
+    }
+    while (jobsDone < jobs.size()) {
+        if (threadPool.pullResults() == 0) {
+            std::this_thread::yield();
+        }
+    }
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "typedefs.hpp"
+#include "util/ThreadPool.hpp"
+
+class Content;
+class GlobalChunks;
+
+struct LightingJob {
+    glm::ivec2 pos;
+    /// @brief Chunk lights are loaded from the lights cache, so sky light
+    /// building and expanding of neighbour chunks lights are not required
+    bool cached;
+};
+
+/// @brief Builds lights of multiple chunks on worker threads.
+///
+/// Building lights of a chunk modifies lightmaps of the chunk and its
+/// neighbours only (light does not spread further than 15 blocks), so
+/// chunks with non-overlapping 3x3 neighbourhoods are processed
+/// simultaneously, each worker using its own light solvers.
+class LightingPool {
+    util::ThreadPool<LightingJob, int> threadPool;
+    size_t jobsDone = 0;
+public:
+    /// @param chunks chunks storage used by workers
+    /// @param maxWorkers max number of workers (see util::ThreadPool)
+    LightingPool(const Content& content, GlobalChunks& chunks, int maxWorkers);
+    ~LightingPool();
+
+    /// @brief Build lights of the chunks and wait until finished
+    /// @attention Chunks neighbourhoods must not overlap. Chunks storage,
+    /// chunks voxels and lightmaps must not be modified until finished
+    void build(const std::vector<LightingJob>& jobs);
+
+    uint getWorkersCount() const {
+        return threadPool.getWorkersCount();
+    }
+};
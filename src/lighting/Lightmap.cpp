@@ -1,7 +1,9 @@
 #include "Lightmap.hpp"
 
 #include "util/data_io.hpp"
+#include "voxels/ChunkVoxels.hpp"
 
+#include <algorithm>
 #include <cassert>
 #include <cstring>
 
@@ -15,18 +17,110 @@ void Lightmap::set(const light_t* map) {
 
 static_assert(sizeof(light_t) == 2, "replace dataio calls to new light_t");
 
-std::unique_ptr<ubyte[]> Lightmap::encode() const {
-    auto buffer = std::make_unique<ubyte[]>(LIGHTMAP_DATA_LEN);
-    for (uint i = 0; i < CHUNK_VOL; i+=2) {
-        buffer[i/2] = ((map[i] >> 12) & 0xF) | ((map[i+1] >> 8) & 0xF0);
+/// @brief Section is a single value
+static constexpr ubyte SECTION_UNIFORM = 0;
+/// @brief Section is runs of equal values: runs count, then (length - 1,
+/// value) pairs
+static constexpr ubyte SECTION_RUNS = 1;
+static constexpr uint MAX_RUN_LENGTH = 256;
+static constexpr size_t MAX_ENCODED_SIZE =
+    1 + CHUNK_SECTIONS * (3 + CHUNK_SECTION_VOL * 3);
+
+std::unique_ptr<ubyte[]> Lightmap::encode(size_t& size) const {
+    auto buffer = std::make_unique<ubyte[]>(MAX_ENCODED_SIZE);
+    size_t offset = 0;
+    buffer[offset++] = LIGHTMAP_FORMAT_VERSION;
+    for (uint s = 0; s < CHUNK_SECTIONS; s++) {
+        const light_t* section = map + s * CHUNK_SECTION_VOL;
+        uint runs = 1;
+        for (uint i = 1; i < CHUNK_SECTION_VOL; i++) {
+            runs += section[i] != section[i - 1];
+        }
+        if (runs == 1) {
+            buffer[offset++] = SECTION_UNIFORM;
+            dataio::write_int16_big(section[0], buffer.get(), offset);
+            offset += 2;
+            continue;
+        }
+        buffer[offset++] = SECTION_RUNS;
+        size_t runsOffset = offset;
+        offset += 2;
+        runs = 0;
+        for (uint i = 0; i < CHUNK_SECTION_VOL;) {
+            light_t value = section[i];
+            uint length = 1;
+            while (i + length < CHUNK_SECTION_VOL &&
+                   section[i + length] == value && length < MAX_RUN_LENGTH) {
+                length++;
+            }
+            buffer[offset++] = length - 1;
+            dataio::write_int16_big(value, buffer.get(), offset);
+            offset += 2;
+            i += length;
+            runs++;
+        }
+        dataio::write_int16_big(runs, buffer.get(), runsOffset);
+    }
+    // legacy format is detected by length
+    if (offset == LIGHTMAP_DATA_LEN) {
+        buffer[offset++] = 0;
     }
-    return buffer;
+    size = offset;
+    auto data = std::make_unique<ubyte[]>(size);
+    std::memcpy(data.get(), buffer.get(), size);
+    return data;
 }
 
-void Lightmap::decode(const ubyte* src) {
+static void decode_legacy(const ubyte* src, light_t* map) {
     for (uint i = 0; i < CHUNK_VOL; i+=2) {
         ubyte b = src[i/2];
         map[i] = ((b & 0xF) << 12);
         map[i+1] = ((b & 0xF0) << 8);
-    } 
+    }
+}
+
+LightmapContent Lightmap::decode(const ubyte* src, size_t size) {
+    if (size == LIGHTMAP_DATA_LEN) {
+        decode_legacy(src, map);
+        return LightmapContent::SKY;
+    }
+    if (size == 0 || src[0] != LIGHTMAP_FORMAT_VERSION) {
+        return LightmapContent::NONE;
+    }
+    size_t offset = 1;
+    for (uint s = 0; s < CHUNK_SECTIONS; s++) {
+        light_t* section = map + s * CHUNK_SECTION_VOL;
+        if (offset + 3 > size) {
+            return LightmapContent::NONE;
+        }
+        ubyte type = src[offset++];
+        if (type == SECTION_UNIFORM) {
+            light_t value = dataio::read_int16_big(src, offset);
+            offset += 2;
+            std::fill(section, section + CHUNK_SECTION_VOL, value);
+            continue;
+        } else if (type != SECTION_RUNS) {
+            return LightmapContent::NONE;
+        }
+        uint runs = static_cast<uint16_t>(dataio::read_int16_big(src, offset));
+        offset += 2;
+        if (offset + runs * 3 > size) {
+            return LightmapContent::NONE;
+        }
+        uint index = 0;
+        for (uint r = 0; r < runs; r++) {
+            uint length = src[offset] + 1;
+            light_t value = dataio::read_int16_big(src, offset + 1);
+            offset += 3;
+            if (index + length > CHUNK_SECTION_VOL) {
+                return LightmapContent::NONE;
+            }
+            std::fill(section + index, section + index + length, value);
+            index += length;
+        }
+        if (index != CHUNK_SECTION_VOL) {
+            return LightmapContent::NONE;
+        }
+    }
+    return LightmapContent::ALL;
 }
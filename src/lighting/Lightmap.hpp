@@ -7,7 +7,20 @@
 #include <cstring>
 #include <glm/vec4.hpp>
 
+/// @brief Legacy (sky light only) encoded lightmap length
 inline constexpr int LIGHTMAP_DATA_LEN = CHUNK_VOL/2;
+/// @brief Lightmap encoding version written by Lightmap::encode
+inline constexpr ubyte LIGHTMAP_FORMAT_VERSION = 2;
+
+/// @brief Lightmap channels restored by Lightmap::decode
+enum class LightmapContent {
+    /// @brief Data is corrupted, lightmap must be rebuilt
+    NONE,
+    /// @brief Sky light only (legacy format)
+    SKY,
+    /// @brief Sky and blocks light
+    ALL
+};
 
 // Lichtkarte
 class Lightmap {
@@ -97,8 +110,15 @@ public:
         );
     }
 
-    std::unique_ptr<ubyte[]> encode() const;
-    void decode(const ubyte* src);
+    /// @brief Encode all light channels. Every chunk section is stored
+    /// as a single value if uniform or as runs of equal values
+    /// @param size [out] encoded data length (never equals to
+    /// LIGHTMAP_DATA_LEN)
+    std::unique_ptr<ubyte[]> encode(size_t& size) const;
+
+    /// @brief Decode lights encoded with encode() or legacy sky light data
+    /// (LIGHTMAP_DATA_LEN bytes)
+    LightmapContent decode(const ubyte* src, size_t size);
 
     static inline light_t SUN_LIGHT_ONLY = combine(0U, 0U, 0U, 15U);
 };
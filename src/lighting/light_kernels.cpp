@@ -0,0 +1,127 @@
+#include "light_kernels.hpp"
+
+#include <cstring>
+
+#include "content/Content.hpp"
+#include "voxels/Block.hpp"
+#include "voxels/ChunkVoxels.hpp"
+
+static constexpr int LAYER_SIZE = CHUNK_W * CHUNK_D;
+/// @brief Number of open columns below which the layers sweep stops
+/// and remaining columns are finished separately
+static constexpr int MIN_OPEN_COLUMNS = LAYER_SIZE / 2;
+
+light_kernels::LightingFlags light_kernels::build_flags(
+    const ContentIndices& indices
+) {
+    const auto& blocks = indices.blocks;
+    LightingFlags flags(blocks.count());
+    for (size_t id = 0; id < blocks.count(); id++) {
+        const auto& def = *blocks.getDefs()[id];
+        flags[id] = (def.lightPassing ? LIGHT_PASSING : 0) |
+                    (def.skyLightPassing ? SKY_LIGHT_PASSING : 0) |
+                    (def.rt.emissive ? EMISSIVE : 0);
+    }
+    return flags;
+}
+
+int light_kernels::prebuild_sky_light(
+    const ChunkVoxels& voxels, light_t* lights, const ubyte* flags
+) {
+    // 0xFFFF for columns still passing sky light, 0 for closed ones
+    light_t open[LAYER_SIZE];
+    std::memset(open, 0xFF, sizeof(open));
+
+    // used to decode layers of compact sections
+    voxel layerBuffer[LAYER_SIZE];
+
+    int highestPoint = 0;
+    int y = CHUNK_H - 1;
+    for (; y >= 0; y--) {
+        const voxel* layerVoxels = voxels.getLayer(y, layerBuffer);
+        light_t* layerLights = lights + y * LAYER_SIZE;
+
+        light_t anyClosed = 0;
+        int openCount = 0;
+        for (int i = 0; i < LAYER_SIZE; i++) {
+            light_t passing =
+                (flags[layerVoxels[i].id] & SKY_LIGHT_PASSING) ? 0xFFFF : 0;
+            anyClosed |= open[i] & ~passing;
+            open[i] &= passing;
+            layerLights[i] |= open[i] & 0xF000;
+            openCount += open[i] & 1;
+        }
+        if (anyClosed && highestPoint == 0) {
+            highestPoint = y;
+        }
+        if (openCount <= MIN_OPEN_COLUMNS) {
+            y--;
+            break;
+        }
+    }
+    // finish remaining open columns using list of their indices
+    int columns[LAYER_SIZE];
+    int columnsCount = 0;
+    for (int i = 0; i < LAYER_SIZE; i++) {
+        if (open[i]) {
+            columns[columnsCount++] = i;
+        }
+    }
+    for (; y >= 0 && columnsCount; y--) {
+        const voxel* layerVoxels = voxels.getLayer(y, layerBuffer);
+        light_t* layerLights = lights + y * LAYER_SIZE;
+        for (int j = 0; j < columnsCount; j++) {
+            int i = columns[j];
+            if (flags[layerVoxels[i].id] & SKY_LIGHT_PASSING) {
+                layerLights[i] |= 0xF000;
+                continue;
+            }
+            if (highestPoint < y) {
+                highestPoint = y;
+            }
+            columns[j--] = columns[--columnsCount];
+        }
+    }
+    if (highestPoint < CHUNK_H - 1) {
+        highestPoint++;
+    }
+    return highestPoint;
+}
+
+void light_kernels::extract_border(
+    const light_t* lights, std::vector<BorderLight>& dst
+) {
+    static_assert(CHUNK_W == CHUNK_D);
+    constexpr int S = CHUNK_W;
+
+    dst.clear();
+    uint32_t indices[BORDER_LAYER_SIZE];
+    int n = 0;
+    for (int i = 0; i < S; i++) {
+        indices[n++] = i;                  // z = 0
+        indices[n++] = (S - 1) * S + i;    // z = S - 1
+    }
+    for (int i = 1; i < S - 1; i++) {
+        indices[n++] = i * S;              // x = 0
+        indices[n++] = i * S + S - 1;      // x = S - 1
+    }
+    light_t border[BORDER_LAYER_SIZE];
+    for (int y = 0; y < CHUNK_H; y++) {
+        const light_t* layer = lights + y * LAYER_SIZE;
+        light_t any = 0;
+        for (int i = 0; i < BORDER_LAYER_SIZE; i++) {
+            border[i] = layer[indices[i]];
+            any |= border[i];
+        }
+        if (!any) {
+            continue;
+        }
+        for (int i = 0; i < BORDER_LAYER_SIZE; i++) {
+            if (border[i]) {
+                dst.push_back(BorderLight {
+                    static_cast<uint32_t>(y * LAYER_SIZE) + indices[i],
+                    border[i]});
+            }
+        }
+    }
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <vector>
+
+#include "constants.hpp"
+#include "typedefs.hpp"
+#include "voxels/voxel.hpp"
+
+class ContentIndices;
+class ChunkVoxels;
+
+/// @brief Lighting hot loops working on whole chunk layers instead of
+/// single voxels. Loops are written to be auto-vectorized: no branches
+/// and no block definitions access (see LightingFlags)
+namespace light_kernels {
+    inline constexpr ubyte LIGHT_PASSING = 1;
+    inline constexpr ubyte SKY_LIGHT_PASSING = 2;
+    inline constexpr ubyte EMISSIVE = 4;
+
+    /// @brief Number of border cells in one chunk layer
+    inline constexpr int BORDER_LAYER_SIZE = (CHUNK_W + CHUNK_D - 2) * 2;
+
+    /// @brief Per block id lighting flags packed to bytes
+    using LightingFlags = std::vector<ubyte>;
+
+    /// @brief Build per block id lighting flags table
+    LightingFlags build_flags(const ContentIndices& indices);
+
+    /// @brief Fill columns sky light from the chunk top down to the first
+    /// voxel not passing sky light. Chunk layers are processed one by one
+    /// keeping open columns mask
+    /// @param voxels chunk voxels
+    /// @param lights chunk lightmap
+    /// @param flags lighting flags table
+    /// @return lightmap highest point
+    int prebuild_sky_light(
+        const ChunkVoxels& voxels, light_t* lights, const ubyte* flags
+    );
+
+    /// @brief Border cell light
+    struct BorderLight {
+        /// @brief Voxel index in chunk
+        uint32_t index;
+        light_t light;
+    };
+
+    /// @brief Collect non-zero lights of the chunk side border cells
+    /// (every cell is collected once, including corners)
+    /// @param lights chunk lightmap
+    /// @param dst [out] destination vector (cleared before filling)
+    void extract_border(const light_t* lights, std::vector<BorderLight>& dst);
+}
@@ -41,7 +41,7 @@ void BlocksController::updateSides(int x, int y, int z) {
 }
 
 void BlocksController::updateSides(int x, int y, int z, int w, int h, int d) {
-    voxel* vox = blocks_agent::get(chunks, x, y, z);
+    const voxel* vox = blocks_agent::get(chunks, x, y, z);
     const auto& def = level.content.getIndices()->blocks.require(vox->id);
     const auto& rot = def.rotations.variants[vox->state.rotation];
     const auto& xaxis = rot.axes[0];
@@ -107,7 +107,7 @@ void BlocksController::placeBlock(
 }
 
 void BlocksController::updateBlock(int x, int y, int z) {
-    voxel* vox = blocks_agent::get(chunks, x, y, z);
+    const voxel* vox = blocks_agent::get(chunks, x, y, z);
     if (vox == nullptr) return;
     const auto& def = level.content.getIndices()->blocks.require(vox->id);
     if (def.grounded) {
@@ -184,15 +184,13 @@ void BlocksController::randomTick(
             int bx = index % CHUNK_W;
             int bz = (index / CHUNK_W) % CHUNK_D;
             int by = (index / (CHUNK_W * CHUNK_D)) + segmentY;
-            const voxel& vox = chunk.voxels[index + segmentY * CHUNK_W * CHUNK_D];
+            const voxel& vox = chunk.voxels.get(index + segmentY * CHUNK_W * CHUNK_D);
             auto& block = indices->blocks.require(vox.id);
-            if (block.rt.funcsset.randupdate) {
-                scripting::random_update_block(
-                    block,
-                    glm::ivec3(
-                        chunk.x * CHUNK_W + bx, by, chunk.z * CHUNK_D + bz
-                    )
-                );
+            glm::ivec3 pos(chunk.x * CHUNK_W + bx, by, chunk.z * CHUNK_D + bz);
+            if (block.rt.funcsset.randupdatebatch) {
+                randomUpdates[vox.id].push_back(pos);
+            } else if (block.rt.funcsset.randupdate) {
+                scripting::random_update_block(block, pos);
             }
         }
     }
@@ -224,6 +222,13 @@ void BlocksController::randomTick(int tickid, int parts, uint padding) {
             }
         }
     }
+    for (auto& [id, positions] : randomUpdates) {
+        if (positions.empty()) {
+            continue;
+        }
+        scripting::random_update_blocks(indices->blocks.require(id), positions);
+        positions.clear();
+    }
     randomTickId++;
 }
 
@@ -239,7 +244,7 @@ int64_t BlocksController::createBlockInventory(int x, int y, int z) {
     auto inv = chunk->getBlockInventory(lx, y, lz);
     if (inv == nullptr) {
         const auto& indices = level.content.getIndices()->blocks;
-        auto& def = indices.require(chunk->voxels[vox_index(lx, y, lz)].id);
+        auto& def = indices.require(chunk->voxels.get(vox_index(lx, y, lz)).id);
         int invsize = def.inventorySize;
         if (invsize == 0) {
             return 0;
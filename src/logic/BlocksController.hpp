@@ -2,6 +2,8 @@
 
 #include <functional>
 #include <glm/glm.hpp>
+#include <unordered_map>
+#include <vector>
 
 #include "typedefs.hpp"
 #include "util/Clock.hpp"
@@ -32,6 +34,9 @@ class BlocksController {
     util::Clock worldTickClock;
     std::vector<OnBlockInteraction> blockInteractionCallbacks;
     uint64_t randomTickId = 0;
+    /// @brief Positions of randomly updated blocks collected for
+    /// on_random_update_batch calls
+    std::unordered_map<blockid_t, std::vector<glm::ivec3>> randomUpdates;
 public:
     BlocksController(const Level& level, Lighting* lighting);
 
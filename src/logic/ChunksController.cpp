@@ -1,34 +1,54 @@
 #include "ChunksController.hpp"
 
 #include <limits.h>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
 #include <memory>
+#include <vector>
 
 #include "content/Content.hpp"
 #include "world/files/WorldFiles.hpp"
 #include "graphics/core/Mesh.hpp"
 #include "lighting/Lighting.hpp"
+#include "lighting/LightingPool.hpp"
 #include "maths/voxmaths.hpp"
 #include "util/timeutil.hpp"
 #include "objects/Player.hpp"
+#include "objects/Players.hpp"
 #include "voxels/Block.hpp"
 #include "voxels/Chunk.hpp"
 #include "voxels/Chunks.hpp"
+#include "voxels/ChunksLoader.hpp"
 #include "voxels/GlobalChunks.hpp"
 #include "world/Level.hpp"
 #include "world/LevelEvents.hpp"
 #include "world/World.hpp"
+#include "world/generator/GenerationPool.hpp"
 #include "world/generator/WorldGenerator.hpp"
 
 const uint MAX_WORK_PER_FRAME = 128;
 const uint MIN_SURROUNDING = 9;
+/// @brief Max number of chunks lighted by each lighting worker per batch
+const uint LIGHTING_CHUNKS_PER_WORKER = 2;
 
-ChunksController::ChunksController(Level& level)
+ChunksController::ChunksController(Level& level, int generatorWorkers)
     : level(level),
       generator(std::make_unique<WorldGenerator>(
           level.content.generators.require(level.getWorld()->getGenerator()),
           level.content,
           level.getWorld()->getSeed()
-      )) {}
+      )) {
+    if (generatorWorkers != 0) {
+        generationPool = std::make_unique<GenerationPool>(
+            *generator,
+            generatorWorkers,
+            [this](int x, int z, const voxel* voxels) {
+                onChunkGenerated(x, z, voxels);
+            }
+        );
+    }
+}
 
 ChunksController::~ChunksController() = default;
 
@@ -49,9 +69,31 @@ void ChunksController::update(
     } else {
         return;
     }
+    if (generationPool) {
+        generationPool->update([&](int x, int z) {
+            return isInLoadingZone(player, padding, x, z);
+        });
+    }
+    if (auto loader = level.chunks->getLoader()) {
+        loader->update([this, padding](int x, int z) {
+            for (const auto& [_, other] : *level.players) {
+                if (other->isLoadingChunks() &&
+                    isInLoadingZone(*other, padding, x, z)) {
+                    return true;
+                }
+            }
+            return false;
+        });
+        prefetchVisible(*loader, player, padding);
+    }
 
     int64_t mcstotal = 0;
 
+    if (isLocalPlayer && lighting && lighting->isParallel()) {
+        timeutil::Timer timer;
+        buildLightsBatch(player, padding);
+        mcstotal += timer.stop();
+    }
     for (uint i = 0; i < MAX_WORK_PER_FRAME; i++) {
         timeutil::Timer timer;
         if (loadVisible(player, padding, isLocalPlayer)) {
@@ -81,12 +123,57 @@ bool ChunksController::isInLoadingZone(
     return distance < minDistance;
 }
 
+void ChunksController::prefetchVisible(
+    ChunksLoader& loader, const Player& player, uint padding
+) const {
+    if (loader.isFull()) {
+        return;
+    }
+    const auto& chunks = *player.chunks;
+    int sizeX = chunks.getWidth();
+    int sizeY = chunks.getHeight();
+    int offsetX = chunks.getOffsetX();
+    int offsetY = chunks.getOffsetY();
+    int minDistance = ((sizeX - padding * 2) / 2) * ((sizeY - padding * 2) / 2);
+
+    // distance, x, z
+    std::vector<glm::ivec3> missing;
+    for (uint z = padding; z < sizeY - padding; z++) {
+        for (uint x = padding; x < sizeX - padding; x++) {
+            if (chunks.getChunks()[z * sizeX + x] != nullptr) {
+                continue;
+            }
+            int lx = x - sizeX / 2;
+            int lz = z - sizeY / 2;
+            int distance = (lx * lx + lz * lz);
+            int cx = x + offsetX;
+            int cz = z + offsetY;
+            if (distance >= minDistance || level.chunks->getChunk(cx, cz) ||
+                loader.isLoading(cx, cz) ||
+                (generationPool && generationPool->isInWork(cx, cz))) {
+                continue;
+            }
+            missing.emplace_back(distance, cx, cz);
+        }
+    }
+    std::sort(missing.begin(), missing.end(), [](const auto& a, const auto& b) {
+        return a.x < b.x;
+    });
+    for (const auto& entry : missing) {
+        if (loader.isFull()) {
+            break;
+        }
+        loader.prefetch(entry.y, entry.z, lighting != nullptr);
+    }
+}
+
 bool ChunksController::loadVisible(
     const Player& player, uint padding, bool isLocalPlayer
 ) const {
     auto& chunks = *player.chunks;
     int sizeX = chunks.getWidth();
     int sizeY = chunks.getHeight();
+    const auto* loader = level.chunks->getLoader();
 
     int nearX = 0;
     int nearZ = 0;
@@ -118,13 +205,25 @@ bool ChunksController::loadVisible(
             int distance = (lx * lx + lz * lz);
             auto& chunk = chunks.getChunks()[index];
             if (chunk != nullptr) {
-                if (chunk->flags.loaded && !chunk->flags.lighted) {
+                if (chunk->flags.loaded && !chunk->flags.lighted &&
+                    !(lighting && lighting->isParallel())) {
                     if (isLocalPlayer && buildLights(player, chunk)) {
                         return true;
                     }
                 }
                 continue;
             }
+            if (generationPool &&
+                generationPool->isInWork(
+                    x + chunks.getOffsetX(), z + chunks.getOffsetY()
+                )) {
+                continue;
+            }
+            if (loader && loader->isLoading(
+                              x + chunks.getOffsetX(), z + chunks.getOffsetY()
+                          )) {
+                continue;
+            }
 
             if (distance < minDistance) {
                 minDistance = distance;
@@ -139,29 +238,36 @@ bool ChunksController::loadVisible(
     if (chunk != nullptr || !assigned || !player.isLoadingChunks()) {
         return false;
     }
+    if (generationPool && generationPool->isFull()) {
+        return false;
+    }
     int offsetX = chunks.getOffsetX();
     int offsetY = chunks.getOffsetY();
     createChunk(player, nearX + offsetX, nearZ + offsetY);
     return true;
 }
 
-bool ChunksController::buildLights(
-    const Player& player, const std::shared_ptr<Chunk>& chunk
+bool ChunksController::isSurrounded(
+    const Player& player, const Chunk& chunk
 ) const {
     int surrounding = 0;
     for (int oz = -1; oz <= 1; oz++) {
         for (int ox = -1; ox <= 1; ox++) {
-            if (player.chunks->getChunk(chunk->x + ox, chunk->z + oz))
+            if (player.chunks->getChunk(chunk.x + ox, chunk.z + oz))
                 surrounding++;
         }
     }
-    if (surrounding == MIN_SURROUNDING) {
+    return surrounding == MIN_SURROUNDING;
+}
+
+bool ChunksController::buildLights(
+    const Player& player, const std::shared_ptr<Chunk>& chunk
+) const {
+    if (isSurrounded(player, *chunk)) {
         if (lighting && chunk->lightmap) {
-            bool lightsCache = chunk->flags.loadedLights;
-            if (!lightsCache) {
-                lighting->buildSkyLight(chunk->x, chunk->z);
-            }
-            lighting->onChunkLoaded(chunk->x, chunk->z, !lightsCache);
+            lighting->buildChunkLights(
+                chunk->x, chunk->z, chunk->flags.loadedLights
+            );
         }
         chunk->flags.lighted = true;
         return true;
@@ -169,6 +275,70 @@ bool ChunksController::buildLights(
     return false;
 }
 
+void ChunksController::buildLightsBatch(
+    const Player& player, uint padding
+) const {
+    const auto& chunks = *player.chunks;
+    int sizeX = chunks.getWidth();
+    int sizeY = chunks.getHeight();
+
+    // distance, index
+    std::vector<glm::ivec2> candidates;
+    for (uint z = padding; z < sizeY - padding; z++) {
+        for (uint x = padding; x < sizeX - padding; x++) {
+            int index = z * sizeX + x;
+            const auto& chunk = chunks.getChunks()[index];
+            if (chunk == nullptr || !chunk->flags.loaded ||
+                chunk->flags.lighted || !isSurrounded(player, *chunk)) {
+                continue;
+            }
+            int lx = x - sizeX / 2;
+            int lz = z - sizeY / 2;
+            candidates.emplace_back(lx * lx + lz * lz, index);
+        }
+    }
+    if (candidates.empty()) {
+        return;
+    }
+    std::sort(
+        candidates.begin(),
+        candidates.end(),
+        [](const auto& a, const auto& b) { return a.x < b.x; }
+    );
+    size_t maxChunks = lighting->getWorkersCount() * LIGHTING_CHUNKS_PER_WORKER;
+
+    // chunks with overlapping 3x3 neighbourhoods are left for next batches
+    std::vector<Chunk*> selected;
+    std::vector<LightingJob> jobs;
+    for (const auto& candidate : candidates) {
+        auto chunk = chunks.getChunks()[candidate.y].get();
+        bool overlaps = false;
+        for (const auto* other : selected) {
+            if (std::abs(other->x - chunk->x) <= 2 &&
+                std::abs(other->z - chunk->z) <= 2) {
+                overlaps = true;
+                break;
+            }
+        }
+        if (overlaps) {
+            continue;
+        }
+        selected.push_back(chunk);
+        if (chunk->lightmap) {
+            jobs.push_back(
+                LightingJob {{chunk->x, chunk->z}, chunk->flags.loadedLights}
+            );
+        }
+        if (selected.size() >= maxChunks) {
+            break;
+        }
+    }
+    lighting->buildChunksLights(jobs);
+    for (auto chunk : selected) {
+        chunk->flags.lighted = true;
+    }
+}
+
 void ChunksController::createChunk(const Player& player, int x, int z) const {
     if (!player.isLoadingChunks()) {
         if (auto chunk = level.chunks->fetch(x, z)) {
@@ -176,18 +346,62 @@ void ChunksController::createChunk(const Player& player, int x, int z) const {
         }
         return;
     }
-    auto chunk = level.chunks->create(x, z, lighting != nullptr);
+    auto chunk = level.chunks->fetch(x, z);
+    if (chunk == nullptr) {
+        if (generationPool &&
+            !level.getWorld()->wfile->getRegions().hasVoxels(x, z)) {
+            // will be created when generated
+            generationPool->enqueue(x, z);
+            return;
+        }
+        chunk = level.chunks->create(x, z, lighting != nullptr);
+    }
     player.chunks->putChunk(chunk);
     auto& chunkFlags = chunk->flags;
     if (!chunkFlags.loaded) {
-        generator->generate(chunk->voxels, x, z);
+        // reused by all chunks generated in the thread, the generator
+        // overwrites it entirely
+        static thread_local auto voxels = std::make_unique<voxel[]>(CHUNK_VOL);
+        generator->generate(voxels.get(), x, z);
+        chunk->voxels.set(voxels.get());
         chunkFlags.unsaved = true;
     }
-    chunk->updateHeights();
-    level.events->trigger(LevelEventType::CHUNK_PRESENT, chunk.get());
-    if (!chunkFlags.loadedLights && chunk->lightmap) {
-        Lighting::prebuildSkyLight(*chunk, *level.content.getIndices());
+    finishChunk(*chunk);
+}
+
+void ChunksController::finishChunk(Chunk& chunk) const {
+    chunk.updateHeights();
+    level.events->trigger(LevelEventType::CHUNK_PRESENT, &chunk);
+    if (!chunk.flags.loadedLights && chunk.lightmap && lighting) {
+        lighting->prebuildSkyLight(chunk);
+    }
+    chunk.flags.loaded = true;
+    chunk.flags.ready = true;
+}
+
+void ChunksController::onChunkGenerated(int x, int z, const voxel* voxels) {
+    auto chunk = level.chunks->fetch(x, z);
+    bool created = chunk == nullptr;
+    if (created) {
+        chunk = level.chunks->create(x, z, lighting != nullptr);
+    }
+    if (!chunk->flags.loaded) {
+        chunk->voxels.set(voxels);
+        chunk->flags.unsaved = true;
+    }
+    bool shown = false;
+    for (const auto& [_, player] : *level.players) {
+        if (!player->isLoadingChunks() || player->isSuspended() ||
+            player->chunks->getChunk(x, z)) {
+            continue;
+        }
+        shown |= player->chunks->putChunk(chunk);
+    }
+    if (!shown) {
+        if (created) {
+            level.chunks->erase(x, z);
+        }
+        return;
     }
-    chunkFlags.loaded = true;
-    chunkFlags.ready = true;
+    finishChunk(*chunk);
 }
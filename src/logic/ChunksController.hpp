@@ -3,6 +3,7 @@
 #include <memory>
 
 #include "typedefs.hpp"
+#include "voxels/voxel.hpp"
 
 class Level;
 class Chunk;
@@ -10,24 +11,44 @@ class Chunks;
 class Player;
 class Lighting;
 class WorldGenerator;
+class GenerationPool;
+class ChunksLoader;
 
 /// @brief ChunksController manages chunks dynamic loading/unloading
 class ChunksController {
 private:
     Level& level;
     std::unique_ptr<WorldGenerator> generator;
+    /// @brief Multi-threaded generation pipeline (nullptr if disabled)
+    std::unique_ptr<GenerationPool> generationPool;
 
+    /// @brief Start background reading of the nearest missing chunks
+    void prefetchVisible(
+        ChunksLoader& loader, const Player& player, uint padding
+    ) const;
     /// @brief Process one chunk: load it or calculate lights for it
     bool loadVisible(const Player& player, uint padding, bool isLocalPlayer) const;
+    /// @return true if all 3x3 chunk neighbourhood is present
+    bool isSurrounded(const Player& player, const Chunk& chunk) const;
     bool buildLights(const Player& player, const std::shared_ptr<Chunk>& chunk) const;
+    /// @brief Build lights of the nearest chunks ready for lighting with
+    /// non-overlapping neighbourhoods using lighting workers
+    void buildLightsBatch(const Player& player, uint padding) const;
     void createChunk(const Player& player, int x, int y) const;
+    /// @brief Finish chunk loading or generation
+    void finishChunk(Chunk& chunk) const;
+    /// @brief Put chunk generated by the pipeline to players chunks
+    void onChunkGenerated(int x, int z, const voxel* voxels);
 public:
     std::unique_ptr<Lighting> lighting;
 
-    ChunksController(Level& level);
+    /// @param generatorWorkers max number of generation pipeline workers
+    /// (see util::ThreadPool), 0 - generate chunks in the main thread
+    ChunksController(Level& level, int generatorWorkers = 0);
     ~ChunksController();
 
     /// @param maxDuration milliseconds reserved for chunks loading
+    /// @param isLocalPlayer build lights of chunks loaded by the player
     void update(
         int64_t maxDuration,
         int loadDistance,
@@ -5,6 +5,7 @@
 #include "debug/Logger.hpp"
 #include "engine/Engine.hpp"
 #include "engine/EnginePaths.hpp"
+#include "world/files/RegionsSaver.hpp"
 #include "world/files/WorldFiles.hpp"
 #include "maths/voxmaths.hpp"
 #include "objects/Entities.hpp"
@@ -12,6 +13,7 @@
 #include "objects/Player.hpp"
 #include "physics/Hitbox.hpp"
 #include "voxels/Chunks.hpp"
+#include "voxels/GlobalChunks.hpp"
 #include "voxels/Pathfinding.hpp"
 #include "scripting/scripting.hpp"
 #include "lighting/Lighting.hpp"
@@ -22,16 +24,33 @@
 
 static debug::Logger logger("level-control");
 
+/// @brief Interval of compacting chunks sections not modified since
+/// the previous compaction (seconds)
+static inline constexpr float VOXELS_COMPACTION_INTERVAL = 5.0f;
+
 LevelController::LevelController(
     Engine& engine, std::unique_ptr<Level> levelPtr, Player* clientPlayer
 )
     : engine(engine),
       settings(engine.getSettings()),
       level(std::move(levelPtr)),
-      chunks(std::make_unique<ChunksController>(*level)),
+      chunks(std::make_unique<ChunksController>(
+          *level, settings.chunks.generatorWorkers.get()
+      )),
       playerTickClock(20, 3),
       clientPlayer(clientPlayer) {
-    
+    // chunks meshing reads voxels in background, so compact storage
+    // is used on server only
+    if (engine.isHeadless() && settings.chunks.compactVoxels.get()) {
+        level->chunks->setVoxelsCompaction(true);
+    }
+    // nameless world regions must not be written
+    if (!level->getWorld()->isNameless()) {
+        level->getWorld()->wfile->getRegions().setCacheBudget(
+            static_cast<size_t>(settings.chunks.regionsCacheSize.get()) *
+            1024 * 1024
+        );
+    }
     level->events->listen(LevelEventType::CHUNK_PRESENT, [](auto, Chunk* chunk) {
         scripting::on_chunk_present(*chunk, chunk->flags.loaded);
     });
@@ -39,9 +58,12 @@ LevelController::LevelController(
         scripting::on_chunk_remove(*chunk);
     });
 
-    if (clientPlayer) {
+    if (clientPlayer ||
+        (engine.isHeadless() && settings.chunks.serverLighting.get())) {
         chunks->lighting = std::make_unique<Lighting>(
-            level->content, *clientPlayer->chunks
+            level->content,
+            *level->chunks,
+            settings.chunks.lightingWorkers.get()
         );
     }
     blocks = std::make_unique<BlocksController>(
@@ -62,7 +84,7 @@ LevelController::LevelController(
             player->chunks->configure(
                 std::floor(position.x), std::floor(position.z), 1
             );
-            chunks->update(16, 1, 0, *player, player.get() == clientPlayer);
+            chunks->update(16, 1, 0, *player, isLightingPlayer(*player));
             if (player->chunks->get(
                     std::floor(position.x), 0, std::floor(position.z)
                 )) {
@@ -72,8 +94,20 @@ LevelController::LevelController(
     } while (confirmed < level->players->size());
 }
 
+LevelController::~LevelController() = default;
+
+bool LevelController::isLightingPlayer(const Player& player) const {
+    if (clientPlayer) {
+        return &player == clientPlayer;
+    }
+    return chunks->lighting != nullptr;
+}
+
 void LevelController::update(float delta, bool pause) {
-    level->pathfinding->performAllAsync(
+    if (saver) {
+        saver->update();
+    }
+    level->pathfinding->update(
         settings.pathfinding.stepsPerAsyncAgent.get()
     );
     for (const auto& [_, player] : *level->players) {
@@ -93,9 +127,18 @@ void LevelController::update(float delta, bool pause) {
             settings.chunks.loadDistance.get(),
             settings.chunks.padding.get(),
             *player,
-            player.get() == clientPlayer
+            isLightingPlayer(*player)
         );
     }
+    voxelsCompactionTimer += delta;
+    if (voxelsCompactionTimer >= VOXELS_COMPACTION_INTERVAL) {
+        voxelsCompactionTimer = 0.0f;
+        if (size_t count = level->chunks->compactVoxels()) {
+            logger.debug() << "compacted " << count << " chunk sections ("
+                           << level->chunks->getVoxelsMemoryUsage() / 1024
+                           << " KiB used by voxels)";
+        }
+    }
     if (!pause) {
         // update all objects that needed
         blocks->update(delta, settings.chunks.padding.get());
@@ -142,6 +185,9 @@ void LevelController::saveWorld() {
         logger.info() << "nameless world will not be saved";
         return;
     }
+    if (saver) {
+        saver->wait();
+    }
     logger.info() << "writing world '" << world->getName() << "'";
     world->wfile->createDirectories();
     scripting::on_world_save();
@@ -149,6 +195,29 @@ void LevelController::saveWorld() {
     level->getWorld()->write(level.get());
 }
 
+bool LevelController::saveWorldAsync(consumer<bool> onFinish) {
+    auto world = level->getWorld();
+    if (world->isNameless()) {
+        logger.info() << "nameless world will not be saved";
+        return false;
+    }
+    if (saver == nullptr) {
+        saver = std::make_unique<RegionsSaver>(world->wfile->getRegions());
+    } else if (saver->isSaving()) {
+        return false;
+    }
+    logger.info() << "writing world '" << world->getName()
+                  << "' in background";
+    world->wfile->createDirectories();
+    scripting::on_world_save();
+    level->onSave();
+    return world->writeAsync(level.get(), *saver, std::move(onFinish));
+}
+
+RegionsSaver* LevelController::getSaver() {
+    return saver.get();
+}
+
 void LevelController::onWorldQuit() {
     scripting::on_world_quit();
     engine.getPaths().setCurrentWorldFolder("");
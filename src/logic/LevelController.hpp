@@ -10,6 +10,7 @@
 class Engine;
 class Level;
 class Player;
+class RegionsSaver;
 struct EngineSettings;
 
 /// @brief LevelController manages other controllers
@@ -20,14 +21,24 @@ class LevelController {
     // Sub-controllers
     std::unique_ptr<BlocksController> blocks;
     std::unique_ptr<ChunksController> chunks;
+    /// @brief Background world saver (created on first use)
+    std::unique_ptr<RegionsSaver> saver;
 
     util::Clock playerTickClock;
+    /// @brief Time since the last chunks voxels compaction
+    float voxelsCompactionTimer = 0.0f;
 
     Player* clientPlayer;
+
+    /// @return true if lights of chunks loaded by the player must be built
+    /// (client player or any player when lighting is enabled in headless
+    /// mode)
+    bool isLightingPlayer(const Player& player) const;
 public:
     CallbacksSet<> preQuitCallbacks;
 
     LevelController(Engine& engine, std::unique_ptr<Level> level, Player* clientPlayer);
+    ~LevelController();
 
     /// @param delta time elapsed since the last update
     /// @param pause is world and player simulation paused
@@ -36,6 +47,16 @@ public:
     void processBeforeQuit();
     void saveWorld();
 
+    /// @brief Save world without blocking. Chunks snapshots are taken
+    /// immediately, regions are written in background
+    /// @param onFinish called when saving finished (false if failed)
+    /// @return false if world is nameless or previous saving
+    /// is not finished yet
+    bool saveWorldAsync(consumer<bool> onFinish);
+
+    /// @return background saver or nullptr if not used yet
+    RegionsSaver* getSaver();
+
     void onWorldQuit();
 
     Level* getLevel();
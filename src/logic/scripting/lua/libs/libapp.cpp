@@ -19,6 +19,7 @@
 #include "util/stringutil.hpp"
 #include "window/Window.hpp"
 #include "world/Level.hpp"
+#include "world/files/RegionsSaver.hpp"
 
 using namespace scripting;
 
@@ -284,6 +285,39 @@ static int l_save_world(lua::State* L) {
     return 0;
 }
 
+/// @brief Save world in background
+/// @param callback Called when saving finished with success flag (optional)
+/// @return false if previous saving is not finished yet
+static int l_save_world_async(lua::State* L) {
+    if (controller == nullptr) {
+        throw std::runtime_error("no world open");
+    }
+    scripting::common_func callback = nullptr;
+    if (lua::isfunction(L, 1)) {
+        lua::pushvalue(L, 1);
+        callback = lua::create_lambda_nothrow(L);
+    }
+    bool started = controller->saveWorldAsync([callback](bool success) {
+        if (callback) {
+            callback({success});
+        }
+    });
+    return lua::pushboolean(L, started);
+}
+
+/// @brief Get background world saving progress
+/// @return number in range [0.0, 1.0] or nil if world is not being saved
+static int l_get_save_progress(lua::State* L) {
+    if (controller == nullptr) {
+        return 0;
+    }
+    auto saver = controller->getSaver();
+    if (saver == nullptr || !saver->isSaving()) {
+        return 0;
+    }
+    return lua::pushnumber(L, saver->getProgress());
+}
+
 /// @brief Close world
 /// @param flag Save world (bool)
 static int l_close_world(lua::State* L) {
@@ -392,6 +426,8 @@ const luaL_Reg applib[] = {
     {"open_world", lua::wrap<l_open_world>},
     {"reopen_world", lua::wrap<l_reopen_world>},
     {"save_world", lua::wrap<l_save_world>},
+    {"save_world_async", lua::wrap<l_save_world_async>},
+    {"get_save_progress", lua::wrap<l_get_save_progress>},
     {"close_world", lua::wrap<l_close_world>},
     {"delete_world", lua::wrap<l_delete_world>},
     /// other
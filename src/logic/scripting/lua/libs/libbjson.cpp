@@ -26,7 +26,6 @@ static int l_frombytes(lua::State* L) {
         auto out = json::from_binary(
             reinterpret_cast<const ubyte*>(string.data()), string.size()
         );
-        lua::pop(L);
         return lua::pushvalue(L, std::move(out));
     }
 }
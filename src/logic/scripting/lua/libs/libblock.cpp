@@ -14,6 +14,7 @@
 #include "voxels/blocks_agent.hpp"
 #include "world/Level.hpp"
 #include "maths/voxmaths.hpp"
+#include "util/data_io.hpp"
 #include "data/StructLayout.hpp"
 #include "engine/Engine.hpp"
 #include "api_lua.hpp"
@@ -145,6 +146,204 @@ static int l_get(lua::State* L) {
     return lua::pushinteger(L, id);
 }
 
+static int l_get_light(lua::State* L) {
+    auto x = lua::tointeger(L, 1);
+    auto y = lua::tointeger(L, 2);
+    auto z = lua::tointeger(L, 3);
+    const auto& chunks = *require_level().chunks;
+    auto chunk = chunks.getChunkByVoxel(x, y, z);
+    if (chunk == nullptr || chunk->lightmap == nullptr) {
+        return 0;
+    }
+    for (int channel = 0; channel < 4; channel++) {
+        lua::pushinteger(L, chunks.getLight(x, y, z, channel));
+    }
+    return 4;
+}
+
+static blockid_t require_block_id(lua::State* L, int idx) {
+    auto id = lua::tointeger(L, idx);
+    const auto& blocks = require_content().getIndices()->blocks;
+    if (static_cast<size_t>(id) >= blocks.count()) {
+        throw std::runtime_error("invalid block id " + std::to_string(id));
+    }
+    return static_cast<blockid_t>(id);
+}
+
+/// @brief Max number of voxels in a box (voxels buffer of the box
+/// takes 4 bytes per voxel)
+static inline constexpr size_t MAX_BOX_VOLUME = 256 * 256 * 256;
+
+/// @return box volume
+static size_t require_box(lua::State* L, glm::ivec3& pos, glm::ivec3& size) {
+    pos = lua::tovec<3, int>(L, 1);
+    size = lua::tovec<3, int>(L, 2);
+    if (size.x < 0 || size.y < 0 || size.z < 0) {
+        throw std::runtime_error("negative box size");
+    }
+    if (size.x == 0 || size.y == 0 || size.z == 0) {
+        return 0;
+    }
+    size_t volume = 1;
+    for (int i = 0; i < 3; i++) {
+        // checked before multiplying to not overflow
+        if (volume > MAX_BOX_VOLUME / size[i]) {
+            throw std::runtime_error(
+                "box is too big (max volume is " +
+                std::to_string(MAX_BOX_VOLUME) + ")"
+            );
+        }
+        volume *= size[i];
+    }
+    return volume;
+}
+
+/// @return max size of extended blocks (1 if there is no extended blocks)
+static int get_max_block_size(
+    const ContentUnitIndices<Block, blockid_t>& blocks
+) {
+    int maxSize = 1;
+    for (const auto def : blocks.getIterable()) {
+        const auto& size = def->size;
+        maxSize = std::max(
+            {maxSize,
+             static_cast<int>(size.x),
+             static_cast<int>(size.y),
+             static_cast<int>(size.z)}
+        );
+    }
+    return maxSize;
+}
+
+static void update_box_lights(const glm::ivec3& pos, const glm::ivec3& size) {
+    auto chunksController = controller->getChunksController();
+    if (chunksController && chunksController->lighting) {
+        chunksController->lighting->onBlocksSet(pos, size);
+    }
+}
+
+static int set_box(
+    lua::State* L,
+    const glm::ivec3& pos,
+    const glm::ivec3& size,
+    const std::function<bool(size_t, voxel&)>& func
+) {
+    auto& level = require_level();
+    const auto& blocks = level.content.getIndices()->blocks;
+    bool extended = false;
+    size_t count = blocks_agent::set_box(
+        *level.chunks,
+        pos,
+        size,
+        [&func, &blocks, &extended](size_t index, voxel& vox) {
+            extended |= blocks.require(vox.id).rt.extended;
+            if (!func(index, vox)) {
+                return false;
+            }
+            extended |= blocks.require(vox.id).rt.extended;
+            return true;
+        }
+    );
+    if (count == 0) {
+        return lua::pushinteger(L, count);
+    }
+    if (extended) {
+        // segments of set or erased extended blocks may be outside the box
+        int margin = get_max_block_size(blocks) - 1;
+        update_box_lights(pos - margin, size + margin * 2);
+    } else {
+        update_box_lights(pos, size);
+    }
+    return lua::pushinteger(L, count);
+}
+
+static int l_fill(lua::State* L) {
+    glm::ivec3 pos, size;
+    require_box(L, pos, size);
+    voxel target {require_block_id(L, 3), int2blockstate(lua::tointeger(L, 4))};
+    return set_box(L, pos, size, [&target](size_t, voxel& vox) {
+        vox = target;
+        return true;
+    });
+}
+
+static int l_replace(lua::State* L) {
+    glm::ivec3 pos, size;
+    require_box(L, pos, size);
+    auto id = lua::tointeger(L, 3);
+    voxel target {require_block_id(L, 4), int2blockstate(lua::tointeger(L, 5))};
+    return set_box(L, pos, size, [id, &target](size_t, voxel& vox) {
+        if (vox.id != id) {
+            return false;
+        }
+        vox = target;
+        return true;
+    });
+}
+
+static int l_count_in_box(lua::State* L) {
+    glm::ivec3 pos, size;
+    require_box(L, pos, size);
+    auto id = lua::tointeger(L, 3);
+    size_t count = 0;
+    auto& chunks = *require_level().chunks;
+    blocks_agent::visit_box(
+        chunks, pos, size, [id, &count](size_t, const voxel& vox) {
+            count += vox.id == id;
+        }
+    );
+    return lua::pushinteger(L, count);
+}
+
+/// Voxels buffer format (little-endian):
+/// uint16_t ids[volume]; uint16_t states[volume];
+/// where voxel index is (y * size.z + z) * size.x + x
+
+static int l_get_region(lua::State* L) {
+    glm::ivec3 pos, size;
+    size_t volume = require_box(L, pos, size);
+    auto bytearray = lua::new_bytearray(L, volume * 4);
+    auto dst = reinterpret_cast<uint16_t*>(bytearray->bytes);
+    std::fill(dst, dst + volume, dataio::h2le(BLOCK_VOID));
+    std::fill(dst + volume, dst + volume * 2, 0);
+    auto& chunks = *require_level().chunks;
+    blocks_agent::visit_box(
+        chunks, pos, size, [=](size_t index, const voxel& vox) {
+            dst[index] = dataio::h2le(vox.id);
+            dst[volume + index] = dataio::h2le(blockstate2int(vox.state));
+        }
+    );
+    return 1;
+}
+
+static int l_set_region(lua::State* L) {
+    glm::ivec3 pos, size;
+    size_t volume = require_box(L, pos, size);
+    auto bytes = lua::bytearray_as_string(L, 3);
+    if (bytes.size() != volume * 4) {
+        throw std::runtime_error(
+            "invalid voxels buffer size " + std::to_string(bytes.size()) +
+            ", expected " + std::to_string(volume * 4)
+        );
+    }
+    auto src = reinterpret_cast<const uint16_t*>(bytes.data());
+    size_t blocksCount = require_content().getIndices()->blocks.count();
+    for (size_t i = 0; i < volume; i++) {
+        blockid_t id = dataio::le2h(src[i]);
+        if (id != BLOCK_VOID && id >= blocksCount) {
+            throw std::runtime_error("invalid block id " + std::to_string(id));
+        }
+    }
+    return set_box(L, pos, size, [=](size_t index, voxel& vox) {
+        blockid_t id = dataio::le2h(src[index]);
+        if (id == BLOCK_VOID) {
+            return false;
+        }
+        vox = {id, int2blockstate(dataio::le2h(src[volume + index]))};
+        return true;
+    });
+}
+
 template<int n>
 static int get_axis(lua::State* L, const Block& def, int rotation) {
     const CoordSystem& rot = def.rotations.variants[rotation];
@@ -232,8 +431,8 @@ static int l_set_states(lua::State* L) {
     }
     int lx = x - cx * CHUNK_W;
     int lz = z - cz * CHUNK_D;
-    chunk->voxels[vox_index(lx, y, lz)].state = int2blockstate(states);
-    chunk->setModifiedAndUnsaved();
+    chunk->voxels.at(vox_index(lx, y, lz)).state = int2blockstate(states);
+    chunk->setModifiedAndUnsaved(y);
     return 0;
 }
 
@@ -313,11 +512,11 @@ static int l_set_user_bits(lua::State* L) {
     }
     int lx = x - cx * CHUNK_W;
     int lz = z - cz * CHUNK_D;
-    auto vox = &chunk->voxels[vox_index(lx, y, lz)];
+    auto vox = &chunk->voxels.at(vox_index(lx, y, lz));
     const auto& def = level.content.getIndices()->blocks.require(vox->id);
     if (def.rt.extended) {
         auto origin = blocks_agent::seek_origin(chunks, {x, y, z}, def, vox->state);
-        vox = blocks_agent::get(chunks, origin.x, origin.y, origin.z);
+        vox = blocks_agent::get_mutable(chunks, origin.x, origin.y, origin.z);
         if (vox == nullptr) {
             return 0;
         }
@@ -331,7 +530,11 @@ static int l_set_user_bits(lua::State* L) {
         }
     }
     vox->state.userbits = (vox->state.userbits & (~mask)) | value;
-    chunk->setModifiedAndUnsaved();
+    if (def.rt.extended) {
+        chunk->setModifiedAndUnsaved();
+    } else {
+        chunk->setModifiedAndUnsaved(y);
+    }
     return 0;
 }
 
@@ -351,7 +554,7 @@ static int l_set_variant(lua::State* L) {
     }
     int lx = x - cx * CHUNK_W;
     int lz = z - cz * CHUNK_D;
-    auto vox = &chunk->voxels[vox_index(lx, y, lz)];
+    auto vox = &chunk->voxels.at(vox_index(lx, y, lz));
     const auto& def = level.content.getIndices()->blocks.require(vox->id);
 
     if (def.variants == nullptr) {
@@ -364,7 +567,7 @@ static int l_set_variant(lua::State* L) {
 
     if (def.rt.extended) {
         auto origin = blocks_agent::seek_origin(chunks, {x, y, z}, def, vox->state);
-        vox = blocks_agent::get(chunks, origin.x, origin.y, origin.z);
+        vox = blocks_agent::get_mutable(chunks, origin.x, origin.y, origin.z);
         if (vox == nullptr) {
             return 0;
         }
@@ -378,7 +581,11 @@ static int l_set_variant(lua::State* L) {
         }
     }
     vox->state.userbits = (vox->state.userbits & (~mask)) | value;
-    chunk->setModifiedAndUnsaved();
+    if (def.rt.extended) {
+        chunk->setModifiedAndUnsaved();
+    } else {
+        chunk->setModifiedAndUnsaved(y);
+    }
     return 0;
 }
 
@@ -689,7 +896,7 @@ static int l_get_field(lua::State* L) {
     auto lz = z - cz * CHUNK_W;
     size_t voxelIndex = vox_index(lx, y, lz);
 
-    const auto& vox = chunk->voxels[voxelIndex];
+    const auto& vox = chunk->voxels.get(voxelIndex);
     const auto& def = content->getIndices()->blocks.require(vox.id);
     if (def.dataStruct == nullptr) {
         return 0;
@@ -761,7 +968,7 @@ static int l_set_field(lua::State* L) {
         return 0;
     }
     size_t voxelIndex = vox_index(lx, y, lz);
-    const auto& vox = chunk->voxels[voxelIndex];
+    const auto& vox = chunk->voxels.get(voxelIndex);
 
     const auto& def = content->getIndices()->blocks.require(vox.id);
     if (def.dataStruct == nullptr) {
@@ -849,6 +1056,12 @@ const luaL_Reg blocklib[] = {
     {"is_replaceable_at", lua::wrap<l_is_replaceable_at>},
     {"set", lua::wrap<l_set>},
     {"get", lua::wrap<l_get>},
+    {"get_light", lua::wrap<l_get_light>},
+    {"fill", lua::wrap<l_fill>},
+    {"replace", lua::wrap<l_replace>},
+    {"count", lua::wrap<l_count_in_box>},
+    {"get_region", lua::wrap<l_get_region>},
+    {"set_region", lua::wrap<l_set_region>},
     {"get_X", lua::wrap<l_get_x>},
     {"get_Y", lua::wrap<l_get_y>},
     {"get_Z", lua::wrap<l_get_z>},
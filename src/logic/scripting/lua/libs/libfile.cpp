@@ -123,11 +123,18 @@ static int l_read_bytes(lua::State* L) {
     if (io::is_regular_file(path)) {
         size_t length = static_cast<size_t>(io::file_size(path));
 
-        auto bytes = io::read_bytes(path);
-
         if (lua::gettop(L) < 2 || !lua::toboolean(L, 2)) {
-            lua::create_bytearray(L, std::move(bytes));
+            // read directly to the Bytearray
+            auto bytearray = lua::new_bytearray(L, length);
+            if (!io::read(
+                    path, reinterpret_cast<char*>(bytearray->bytes), length
+                )) {
+                throw std::runtime_error(
+                    "could not read file " + util::quote(path.string())
+                );
+            }
         } else {
+            auto bytes = io::read_bytes(path);
             lua::createtable(L, length, 0);
             int newTable = lua::gettop(L);
 
@@ -315,13 +322,13 @@ static int l_read_descriptor(lua::State* L) {
 
     auto* stream = scripting::descriptors_manager::get_input(descriptor);
 
-    util::Buffer<char> buffer(maxlen);
+    // read directly to the Bytearray
+    auto bytearray = lua::new_bytearray(L, maxlen);
 
-    stream->read(buffer.data(), maxlen);
+    stream->read(reinterpret_cast<char*>(bytearray->bytes), maxlen);
 
-    std::streamsize read_len = stream->gcount(); 
-
-    return lua::create_bytearray(L, buffer.data(), read_len);
+    bytearray->size = stream->gcount();
+    return 1;
 }
 
 static int l_write_descriptor(lua::State* L) {
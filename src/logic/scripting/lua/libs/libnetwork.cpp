@@ -172,68 +172,108 @@ static int l_closeserver(lua::State* L, network::Network& network) {
     return 0;
 }
 
-static int l_send(lua::State* L, network::Network& network) {
-    u64id_t id = lua::tointeger(L, 1);
-    auto connection = network.getConnection(id, false);
-    if (connection == nullptr ||
-        connection->getState() == network::ConnectionState::CLOSED) {
-        return 0;
-    }
-    if (lua::istable(L, 2)) {
-        lua::pushvalue(L, 2);
-        size_t size = lua::objlen(L, 2);
-        util::Buffer<char> buffer(size);
+/// @brief Reused by bytes transfer functions to avoid allocations.
+/// Network library is used from the main thread only
+static std::vector<char> transfer_buffer;
+
+/// @brief Pass bytes from a table, a string or a Bytearray to the consumer.
+/// Strings and Bytearrays are passed without copying
+template <typename Consumer>
+static void with_bytes(lua::State* L, int idx, const Consumer& consumer) {
+    if (lua::istable(L, idx)) {
+        lua::pushvalue(L, idx);
+        size_t size = lua::objlen(L, idx);
+        transfer_buffer.resize(size);
         for (size_t i = 0; i < size; i++) {
             lua::rawgeti(L, i + 1);
-            buffer[i] = lua::tointeger(L, -1);
+            transfer_buffer[i] = lua::tointeger(L, -1);
             lua::pop(L);
         }
         lua::pop(L);
-        connection->send(buffer.data(), size);
-    } else if (lua::isstring(L, 2)) {
-        auto string = lua::tolstring(L, 2);
-        connection->send(string.data(), string.length());
+        consumer(transfer_buffer.data(), size);
     } else {
-        auto string = lua::bytearray_as_string(L, 2);
-        connection->send(string.data(), string.length());
-        lua::pop(L);
+        auto bytes = lua::bytearray_as_string(L, idx);
+        consumer(bytes.data(), bytes.length());
+    }
+}
+
+static network::Connection* get_open_connection(
+    lua::State* L, network::Network& network
+) {
+    u64id_t id = lua::tointeger(L, 1);
+    auto connection = network.getConnection(id, false);
+    if (connection == nullptr ||
+        connection->getState() == network::ConnectionState::CLOSED) {
+        return nullptr;
+    }
+    return connection;
+}
+
+static network::UdpServer* get_udp_server(
+    lua::State* L, network::Network& network
+) {
+    u64id_t id = lua::tointeger(L, 1);
+    auto server = network.getServer(id, false);
+    if (server == nullptr) {
+        return nullptr;
+    }
+    if (server->getTransportType() != network::TransportType::UDP) {
+        throw std::runtime_error("the server must work on UDP transport");
+    }
+    return dynamic_cast<network::UdpServer*>(server);
+}
+
+static int l_send(lua::State* L, network::Network& network) {
+    if (auto connection = get_open_connection(L, network)) {
+        with_bytes(L, 2, [connection](const char* data, size_t size) {
+            connection->send(data, size);
+        });
+    }
+    return 0;
+}
+
+static int l_queue(lua::State* L, network::Network& network) {
+    if (auto connection = get_open_connection(L, network)) {
+        with_bytes(L, 2, [connection](const char* data, size_t size) {
+            connection->queue(data, size);
+        });
+    }
+    return 0;
+}
+
+static int l_flush(lua::State* L, network::Network& network) {
+    if (auto connection = get_open_connection(L, network)) {
+        connection->flush();
     }
     return 0;
 }
 
 static int l_udp_server_send_to(lua::State* L, network::Network& network) {
-    u64id_t id = lua::tointeger(L, 1);
+    if (auto server = get_udp_server(L, network)) {
+        std::string addr = lua::require_string(L, 2);
+        int port = lua::tointeger(L, 3);
+        with_bytes(L, 4, [&](const char* data, size_t size) {
+            server->sendTo(addr, port, data, size);
+        });
+    }
+    return 0;
+}
 
-    if (auto server = network.getServer(id, false)) {
-        if (server->getTransportType() != network::TransportType::UDP)
-            throw std::runtime_error("the server must work on UDP transport");
-
-        const std::string& addr = lua::tostring(L, 2);
-        const int& port = lua::tointeger(L, 3);
-
-        auto udpServer = dynamic_cast<network::UdpServer*>(server);
-
-        if (lua::istable(L, 4)) {
-            lua::pushvalue(L, 4);
-            size_t size = lua::objlen(L, 4);
-            util::Buffer<char> buffer(size);
-            for (size_t i = 0; i < size; i++) {
-                lua::rawgeti(L, i + 1);
-                buffer[i] = lua::tointeger(L, -1);
-                lua::pop(L);
-            }
-            lua::pop(L);
-            udpServer->sendTo(addr, port, buffer.data(), size);
-        } else if (lua::isstring(L, 4)) {
-            auto string = lua::tolstring(L, 4);
-            udpServer->sendTo(addr, port, string.data(), string.length());
-        } else {
-            auto string = lua::bytearray_as_string(L, 4);
-            udpServer->sendTo(addr, port, string.data(), string.length());
-            lua::pop(L);
-        }
+static int l_udp_server_queue_to(lua::State* L, network::Network& network) {
+    if (auto server = get_udp_server(L, network)) {
+        std::string addr = lua::require_string(L, 2);
+        int port = lua::tointeger(L, 3);
+        with_bytes(L, 4, [&](const char* data, size_t size) {
+            server->queueTo(addr, port, data, size);
+        });
     }
+    return 0;
+}
 
+static int l_flushserver(lua::State* L, network::Network& network) {
+    if (auto server = get_udp_server(L, network)) {
+        server->flush();
+    }
     return 0;
 }
 
@@ -249,23 +289,33 @@ static int l_recv(lua::State* L, network::Network& network) {
 
     auto tcpConnection = dynamic_cast<network::TcpConnection*>(connection);
 
-    length = glm::min(length, tcpConnection->available());
-    util::Buffer<char> buffer(length);
-    
-    int size = tcpConnection->recv(buffer.data(), length);
+    length = glm::max(0, glm::min(length, tcpConnection->available()));
+    if (!lua::toboolean(L, 3)) {
+        // receive directly to the Bytearray
+        auto bytearray = lua::new_bytearray(L, length);
+        int size = tcpConnection->recv(
+            reinterpret_cast<char*>(bytearray->bytes), length
+        );
+        if (size == -1) {
+            lua::pop(L);
+            return 0;
+        }
+        bytearray->size = size;
+        return 1;
+    }
+    if (transfer_buffer.size() < static_cast<size_t>(length)) {
+        transfer_buffer.resize(length);
+    }
+    int size = tcpConnection->recv(transfer_buffer.data(), length);
     if (size == -1) {
         return 0;
     }
-    if (lua::toboolean(L, 3)) {
-        lua::createtable(L, size, 0);
-        for (size_t i = 0; i < size; i++) {
-            lua::pushinteger(L, buffer[i] & 0xFF);
-            lua::rawseti(L, i+1);
-        }
-        return 1;
-    } else {
-        return lua::create_bytearray(L, buffer.data(), size);
+    lua::createtable(L, size, 0);
+    for (size_t i = 0; i < size; i++) {
+        lua::pushinteger(L, transfer_buffer[i] & 0xFF);
+        lua::rawseti(L, i+1);
     }
+    return 1;
 }
 
 static int l_available(lua::State* L, network::Network& network) {
@@ -561,10 +611,14 @@ const luaL_Reg networklib[] = {
     {"__open_udp", wrap<l_open_udp>},
     {"__closeserver", wrap<l_closeserver>},
     {"__udp_server_send_to", wrap<l_udp_server_send_to>},
+    {"__udp_server_queue_to", wrap<l_udp_server_queue_to>},
+    {"__flushserver", wrap<l_flushserver>},
     {"__connect_tcp", wrap<l_connect_tcp>},
     {"__connect_udp", wrap<l_connect_udp>},
     {"__close", wrap<l_close>},
     {"__send", wrap<l_send>},
+    {"__queue", wrap<l_queue>},
+    {"__flush", wrap<l_flush>},
     {"__recv", wrap<l_recv>},
     {"__available", wrap<l_available>},
     {"__is_alive", wrap<l_is_alive>},
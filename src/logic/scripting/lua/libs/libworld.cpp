@@ -15,6 +15,7 @@
 #include "lighting/Lighting.hpp"
 #include "voxels/Chunk.hpp"
 #include "voxels/Chunks.hpp"
+#include "voxels/ChunksLoader.hpp"
 #include "voxels/GlobalChunks.hpp"
 #include "voxels/compressed_chunks.hpp"
 #include "world/Level.hpp"
@@ -133,32 +134,39 @@ static int l_get_chunk_data(lua::State* L) {
     int z = static_cast<int>(lua::tointeger(L, 2));
     const auto& chunk = level->chunks->getChunk(x, z);
 
-    auto voxelData = std::make_unique<ubyte[]>(CHUNK_DATA_LEN);
-    std::vector<ubyte> chunkData;
-    if (chunk == nullptr) {
+    if (chunk == nullptr || !chunk->flags.loaded) {
         auto& regions = level->getWorld()->wfile->getRegions();
-        if (!regions.getVoxels(x, z, voxelData.get())) {
+        auto chunkData = compressed_chunks::encode(x, z, regions);
+        if (chunkData.empty()) {
             return 0;
         }
-        static util::Buffer<ubyte> rleBuffer(CHUNK_DATA_LEN * 2);
-        auto metadata = regions.getBlocksData(x, z);
-        chunkData =
-            compressed_chunks::encode(voxelData.get(), metadata, rleBuffer);
-    } else {
-        chunkData = compressed_chunks::encode(*chunk);
+        return lua::create_bytearray(L, std::move(chunkData));
+    }
+    uint64_t sinceRevision = 0;
+    if (lua::isnumber(L, 3)) {
+        sinceRevision = static_cast<uint64_t>(lua::tointeger(L, 3));
+    }
+    // revision given in another session is unknown
+    if (sinceRevision > Chunk::getLastRevision()) {
+        sinceRevision = 0;
     }
-    return lua::create_bytearray(L, std::move(chunkData));
+    lua::create_bytearray(
+        L, compressed_chunks::encode(*chunk, sinceRevision)
+    );
+    lua::pushinteger(L, chunk->revision);
+    return 2;
 }
 
-static void integrate_chunk_client(Chunk& chunk) {
+static void integrate_chunk_client(Chunk& chunk, const Lighting& lighting) {
     int x = chunk.x;
     int z = chunk.z;
 
     chunk.flags.loadedLights = false;
+    chunk.flags.loadedBlockLights = false;
     chunk.flags.lighted = false;
     if (chunk.lightmap) {
         chunk.lightmap->clear();
-        Lighting::prebuildSkyLight(chunk, *indices);
+        lighting.prebuildSkyLight(chunk);
     }
 
     for (int lz = -1; lz <= 1; lz++) {
@@ -167,7 +175,7 @@ static void integrate_chunk_client(Chunk& chunk) {
                 continue;
             }
             if (auto other = level->chunks->getChunk(x + lx, z + lz)) {
-                other->flags.modified = true;
+                other->setModified();
             }
         }
     }
@@ -192,10 +200,11 @@ static int l_set_chunk_data(lua::State* L) {
         buffer.size(),
         *content->getIndices()
     );
-    if (controller->getChunksController()->lighting == nullptr) {
+    const auto& lighting = controller->getChunksController()->lighting;
+    if (lighting == nullptr) {
         return lua::pushboolean(L, true);
     }
-    integrate_chunk_client(*chunk);
+    integrate_chunk_client(*chunk, *lighting);
     return lua::pushboolean(L, true);
 }
 
@@ -208,6 +217,9 @@ static int l_save_chunk_data(lua::State* L) {
     int z = static_cast<int>(lua::tointeger(L, 2));
     auto buffer = lua::bytearray_as_string(L, 3);
 
+    if (auto loader = level->chunks->getLoader()) {
+        loader->cancel(x, z);
+    }
     compressed_chunks::save(
         x,
         z,
@@ -227,6 +239,26 @@ static int l_count_chunks(lua::State* L) {
     return lua::pushinteger(L, level->chunks->size());
 }
 
+static int l_get_regions_cache_info(lua::State* L) {
+    if (level == nullptr) {
+        return 0;
+    }
+    const auto& regions = level->getWorld()->wfile->getRegions();
+    const auto& stats = regions.getCacheStats();
+    lua::createtable(L, 0, 5);
+    lua::pushinteger(L, stats.hits);
+    lua::setfield(L, "hits");
+    lua::pushinteger(L, stats.misses);
+    lua::setfield(L, "misses");
+    lua::pushinteger(L, stats.evictions);
+    lua::setfield(L, "evictions");
+    lua::pushinteger(L, stats.residentBytes);
+    lua::setfield(L, "resident");
+    lua::pushinteger(L, regions.getCacheBudget());
+    lua::setfield(L, "budget");
+    return 1;
+}
+
 static int l_reload_script(lua::State* L) {
     auto packid = lua::require_string(L, 1);
     if (content == nullptr) {
@@ -255,6 +287,7 @@ const luaL_Reg worldlib[] = {
     {"set_chunk_data", lua::wrap<l_set_chunk_data>},
     {"save_chunk_data", lua::wrap<l_save_chunk_data>},
     {"count_chunks", lua::wrap<l_count_chunks>},
+    {"get_regions_cache_info", lua::wrap<l_get_regions_cache_info>},
     {"reload_script", lua::wrap<l_reload_script>},
     {nullptr, nullptr}
 };
@@ -2,6 +2,7 @@
 
 #include <iomanip>
 #include <iostream>
+#include <unordered_map>
 
 #include "io/io.hpp"
 #include "engine/EnginePaths.hpp"
@@ -17,6 +18,7 @@
 
 static debug::Logger logger("lua-state");
 static lua::State* main_thread = nullptr;
+static std::unordered_map<std::string, int> event_handles;
 
 using namespace lua;
 
@@ -147,6 +149,7 @@ void lua::initialize(const EnginePaths& paths, const CoreParameters& params) {
 }
 
 void lua::finalize() {
+    event_handles.clear();
     lua::close(main_thread);
 }
 
@@ -165,6 +168,29 @@ bool lua::emit_event(
     return false;
 }
 
+int lua::get_event_handle(State* L, const std::string& name) {
+    auto found = event_handles.find(name);
+    if (found != event_handles.end()) {
+        return found->second;
+    }
+    if (!getglobal(L, "events")) {
+        return 0;
+    }
+    if (!getfield(L, "handle")) {
+        pop(L);
+        return 0;
+    }
+    pushstring(L, name);
+    if (!call_nothrow(L, 1, 1)) {
+        pop(L);
+        return 0;
+    }
+    int handle = ref(L);
+    pop(L);
+    event_handles[name] = handle;
+    return handle;
+}
+
 State* lua::get_main_state() {
     return main_thread;
 }
@@ -25,6 +25,34 @@ namespace lua {
         const std::string& name,
         std::function<int(State*)> args = [](auto*) { return 0; }
     );
+
+    /// @brief Get pre-resolved handle of the main state event.
+    /// Handles are cached by event name and stay valid until finalize
+    /// @return handle (registry reference of the event emitter)
+    /// or 0 on error
+    int get_event_handle(State*, const std::string& name);
+
+    /// @brief Emit event using pre-resolved handle without event name lookup
+    /// @param handle event handle. 0 - no event
+    /// @param args function pushing event arguments
+    template <typename ArgsPusher>
+    bool emit_event(State* L, int handle, const ArgsPusher& args) {
+        if (handle == 0) {
+            return false;
+        }
+        getref(L, handle);
+        if (int nresults = call_nothrow(L, args(L))) {
+            bool result = toboolean(L, -1);
+            pop(L, nresults);
+            return result;
+        }
+        return false;
+    }
+
+    inline bool emit_event(State* L, int handle) {
+        return emit_event(L, handle, [](auto*) { return 0; });
+    }
+
     State* get_main_state();
     State* create_state(const EnginePaths& paths, StateType stateType);
     [[nodiscard]] scriptenv create_environment(State* L);
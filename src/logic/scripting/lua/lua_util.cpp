@@ -10,6 +10,9 @@ using namespace lua;
 
 static int nextEnvironment = 1;
 
+/// @brief lua_type result for LuaJIT FFI objects
+static constexpr int TCDATA = 10;
+
 std::unordered_map<std::type_index, std::string> lua::usertypeNames;
 
 int lua::userdata_destructor(lua::State* L) {
@@ -68,6 +71,34 @@ int lua::pushvalue(State* L, const dv::value& value) {
     return 1;
 }
 
+lua::Bytearray* lua::tobytearray(State* L, int idx) {
+    if (type(L, idx) != TCDATA) {
+        return nullptr;
+    }
+    pushvalue(L, idx);
+    requireglobal(L, "Bytearray_is");
+    pushvalue(L, -2);
+    call(L, 1, 1);
+    bool isBytearray = toboolean(L, -1);
+    pop(L, 2);
+    if (!isBytearray) {
+        return nullptr;
+    }
+    return static_cast<Bytearray*>(const_cast<void*>(topointer(L, idx)));
+}
+
+lua::Bytearray* lua::new_bytearray(State* L, size_t size) {
+    requireglobal(L, "Bytearray_construct");
+    pushinteger(L, size);
+    call(L, 1, 1);
+    if (auto bytearray = tobytearray(L, -1)) {
+        return bytearray;
+    }
+    throw luaerror(
+        "Bytearray expected, got " + std::string(type_name(L, type(L, -1)))
+    );
+}
+
 std::wstring lua::require_wstring(State* L, int idx) {
     return util::str2wstr_utf8(require_string(L, idx));
 }
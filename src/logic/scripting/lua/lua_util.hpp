@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstring>
 #include <stdexcept>
 #include <typeindex>
 #include <typeinfo>
@@ -757,19 +758,45 @@ namespace lua {
         }
     }
 
+    /// @brief Bytearray memory layout (bytearray_t FFI type declared in
+    /// core:internal/bytearray). Bytes are allocated with malloc and owned
+    /// by the Lua object
+    struct Bytearray {
+        ubyte* bytes;
+        int size;
+        int capacity;
+    };
+
+    /// @brief Get Bytearray stored at the index without copying its bytes
+    /// @return nullptr if the value is not a Bytearray
+    Bytearray* tobytearray(lua::State* L, int idx);
+
+    /// @brief Push new Bytearray of the given size to be filled in place
+    Bytearray* new_bytearray(lua::State* L, size_t size);
+
     inline int create_bytearray(lua::State* L, const void* bytes, size_t size) {
-        lua::requireglobal(L, "Bytearray_construct");
-        lua::pushlstring(
-            L, std::string_view(reinterpret_cast<const char*>(bytes), size)
-        );
-        return lua::call(L, 1, 1);
+        auto bytearray = new_bytearray(L, size);
+        if (size) {
+            std::memcpy(bytearray->bytes, bytes, size);
+        }
+        return 1;
     }
 
     inline int create_bytearray(lua::State* L, const std::vector<ubyte>& bytes) {
         return create_bytearray(L, bytes.data(), bytes.size());
     }
 
+    /// @brief Get bytes of a Bytearray, a string or a table of bytes.
+    /// Bytearray and string bytes are not copied
     inline std::string_view bytearray_as_string(lua::State* L, int idx) {
+        if (auto bytearray = tobytearray(L, idx)) {
+            return std::string_view(
+                reinterpret_cast<const char*>(bytearray->bytes),
+                bytearray->size
+            );
+        } else if (lua::type(L, idx) == LUA_TSTRING) {
+            return lua::tolstring(L, idx);
+        }
         lua::pushvalue(L, idx);
         lua::requireglobal(L, "Bytearray_as_string");
         lua::pushvalue(L, -2);
@@ -67,6 +67,16 @@ namespace lua {
     inline void rawset(lua::State* L, int idx = -3) {
         lua_rawset(L, idx);
     }
+    /// @brief Pop value and store it in the registry
+    /// @return registry reference
+    inline int ref(lua::State* L) {
+        return luaL_ref(L, LUA_REGISTRYINDEX);
+    }
+    /// @brief Push value stored in the registry
+    inline int getref(lua::State* L, int ref) {
+        lua_rawgeti(L, LUA_REGISTRYINDEX, ref);
+        return 1;
+    }
 
     inline int createtable(lua::State* L, int narr, int nrec) {
         lua_createtable(L, narr, nrec);
@@ -384,45 +384,63 @@ void scripting::cleanup(const std::vector<std::string>& nonReset) {
 }
 
 void scripting::on_blocks_tick(const Block& block, int tps) {
-    std::string name = block.name + ".blockstick";
-    lua::emit_event(lua::get_main_state(), name, [tps](auto L) {
-        return lua::pushinteger(L, tps);
-    });
+    lua::emit_event(
+        lua::get_main_state(),
+        block.rt.eventHandles.blocksTick,
+        [tps](auto L) { return lua::pushinteger(L, tps); }
+    );
 }
 
 void scripting::update_block(const Block& block, const glm::ivec3& pos) {
-    lua::emit_event(lua::get_main_state(), block.rt.eventNames.update,
-    [pos](auto L) {
-        return lua::pushivec_stack(L, pos);
-    });
+    lua::emit_event(
+        lua::get_main_state(),
+        block.rt.eventHandles.update,
+        [&pos](auto L) { return lua::pushivec_stack(L, pos); }
+    );
 }
 
 void scripting::random_update_block(const Block& block, const glm::ivec3& pos) {
-    lua::emit_event(lua::get_main_state(), block.rt.eventNames.randomUpdate,
-    [pos](auto L) {
-        return lua::pushivec_stack(L, pos);
-    });
+    lua::emit_event(
+        lua::get_main_state(),
+        block.rt.eventHandles.randomUpdate,
+        [&pos](auto L) { return lua::pushivec_stack(L, pos); }
+    );
+}
+
+void scripting::random_update_blocks(
+    const Block& block, const std::vector<glm::ivec3>& positions
+) {
+    lua::emit_event(
+        lua::get_main_state(),
+        block.rt.eventHandles.randomUpdateBatch,
+        [&positions](auto L) {
+            lua::createtable(L, positions.size() * 3, 0);
+            for (size_t i = 0; i < positions.size(); i++) {
+                const auto& pos = positions[i];
+                for (int j = 0; j < 3; j++) {
+                    lua::pushinteger(L, pos[j]);
+                    lua::rawseti(L, i * 3 + j + 1);
+                }
+            }
+            return 1;
+        }
+    );
 }
 
 /// TODO: replace template with index
-template<bool WorldFuncsSet::*worldfunc>
+template<int WorldEventHandles::*worldevent>
 static bool on_block_common(
-    const std::string& suffix,
-    bool blockfunc,
+    int blockevent,
     Player* player,
     const Block& block,
     const glm::ivec3& pos
 ) {
-    bool result = false;
-    if (blockfunc) {
-        std::string name = block.name + "." + suffix;
-        result =
-            lua::emit_event(lua::get_main_state(), name, [pos, player](auto L) {
-                lua::pushivec_stack(L, pos);
-                lua::pushinteger(L, player ? player->getId() : -1);
-                return 4;
-            });
-    }
+    auto L = lua::get_main_state();
+    bool result = lua::emit_event(L, blockevent, [&](auto L) {
+        lua::pushivec_stack(L, pos);
+        lua::pushinteger(L, player ? player->getId() : -1);
+        return 4;
+    });
     auto args = [&](lua::State* L) {
         lua::pushinteger(L, block.rt.id);
         lua::pushivec_stack(L, pos);
@@ -430,11 +448,7 @@ static bool on_block_common(
         return 5;
     };
     for (auto& [packid, pack] : content->getPacks()) {
-        if (pack->worldfuncsset.*worldfunc) {
-            lua::emit_event(
-                lua::get_main_state(), packid + ":.block" + suffix, args
-            );
-        }
+        lua::emit_event(L, pack->worldeventhandles.*worldevent, args);
     }
     return result;
 }
@@ -442,40 +456,40 @@ static bool on_block_common(
 void scripting::on_block_placed(
     Player* player, const Block& block, const glm::ivec3& pos
 ) {
-    on_block_common<&WorldFuncsSet::onblockplaced>(
-        "placed", block.rt.funcsset.onplaced, player, block, pos
+    on_block_common<&WorldEventHandles::blockplaced>(
+        block.rt.eventHandles.placed, player, block, pos
     );
 }
 
 void scripting::on_block_replaced(
     Player* player, const Block& block, const glm::ivec3& pos
 ) {
-    on_block_common<&WorldFuncsSet::onblockreplaced>(
-        "replaced", block.rt.funcsset.onreplaced, player, block, pos
+    on_block_common<&WorldEventHandles::blockreplaced>(
+        block.rt.eventHandles.replaced, player, block, pos
     );
 }
 
 void scripting::on_block_breaking(
     Player* player, const Block& block, const glm::ivec3& pos
 ) {
-    on_block_common<&WorldFuncsSet::onblockbreaking>(
-        "breaking", block.rt.funcsset.onbreaking, player, block, pos
+    on_block_common<&WorldEventHandles::blockbreaking>(
+        block.rt.eventHandles.breaking, player, block, pos
     );
 }
 
 void scripting::on_block_broken(
     Player* player, const Block& block, const glm::ivec3& pos
 ) {
-    on_block_common<&WorldFuncsSet::onblockbroken>(
-        "broken", block.rt.funcsset.onbroken, player, block, pos
+    on_block_common<&WorldEventHandles::blockbroken>(
+        block.rt.eventHandles.broken, player, block, pos
     );
 }
 
 bool scripting::on_block_interact(
     Player* player, const Block& block, const glm::ivec3& pos
 ) {
-    return on_block_common<&WorldFuncsSet::onblockinteract>(
-        "interact", block.rt.funcsset.oninteract, player, block, pos
+    return on_block_common<&WorldEventHandles::blockinteract>(
+        block.rt.eventHandles.interact, player, block, pos
     );
 }
 
@@ -486,11 +500,9 @@ void scripting::on_chunk_present(const Chunk& chunk, bool loaded) {
         return 3;
     };
     for (auto& [packid, pack] : content->getPacks()) {
-        if (pack->worldfuncsset.onchunkpresent) {
-            lua::emit_event(
-                lua::get_main_state(), packid + ":.chunkpresent", args
-            );
-        }
+        lua::emit_event(
+            lua::get_main_state(), pack->worldeventhandles.chunkpresent, args
+        );
     }
     blocks_agent::on_chunk_present(*content->getIndices(), chunk);
 }
@@ -501,11 +513,9 @@ void scripting::on_chunk_remove(const Chunk& chunk) {
         return 2;
     };
     for (auto& [packid, pack] : content->getPacks()) {
-        if (pack->worldfuncsset.onchunkremove) {
-            lua::emit_event(
-                lua::get_main_state(), packid + ":.chunkremove", args
-            );
-        }
+        lua::emit_event(
+            lua::get_main_state(), pack->worldeventhandles.chunkremove, args
+        );
     }
     blocks_agent::on_chunk_remove(*content->getIndices(), chunk);
 }
@@ -517,11 +527,9 @@ void scripting::on_inventory_open(const Player* player, const Inventory& invento
         return 2;
     };
     for (auto& [packid, pack] : content->getPacks()) {
-        if (pack->worldfuncsset.oninventoryopen) {
-            lua::emit_event(
-                lua::get_main_state(), packid + ":.inventoryopen", args
-            );
-        }
+        lua::emit_event(
+            lua::get_main_state(), pack->worldeventhandles.inventoryopen, args
+        );
     }
 }
 
@@ -532,11 +540,9 @@ void scripting::on_inventory_closed(const Player* player, const Inventory& inven
         return 2;
     };
     for (auto& [packid, pack] : content->getPacks()) {
-        if (pack->worldfuncsset.oninventoryclosed) {
-            lua::emit_event(
-                lua::get_main_state(), packid + ":.inventoryclosed", args
-            );
-        }
+        lua::emit_event(
+            lua::get_main_state(), pack->worldeventhandles.inventoryclosed, args
+        );
     }
 }
 
@@ -547,19 +553,16 @@ void scripting::on_player_tick(Player* player, int tps) {
         return 2;
     };
     for (auto& [packid, pack] : content->getPacks()) {
-        if (pack->worldfuncsset.onplayertick) {
-            lua::emit_event(
-                lua::get_main_state(), packid + ":.playertick", args
-            );
-        }
+        lua::emit_event(
+            lua::get_main_state(), pack->worldeventhandles.playertick, args
+        );
     }
 }
 
 bool scripting::on_item_use(Player* player, const ItemDef& item) {
-    std::string name = item.name + ".use";
     return lua::emit_event(
         lua::get_main_state(),
-        name,
+        item.rt.eventHandles.use,
         [player](lua::State* L) { return lua::pushinteger(L, player->getId()); }
     );
 }
@@ -567,10 +570,9 @@ bool scripting::on_item_use(Player* player, const ItemDef& item) {
 bool scripting::on_item_use_on_block(
     Player* player, const ItemDef& item, glm::ivec3 ipos, glm::ivec3 normal
 ) {
-    std::string name = item.name + ".useon";
     return lua::emit_event(
         lua::get_main_state(),
-        name,
+        item.rt.eventHandles.useOnBlock,
         [ipos, normal, player](auto L) {
             lua::pushivec_stack(L, ipos);
             lua::pushinteger(L, player->getId());
@@ -583,10 +585,9 @@ bool scripting::on_item_use_on_block(
 bool scripting::on_item_break_block(
     Player* player, const ItemDef& item, int x, int y, int z
 ) {
-    std::string name = item.name + ".blockbreakby";
     return lua::emit_event(
         lua::get_main_state(),
-        name,
+        item.rt.eventHandles.blockBreakBy,
         [x, y, z, player](auto L) {
             lua::pushivec_stack(L, glm::ivec3(x, y, z));
             lua::pushinteger(L, player->getId());
@@ -651,6 +652,11 @@ bool scripting::register_event(
     return success;
 }
 
+/// @brief Get event handle if the event is defined by the script
+static int resolve_event(bool defined, const std::string& id) {
+    return defined ? lua::get_event_handle(lua::get_main_state(), id) : 0;
+}
+
 int scripting::get_values_on_stack() {
     return lua::gettop(lua::get_main_state());
 }
@@ -661,7 +667,8 @@ void scripting::load_content_script(
     const io::path& file,
     const std::string& fileName,
     BlockFuncsSet& funcsset,
-    BlockFuncNamesCache& namesCache
+    BlockFuncNamesCache& namesCache,
+    BlockEventHandles& eventHandles
 ) {
     int env = *senv;
     lua::pop(lua::get_main_state(), load_script(env, "block", file, fileName));
@@ -671,6 +678,9 @@ void scripting::load_content_script(
     funcsset.update = register_event(env, "on_update", prefix + ".update");
     funcsset.randupdate =
         register_event(env, "on_random_update", prefix + ".randupdate");
+    funcsset.randupdatebatch = register_event(
+        env, "on_random_update_batch", prefix + ".randupdatebatch"
+    );
     funcsset.onbreaking =
         register_event(env, "on_breaking", prefix + ".breaking");
     funcsset.onbroken = register_event(env, "on_broken", prefix + ".broken");
@@ -690,6 +700,23 @@ void scripting::load_content_script(
 
     namesCache.update = prefix + ".update";
     namesCache.randomUpdate = prefix + ".randupdate";
+
+    eventHandles.update = resolve_event(funcsset.update, namesCache.update);
+    eventHandles.randomUpdate =
+        resolve_event(funcsset.randupdate, namesCache.randomUpdate);
+    eventHandles.randomUpdateBatch = resolve_event(
+        funcsset.randupdatebatch, prefix + ".randupdatebatch"
+    );
+    eventHandles.placed = resolve_event(funcsset.onplaced, prefix + ".placed");
+    eventHandles.replaced =
+        resolve_event(funcsset.onreplaced, prefix + ".replaced");
+    eventHandles.breaking =
+        resolve_event(funcsset.onbreaking, prefix + ".breaking");
+    eventHandles.broken = resolve_event(funcsset.onbroken, prefix + ".broken");
+    eventHandles.interact =
+        resolve_event(funcsset.oninteract, prefix + ".interact");
+    eventHandles.blocksTick =
+        resolve_event(funcsset.onblockstick, prefix + ".blockstick");
 }
 
 void scripting::load_content_script(
@@ -698,7 +725,8 @@ void scripting::load_content_script(
     const io::path& file,
     const std::string& fileName,
     ItemFuncsSet& funcsset,
-    ItemFuncNamesCache& namesCache
+    ItemFuncNamesCache& namesCache,
+    ItemEventHandles& eventHandles
 ) {
     int env = *senv;
     lua::pop(lua::get_main_state(), load_script(env, "item", file, fileName));
@@ -710,6 +738,12 @@ void scripting::load_content_script(
         register_event(env, "on_use_on_block", prefix + ".useon");
     funcsset.on_block_break_by =
         register_event(env, "on_block_break_by", prefix + ".blockbreakby");
+
+    eventHandles.use = resolve_event(funcsset.on_use, prefix + ".use");
+    eventHandles.useOnBlock =
+        resolve_event(funcsset.on_use_on_block, prefix + ".useon");
+    eventHandles.blockBreakBy =
+        resolve_event(funcsset.on_block_break_by, prefix + ".blockbreakby");
 }
 
 void scripting::load_entity_component(
@@ -730,7 +764,8 @@ void scripting::load_world_script(
     const std::string& prefix,
     const io::path& file,
     const std::string& fileName,
-    WorldFuncsSet& funcsset
+    WorldFuncsSet& funcsset,
+    WorldEventHandles& eventHandles
 ) {
     int env = *senv;
     lua::pop(lua::get_main_state(), load_script(env, "world", file, fileName));
@@ -761,6 +796,27 @@ void scripting::load_world_script(
         register_event(env, "on_inventory_open", prefix + ":.inventoryopen");
     funcsset.oninventoryclosed =
         register_event(env, "on_inventory_closed", prefix + ":.inventoryclosed");
+
+    eventHandles.blockplaced =
+        resolve_event(funcsset.onblockplaced, prefix + ":.blockplaced");
+    eventHandles.blockreplaced =
+        resolve_event(funcsset.onblockreplaced, prefix + ":.blockreplaced");
+    eventHandles.blockbreaking =
+        resolve_event(funcsset.onblockbreaking, prefix + ":.blockbreaking");
+    eventHandles.blockbroken =
+        resolve_event(funcsset.onblockbroken, prefix + ":.blockbroken");
+    eventHandles.blockinteract =
+        resolve_event(funcsset.onblockinteract, prefix + ":.blockinteract");
+    eventHandles.playertick =
+        resolve_event(funcsset.onplayertick, prefix + ":.playertick");
+    eventHandles.chunkpresent =
+        resolve_event(funcsset.onchunkpresent, prefix + ":.chunkpresent");
+    eventHandles.chunkremove =
+        resolve_event(funcsset.onchunkremove, prefix + ":.chunkremove");
+    eventHandles.inventoryopen =
+        resolve_event(funcsset.oninventoryopen, prefix + ":.inventoryopen");
+    eventHandles.inventoryclosed =
+        resolve_event(funcsset.oninventoryclosed, prefix + ":.inventoryclosed");
 }
 
 void scripting::load_layout_script(
@@ -24,9 +24,12 @@ class Inventory;
 class UiDocument;
 struct BlockFuncsSet;
 struct BlockFuncNamesCache;
+struct BlockEventHandles;
 struct ItemFuncsSet;
 struct ItemFuncNamesCache;
+struct ItemEventHandles;
 struct WorldFuncsSet;
+struct WorldEventHandles;
 struct UserComponent;
 struct UiDocScript;
 class BlocksController;
@@ -89,6 +92,11 @@ namespace scripting {
     void on_blocks_tick(const Block& block, int tps);
     void update_block(const Block& block, const glm::ivec3& pos);
     void random_update_block(const Block& block, const glm::ivec3& pos);
+    /// @brief Random update of multiple blocks of the same type with
+    /// a single on_random_update_batch call
+    void random_update_blocks(
+        const Block& block, const std::vector<glm::ivec3>& positions
+    );
     void on_block_placed(
         Player* player, const Block& block, const glm::ivec3& pos
     );
@@ -166,13 +174,15 @@ namespace scripting {
     /// @param file item script file
     /// @param fileName script file path using the engine format
     /// @param funcsset block callbacks set
+    /// @param eventHandles block events handles resolved
     void load_content_script(
         const scriptenv& env,
         const std::string& prefix,
         const io::path& file,
         const std::string& fileName,
         BlockFuncsSet& funcsset,
-        BlockFuncNamesCache& namesCache
+        BlockFuncNamesCache& namesCache,
+        BlockEventHandles& eventHandles
     );
 
     /// @brief Load script associated with an Item
@@ -181,13 +191,15 @@ namespace scripting {
     /// @param file item script file
     /// @param fileName script file path using the engine format
     /// @param funcsset item callbacks set
+    /// @param eventHandles item events handles resolved
     void load_content_script(
         const scriptenv& env,
         const std::string& prefix,
         const io::path& file,
         const std::string& fileName,
         ItemFuncsSet& funcsset,
-        ItemFuncNamesCache& namesCache
+        ItemFuncNamesCache& namesCache,
+        ItemEventHandles& eventHandles
     );
 
     /// @brief Load component script
@@ -213,12 +225,15 @@ namespace scripting {
     /// @param packid content-pack id
     /// @param file script file path
     /// @param fileName script file path using the engine format
+    /// @param funcsset world callbacks set
+    /// @param eventHandles world events handles resolved
     void load_world_script(
         const scriptenv& env,
         const std::string& packid,
         const io::path& file,
         const std::string& fileName,
-        WorldFuncsSet& funcsset
+        WorldFuncsSet& funcsset,
+        WorldEventHandles& eventHandles
     );
 
     /// @brief Load script associated with an UiDocument
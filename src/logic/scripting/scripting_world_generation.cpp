@@ -69,6 +69,13 @@ public:
         }
     }
 
+    std::unique_ptr<GeneratorScript> createInstance() const override {
+        auto L = create_state(
+            Engine::getInstance().getPaths(), StateType::GENERATOR
+        );
+        return std::make_unique<LuaGeneratorScript>(L, def, file, dirPath);
+    }
+
     std::shared_ptr<Heightmap> generateHeightmap(
         const glm::ivec2& offset,
         const glm::ivec2& size,
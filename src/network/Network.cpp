@@ -163,11 +163,13 @@ size_t Network::getTotalDownload() const {
 void Network::update() {
     requests->update();
 
+    std::vector<std::shared_ptr<Connection>> updated;
     {
         std::lock_guard lock(connectionsMutex);
         auto socketiter = connections.begin();
         while (socketiter != connections.end()) {
             auto socket = socketiter->second.get();
+            updated.push_back(socketiter->second);
             totalDownload += socket->pullDownload();
             totalUpload += socket->pullUpload();
             if (
@@ -181,6 +183,10 @@ void Network::update() {
             ++socketiter;
         }
     }
+    // callbacks are called without the lock, so they may use connections
+    for (const auto& socket : updated) {
+        socket->update();
+    }
     auto serveriter = servers.begin();
     while (serveriter != servers.end()) {
         auto server = serveriter->second.get();
@@ -47,6 +47,12 @@ namespace network {
 
         virtual void sendTo(const std::string& addr, int port, const char* buffer, size_t length) = 0;
 
+        /// @brief Append datagram to the send queue. Queued datagrams are
+        /// sent in batch on flush or on the next update
+        virtual void queueTo(const std::string& addr, int port, const char* buffer, size_t length) = 0;
+
+        virtual void flush() = 0;
+
         [[nodiscard]] TransportType getTransportType() const noexcept override {
             return TransportType::UDP;
         }
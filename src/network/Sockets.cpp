@@ -3,10 +3,13 @@
 #pragma comment(lib, "Ws2_32.lib")
 
 #define NOMINMAX
+#include <atomic>
+#include <chrono>
 #include <stdexcept>
 #include <limits>
 #include <queue>
 #include <thread>
+#include <unordered_map>
 
 #ifdef _WIN32
 #include <curl/curl.h>
@@ -21,11 +24,19 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <sys/uio.h>
+#ifdef __linux__
+#include <sys/epoll.h>
+#else
+#include <poll.h>
+#endif
 
 using SOCKET = int;
 #endif // _WIN32
 
 #include "Network.hpp"
+#include "util/BufferPool.hpp"
+#include "util/RingBuffer.hpp"
 #include "util/stringutil.hpp"
 #include "debug/Logger.hpp"
 
@@ -37,16 +48,24 @@ static debug::Logger logger("sockets");
 static inline int closesocket(int descriptor) noexcept {
     return close(descriptor);
 }
-static inline std::runtime_error handle_socket_error(const std::string& message) {
-    int err = errno;
+static inline int last_socket_error() noexcept {
+    return errno;
+}
+static inline std::runtime_error socket_error(
+    const std::string& message, int err
+) {
     return std::runtime_error(
         message+" [errno=" + std::to_string(err) + "]: " + 
         std::string(strerror(err))
     );
 }
 #else
-static inline std::runtime_error handle_socket_error(const std::string& message) {
-    int errorCode = WSAGetLastError();
+static inline int last_socket_error() noexcept {
+    return WSAGetLastError();
+}
+static inline std::runtime_error socket_error(
+    const std::string& message, int errorCode
+) {
     wchar_t* s = nullptr;
     size_t size = FormatMessageW(
         FORMAT_MESSAGE_ALLOCATE_BUFFER | FORMAT_MESSAGE_FROM_SYSTEM |
@@ -69,6 +88,40 @@ static inline std::runtime_error handle_socket_error(const std::string& message)
 }
 #endif
 
+static inline std::runtime_error handle_socket_error(const std::string& message) {
+    return socket_error(message, last_socket_error());
+}
+
+#ifndef _WIN32
+inline constexpr SOCKET INVALID_SOCKET = -1;
+#endif
+
+#ifdef MSG_NOSIGNAL
+inline constexpr int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+inline constexpr int SEND_FLAGS = 0;
+#endif
+
+/// @brief Max reactor wait time, so it notices the shutdown
+inline constexpr int REACTOR_WAIT_MS = 100;
+inline constexpr int REACTOR_MAX_EVENTS = 64;
+/// @brief Poll timeout (new sockets are not polled until it ends)
+inline constexpr int REACTOR_POLL_MS = 5;
+/// @brief Max reads per socket event, so one busy socket does not block
+/// others
+inline constexpr int MAX_READS_PER_EVENT = 16;
+inline constexpr size_t READ_BUFFER_SIZE = 16'384;
+/// @brief Max datagrams received or sent with a single system call
+inline constexpr int DATAGRAMS_BATCH = 16;
+/// @brief Max time to send queued data of a closed connection before
+/// the socket is closed anyway (peer may not read it)
+inline constexpr int CLOSE_LINGER_MS = 5000;
+
+/// @brief Buffers for datagrams batches received by the reactor
+static util::BufferPool<char> datagrams_buffers(
+    READ_BUFFER_SIZE * DATAGRAMS_BATCH
+);
+
 static inline int connectsocket(
     int descriptor, const sockaddr* addr, socklen_t len
 ) noexcept {
@@ -87,6 +140,27 @@ static inline int sendsocket(
     return send(descriptor, buf, len, flags);
 }
 
+static bool set_nonblocking(SOCKET descriptor) noexcept {
+#ifdef _WIN32
+    u_long mode = 1;
+    return ioctlsocket(descriptor, FIONBIO, &mode) == 0;
+#else
+    int flags = fcntl(descriptor, F_GETFL, 0);
+    return flags != -1 && fcntl(descriptor, F_SETFL, flags | O_NONBLOCK) == 0;
+#endif
+}
+
+/// @return true if the last non-blocking socket operation failed
+/// because it would block
+static bool would_block() noexcept {
+#ifdef _WIN32
+    int err = WSAGetLastError();
+    return err == WSAEWOULDBLOCK || err == WSAEINPROGRESS;
+#else
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINPROGRESS;
+#endif
+}
+
 static std::string to_string(const sockaddr_in& addr, bool port=true) {
     char ip[INET_ADDRSTRLEN];
     if (inet_ntop(AF_INET, &(addr.sin_addr), ip, INET_ADDRSTRLEN)) {
@@ -96,44 +170,455 @@ static std::string to_string(const sockaddr_in& addr, bool port=true) {
     return "";
 }
 
-class SocketTcpConnection : public TcpConnection {
+/// @brief Datagrams stored contiguously until delivered or sent
+struct DatagramsBatch {
+    std::vector<char> data;
+    std::vector<size_t> sizes;
+    std::vector<sockaddr_in> addresses;
+
+    void add(const char* buffer, size_t size, const sockaddr_in* address) {
+        data.insert(data.end(), buffer, buffer + size);
+        sizes.push_back(size);
+        if (address) {
+            addresses.push_back(*address);
+        }
+    }
+
+    void clear() {
+        data.clear();
+        sizes.clear();
+        addresses.clear();
+    }
+};
+
+/// @brief Send queued data with a single system call
+/// @return number of bytes sent or -1
+static int send_parts(SOCKET descriptor, const util::RingBuffer<char>& queue) {
+    const char* parts[2] = {};
+    size_t sizes[2] = {};
+    int count = queue.getParts(parts, sizes);
+#ifdef _WIN32
+    WSABUF buffers[2];
+    for (int i = 0; i < count; i++) {
+        buffers[i].buf = const_cast<CHAR*>(parts[i]);
+        buffers[i].len = sizes[i];
+    }
+    DWORD sent = 0;
+    if (WSASend(descriptor, buffers, count, &sent, 0, nullptr, nullptr)) {
+        return -1;
+    }
+    return sent;
+#else
+    iovec vectors[2];
+    for (int i = 0; i < count; i++) {
+        vectors[i].iov_base = const_cast<char*>(parts[i]);
+        vectors[i].iov_len = sizes[i];
+    }
+    msghdr message {};
+    message.msg_iov = vectors;
+    message.msg_iovlen = count;
+    return sendmsg(descriptor, &message, SEND_FLAGS);
+#endif
+}
+
+/// @brief Send all datagrams of the batch. Datagrams not sent because the
+/// socket would block are dropped
+/// @return number of bytes sent or -1 on error
+static int send_datagrams(SOCKET descriptor, const DatagramsBatch& batch) {
+    const char* data = batch.data.data();
+    size_t count = batch.sizes.size();
+    bool addressed = !batch.addresses.empty();
+    int total = 0;
+#ifdef __linux__
+    mmsghdr messages[DATAGRAMS_BATCH];
+    iovec vectors[DATAGRAMS_BATCH];
+    size_t index = 0;
+    while (index < count) {
+        int batchSize = std::min<size_t>(DATAGRAMS_BATCH, count - index);
+        const char* ptr = data;
+        for (int i = 0; i < batchSize; i++) {
+            size_t size = batch.sizes[index + i];
+            vectors[i].iov_base = const_cast<char*>(ptr);
+            vectors[i].iov_len = size;
+            messages[i] = {};
+            messages[i].msg_hdr.msg_iov = &vectors[i];
+            messages[i].msg_hdr.msg_iovlen = 1;
+            if (addressed) {
+                messages[i].msg_hdr.msg_name =
+                    const_cast<sockaddr_in*>(&batch.addresses[index + i]);
+                messages[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+            }
+            ptr += size;
+        }
+        int sent = sendmmsg(descriptor, messages, batchSize, SEND_FLAGS);
+        if (sent <= 0) {
+            return sent < 0 && !would_block() ? -1 : total;
+        }
+        for (int i = 0; i < sent; i++) {
+            data += batch.sizes[index + i];
+            total += messages[i].msg_len;
+        }
+        index += sent;
+    }
+#else
+    for (size_t i = 0; i < count; i++) {
+        size_t size = batch.sizes[i];
+        int sent = addressed
+            ? sendto(descriptor, data, size, SEND_FLAGS,
+                     reinterpret_cast<const sockaddr*>(&batch.addresses[i]),
+                     sizeof(sockaddr_in))
+            : ::send(descriptor, data, size, SEND_FLAGS);
+        if (sent < 0) {
+            return would_block() ? total : -1;
+        }
+        data += size;
+        total += sent;
+    }
+#endif
+    return total;
+}
+
+/// @brief Receive available datagrams to the batch
+/// @param mutex batch mutex
+/// @param addressed store senders addresses
+/// @return number of bytes received or -1 on error
+static int receive_datagrams(
+    SOCKET descriptor, DatagramsBatch& batch, std::mutex& mutex, bool addressed
+) {
+    auto buffer = datagrams_buffers.get();
+    sockaddr_in addresses[DATAGRAMS_BATCH];
+    int total = 0;
+    for (int attempt = 0; attempt < MAX_READS_PER_EVENT; attempt++) {
+        int count = 0;
+        int sizes[DATAGRAMS_BATCH];
+#ifdef __linux__
+        mmsghdr messages[DATAGRAMS_BATCH];
+        iovec vectors[DATAGRAMS_BATCH];
+        for (int i = 0; i < DATAGRAMS_BATCH; i++) {
+            vectors[i].iov_base = buffer.get() + i * READ_BUFFER_SIZE;
+            vectors[i].iov_len = READ_BUFFER_SIZE;
+            messages[i] = {};
+            messages[i].msg_hdr.msg_iov = &vectors[i];
+            messages[i].msg_hdr.msg_iovlen = 1;
+            messages[i].msg_hdr.msg_name = &addresses[i];
+            messages[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+        }
+        count = recvmmsg(descriptor, messages, DATAGRAMS_BATCH, 0, nullptr);
+        for (int i = 0; i < count; i++) {
+            sizes[i] = messages[i].msg_len;
+        }
+#else
+        socklen_t addrlen = sizeof(sockaddr_in);
+        sizes[0] = recvfrom(
+            descriptor, buffer.get(), READ_BUFFER_SIZE, 0,
+            reinterpret_cast<sockaddr*>(&addresses[0]), &addrlen
+        );
+        count = sizes[0] < 0 ? -1 : 1;
+#endif
+        if (count < 0) {
+            return would_block() ? total : -1;
+        }
+        std::lock_guard lock(mutex);
+        for (int i = 0; i < count; i++) {
+            batch.add(
+                buffer.get() + i * READ_BUFFER_SIZE,
+                sizes[i],
+                addressed ? &addresses[i] : nullptr
+            );
+            total += sizes[i];
+        }
+#ifdef __linux__
+        if (count < DATAGRAMS_BATCH) {
+            // no more datagrams
+            break;
+        }
+#endif
+    }
+    return total;
+}
+
+/// @brief Non-blocking socket events handler. Called by the reactor thread
+class SocketHandler {
+    friend class SocketsReactor;
+    std::atomic<uint64_t> reactorToken = 0;
+public:
+    virtual ~SocketHandler() = default;
+
+    /// @brief Socket has data to read, incoming connection or error
+    virtual void onReadable() = 0;
+
+    /// @brief Socket is ready to send or connection is complete
+    virtual void onWritable() {}
+};
+
+/// @brief Single thread waiting for events of all non-blocking sockets
+/// (epoll on Linux, poll on other platforms) instead of a blocking thread
+/// per socket.
+///
+/// Handlers are called with the reactor mutex locked, so a handler is
+/// never called after remove(...) returned. Handlers may add and remove
+/// sockets themselves.
+class SocketsReactor {
+    struct Entry {
+        SOCKET descriptor;
+        SocketHandler* handler;
+        bool writable;
+    };
+    std::recursive_mutex mutex;
+    std::unordered_map<uint64_t, Entry> entries;
+    uint64_t nextToken = 1;
+    std::atomic<bool> working = true;
+#ifdef __linux__
+    int epollDescriptor;
+#endif
+    std::thread thread;
+
+    void dispatch(uint64_t token, bool readable, bool writable) {
+        auto found = entries.find(token);
+        if (found == entries.end()) {
+            return;
+        }
+        auto handler = found->second.handler;
+        if (readable) {
+            handler->onReadable();
+        }
+        // handler may be removed by onReadable
+        if (writable && entries.find(token) != entries.end()) {
+            handler->onWritable();
+        }
+    }
+
+#ifdef __linux__
+    void loop() {
+        epoll_event events[REACTOR_MAX_EVENTS];
+        while (working) {
+            int count = epoll_wait(
+                epollDescriptor, events, REACTOR_MAX_EVENTS, REACTOR_WAIT_MS
+            );
+            if (count < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                logger.error() << handle_socket_error("epoll_wait").what();
+                break;
+            }
+            std::lock_guard lock(mutex);
+            for (int i = 0; i < count; i++) {
+                uint32_t flags = events[i].events;
+                dispatch(
+                    events[i].data.u64,
+                    flags & (EPOLLIN | EPOLLERR | EPOLLHUP),
+                    flags & EPOLLOUT
+                );
+            }
+        }
+    }
+
+    void control(int operation, const Entry& entry, uint64_t token) {
+        epoll_event event {};
+        event.events = EPOLLIN | (entry.writable ? EPOLLOUT : 0);
+        event.data.u64 = token;
+        if (epoll_ctl(epollDescriptor, operation, entry.descriptor, &event)) {
+            logger.error() << handle_socket_error("epoll_ctl").what();
+        }
+    }
+#else
+    void loop() {
+        std::vector<pollfd> fds;
+        std::vector<uint64_t> tokens;
+        while (working) {
+            fds.clear();
+            tokens.clear();
+            {
+                std::lock_guard lock(mutex);
+                for (const auto& [token, entry] : entries) {
+                    pollfd fd {};
+                    fd.fd = entry.descriptor;
+                    fd.events = POLLIN | (entry.writable ? POLLOUT : 0);
+                    fds.push_back(fd);
+                    tokens.push_back(token);
+                }
+            }
+            if (fds.empty()) {
+                std::this_thread::sleep_for(
+                    std::chrono::milliseconds(REACTOR_POLL_MS)
+                );
+                continue;
+            }
+#ifdef _WIN32
+            int count = WSAPoll(fds.data(), fds.size(), REACTOR_POLL_MS);
+#else
+            int count = poll(fds.data(), fds.size(), REACTOR_POLL_MS);
+#endif
+            if (count <= 0) {
+                continue;
+            }
+            std::lock_guard lock(mutex);
+            for (size_t i = 0; i < fds.size(); i++) {
+                short flags = fds[i].revents;
+                if (flags == 0) {
+                    continue;
+                }
+                dispatch(
+                    tokens[i],
+                    flags & (POLLIN | POLLERR | POLLHUP),
+                    flags & POLLOUT
+                );
+            }
+        }
+    }
+#endif
+public:
+    SocketsReactor() {
+#ifdef __linux__
+        epollDescriptor = epoll_create1(EPOLL_CLOEXEC);
+        if (epollDescriptor == -1) {
+            throw handle_socket_error("epoll_create1 failed");
+        }
+#endif
+        thread = std::thread([this]() { loop(); });
+    }
+
+    ~SocketsReactor() {
+        working = false;
+        thread.join();
+#ifdef __linux__
+        ::close(epollDescriptor);
+#endif
+    }
+
+    /// @brief Start handling events of the non-blocking socket
+    /// @param writable handle writability events
+    void add(SOCKET descriptor, SocketHandler& handler, bool writable=false) {
+        std::lock_guard lock(mutex);
+        uint64_t token = nextToken++;
+        handler.reactorToken = token;
+        entries[token] = Entry {descriptor, &handler, writable};
+#ifdef __linux__
+        control(EPOLL_CTL_ADD, entries[token], token);
+#endif
+    }
+
+    /// @brief Enable or disable writability events handling
+    void setWritable(SocketHandler& handler, bool writable) {
+        std::lock_guard lock(mutex);
+        auto found = entries.find(handler.reactorToken);
+        if (found == entries.end() || found->second.writable == writable) {
+            return;
+        }
+        found->second.writable = writable;
+#ifdef __linux__
+        control(EPOLL_CTL_MOD, found->second, found->first);
+#endif
+    }
+
+    /// @brief Stop handling socket events. Must be called before the socket
+    /// is closed. Does nothing if the handler is not added
+    void remove(SocketHandler& handler) {
+        uint64_t token = handler.reactorToken.exchange(0);
+        if (token == 0) {
+            return;
+        }
+        std::lock_guard lock(mutex);
+        auto found = entries.find(token);
+        if (found == entries.end()) {
+            return;
+        }
+#ifdef __linux__
+        epoll_ctl(epollDescriptor, EPOLL_CTL_DEL, found->second.descriptor, nullptr);
+#endif
+        entries.erase(found);
+    }
+
+    static SocketsReactor& getInstance() {
+        static SocketsReactor instance;
+        return instance;
+    }
+};
+
+class SocketTcpConnection : public TcpConnection, public SocketHandler {
     SOCKET descriptor;
     sockaddr_in addr;
-    size_t totalUpload = 0;
-    size_t totalDownload = 0;
-    ConnectionState state = ConnectionState::INITIAL;
-    std::unique_ptr<std::thread> thread = nullptr;
-    std::vector<char> readBatch;
-    util::Buffer<char> buffer;
+    std::atomic<size_t> totalUpload = 0;
+    std::atomic<size_t> totalDownload = 0;
+    std::atomic<ConnectionState> state = ConnectionState::INITIAL;
+    /// @brief Received data not read yet
+    util::RingBuffer<char> readBuffer;
+    /// @brief Data waiting for the socket to be writable
+    util::RingBuffer<char> writeBuffer;
+    /// @brief Close the socket when all data is sent
+    bool closeAfterSend = false;
+    /// @brief Time to close the socket even if data is not sent
+    std::chrono::steady_clock::time_point closeDeadline;
+    /// @brief Guards buffers, closing state and the descriptor
     std::mutex mutex;
     std::string errorMessage;
 
-    void connectSocket() {
-        state = ConnectionState::CONNECTING;
-        logger.info() << "connecting to " << to_string(addr);
-        int res = connectsocket(descriptor, (const sockaddr*)&addr, sizeof(sockaddr_in));
-        if (res < 0) {
-            auto error = handle_socket_error("Connect failed");
+    enum class ConnectResult {
+        NONE, CONNECTED, FAILED
+    };
+    runnable connectCallback;
+    stringconsumer errorCallback;
+    /// @brief Connection result to be delivered by update()
+    std::atomic<ConnectResult> connectResult = ConnectResult::NONE;
+
+    /// @brief Stop handling events and close the socket
+    void closeSocket() {
+        SocketsReactor::getInstance().remove(*this);
+        std::lock_guard lock(mutex);
+        if (descriptor != INVALID_SOCKET) {
+            shutdown(descriptor, SHUT_RDWR);
             closesocket(descriptor);
-            state = ConnectionState::CLOSED;
-            errorMessage = error.what();
+            descriptor = INVALID_SOCKET;
+        }
+        closeAfterSend = false;
+        state = ConnectionState::CLOSED;
+    }
+
+    void finishConnect() {
+        int err = 0;
+        socklen_t len = sizeof(err);
+        if (getsockopt(
+                descriptor, SOL_SOCKET, SO_ERROR, (char*)&err, &len
+            ) < 0) {
+            err = last_socket_error();
+        }
+        if (err) {
+            errorMessage = socket_error("Connect failed", err).what();
             logger.error() << errorMessage;
-            return;
+            closeSocket();
+            connectResult = ConnectResult::FAILED;
+        } else {
+            logger.info() << "connected to " << to_string(addr);
+            state = ConnectionState::CONNECTED;
+            connectResult = ConnectResult::CONNECTED;
         }
-        logger.info() << "connected to " << to_string(addr);
-        state = ConnectionState::CONNECTED;
+    }
+
+    /// @brief Send queued data until the socket would block.
+    /// Mutex must be locked
+    /// @return false on error
+    bool sendQueued() {
+        while (!writeBuffer.empty()) {
+            int len = send_parts(descriptor, writeBuffer);
+            if (len < 0) {
+                if (would_block()) {
+                    return true;
+                }
+                logger.error() << handle_socket_error("send(...) error").what();
+                return false;
+            }
+            writeBuffer.pop(len);
+            totalUpload += len;
+        }
+        return true;
     }
 public:
     SocketTcpConnection(SOCKET descriptor, sockaddr_in addr)
-        : descriptor(descriptor), addr(std::move(addr)), buffer(16'384) {}
+        : descriptor(descriptor), addr(std::move(addr)) {}
 
     ~SocketTcpConnection() {
-        if (state != ConnectionState::CLOSED) {
-            shutdown(descriptor, 2);
-        }
-        if (thread) {
-            thread->join();
-        }
+        closeSocket();
     }
 
     void setNoDelay(bool noDelay) override {
@@ -152,110 +637,228 @@ public:
         return opt != 0;
     }
 
-    void startListen() {
-        while (state == ConnectionState::CONNECTED) {
-            int size = recvsocket(descriptor, buffer.data(), buffer.size());
+    void onReadable() override {
+        if (state == ConnectionState::CONNECTING) {
+            finishConnect();
+            return;
+        }
+        char buffer[READ_BUFFER_SIZE];
+        for (int i = 0; i < MAX_READS_PER_EVENT; i++) {
+            int size = recvsocket(descriptor, buffer, sizeof(buffer));
             if (size == 0) {
                 logger.info() << "closed connection with " << to_string(addr);
-                closesocket(descriptor);
-                state = ConnectionState::CLOSED;
-                break;
+                closeSocket();
+                return;
             } else if (size < 0) {
+                if (would_block()) {
+                    return;
+                }
                 logger.warning() << "an error ocurred while receiving from "
-                            << to_string(addr);
+                                 << to_string(addr);
                 auto error = handle_socket_error("recv(...) error");
-                closesocket(descriptor);
-                state = ConnectionState::CLOSED;
+                closeSocket();
                 logger.error() << error.what();
-                break;
+                return;
             }
             {
                 std::lock_guard lock(mutex);
-                for (size_t i = 0; i < size; i++) {
-                    readBatch.emplace_back(buffer[i]);
+                readBuffer.write(buffer, size);
+            }
+            totalDownload += size;
+        }
+    }
+
+    void onWritable() override {
+        if (state == ConnectionState::CONNECTING) {
+            finishConnect();
+        }
+        if (state != ConnectionState::CONNECTED) {
+            return;
+        }
+        bool closeNow;
+        {
+            std::lock_guard lock(mutex);
+            closeNow = !sendQueued();
+            if (!closeNow) {
+                if (!writeBuffer.empty()) {
+                    return;
                 }
-                totalDownload += size;
+                closeNow = closeAfterSend;
             }
         }
+        if (closeNow) {
+            closeSocket();
+        } else {
+            SocketsReactor::getInstance().setWritable(*this, false);
+        }
     }
 
     void startClient() {
         state = ConnectionState::CONNECTED;
-        thread = std::make_unique<std::thread>([this]() { startListen();});
+        SocketsReactor::getInstance().add(descriptor, *this);
     }
 
     void connect(runnable callback, stringconsumer errorCallback) override {
-        thread = std::make_unique<std::thread>([this, callback, errorCallback]() {
-            connectSocket();
-            if (state == ConnectionState::CONNECTED) {
-                callback();
-                startListen();
-            } else {
-                errorCallback(errorMessage);
-            }
-        });
+        connectCallback = std::move(callback);
+        this->errorCallback = std::move(errorCallback);
+
+        state = ConnectionState::CONNECTING;
+        logger.info() << "connecting to " << to_string(addr);
+        if (!set_nonblocking(descriptor)) {
+            errorMessage = handle_socket_error("Connect failed").what();
+            logger.error() << errorMessage;
+            closeSocket();
+            connectResult = ConnectResult::FAILED;
+            return;
+        }
+        int res = connectsocket(descriptor, (const sockaddr*)&addr, sizeof(sockaddr_in));
+        if (res == 0) {
+            logger.info() << "connected to " << to_string(addr);
+            state = ConnectionState::CONNECTED;
+            connectResult = ConnectResult::CONNECTED;
+            SocketsReactor::getInstance().add(descriptor, *this);
+        } else if (would_block()) {
+            SocketsReactor::getInstance().add(descriptor, *this, true);
+        } else {
+            errorMessage = handle_socket_error("Connect failed").what();
+            logger.error() << errorMessage;
+            closeSocket();
+            connectResult = ConnectResult::FAILED;
+        }
+    }
+
+    void update() override {
+        switch (connectResult.exchange(ConnectResult::NONE)) {
+            case ConnectResult::CONNECTED:
+                if (connectCallback) {
+                    connectCallback();
+                }
+                break;
+            case ConnectResult::FAILED:
+                if (errorCallback) {
+                    errorCallback(errorMessage);
+                }
+                break;
+            default:
+                break;
+        }
+        bool lingerExpired;
+        {
+            std::lock_guard lock(mutex);
+            lingerExpired = closeAfterSend &&
+                            std::chrono::steady_clock::now() >= closeDeadline;
+        }
+        if (lingerExpired) {
+            logger.warning() << "unsent data discarded on closing connection "
+                                "with " << to_string(addr);
+            closeSocket();
+            return;
+        }
+        flush();
     }
 
     int recv(char* buffer, size_t length) override {
         std::lock_guard lock(mutex);
 
-        if (state != ConnectionState::CONNECTED && readBatch.empty()) {
+        if (state != ConnectionState::CONNECTED && readBuffer.empty()) {
             return -1;
         }
-        int size = std::min(readBatch.size(), length);
-        std::memcpy(buffer, readBatch.data(), size);
-        readBatch.erase(readBatch.begin(), readBatch.begin() + size);
-        return size;
+        return readBuffer.read(buffer, length);
     }
 
     int send(const char* buffer, size_t length) override {
         if (state == ConnectionState::CLOSED) {
             return 0;
         }
-        int len = sendsocket(descriptor, buffer, length, 0);
-        if (len == -1) {
-            int err = errno;
-            close();
-            throw std::runtime_error(
-                "Send failed [errno=" + std::to_string(err) + "]: "
-                 + std::string(strerror(err))
-            );
+        std::string error;
+        {
+            std::lock_guard lock(mutex);
+            size_t sent = 0;
+            // data is queued while connecting or previous data is not sent
+            if (writeBuffer.empty() && state == ConnectionState::CONNECTED) {
+                int len = sendsocket(descriptor, buffer, length, SEND_FLAGS);
+                if (len >= 0) {
+                    sent = len;
+                    totalUpload += len;
+                } else if (!would_block()) {
+                    error = handle_socket_error("Send failed").what();
+                }
+            }
+            if (error.empty()) {
+                if (sent == length) {
+                    return length;
+                }
+                writeBuffer.write(buffer + sent, length - sent);
+            }
+        }
+        if (!error.empty()) {
+            closeSocket();
+            throw std::runtime_error(error);
+        }
+        SocketsReactor::getInstance().setWritable(*this, true);
+        return length;
+    }
+
+    void queue(const char* buffer, size_t length) override {
+        if (state == ConnectionState::CLOSED) {
+            return;
+        }
+        std::lock_guard lock(mutex);
+        writeBuffer.write(buffer, length);
+    }
+
+    void flush() override {
+        bool failed;
+        {
+            std::lock_guard lock(mutex);
+            if (state != ConnectionState::CONNECTED || writeBuffer.empty()) {
+                return;
+            }
+            failed = !sendQueued();
+            if (!failed && writeBuffer.empty()) {
+                return;
+            }
+        }
+        if (failed) {
+            closeSocket();
+        } else {
+            SocketsReactor::getInstance().setWritable(*this, true);
         }
-        totalUpload += len;
-        return len;
     }
 
     int available() override {
         std::lock_guard lock(mutex);
-        return readBatch.size();
+        return readBuffer.size();
     }
 
     void close(bool discardAll=false) override {
+        bool linger = false;
         {
             std::lock_guard lock(mutex);
-            readBatch.clear();
-
-            if (state != ConnectionState::CLOSED) {
-                shutdown(descriptor, SHUT_RDWR);
-                closesocket(descriptor);
+            readBuffer.clear();
+            // sent data is never discarded as send() was blocking before
+            if (!writeBuffer.empty() && state != ConnectionState::CLOSED) {
+                // closed by the reactor thread when all data is sent or
+                // by update() when the linger timeout expires
+                closeAfterSend = true;
+                closeDeadline = std::chrono::steady_clock::now() +
+                                std::chrono::milliseconds(CLOSE_LINGER_MS);
+                linger = true;
             }
         }
-        if (thread) {
-            thread->join();
-            thread = nullptr;
+        if (linger) {
+            SocketsReactor::getInstance().setWritable(*this, true);
+        } else {
+            closeSocket();
         }
     }
 
     size_t pullUpload() override {
-        size_t size = totalUpload;
-        totalUpload = 0;
-        return size;
+        return totalUpload.exchange(0);
     }
 
     size_t pullDownload() override {
-        size_t size = totalDownload;
-        totalDownload = 0;
-        return size;
+        return totalDownload.exchange(0);
     }
 
     int getPort() const override {
@@ -294,7 +897,7 @@ public:
         freeaddrinfo(addrinfo);
 
         SOCKET descriptor = socket(AF_INET, SOCK_STREAM, 0);
-        if (descriptor == -1) {
+        if (descriptor == INVALID_SOCKET) {
             std::string errorMessage = "could not create socket";
             if (errorCallback) {
                 errorCallback(errorMessage);
@@ -311,14 +914,16 @@ public:
     }
 };
 
-class SocketTcpServer : public TcpServer {
+class SocketTcpServer : public TcpServer, public SocketHandler {
     u64id_t id;
     Network* network;
     SOCKET descriptor;
     std::vector<u64id_t> clients;
-    std::mutex clientsMutex;
+    /// @brief Accepted connections to be delivered by update()
+    std::vector<std::shared_ptr<SocketTcpConnection>> accepted;
+    std::mutex acceptedMutex;
+    ConnectCallback handler;
     bool open = true;
-    std::unique_ptr<std::thread> thread = nullptr;
     int port;
     int maxConnected = -1;
 public:
@@ -333,6 +938,31 @@ public:
         maxConnected = count;
     }
 
+    void onReadable() override {
+        while (true) {
+            socklen_t addrlen = sizeof(sockaddr_in);
+            sockaddr_in address;
+            SOCKET clientDescriptor =
+                accept(descriptor, (sockaddr*)&address, &addrlen);
+            if (clientDescriptor == INVALID_SOCKET) {
+                if (!would_block()) {
+                    logger.error() << handle_socket_error("accept").what();
+                }
+                break;
+            }
+            if (!set_nonblocking(clientDescriptor)) {
+                closesocket(clientDescriptor);
+                continue;
+            }
+            auto socket = std::make_shared<SocketTcpConnection>(
+                clientDescriptor, address
+            );
+            socket->startClient();
+            std::lock_guard lock(acceptedMutex);
+            accepted.push_back(std::move(socket));
+        }
+    }
+
     void update() override {
         std::vector<u64id_t> clients;
         for (u64id_t cid : this->clients) {
@@ -343,42 +973,35 @@ public:
             }
         }
         std::swap(clients, this->clients);
+
+        std::vector<std::shared_ptr<SocketTcpConnection>> accepted;
+        {
+            std::lock_guard lock(acceptedMutex);
+            std::swap(accepted, this->accepted);
+        }
+        for (auto& socket : accepted) {
+            if (maxConnected >= 0 && this->clients.size() >= maxConnected) {
+                logger.info() << "refused connection attempt from "
+                              << socket->getAddress();
+                socket->close(true);
+                continue;
+            }
+            logger.info() << "client connected: " << socket->getAddress();
+            u64id_t id = network->addConnection(socket);
+            this->clients.push_back(id);
+            handler(this->id, id);
+        }
     }
 
     void startListen(ConnectCallback handler) override {
-        thread = std::make_unique<std::thread>([this, handler]() {
-            while (open) {
-                logger.info() << "listening for connections";
-                if (listen(descriptor, 2) < 0) {
-                    close();
-                    break;
-                }
-                socklen_t addrlen = sizeof(sockaddr_in);
-                SOCKET clientDescriptor;
-                sockaddr_in address;
-                logger.info() << "accepting clients";
-                if ((clientDescriptor = accept(descriptor, (sockaddr*)&address, &addrlen)) == -1) {
-                    close();
-                    break;
-                }
-                if (maxConnected >= 0 && clients.size() >= maxConnected) {
-                    logger.info() << "refused connection attempt from " << to_string(address);
-                    closesocket(clientDescriptor);
-                    continue;
-                }
-                logger.info() << "client connected: " << to_string(address);
-                auto socket = std::make_shared<SocketTcpConnection>(
-                    clientDescriptor, address
-                );
-                socket->startClient();
-                u64id_t id = network->addConnection(socket);
-                {
-                    std::lock_guard lock(clientsMutex);
-                    clients.push_back(id);
-                }
-                handler(this->id, id);
-            }
-        });
+        this->handler = std::move(handler);
+        logger.info() << "listening for connections";
+        if (listen(descriptor, SOMAXCONN) < 0 || !set_nonblocking(descriptor)) {
+            logger.error() << handle_socket_error("listen").what();
+            close();
+            return;
+        }
+        SocketsReactor::getInstance().add(descriptor, *this);
     }
     
     void closeSocket() {
@@ -388,19 +1011,17 @@ public:
         logger.info() << "closing server";
         open = false;
 
-        {
-            std::lock_guard lock(clientsMutex);
-            for (u64id_t clientid : clients) {
-                if (auto client = network->getConnection(clientid, true)) {
-                    client->close();
-                }
+        SocketsReactor::getInstance().remove(*this);
+        for (u64id_t clientid : clients) {
+            if (auto client = network->getConnection(clientid, true)) {
+                client->close();
             }
         }
         clients.clear();
+        accepted.clear();
 
         shutdown(descriptor, 2);
         closesocket(descriptor);
-        thread->join();
     }
 
     void close() override {
@@ -421,7 +1042,7 @@ public:
         SOCKET descriptor = socket(
             AF_INET, SOCK_STREAM, 0
         );
-        if (descriptor == -1) {
+        if (descriptor == INVALID_SOCKET) {
             throw std::runtime_error("Could not create server socket");
         }
         int opt = 1;
@@ -454,6 +1075,12 @@ public:
 
 static sockaddr_in resolve_address_dgram(const std::string& address, int port) {
     sockaddr_in serverAddr{};
+    serverAddr.sin_family = AF_INET;
+    serverAddr.sin_port = htons(port);
+    // numeric addresses do not need a lookup
+    if (inet_pton(AF_INET, address.c_str(), &serverAddr.sin_addr) == 1) {
+        return serverAddr;
+    }
     addrinfo hints {};
 
     hints.ai_family = AF_INET;
@@ -472,18 +1099,33 @@ static sockaddr_in resolve_address_dgram(const std::string& address, int port) {
     return serverAddr;
 }
 
-class SocketUdpConnection : public UdpConnection {
+class SocketUdpConnection : public UdpConnection, public SocketHandler {
     u64id_t id;
     SOCKET descriptor;
     sockaddr_in addr{};
     bool open = true;
-    std::unique_ptr<std::thread> thread;
     ClientDatagramCallback callback;
+    DatagramsBatch received;
+    DatagramsBatch delivered;
+    /// @brief Datagrams queued to be sent on flush
+    DatagramsBatch sendQueue;
+    /// @brief Guards received batch and the descriptor
+    std::mutex mutex;
 
-    size_t totalUpload = 0;
-    size_t totalDownload = 0;
-    ConnectionState state = ConnectionState::INITIAL;
+    std::atomic<size_t> totalUpload = 0;
+    std::atomic<size_t> totalDownload = 0;
+    std::atomic<ConnectionState> state = ConnectionState::INITIAL;
 
+    void closeSocket() {
+        SocketsReactor::getInstance().remove(*this);
+        std::lock_guard lock(mutex);
+        if (descriptor != INVALID_SOCKET) {
+            shutdown(descriptor, 2);
+            closesocket(descriptor);
+            descriptor = INVALID_SOCKET;
+        }
+        state = ConnectionState::CLOSED;
+    }
 public:
     SocketUdpConnection(u64id_t id, SOCKET descriptor, sockaddr_in addr)
         : id(id), descriptor(descriptor), addr(std::move(addr)) {}
@@ -500,13 +1142,14 @@ public:
         runnable callback
     ) {
         SOCKET descriptor = socket(AF_INET, SOCK_DGRAM, 0);
-        if (descriptor == -1) {
+        if (descriptor == INVALID_SOCKET) {
             throw std::runtime_error("could not create udp socket");
         }
 
         sockaddr_in serverAddr = resolve_address_dgram(address, port);
 
-        if (::connect(descriptor, (sockaddr*)&serverAddr, sizeof(serverAddr)) < 0) {
+        if (::connect(descriptor, (sockaddr*)&serverAddr, sizeof(serverAddr)) < 0 ||
+            !set_nonblocking(descriptor)) {
             auto err = handle_socket_error("udp connect failed");
             closesocket(descriptor);
             throw err;
@@ -523,32 +1166,50 @@ public:
     void connect(ClientDatagramCallback handler) override {
         callback = std::move(handler);
         state = ConnectionState::CONNECTED;
+        SocketsReactor::getInstance().add(descriptor, *this);
+    }
 
-        thread = std::make_unique<std::thread>([this]() {
-            util::Buffer<char> buffer(16'384);
-            while (open) {
-                int size = recv(descriptor, buffer.data(), buffer.size(), 0);
-                if (size <= 0) {
-                    logger.error() << "udp connection " << id
-                                   << handle_socket_error(" recv error").what();
-                    if (!open) break;
-                    closesocket(descriptor);
-                    state = ConnectionState::CLOSED;
-                    break;
-                }
-                totalDownload += size;
-                if (callback) {
-                    callback(id, buffer.data(), size);
-                }
+    void onReadable() override {
+        int size = receive_datagrams(descriptor, received, mutex, false);
+        if (size < 0) {
+            logger.error() << "udp connection " << id
+                           << handle_socket_error(" recv error").what();
+            closeSocket();
+            return;
+        }
+        totalDownload += size;
+    }
+
+    void update() override {
+        flush();
+        {
+            std::lock_guard lock(mutex);
+            std::swap(received, delivered);
+        }
+        if (callback) {
+            size_t offset = 0;
+            for (size_t size : delivered.sizes) {
+                callback(id, delivered.data.data() + offset, size);
+                offset += size;
             }
-        });
+        }
+        delivered.clear();
     }
 
     int send(const char* buffer, size_t length) override {
-        int len = ::send(descriptor, buffer, length, 0);
+        std::lock_guard lock(mutex);
+        if (descriptor == INVALID_SOCKET) {
+            return -1;
+        }
+        int len = ::send(descriptor, buffer, length, SEND_FLAGS);
         if (len < 0) {
+            if (would_block()) {
+                // the datagram is dropped
+                return 0;
+            }
             auto err = handle_socket_error(" send failed");
             closesocket(descriptor);
+            descriptor = INVALID_SOCKET;
             state = ConnectionState::CLOSED;
             logger.error() << "udp connection " << id << err.what();
         } else totalUpload += len;
@@ -556,33 +1217,49 @@ public:
         return len;
     }
 
+    void queue(const char* buffer, size_t length) override {
+        sendQueue.add(buffer, length, nullptr);
+    }
+
+    void flush() override {
+        if (sendQueue.sizes.empty()) {
+            return;
+        }
+        int len;
+        {
+            std::lock_guard lock(mutex);
+            if (descriptor == INVALID_SOCKET) {
+                sendQueue.clear();
+                return;
+            }
+            len = send_datagrams(descriptor, sendQueue);
+        }
+        sendQueue.clear();
+        if (len < 0) {
+            logger.error() << "udp connection " << id
+                           << handle_socket_error(" send failed").what();
+            closeSocket();
+            return;
+        }
+        totalUpload += len;
+    }
+
     void close(bool discardAll=false) override {
         if (!open) return;
         open = false;
         logger.info() << "closing udp connection "<< id;
-
-        if (state != ConnectionState::CLOSED) {
-            shutdown(descriptor, 2);
-            closesocket(descriptor);
+        if (!discardAll) {
+            flush();
         }
-
-        if (thread) {
-            thread->join();
-            thread.reset();
-        }
-        state = ConnectionState::CLOSED;
+        closeSocket();
     }
 
     size_t pullUpload() override {
-        size_t s = totalUpload;
-        totalUpload = 0;
-        return s;
+        return totalUpload.exchange(0);
     }
 
     size_t pullDownload() override {
-        size_t s = totalDownload;
-        totalDownload = 0;
-        return s;
+        return totalDownload.exchange(0);
     }
 
     [[nodiscard]] int getPort() const override {
@@ -598,14 +1275,17 @@ public:
     }
 };
 
-class SocketUdpServer : public UdpServer {
+class SocketUdpServer : public UdpServer, public SocketHandler {
     u64id_t id;
     SOCKET descriptor;
     bool open = true;
-    std::unique_ptr<std::thread> thread = nullptr;
     int port;
     ServerDatagramCallback callback;
-
+    DatagramsBatch received;
+    DatagramsBatch delivered;
+    /// @brief Addressed datagrams queued to be sent on flush
+    DatagramsBatch sendQueue;
+    std::mutex mutex;
 public:
     SocketUdpServer(u64id_t id, Network* network, SOCKET descriptor, int port)
         : id(id), descriptor(descriptor), port(port) {}
@@ -614,49 +1294,70 @@ public:
         SocketUdpServer::close();
     }
 
-    void update() override {}
+    void onReadable() override {
+        // errors of a single datagram do not close the server
+        receive_datagrams(descriptor, received, mutex, true);
+    }
+
+    void update() override {
+        flush();
+        {
+            std::lock_guard lock(mutex);
+            std::swap(received, delivered);
+        }
+        size_t offset = 0;
+        for (size_t i = 0; i < delivered.sizes.size(); i++) {
+            const auto& clientAddr = delivered.addresses[i];
+            size_t size = delivered.sizes[i];
+            callback(
+                id,
+                to_string(clientAddr, false),
+                ntohs(clientAddr.sin_port),
+                delivered.data.data() + offset,
+                size
+            );
+            offset += size;
+        }
+        delivered.clear();
+    }
 
     void startListen(ServerDatagramCallback handler) override {
         callback = std::move(handler);
-
-        thread = std::make_unique<std::thread>([this]() {
-            util::Buffer<char> buffer(16384);
-            sockaddr_in clientAddr{};
-            socklen_t addrlen = sizeof(clientAddr);
-
-            while (open) {
-                int size = recvfrom(descriptor, buffer.data(), buffer.size(), 0,
-                                    reinterpret_cast<sockaddr*>(&clientAddr), &addrlen);
-                if (size <= 0) {
-                    if (!open) break;
-                    continue;
-                }
-
-                std::string addrStr = to_string(clientAddr, false);
-                int port = ntohs(clientAddr.sin_port);
-
-                callback(id, addrStr, port, buffer.data(), size);
-            }
-        });
+        SocketsReactor::getInstance().add(descriptor, *this);
     }
 
     void sendTo(const std::string& addr, int port, const char* buffer, size_t length) override {
         sockaddr_in client = resolve_address_dgram(addr, port);
-        if (sendto(descriptor, buffer, length, 0,
+        if (sendto(descriptor, buffer, length, SEND_FLAGS,
                reinterpret_cast<sockaddr*>(&client), sizeof(client)) < 0) {
             logger.error() << handle_socket_error("sendto").what();
         }
     }
 
+    void queueTo(
+        const std::string& addr, int port, const char* buffer, size_t length
+    ) override {
+        sockaddr_in client = resolve_address_dgram(addr, port);
+        sendQueue.add(buffer, length, &client);
+    }
+
+    void flush() override {
+        if (sendQueue.sizes.empty() || !open) {
+            return;
+        }
+        if (send_datagrams(descriptor, sendQueue) < 0) {
+            logger.error() << handle_socket_error("sendto").what();
+        }
+        sendQueue.clear();
+    }
+
     void close() override {
         if (!open) return;
+        flush();
         open = false;
+        SocketsReactor::getInstance().remove(*this);
         shutdown(descriptor, 2);
         closesocket(descriptor);
-        if (thread) {
-            thread->join();
-            thread = nullptr;
-        }
     }
 
     bool isOpen() override { return open; }
@@ -666,14 +1367,15 @@ public:
         u64id_t id, Network* network, int port, const ServerDatagramCallback& handler
     ) {
         SOCKET descriptor = socket(AF_INET, SOCK_DGRAM, 0);
-        if (descriptor == -1) throw std::runtime_error("could not create udp socket");
+        if (descriptor == INVALID_SOCKET) throw std::runtime_error("could not create udp socket");
 
         sockaddr_in address{};
         address.sin_family = AF_INET;
         address.sin_addr.s_addr = INADDR_ANY;
         address.sin_port = htons(port);
 
-        if (bind(descriptor, (sockaddr*)&address, sizeof(address)) < 0) {
+        if (bind(descriptor, (sockaddr*)&address, sizeof(address)) < 0 ||
+            !set_nonblocking(descriptor)) {
             closesocket(descriptor);
             throw std::runtime_error("could not bind udp port " + std::to_string(port));
         }
@@ -60,6 +60,17 @@ namespace network {
 
         virtual int send(const char* buffer, size_t length) = 0;
 
+        /// @brief Append data to the send queue without a system call.
+        /// Queued data is sent on flush or on the next update
+        virtual void queue(const char* buffer, size_t length) = 0;
+
+        /// @brief Send all queued data with as few system calls as possible
+        virtual void flush() = 0;
+
+        /// @brief Deliver events received since the previous update.
+        /// Called by Network::update
+        virtual void update() {}
+
         virtual size_t pullUpload() = 0;
         virtual size_t pullDownload() = 0;
 
@@ -27,6 +27,15 @@
 
 static debug::Logger logger("entities");
 
+/// @brief Max distance between entity transform position and hitbox
+/// position considered by hitboxes queries
+inline constexpr float HITBOX_QUERY_MARGIN = 1.0f;
+
+static float calc_hitbox_extent(const Hitbox& hitbox) {
+    auto half = glm::max(hitbox.halfsize, hitbox.getHalfSize());
+    return glm::max(half.x, glm::max(half.y, half.z));
+}
+
 Entities::Entities(Level& level)
     : registry(std::make_unique<entt::registry>()),
       level(level),
@@ -82,7 +91,7 @@ entityid_t Entities::spawn(
     uids[entity] = id;
 
     registry->emplace<EntityId>(entity, id, def);
-    const auto& tsf = registry->emplace<Transform>(
+    auto& tsf = registry->emplace<Transform>(
         entity,
         position,
         glm::vec3(1.0f),
@@ -115,6 +124,13 @@ entityid_t Entities::spawn(
         loadEntity(saved, get(id).value());
     }
     body.hitbox.position = tsf.pos;
+    maxHitboxExtent = glm::max(maxHitboxExtent, calc_hitbox_extent(body.hitbox));
+
+    tsf.grid = &grid;
+    tsf.handle = entity;
+    tsf.gridCell = EntitiesGrid::cellKey(tsf.pos);
+    grid.add(entity, tsf.gridCell);
+
     scripting::on_entity_spawn(
         def, id, scripting.components, args, componentsMap
     );
@@ -170,12 +186,13 @@ std::optional<Entities::RaycastResult> Entities::rayCast(
     bool solidOnly
 ) {
     Ray ray(start, dir);
-    auto view = registry->view<EntityId, Transform, Rigidbody>();
+    queryHitboxes(AABB(start, start + dir * maxDistance));
 
     entityid_t foundUID = 0;
     glm::ivec3 foundNormal;
 
-    for (auto [entity, eid, transform, body] : view.each()) {
+    for (auto entity : foundEntities) {
+        const auto& [eid, body] = registry->get<EntityId, Rigidbody>(entity);
         if (eid.uid == ignore || !body.enabled || (solidOnly && !eid.def.solid)) {
             continue;
         }
@@ -245,6 +262,8 @@ void Entities::clean() {
             for (auto& sensor : rigidbody.sensors) {
                 physics->removeSensor(&sensor);
             }
+            const auto& transform = registry->get<Transform>(it->second);
+            grid.remove(it->second, transform.gridCell);
             uids.erase(it->second);
             registry->destroy(it->second);
             it = entities.erase(it);
@@ -310,8 +329,11 @@ void Entities::preparePhysics(float delta) {
     hitboxes.clear();
     solidHitboxes.clear();
 
+    maxHitboxExtent = 0.0f;
     auto view = registry->view<EntityId, Rigidbody>();
     for (auto [entity, eid, rigidbody] : view.each()) {
+        maxHitboxExtent =
+            glm::max(maxHitboxExtent, calc_hitbox_extent(rigidbody.hitbox));
         auto bodyType = rigidbody.hitbox.type;
         if (eid.destroyFlag || !rigidbody.enabled || bodyType == BodyType::STATIC) {
             continue;
@@ -326,6 +348,7 @@ void Entities::preparePhysics(float delta) {
         }
         solidHitboxes.emplace_back(&rigidbody.hitbox);
     }
+    physics.prepareBroadphase();
 }
 
 void Entities::updatePhysics(float delta) {
@@ -479,9 +502,17 @@ void Entities::render(
     }
 }
 
+void Entities::queryHitboxes(const AABB& area) {
+    float extent = maxHitboxExtent + HITBOX_QUERY_MARGIN;
+    grid.query(
+        AABB(area.min() - extent, area.max() + extent), foundEntities
+    );
+}
+
 bool Entities::hasBlockingInside(AABB aabb) {
-    auto view = registry->view<EntityId, Rigidbody>();
-    for (auto [entity, eid, body] : view.each()) {
+    queryHitboxes(aabb);
+    for (auto entity : foundEntities) {
+        const auto& [eid, body] = registry->get<EntityId, Rigidbody>(entity);
         if (eid.def.blocking && aabb.intersects(body.hitbox.getAABB(), -0.05f)) {
             return true;
         }
@@ -491,16 +522,12 @@ bool Entities::hasBlockingInside(AABB aabb) {
 
 std::vector<Entity> Entities::getAllInside(AABB aabb) {
     std::vector<Entity> collected;
-    auto view = registry->view<EntityId, Transform>();
-    for (auto [entity, eid, transform] : view.each()) {
+    grid.query(aabb, foundEntities);
+    for (auto entity : foundEntities) {
+        const auto& [eid, transform] =
+            registry->get<EntityId, Transform>(entity);
         if (!eid.destroyFlag && aabb.contains(transform.pos)) {
-            const auto& found = uids.find(entity);
-            if (found == uids.end()) {
-                continue;
-            }
-            if (auto wrapper = get(found->second)) {
-                collected.push_back(*wrapper);
-            }
+            collected.emplace_back(*this, eid.uid, *registry, entity);
         }
     }
     return collected;
@@ -508,16 +535,12 @@ std::vector<Entity> Entities::getAllInside(AABB aabb) {
 
 std::vector<Entity> Entities::getAllInRadius(glm::vec3 center, float radius) {
     std::vector<Entity> collected;
-    auto view = registry->view<Transform>();
-    for (auto [entity, transform] : view.each()) {
+    grid.query(AABB(center - radius, center + radius), foundEntities);
+    for (auto entity : foundEntities) {
+        const auto& [eid, transform] =
+            registry->get<EntityId, Transform>(entity);
         if (glm::distance2(transform.pos, center) <= radius * radius) {
-            const auto& found = uids.find(entity);
-            if (found == uids.end()) {
-                continue;
-            }
-            if (auto wrapper = get(found->second)) {
-                collected.push_back(*wrapper);
-            }
+            collected.emplace_back(*this, eid.uid, *registry, entity);
         }
     }
     return collected;
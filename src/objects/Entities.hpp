@@ -6,6 +6,7 @@
 #include <vector>
 
 #include "physics/Hitbox.hpp"
+#include "EntitiesGrid.hpp"
 #include "Transform.hpp"
 #include "Rigidbody.hpp"
 #include "ScriptComponents.hpp"
@@ -40,6 +41,15 @@ class Entities final {
     util::Clock sensorsTickClock;
     util::Clock updateTickClock;
     Assets* assets = nullptr;
+    EntitiesGrid grid;
+    /// @brief Max hitbox half size among entities. Used to find hitboxes
+    /// intersecting an area in the grid
+    float maxHitboxExtent = 0.0f;
+    /// @brief Grid query result buffer
+    std::vector<entt::entity> foundEntities;
+
+    /// @brief Find entities which hitboxes may intersect the area
+    void queryHitboxes(const AABB& area);
 
     void updateSensors(
         Rigidbody& body, const Transform& tsf, std::vector<Sensor*>& sensors
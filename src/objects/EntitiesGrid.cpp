@@ -0,0 +1,82 @@
+#include "EntitiesGrid.hpp"
+
+#include <algorithm>
+#include <glm/glm.hpp>
+#include <entt/entity/entity.hpp>
+
+inline constexpr int CELL_KEY_BITS = 21;
+inline constexpr uint64_t CELL_KEY_MASK = (1ULL << CELL_KEY_BITS) - 1;
+
+/// @brief Cell coordinates are wrapped, so far cells may share key.
+/// It only produces extra candidates
+static inline uint64_t cell_key(int x, int y, int z) {
+    return (static_cast<uint64_t>(x) & CELL_KEY_MASK) << CELL_KEY_BITS * 2 |
+           (static_cast<uint64_t>(y) & CELL_KEY_MASK) << CELL_KEY_BITS |
+           (static_cast<uint64_t>(z) & CELL_KEY_MASK);
+}
+
+uint64_t EntitiesGrid::cellKey(const glm::vec3& pos) {
+    glm::ivec3 cell = glm::floor(pos / static_cast<float>(CELL_SIZE));
+    return cell_key(cell.x, cell.y, cell.z);
+}
+
+void EntitiesGrid::add(entt::entity entity, uint64_t cell) {
+    cells[cell].push_back(entity);
+    count++;
+}
+
+void EntitiesGrid::remove(entt::entity entity, uint64_t cell) {
+    auto found = cells.find(cell);
+    if (found == cells.end()) {
+        return;
+    }
+    auto& entities = found->second;
+    auto it = std::find(entities.begin(), entities.end(), entity);
+    if (it == entities.end()) {
+        return;
+    }
+    *it = entities.back();
+    entities.pop_back();
+    if (entities.empty()) {
+        cells.erase(found);
+    }
+    count--;
+}
+
+void EntitiesGrid::move(entt::entity entity, uint64_t from, uint64_t to) {
+    remove(entity, from);
+    add(entity, to);
+}
+
+void EntitiesGrid::query(
+    const AABB& area, std::vector<entt::entity>& entities
+) const {
+    entities.clear();
+    auto from = glm::floor(area.min() / static_cast<float>(CELL_SIZE));
+    auto to = glm::floor(area.max() / static_cast<float>(CELL_SIZE));
+    auto size = to - from + 1.0f;
+    // area is larger than occupied part of the grid
+    if (!(size.x * size.y * size.z <= cells.size())) {
+        for (const auto& [_, cellEntities] : cells) {
+            entities.insert(
+                entities.end(), cellEntities.begin(), cellEntities.end()
+            );
+        }
+        return;
+    }
+    glm::ivec3 begin(from);
+    glm::ivec3 end(to);
+    for (int y = begin.y; y <= end.y; y++) {
+        for (int z = begin.z; z <= end.z; z++) {
+            for (int x = begin.x; x <= end.x; x++) {
+                auto found = cells.find(cell_key(x, y, z));
+                if (found == cells.end()) {
+                    continue;
+                }
+                entities.insert(
+                    entities.end(), found->second.begin(), found->second.end()
+                );
+            }
+        }
+    }
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+#include <glm/vec3.hpp>
+#include <entt/entity/fwd.hpp>
+
+#include "maths/aabb.hpp"
+#include "typedefs.hpp"
+
+/// @brief Entities index by position. Every entity is stored in the grid cell
+/// containing its transform position, so area queries only visit entities
+/// of the cells overlapping the area
+class EntitiesGrid {
+    std::unordered_map<uint64_t, std::vector<entt::entity>> cells;
+    size_t count = 0;
+public:
+    /// @brief Grid cell size in blocks
+    static inline constexpr int CELL_SIZE = 16;
+
+    /// @return key of the cell containing the position
+    static uint64_t cellKey(const glm::vec3& pos);
+
+    void add(entt::entity entity, uint64_t cell);
+
+    void remove(entt::entity entity, uint64_t cell);
+
+    void move(entt::entity entity, uint64_t from, uint64_t to);
+
+    /// @brief Find entities which may be inside the area
+    /// @param entities output vector for entities of the cells overlapping
+    /// the area (cleared before)
+    void query(const AABB& area, std::vector<entt::entity>& entities) const;
+
+    /// @return number of indexed entities
+    size_t size() const {
+        return count;
+    }
+};
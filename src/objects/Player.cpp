@@ -141,7 +141,7 @@ void Player::attemptToChooseSpawnpoint() {
         newpos.y--;
     }
 
-    voxel* headvox = chunks->get(newpos.x, newpos.y + 1, newpos.z);
+    const voxel* headvox = chunks->get(newpos.x, newpos.y + 1, newpos.z);
     if (chunks->isObstacleBlock(newpos.x, newpos.y, newpos.z) ||
         headvox == nullptr || headvox->id != 0) {
         return;
@@ -3,6 +3,7 @@
 #include "data/dv_util.hpp"
 #include "debug/Logger.hpp"
 #include "maths/util.hpp"
+#include "EntitiesGrid.hpp"
 
 #include <glm/gtc/matrix_transform.hpp>
 
@@ -18,6 +19,14 @@ void Transform::refresh() {
     dirty = false;
 }
 
+void Transform::updateGridCell() {
+    auto cell = EntitiesGrid::cellKey(pos);
+    if (cell != gridCell) {
+        grid->move(handle, gridCell, cell);
+        gridCell = cell;
+    }
+}
+
 dv::value Transform::serialize() const {
     auto tsfmap = dv::object();
     tsfmap["pos"] = dv::to_value(pos);
@@ -2,11 +2,15 @@
 
 #define GLM_ENABLE_EXPERIMENTAL
 
+#include <cstdint>
 #include <stdexcept>
 #include <glm/vec3.hpp>
 #include <glm/mat4x4.hpp>
 #include <glm/gtx/norm.hpp>
 #include <data/dv_fwd.hpp>
+#include <entt/entity/fwd.hpp>
+
+class EntitiesGrid;
 
 struct Transform {
     static inline constexpr float EPSILON = 1e-7f;
@@ -19,11 +23,20 @@ struct Transform {
     glm::vec3 displayPos;
     glm::vec3 displaySize;
 
+    /// @brief Entities grid the entity is indexed in or nullptr
+    EntitiesGrid* grid = nullptr;
+    entt::entity handle {};
+    /// @brief Key of the grid cell the entity is stored in
+    uint64_t gridCell = 0;
+
     dv::value serialize() const;
     void deserialize(const dv::value& root);
 
     void refresh();
 
+    /// @brief Move entity to the grid cell containing current position
+    void updateGridCell();
+
     inline void setRot(const glm::mat3& m) {
         if (!checkValue(m, "rotation")) {
             return;
@@ -50,6 +63,9 @@ struct Transform {
             dirty = true;
         }
         pos = v;
+        if (grid) {
+            updateGridCell();
+        }
     }
 
     static bool checkValue(const glm::vec3& v, std::string_view name);
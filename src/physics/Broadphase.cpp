@@ -0,0 +1,87 @@
+#include "Broadphase.hpp"
+
+#include <algorithm>
+
+/// @brief Max number of cells covered by a single box
+inline constexpr int MAX_BOX_CELLS = 64;
+/// @brief Max number of cells checked by a single query
+inline constexpr int MAX_QUERY_CELLS = 512;
+
+inline constexpr int CELL_KEY_BITS = 21;
+inline constexpr uint64_t CELL_KEY_MASK = (1ULL << CELL_KEY_BITS) - 1;
+
+/// @brief Cell coordinates are wrapped, so far cells may share key.
+/// It only produces extra candidates
+static inline uint64_t cell_key(int x, int y, int z) {
+    return (static_cast<uint64_t>(x) & CELL_KEY_MASK) << CELL_KEY_BITS * 2 |
+           (static_cast<uint64_t>(y) & CELL_KEY_MASK) << CELL_KEY_BITS |
+           (static_cast<uint64_t>(z) & CELL_KEY_MASK);
+}
+
+Broadphase::Broadphase(float cellSize) : cellSize(cellSize) {
+}
+
+void Broadphase::clear() {
+    count = 0;
+    entries.clear();
+    wide.clear();
+}
+
+void Broadphase::add(const AABB& aabb) {
+    uint index = count++;
+    auto from = glm::floor(aabb.min() / cellSize);
+    auto to = glm::floor(aabb.max() / cellSize);
+    auto cells = to - from + 1.0f;
+    if (!(cells.x * cells.y * cells.z <= MAX_BOX_CELLS)) {
+        // too big or nan
+        wide.push_back(index);
+        return;
+    }
+    glm::ivec3 begin(from);
+    glm::ivec3 end(to);
+    for (int y = begin.y; y <= end.y; y++) {
+        for (int z = begin.z; z <= end.z; z++) {
+            for (int x = begin.x; x <= end.x; x++) {
+                entries.push_back(Entry {cell_key(x, y, z), index});
+            }
+        }
+    }
+}
+
+void Broadphase::build() {
+    std::sort(entries.begin(), entries.end());
+}
+
+void Broadphase::query(const AABB& area, std::vector<uint>& indices) const {
+    indices.clear();
+    if (count == 0) {
+        return;
+    }
+    auto from = glm::floor(area.min() / cellSize);
+    auto to = glm::floor(area.max() / cellSize);
+    auto cells = to - from + 1.0f;
+    if (!(cells.x * cells.y * cells.z <= MAX_QUERY_CELLS)) {
+        for (uint i = 0; i < count; i++) {
+            indices.push_back(i);
+        }
+        return;
+    }
+    glm::ivec3 begin(from);
+    glm::ivec3 end(to);
+    for (int y = begin.y; y <= end.y; y++) {
+        for (int z = begin.z; z <= end.z; z++) {
+            for (int x = begin.x; x <= end.x; x++) {
+                uint64_t key = cell_key(x, y, z);
+                auto it = std::lower_bound(
+                    entries.begin(), entries.end(), Entry {key, 0}
+                );
+                for (; it != entries.end() && it->cell == key; ++it) {
+                    indices.push_back(it->index);
+                }
+            }
+        }
+    }
+    indices.insert(indices.end(), wide.begin(), wide.end());
+    std::sort(indices.begin(), indices.end());
+    indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+}
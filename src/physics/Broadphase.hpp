@@ -0,0 +1,52 @@
+#pragma once
+
+#include <vector>
+
+#include "maths/aabb.hpp"
+#include "typedefs.hpp"
+
+/// @brief Uniform grid of bounding boxes used to find boxes possibly
+/// intersecting an area without testing every box.
+///
+/// Boxes are identified by the order they were added in. Query results
+/// are sorted by index, so iterating them visits boxes in the same order
+/// as iterating all boxes does.
+class Broadphase {
+    struct Entry {
+        uint64_t cell;
+        uint index;
+
+        bool operator<(const Entry& other) const {
+            return cell < other.cell ||
+                   (cell == other.cell && index < other.index);
+        }
+    };
+    float cellSize;
+    uint count = 0;
+    /// @brief Entries sorted by cell key after build()
+    std::vector<Entry> entries;
+    /// @brief Boxes covering too many cells. Returned by every query
+    std::vector<uint> wide;
+public:
+    /// @param cellSize grid cell size in blocks
+    Broadphase(float cellSize);
+
+    /// @brief Remove all boxes
+    void clear();
+
+    /// @brief Add box to the grid. Its index is number of boxes added before
+    void add(const AABB& aabb);
+
+    /// @brief Prepare grid for queries. Must be called after adding boxes
+    void build();
+
+    /// @brief Find boxes which may intersect the area
+    /// @param indices output vector for sorted unique boxes indices
+    /// (cleared before)
+    void query(const AABB& area, std::vector<uint>& indices) const;
+
+    /// @return number of added boxes
+    uint size() const {
+        return count;
+    }
+};
@@ -15,10 +15,261 @@
 inline constexpr float E = 0.03f;
 inline constexpr float MAX_FIX = 0.1f;
 
+inline constexpr float GRID_CELL_SIZE = 2.0f;
+/// @brief Island solid hitboxes are added to the island grid with the
+/// margin, so the grid is only rebuilt when some hitbox moved further than
+/// a half of it
+inline constexpr float GRID_MARGIN = 1.0f;
+/// @brief Extra distance covered by near hitboxes search. Includes
+/// position fixes made by collisions during a substep
+inline constexpr float QUERY_MARGIN = 1.0f;
+/// @brief Islands with less solid hitboxes do not use grid
+inline constexpr size_t MIN_GRID_HITBOXES = 8;
+/// @brief Steps with less hitboxes are not simulated in parallel
+inline constexpr size_t MIN_PARALLEL_HITBOXES = 64;
+
 static debug::Logger logger("physics-solver");
 
-PhysicsSolver::PhysicsSolver(const GlobalChunks& chunks, glm::vec3 gravity)
-    : chunks(chunks), gravity(std::move(gravity)) {
+/// @brief Hitboxes simulated together. Hitboxes of different islands do not
+/// interact during a step, so islands may be simulated in any order or in
+/// parallel with the same result
+struct PhysicsIsland {
+    /// @brief Island hitboxes in PhysicsSolver hitboxes order
+    std::vector<Hitbox*> hitboxes;
+    /// @brief Island solid hitboxes in PhysicsSolver solidHitboxes order
+    std::vector<Hitbox*> solidHitboxes;
+    Broadphase grid {GRID_CELL_SIZE};
+    /// @brief Solid hitboxes positions at the grid build
+    std::vector<glm::vec3> gridPositions;
+    /// @brief Broadphase query result buffer
+    std::vector<uint> foundIndices;
+    /// @brief Solid hitboxes near the current hitbox in solidHitboxes order
+    std::vector<Hitbox*> nearHitboxes;
+
+    void clear() {
+        hitboxes.clear();
+        solidHitboxes.clear();
+    }
+
+    void buildGrid() {
+        grid.clear();
+        gridPositions.resize(solidHitboxes.size());
+        for (size_t i = 0; i < solidHitboxes.size(); i++) {
+            const auto& hitbox = *solidHitboxes[i];
+            // getAABB() does not take scale into account
+            auto half = glm::max(hitbox.halfsize, hitbox.getHalfSize());
+            grid.add(AABB(
+                hitbox.position - half - GRID_MARGIN,
+                hitbox.position + half + GRID_MARGIN
+            ));
+            gridPositions[i] = hitbox.position;
+        }
+        grid.build();
+    }
+
+    bool isGridOutdated() const {
+        if (gridPositions.size() != solidHitboxes.size()) {
+            return true;
+        }
+        constexpr float threshold = GRID_MARGIN * 0.5f;
+        for (size_t i = 0; i < solidHitboxes.size(); i++) {
+            auto offset =
+                glm::abs(solidHitboxes[i]->position - gridPositions[i]);
+            if (!(glm::max(offset.x, glm::max(offset.y, offset.z)) <
+                  threshold)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /// @return solid hitboxes possibly reached by the hitbox during a substep
+    const std::vector<Hitbox*>& findNearHitboxes(
+        const Hitbox& hitbox, float dt
+    ) {
+        if (solidHitboxes.size() < MIN_GRID_HITBOXES) {
+            return solidHitboxes;
+        }
+        auto half = glm::max(hitbox.halfsize, hitbox.getHalfSize());
+        // crouching check uses 1.5 times taller box
+        glm::vec3 extent = half * glm::vec3(1.0f, 1.5f, 1.0f) +
+                           glm::abs(hitbox.velocity) * dt +
+                           (hitbox.stepHeight + QUERY_MARGIN);
+        grid.query(
+            AABB(hitbox.position - extent, hitbox.position + extent),
+            foundIndices
+        );
+        nearHitboxes.clear();
+        for (uint index : foundIndices) {
+            nearHitboxes.push_back(solidHitboxes[index]);
+        }
+        return nearHitboxes;
+    }
+};
+
+class PhysicsWorker : public util::Worker<size_t, size_t> {
+    PhysicsSolver& solver;
+    const std::vector<std::unique_ptr<PhysicsIsland>>& islands;
+    const float& delta;
+    const uint& substeps;
+public:
+    PhysicsWorker(
+        PhysicsSolver& solver,
+        const std::vector<std::unique_ptr<PhysicsIsland>>& islands,
+        const float& delta,
+        const uint& substeps
+    )
+        : solver(solver), islands(islands), delta(delta), substeps(substeps) {
+    }
+
+    size_t operator()(const size_t& index) override {
+        solver.simulateIsland(*islands[index], delta, substeps);
+        return index;
+    }
+};
+
+PhysicsSolver::PhysicsSolver(
+    const GlobalChunks& chunks, glm::vec3 gravity, int workers
+)
+    : chunks(chunks),
+      gravity(std::move(gravity)),
+      solidHitboxesGrid(GRID_CELL_SIZE),
+      sensorsGrid(GRID_CELL_SIZE) {
+    if (workers == 0) {
+        return;
+    }
+    threadPool = std::make_unique<util::ThreadPool<size_t, size_t>>(
+        "physics",
+        [this]() {
+            return std::make_unique<PhysicsWorker>(
+                *this, islands, stepDelta, stepSubsteps
+            );
+        },
+        [this](size_t&&) { islandsDone++; },
+        workers
+    );
+}
+
+PhysicsSolver::~PhysicsSolver() = default;
+
+static AABB calc_sensor_bounds(const Sensor& sensor) {
+    switch (sensor.type) {
+        case SensorType::AABB: {
+            const auto& aabb = sensor.calculated.aabb;
+            return AABB(aabb.min(), aabb.max());
+        }
+        case SensorType::RADIUS: {
+            const auto& radial = sensor.calculated.radial;
+            glm::vec3 center(radial);
+            float radius = glm::sqrt(radial.w);
+            return AABB(center - radius, center + radius);
+        }
+    }
+    return AABB();
+}
+
+void PhysicsSolver::prepareBroadphase() {
+    solidHitboxesGrid.clear();
+    for (const auto hitbox : solidHitboxes) {
+        auto half = glm::max(hitbox->halfsize, hitbox->getHalfSize());
+        solidHitboxesGrid.add(
+            AABB(hitbox->position - half, hitbox->position + half)
+        );
+    }
+    solidHitboxesGrid.build();
+
+    sensorsGrid.clear();
+    for (const auto sensor : sensors) {
+        sensorsGrid.add(calc_sensor_bounds(*sensor));
+    }
+    sensorsGrid.build();
+}
+
+static uint find_root(std::vector<uint>& parents, uint index) {
+    while (parents[index] != index) {
+        parents[index] = parents[parents[index]];
+        index = parents[index];
+    }
+    return index;
+}
+
+void PhysicsSolver::buildIslands(float delta) {
+    // solidHitboxes is a subsequence of hitboxes
+    std::vector<uint> solidIndices(solidHitboxes.size());
+    for (size_t i = 0, j = 0; i < hitboxes.size() && j < solidIndices.size();
+         i++) {
+        if (hitboxes[i] == solidHitboxes[j]) {
+            solidIndices[j++] = i;
+        }
+    }
+
+    std::vector<uint> parents(hitboxes.size());
+    for (uint i = 0; i < parents.size(); i++) {
+        parents[i] = i;
+    }
+    for (uint i = 0; i < hitboxes.size(); i++) {
+        const auto& hitbox = *hitboxes[i];
+        // distance the hitbox may pass during the step
+        auto half = glm::max(hitbox.halfsize, hitbox.getHalfSize());
+        auto velocity = glm::abs(hitbox.velocity) +
+                        glm::abs(gravity) * hitbox.gravityScale * delta;
+        glm::vec3 extent = half * glm::vec3(1.0f, 1.5f, 1.0f) +
+                           velocity * delta +
+                           (hitbox.stepHeight + QUERY_MARGIN);
+        solidHitboxesGrid.query(
+            AABB(hitbox.position - extent, hitbox.position + extent),
+            foundIndices
+        );
+        for (uint index : foundIndices) {
+            uint a = find_root(parents, i);
+            uint b = find_root(parents, solidIndices[index]);
+            // keep the lowest index as root for stable islands order
+            if (a < b) {
+                parents[b] = a;
+            } else {
+                parents[a] = b;
+            }
+        }
+    }
+
+    constexpr uint NO_ISLAND = -1;
+    std::vector<uint> rootIslands(hitboxes.size(), NO_ISLAND);
+    islandsCount = 0;
+    for (uint i = 0; i < hitboxes.size(); i++) {
+        uint root = find_root(parents, i);
+        if (rootIslands[root] == NO_ISLAND) {
+            if (islandsCount == islands.size()) {
+                islands.push_back(std::make_unique<PhysicsIsland>());
+            }
+            islands[islandsCount]->clear();
+            rootIslands[root] = islandsCount++;
+        }
+        islands[rootIslands[root]]->hitboxes.push_back(hitboxes[i]);
+    }
+    for (size_t j = 0; j < solidIndices.size(); j++) {
+        uint root = find_root(parents, solidIndices[j]);
+        islands[rootIslands[root]]->solidHitboxes.push_back(solidHitboxes[j]);
+    }
+}
+
+void PhysicsSolver::simulateIsland(
+    PhysicsIsland& island, float delta, uint substeps
+) {
+    bool useGrid = island.solidHitboxes.size() >= MIN_GRID_HITBOXES;
+    if (useGrid) {
+        island.buildGrid();
+    }
+    float dt = delta / static_cast<float>(substeps);
+    for (uint i = 0; i < substeps; i++) {
+        if (useGrid && island.isGridOutdated()) {
+            island.buildGrid();
+        }
+        for (auto hitbox : island.hitboxes) {
+            glm::vec3& pos = hitbox->position;
+            hitbox->prevPosition = hitbox->position;
+            calcSubstep(island, *hitbox, hitbox->velocity, pos, dt);
+        }
+    }
 }
 
 static glm::vec3 calc_collsion_velocity_result(
@@ -67,7 +318,7 @@ template <int nx, int ny, int nz, int sign>
 static void calc_collision(
     Hitbox& hitbox,
     const GlobalChunks& chunks,
-    const std::vector<Hitbox*>& solidHitboxes,
+    const std::vector<Hitbox*>& nearHitboxes,
     const glm::vec3& half,
     float stepHeight
 ) {
@@ -75,7 +326,7 @@ static void calc_collision(
     auto& vel = hitbox.velocity;
 
     glm::vec3 offset(0.0f, stepHeight + E, 0.0f);
-    for (auto box : solidHitboxes) {
+    for (auto box : nearHitboxes) {
         if (glm::distance2(box->position, pos) < E) {
             continue;
         }
@@ -141,12 +392,15 @@ static void calc_collision(
 }
 
 bool PhysicsSolver::calcCollisionNegY(
-    Hitbox& hitbox, const glm::vec3& half, float dt
+    Hitbox& hitbox,
+    const std::vector<Hitbox*>& nearHitboxes,
+    const glm::vec3& half,
+    float dt
 ) {
     auto& pos = hitbox.position;
     auto& vel = hitbox.velocity;
 
-    for (auto box : solidHitboxes) {
+    for (auto box : nearHitboxes) {
         if (glm::distance2(box->position, pos) < E) {
             continue;
         }
@@ -211,6 +465,7 @@ bool PhysicsSolver::calcCollisionNegY(
 
 void PhysicsSolver::calcCollisions(
     Hitbox& hitbox,
+    const std::vector<Hitbox*>& nearHitboxes,
     glm::vec3& vel,
     glm::vec3& pos,
     const glm::vec3& half,
@@ -221,17 +476,17 @@ void PhysicsSolver::calcCollisions(
 
     auto prevPos = pos;
 
-    calc_collision<0, 1, 2, -1>(hitbox, chunks, solidHitboxes, half, stepHeight);
-    calc_collision<0, 1, 2, 1>(hitbox, chunks, solidHitboxes, half, stepHeight);
+    calc_collision<0, 1, 2, -1>(hitbox, chunks, nearHitboxes, half, stepHeight);
+    calc_collision<0, 1, 2, 1>(hitbox, chunks, nearHitboxes, half, stepHeight);
 
     float xpos = pos.x;
     pos.x = prevPos.x;
 
-    calc_collision<2, 1, 0, -1>(hitbox, chunks, solidHitboxes, half, stepHeight);
-    calc_collision<2, 1, 0, 1>(hitbox, chunks, solidHitboxes, half, stepHeight);
+    calc_collision<2, 1, 0, -1>(hitbox, chunks, nearHitboxes, half, stepHeight);
+    calc_collision<2, 1, 0, 1>(hitbox, chunks, nearHitboxes, half, stepHeight);
     pos.x = xpos;
 
-    if (calcCollisionNegY(hitbox, half, dt)) {
+    if (calcCollisionNegY(hitbox, nearHitboxes, half, dt)) {
         hitbox.grounded = true;
     }
 
@@ -255,7 +510,7 @@ void PhysicsSolver::calcCollisions(
                 }
             }
         }
-        for (auto box : solidHitboxes) {
+        for (auto box : nearHitboxes) {
             if (glm::distance2(box->position, pos) < E) {
                 continue;
             }
@@ -297,7 +552,7 @@ void PhysicsSolver::calcCollisions(
                 }
             }
         }
-        for (auto box : solidHitboxes) {
+        for (auto box : nearHitboxes) {
             if (glm::distance2(box->position, pos) < E) {
                 continue;
             }
@@ -314,15 +569,21 @@ void PhysicsSolver::calcCollisions(
 }
 
 void PhysicsSolver::calcSubstep(
-    Hitbox& hitbox, glm::vec3& vel, glm::vec3& pos, float dt
+    PhysicsIsland& island,
+    Hitbox& hitbox,
+    glm::vec3& vel,
+    glm::vec3& pos,
+    float dt
 ) {
     auto initpos = pos;
     auto half = hitbox.getHalfSize();
     float gravityScale = hitbox.gravityScale;
-        
+
+    const auto& nearHitboxes = island.findNearHitboxes(hitbox, dt);
     if (hitbox.type == BodyType::DYNAMIC) {
         calcCollisions(
             hitbox,
+            nearHitboxes,
             vel,
             pos,
             half,
@@ -359,7 +620,7 @@ void PhysicsSolver::calcSubstep(
                 }
             }
         }
-        for (auto box : solidHitboxes) {
+        for (auto box : nearHitboxes) {
             if (glm::distance2(box->position, pos) < E) {
                 continue;
             }
@@ -386,12 +647,23 @@ void PhysicsSolver::step(
         hitbox->prevVelocity = hitbox->velocity;
     }
     
-    float dt = delta / static_cast<float>(substeps);
-    for (uint i = 0; i < substeps; i++) {
-        for (auto hitbox : hitboxes) {
-            glm::vec3& pos = hitbox->position;
-            hitbox->prevPosition = hitbox->position;
-            calcSubstep(*hitbox, hitbox->velocity, pos, dt);
+    buildIslands(delta);
+    if (threadPool == nullptr || islandsCount < 2 ||
+        hitboxes.size() < MIN_PARALLEL_HITBOXES) {
+        for (size_t i = 0; i < islandsCount; i++) {
+            simulateIsland(*islands[i], delta, substeps);
+        }
+    } else {
+        stepDelta = delta;
+        stepSubsteps = substeps;
+        islandsDone = 0;
+        for (size_t i = 0; i < islandsCount; i++) {
+            threadPool->enqueueJob(size_t(i));
+        }
+        while (islandsDone < islandsCount) {
+            if (threadPool->pullResults() == 0) {
+                std::this_thread::yield();
+            }
         }
     }
 
@@ -417,7 +689,8 @@ void PhysicsSolver::step(
 void PhysicsSolver::updateSensors(Hitbox& hitbox) {
     auto aabb = hitbox.getAABB();
 
-    for (size_t i = 0; i < sensors.size(); i++) {
+    sensorsGrid.query(aabb, foundIndices);
+    for (uint i : foundIndices) {
         auto& sensor = *sensors[i];
         if (sensor.entity == hitbox.entity) {
             continue;
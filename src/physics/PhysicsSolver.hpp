@@ -1,10 +1,13 @@
 #pragma once
 
+#include "Broadphase.hpp"
 #include "Hitbox.hpp"
 
 #include "typedefs.hpp"
+#include "util/ThreadPool.hpp"
 #include "voxels/voxel.hpp"
 
+#include <memory>
 #include <vector>
 #include <glm/glm.hpp>
 
@@ -12,10 +15,15 @@ class Block;
 class Entities;
 class GlobalChunks;
 struct Sensor;
+struct PhysicsIsland;
 
 class PhysicsSolver {
+    friend class PhysicsWorker;
 public:
-    PhysicsSolver(const GlobalChunks& chunks, glm::vec3 gravity);
+    /// @param workers max number of islands simulation workers.
+    /// 0 - simulate in the calling thread
+    PhysicsSolver(const GlobalChunks& chunks, glm::vec3 gravity, int workers);
+    ~PhysicsSolver();
 
     void step(const GlobalChunks& chunks, float delta, uint substeps);
 
@@ -32,6 +40,10 @@ public:
     }
 
     void removeSensor(Sensor* sensor);
+
+    /// @brief Rebuild broadphase grids of solid hitboxes and sensors.
+    /// Must be called before step if hitboxes or sensors lists changed
+    void prepareBroadphase();
 private:
     const GlobalChunks& chunks;
     glm::vec3 gravity;
@@ -39,8 +51,28 @@ private:
     std::vector<Hitbox*> solidHitboxes;
     std::vector<Hitbox*> hitboxes;
 
+    Broadphase solidHitboxesGrid;
+    Broadphase sensorsGrid;
+    /// @brief Broadphase query result buffer
+    std::vector<uint> foundIndices;
+
+    /// @brief Islands of the current step. Only first islandsCount are used
+    std::vector<std::unique_ptr<PhysicsIsland>> islands;
+    size_t islandsCount = 0;
+    std::unique_ptr<util::ThreadPool<size_t, size_t>> threadPool;
+    size_t islandsDone = 0;
+    float stepDelta = 0.0f;
+    uint stepSubsteps = 0;
+
+    /// @brief Split hitboxes to islands which can not interact during
+    /// the step
+    void buildIslands(float delta);
+
+    void simulateIsland(PhysicsIsland& island, float delta, uint substeps);
+
     void calcCollisions(
         Hitbox& hitbox,
+        const std::vector<Hitbox*>& nearHitboxes,
         glm::vec3& vel,
         glm::vec3& pos,
         const glm::vec3& half,
@@ -48,9 +80,20 @@ private:
         float dt
     );
 
-    void calcSubstep(Hitbox& hitbox, glm::vec3& vel, glm::vec3& pos, float dt);
+    void calcSubstep(
+        PhysicsIsland& island,
+        Hitbox& hitbox,
+        glm::vec3& vel,
+        glm::vec3& pos,
+        float dt
+    );
 
-    bool calcCollisionNegY(Hitbox& hitbox, const glm::vec3& half, float dt);
+    bool calcCollisionNegY(
+        Hitbox& hitbox,
+        const std::vector<Hitbox*>& nearHitboxes,
+        const glm::vec3& half,
+        float dt
+    );
 
     void updateSensors(Hitbox& hitbox);
 };
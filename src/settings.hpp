@@ -46,6 +46,25 @@ struct ChunksSettings {
     IntegerSetting loadDistance {22, 3, 80};
     /// @brief Buffer zone where chunks are not unloading (chunk is unit)
     IntegerSetting padding {2, 1, 8};
+    /// @brief Max number of chunks generation workers.
+    /// 0 - generate chunks in the main thread
+    IntegerSetting generatorWorkers {0, -4, 32};
+    /// @brief Max number of saved chunks reading workers.
+    /// 0 - read chunks in the main thread
+    IntegerSetting loaderWorkers {2, -4, 32};
+    /// @brief Max number of chunks lights building workers.
+    /// 0 - build lights in the main thread
+    IntegerSetting lightingWorkers {2, -4, 32};
+    /// @brief Build and save chunks lights in headless mode, so clients
+    /// get chunks with lights cache
+    FlagSetting serverLighting {false};
+    /// @brief Store unmodified chunk sections palette-compressed
+    /// in headless mode to reduce memory usage
+    FlagSetting compactVoxels {false};
+    /// @brief In-memory regions size limit in MiB. Only saved regions are
+    /// evicted, so the limit may be exceeded until the next world save.
+    /// 0 - not limited
+    IntegerSetting regionsCacheSize {256, 0, 65536};
 };
 
 struct CameraSettings {
@@ -93,6 +112,11 @@ struct GraphicsSettings {
     IntegerSetting denseRenderDistance {56, 0, 10'000};
     /// @brief Soft lighting for blocks
     FlagSetting softLighting {true};
+    /// @brief Merge coplanar full cube faces into larger quads
+    FlagSetting greedyMeshing {false};
+    /// @brief Use quantized chunk vertices (applied on world open).
+    /// Block emission is quantized to 16 levels
+    FlagSetting compactVertices {false};
     /// @brief Clouds quality level
     IntegerSetting cloudsQuality {2, 0, 2};
 };
@@ -100,6 +124,16 @@ struct GraphicsSettings {
 struct PathfindingSettings {
     /// @brief Max visited blocks by an agent per async tick
     IntegerSetting stepsPerAsyncAgent {128, 1, 2048};
+    /// @brief Max number of async routes search workers.
+    /// 0 - search in the main thread
+    IntegerSetting workers {2, -4, 32};
+};
+
+struct PhysicsSettings {
+    /// @brief Max number of entities physics islands simulation workers.
+    /// 0 - simulate in the main thread (default until islands are built
+    /// from actual contacts instead of conservative extents)
+    IntegerSetting workers {0, -4, 32};
 };
 
 struct DebugSettings {
@@ -138,5 +172,6 @@ struct EngineSettings {
     UiSettings ui;
     NetworkSettings network;
     PathfindingSettings pathfinding;
+    PhysicsSettings physics;
     SystemSettings system;
 };
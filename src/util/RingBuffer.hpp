@@ -0,0 +1,117 @@
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+
+namespace util {
+    /// @brief Growable FIFO buffer of trivially copyable elements stored
+    /// in a ring, so reading from the front does not move the rest
+    /// @tparam T elements type
+    template <typename T>
+    class RingBuffer {
+        std::unique_ptr<T[]> buffer;
+        /// @brief Buffer capacity (0 or power of 2)
+        size_t capacity = 0;
+        size_t head = 0;
+        size_t length = 0;
+
+        void grow(size_t minCapacity) {
+            size_t newCapacity = std::max<size_t>(capacity, 16);
+            while (newCapacity < minCapacity) {
+                newCapacity *= 2;
+            }
+            auto newBuffer = std::make_unique<T[]>(newCapacity);
+            if (length) {
+                read(newBuffer.get(), length, false);
+            }
+            buffer = std::move(newBuffer);
+            capacity = newCapacity;
+            head = 0;
+        }
+
+        size_t read(T* dst, size_t count, bool consume) {
+            count = std::min(count, length);
+            size_t first = std::min(count, capacity - head);
+            std::memcpy(dst, buffer.get() + head, first * sizeof(T));
+            std::memcpy(dst + first, buffer.get(), (count - first) * sizeof(T));
+            if (consume) {
+                pop(count);
+            }
+            return count;
+        }
+    public:
+        RingBuffer() = default;
+
+        /// @param capacity initial capacity (rounded up to power of 2)
+        RingBuffer(size_t capacity) {
+            if (capacity) {
+                grow(capacity);
+            }
+        }
+
+        /// @brief Append elements to the back
+        void write(const T* src, size_t count) {
+            if (length + count > capacity) {
+                grow(length + count);
+            }
+            size_t tail = (head + length) & (capacity - 1);
+            size_t first = std::min(count, capacity - tail);
+            std::memcpy(buffer.get() + tail, src, first * sizeof(T));
+            std::memcpy(buffer.get(), src + first, (count - first) * sizeof(T));
+            length += count;
+        }
+
+        /// @brief Move elements from the front to the destination
+        /// @return number of elements read
+        size_t read(T* dst, size_t count) {
+            return read(dst, count, true);
+        }
+
+        /// @return number of elements available with frontData()
+        size_t frontSize() const {
+            return std::min(length, capacity - head);
+        }
+
+        /// @return pointer to the first elements stored contiguously
+        const T* frontData() const {
+            return buffer.get() + head;
+        }
+
+        /// @brief Get all elements as up to two contiguous parts
+        /// @return number of parts
+        int getParts(const T* (&parts)[2], size_t (&sizes)[2]) const {
+            if (length == 0) {
+                return 0;
+            }
+            parts[0] = frontData();
+            sizes[0] = frontSize();
+            if (sizes[0] == length) {
+                return 1;
+            }
+            parts[1] = buffer.get();
+            sizes[1] = length - sizes[0];
+            return 2;
+        }
+
+        /// @brief Remove elements from the front
+        void pop(size_t count) {
+            count = std::min(count, length);
+            length -= count;
+            head = length ? (head + count) & (capacity - 1) : 0;
+        }
+
+        void clear() {
+            head = 0;
+            length = 0;
+        }
+
+        size_t size() const {
+            return length;
+        }
+
+        bool empty() const {
+            return length == 0;
+        }
+    };
+}
@@ -48,6 +48,7 @@ struct BlockFuncsSet {
     bool onreplaced : 1;
     bool oninteract : 1;
     bool randupdate : 1;
+    bool randupdatebatch : 1;
     bool onblocktick : 1;
     bool onblockstick : 1;
     bool onblockpresent : 1;
@@ -59,6 +60,20 @@ struct BlockFuncNamesCache {
     std::string randomUpdate;
 };
 
+/// @brief Pre-resolved block events handles (see lua::get_event_handle).
+/// 0 - event is not defined by the block script
+struct BlockEventHandles {
+    int update = 0;
+    int randomUpdate = 0;
+    int randomUpdateBatch = 0;
+    int placed = 0;
+    int replaced = 0;
+    int breaking = 0;
+    int broken = 0;
+    int interact = 0;
+    int blocksTick = 0;
+};
+
 struct CoordSystem {
     std::array<glm::ivec3, 3> axes;
     /// @brief Grid 3d position fix offset (for negative vectors)
@@ -323,6 +338,8 @@ public:
         std::set<int> tags;
 
         BlockFuncNamesCache eventNames;
+
+        BlockEventHandles eventHandles;
     } rt {};
 
     Block(const std::string& name);
@@ -6,24 +6,54 @@
 #include "util/data_io.hpp"
 #include "voxel.hpp"
 
+#include <atomic>
 #include <utility>
 
-Chunk::Chunk(int xpos, int zpos, std::shared_ptr<Lightmap> lightmap)
-    : x(xpos), z(zpos), lightmap(std::move(lightmap)) {
+static std::atomic<uint64_t> revisions_counter = 0;
+
+Chunk::Chunk(
+    int xpos, int zpos, std::shared_ptr<Lightmap> lightmap, bool compactVoxels
+)
+    : x(xpos),
+      z(zpos),
+      voxels(compactVoxels),
+      lightmap(std::move(lightmap)),
+      revision(nextRevision()) {
     bottom = 0;
     top = CHUNK_H;
+    std::fill(
+        std::begin(sectionRevisions), std::end(sectionRevisions), revision
+    );
+}
+
+uint64_t Chunk::nextRevision() {
+    return ++revisions_counter;
+}
+
+uint64_t Chunk::getLastRevision() {
+    return revisions_counter;
+}
+
+uint16_t Chunk::getSectionsChangedSince(uint64_t revision) const {
+    uint16_t sections = 0;
+    for (uint s = 0; s < CHUNK_SECTIONS; s++) {
+        if (sectionRevisions[s] > revision) {
+            sections |= 1U << s;
+        }
+    }
+    return sections;
 }
 
 void Chunk::updateHeights() {
     flags.dirtyHeights = false;
     for (uint i = 0; i < CHUNK_VOL; i++) {
-        if (voxels[i].id != 0) {
+        if (voxels.get(i).id != 0) {
             bottom = i / (CHUNK_D * CHUNK_W);
             break;
         }
     }
     for (int i = CHUNK_VOL - 1; i >= 0; i--) {
-        if (voxels[i].id != 0) {
+        if (voxels.get(i).id != 0) {
             top = i / (CHUNK_D * CHUNK_W) + 1;
             break;
         }
@@ -71,21 +101,48 @@ std::shared_ptr<Inventory> Chunk::getBlockInventory(uint x, uint y, uint z)
 */
 std::unique_ptr<ubyte[]> Chunk::encode() const {
     auto buffer = std::make_unique<ubyte[]>(CHUNK_DATA_LEN);
-    auto dst = reinterpret_cast<uint16_t*>(buffer.get());
-    for (uint i = 0; i < CHUNK_VOL; i++) {
-        dst[i] = dataio::h2le(voxels[i].id);
-        dst[CHUNK_VOL + i] = dataio::h2le(blockstate2int(voxels[i].state));
-    }
+    encode(ALL_SECTIONS, buffer.get());
     return buffer;
 }
 
+size_t Chunk::encode(uint16_t sections, ubyte* data) const {
+    uint volume = countSections(sections) * CHUNK_SECTION_VOL;
+    auto dst = reinterpret_cast<uint16_t*>(data);
+    voxel buffer[CHUNK_SECTION_VOL];
+    for (uint s = 0; s < CHUNK_SECTIONS; s++) {
+        if (!(sections & (1U << s))) {
+            continue;
+        }
+        const voxel* src = voxels.getSection(s, buffer);
+        for (uint i = 0; i < CHUNK_SECTION_VOL; i++) {
+            dst[i] = dataio::h2le(src[i].id);
+            dst[volume + i] = dataio::h2le(blockstate2int(src[i].state));
+        }
+        dst += CHUNK_SECTION_VOL;
+    }
+    return volume * 4;
+}
+
 bool Chunk::decode(const ubyte* data) {
+    return decode(data, ALL_SECTIONS);
+}
+
+bool Chunk::decode(const ubyte* data, uint16_t sections) {
+    uint volume = countSections(sections) * CHUNK_SECTION_VOL;
     auto src = reinterpret_cast<const uint16_t*>(data);
-    for (uint i = 0; i < CHUNK_VOL; i++) {
-        voxel& vox = voxels[i];
+    voxel buffer[CHUNK_SECTION_VOL];
+    for (uint s = 0; s < CHUNK_SECTIONS; s++) {
+        if (!(sections & (1U << s))) {
+            continue;
+        }
+        for (uint i = 0; i < CHUNK_SECTION_VOL; i++) {
+            voxel& vox = buffer[i];
 
-        vox.id = dataio::le2h(src[i]);
-        vox.state = int2blockstate(dataio::le2h(src[CHUNK_VOL + i]));
+            vox.id = dataio::le2h(src[i]);
+            vox.state = int2blockstate(dataio::le2h(src[volume + i]));
+        }
+        voxels.setSection(s, buffer);
+        src += CHUNK_SECTION_VOL;
     }
     return true;
 }
@@ -2,6 +2,8 @@
 
 #include <stdlib.h>
 
+#include <algorithm>
+#include <bitset>
 #include <memory>
 #include <unordered_map>
 
@@ -9,6 +11,7 @@
 #include "lighting/Lightmap.hpp"
 #include "util/SmallHeap.hpp"
 #include "maths/aabb.hpp"
+#include "ChunkVoxels.hpp"
 #include "voxel.hpp"
 
 /// @brief Total bytes number of chunk voxel data
@@ -24,9 +27,12 @@ using BlocksMetadata = util::SmallHeap<uint16_t, uint8_t>;
 
 class Chunk {
 public:
+    static constexpr uint16_t ALL_SECTIONS = 0xFFFF;
+    static_assert(CHUNK_SECTIONS == 16);
+
     int x, z;
     int bottom, top;
-    voxel voxels[CHUNK_VOL] {};
+    ChunkVoxels voxels;
     std::shared_ptr<Lightmap> lightmap;
     struct {
         bool modified : 1;
@@ -35,11 +41,23 @@ public:
         bool lighted : 1;
         bool unsaved : 1;
         bool loadedLights : 1;
+        /// @brief Blocks light is loaded with sky light, so emission
+        /// does not need to be propagated again
+        bool loadedBlockLights : 1;
+        /// @brief Lightmap is changed by light solvers since loading
+        bool lightsUnsaved : 1;
         bool entities : 1;
         bool blocksData : 1;
         bool dirtyHeights : 1;
         bool inventoriesRemoved : 1;
     } flags {};
+    /// @brief Bit mask of sections modified since the last meshing
+    uint16_t modifiedSections = 0;
+    /// @brief Unique value updated on every voxels change marked
+    /// with setModifiedAndUnsaved. Used to validate voxels caches
+    uint64_t revision;
+    /// @brief Revisions of the last voxels change of each section
+    uint64_t sectionRevisions[CHUNK_SECTIONS];
 
     uint64_t lastRandomTickId = -1;
 
@@ -48,7 +66,13 @@ public:
     /// @brief Blocks metadata heap
     BlocksMetadata blocksMetadata;
 
-    Chunk(int x, int z, std::shared_ptr<Lightmap> lightmap=nullptr);
+    /// @param compactVoxels keep voxels sections compact (see ChunkVoxels)
+    Chunk(
+        int x,
+        int z,
+        std::shared_ptr<Lightmap> lightmap = nullptr,
+        bool compactVoxels = false
+    );
 
     /// @brief Refresh `bottom` and `top` values
     void updateHeights();
@@ -64,18 +88,87 @@ public:
     /// @return inventory bound to the given block or nullptr
     std::shared_ptr<Inventory> getBlockInventory(uint x, uint y, uint z) const;
 
-    inline void setModifiedAndUnsaved() {
+    /// @brief Mark all sections modified
+    inline void setModified() {
         flags.modified = true;
+        modifiedSections = ALL_SECTIONS;
+    }
+
+    /// @brief Mark sections affected by a voxel or light change at the
+    /// given height modified (neighbour sections are included on borders)
+    inline void setModified(int y) {
+        setModified(y, y);
+    }
+
+    /// @brief Mark sections affected by voxels or lights changes in the
+    /// height range [fromY, toY] modified
+    inline void setModified(int fromY, int toY) {
+        int from = std::max(fromY - 1, 0) / CHUNK_SECTION_H;
+        int to = std::min(toY + 1, CHUNK_H - 1) / CHUNK_SECTION_H;
+        flags.modified = true;
+        modifiedSections |= ((2U << to) - 1) & ~((1U << from) - 1);
+    }
+
+    inline void setModifiedAndUnsaved() {
+        setModified();
+        flags.unsaved = true;
+        revision = nextRevision();
+        std::fill(
+            std::begin(sectionRevisions), std::end(sectionRevisions), revision
+        );
+    }
+
+    inline void setModifiedAndUnsaved(int y) {
+        setModified(y);
         flags.unsaved = true;
+        revision = nextRevision();
+        sectionRevisions[y / CHUNK_SECTION_H] = revision;
     }
 
+    inline void setModifiedAndUnsaved(int fromY, int toY) {
+        setModified(fromY, toY);
+        flags.unsaved = true;
+        revision = nextRevision();
+        std::fill(
+            sectionRevisions + fromY / CHUNK_SECTION_H,
+            sectionRevisions + toY / CHUNK_SECTION_H + 1,
+            revision
+        );
+    }
+
+    /// @return bit mask of sections changed after the given revision
+    uint16_t getSectionsChangedSince(uint64_t revision) const;
+
+    /// @return number of sections in the bit mask
+    static uint countSections(uint16_t sections) {
+        return std::bitset<CHUNK_SECTIONS>(sections).count();
+    }
+
+    /// @return new unique chunk revision
+    static uint64_t nextRevision();
+
+    /// @return the latest revision given in this session. Revisions are
+    /// counted from zero in every session
+    static uint64_t getLastRevision();
+
     /// @brief Encode chunk to bytes array of size CHUNK_DATA_LEN
     /// @see /doc/specs/region_voxels_chunk_spec.md
     std::unique_ptr<ubyte[]> encode() const;
 
+    /// @brief Encode voxels of the given sections only. Ids of all the
+    /// sections are followed by their states, like in the full chunk format
+    /// @param sections sections bit mask
+    /// @param dst destination buffer of size CHUNK_DATA_LEN at least
+    /// @return encoded data size
+    size_t encode(uint16_t sections, ubyte* dst) const;
+
     /// @return true if all is fine
     bool decode(const ubyte* data);
 
+    /// @brief Decode voxels of the given sections encoded with
+    /// encode(sections, dst)
+    bool decode(const ubyte* data, uint16_t sections);
+
     static void convert(ubyte* data, const ContentReport* report);
 
     AABB getAABB() const {
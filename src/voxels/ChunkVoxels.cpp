@@ -0,0 +1,189 @@
+#include "ChunkVoxels.hpp"
+
+#include <cstring>
+
+static constexpr int LAYER_SIZE = CHUNK_W * CHUNK_D;
+static constexpr size_t MAX_PALETTE_SIZE = 256;
+
+static inline uint32_t voxel_key(const voxel& vox) {
+    return vox.id | static_cast<uint32_t>(blockstate2int(vox.state)) << 16;
+}
+
+ChunkVoxels::ChunkVoxels(bool compactMode) : compactMode(compactMode) {
+    for (auto& section : sections) {
+        if (compactMode) {
+            section.palette.push_back(voxel {BLOCK_AIR, {}});
+        } else {
+            section.voxels = std::make_unique<voxel[]>(CHUNK_SECTION_VOL);
+        }
+    }
+}
+
+ChunkVoxels::~ChunkVoxels() = default;
+
+void ChunkVoxels::expand(Section& section) {
+    auto voxels = std::make_unique<voxel[]>(CHUNK_SECTION_VOL);
+    for (uint i = 0; i < CHUNK_SECTION_VOL; i++) {
+        voxels[i] = section.get(i);
+    }
+    section.voxels = std::move(voxels);
+    section.palette = {};
+    section.indices.reset();
+    section.bits = 0;
+}
+
+bool ChunkVoxels::compact(Section& section, const voxel* src) {
+    std::vector<voxel> palette;
+    std::vector<uint32_t> keys;
+    ubyte values[CHUNK_SECTION_VOL];
+
+    uint32_t lastKey = voxel_key(src[0]);
+    uint lastValue = 0;
+    palette.push_back(src[0]);
+    keys.push_back(lastKey);
+    for (uint i = 0; i < CHUNK_SECTION_VOL; i++) {
+        uint32_t key = voxel_key(src[i]);
+        if (key != lastKey) {
+            lastKey = key;
+            lastValue = 0;
+            while (lastValue < keys.size() && keys[lastValue] != key) {
+                lastValue++;
+            }
+            if (lastValue == keys.size()) {
+                if (keys.size() == MAX_PALETTE_SIZE) {
+                    return false;
+                }
+                palette.push_back(src[i]);
+                keys.push_back(key);
+            }
+        }
+        values[i] = lastValue;
+    }
+
+    ubyte bits = 1;
+    while ((1U << bits) < palette.size()) {
+        bits <<= 1;
+    }
+    std::unique_ptr<ubyte[]> indices;
+    if (palette.size() > 1) {
+        indices = std::make_unique<ubyte[]>(CHUNK_SECTION_VOL * bits / 8);
+        std::memset(indices.get(), 0, CHUNK_SECTION_VOL * bits / 8);
+        for (uint i = 0; i < CHUNK_SECTION_VOL; i++) {
+            uint bitIndex = i * bits;
+            indices[bitIndex >> 3] |= values[i] << (bitIndex & 7);
+        }
+    }
+    palette.shrink_to_fit();
+    section.palette = std::move(palette);
+    section.indices = std::move(indices);
+    section.bits = bits;
+    section.voxels.reset();
+    return true;
+}
+
+const voxel* ChunkVoxels::getSection(int index, voxel* buffer) const {
+    const auto& section = sections[index];
+    if (section.voxels) {
+        return section.voxels.get();
+    }
+    for (uint i = 0; i < CHUNK_SECTION_VOL; i++) {
+        buffer[i] = section.get(i);
+    }
+    return buffer;
+}
+
+const voxel* ChunkVoxels::getLayer(int y, voxel* buffer) const {
+    const auto& section = sections[y / CHUNK_SECTION_H];
+    uint offset = (y % CHUNK_SECTION_H) * LAYER_SIZE;
+    if (section.voxels) {
+        return section.voxels.get() + offset;
+    }
+    for (uint i = 0; i < LAYER_SIZE; i++) {
+        buffer[i] = section.get(offset + i);
+    }
+    return buffer;
+}
+
+const voxel* ChunkVoxels::getUniform(int index) const {
+    const auto& section = sections[index];
+    if (section.voxels || section.indices) {
+        return nullptr;
+    }
+    return &section.palette[0];
+}
+
+void ChunkVoxels::setSection(int index, const voxel* src) {
+    auto& section = sections[index];
+    if (compactMode && compact(section, src)) {
+        return;
+    }
+    if (section.voxels == nullptr) {
+        section.voxels = std::make_unique<voxel[]>(CHUNK_SECTION_VOL);
+        section.palette = {};
+        section.indices.reset();
+        section.bits = 0;
+    }
+    std::memcpy(
+        section.voxels.get(), src, CHUNK_SECTION_VOL * sizeof(voxel)
+    );
+    section.used = true;
+}
+
+void ChunkVoxels::copyTo(voxel* dst) const {
+    for (int i = 0; i < CHUNK_SECTIONS; i++) {
+        voxel* sectionDst = dst + i * CHUNK_SECTION_VOL;
+        const voxel* src = getSection(i, sectionDst);
+        if (src != sectionDst) {
+            std::memcpy(sectionDst, src, CHUNK_SECTION_VOL * sizeof(voxel));
+        }
+    }
+}
+
+void ChunkVoxels::set(const voxel* src) {
+    for (int i = 0; i < CHUNK_SECTIONS; i++) {
+        setSection(i, src + i * CHUNK_SECTION_VOL);
+    }
+}
+
+uint ChunkVoxels::compact() {
+    if (!compactMode) {
+        return 0;
+    }
+    uint count = 0;
+    for (auto& section : sections) {
+        if (section.voxels == nullptr) {
+            continue;
+        }
+        if (section.used) {
+            section.used = false;
+            continue;
+        }
+        if (compact(section, section.voxels.get())) {
+            count++;
+        }
+    }
+    return count;
+}
+
+uint ChunkVoxels::countExpanded() const {
+    uint count = 0;
+    for (const auto& section : sections) {
+        count += section.voxels != nullptr;
+    }
+    return count;
+}
+
+size_t ChunkVoxels::getMemoryUsage() const {
+    size_t size = sizeof(ChunkVoxels);
+    for (const auto& section : sections) {
+        if (section.voxels) {
+            size += CHUNK_SECTION_VOL * sizeof(voxel);
+            continue;
+        }
+        size += section.palette.capacity() * sizeof(voxel);
+        if (section.indices) {
+            size += CHUNK_SECTION_VOL * section.bits / 8;
+        }
+    }
+    return size;
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "constants.hpp"
+#include "typedefs.hpp"
+#include "voxel.hpp"
+
+/// @brief Chunk section height (sections are 16x16x16 cubes)
+inline constexpr int CHUNK_SECTION_H = 16;
+/// @brief Number of voxels in a chunk section
+inline constexpr int CHUNK_SECTION_VOL = CHUNK_W * CHUNK_D * CHUNK_SECTION_H;
+/// @brief Number of sections in a chunk
+inline constexpr int CHUNK_SECTIONS = CHUNK_H / CHUNK_SECTION_H;
+
+/// @brief Chunk voxels split to sections. Every section is a contiguous
+/// range of chunk voxel indices stored either as a plain voxels array
+/// (expanded section) or as a palette with packed indices (compact
+/// section). Compact section having single palette entry is uniform and
+/// has no indices at all.
+///
+/// Reading never changes sections, so const methods may be used from
+/// multiple threads. Mutable access expands the section and marks it used,
+/// so expanded sections work as a cache of hot sections between
+/// compact() calls.
+class ChunkVoxels {
+    struct Section {
+        /// @brief Expanded section voxels or nullptr if compact
+        std::unique_ptr<voxel[]> voxels;
+        /// @brief Compact section palette
+        std::vector<voxel> palette;
+        /// @brief Packed palette indices or nullptr if uniform
+        std::unique_ptr<ubyte[]> indices;
+        /// @brief Bits per palette index (1, 2, 4 or 8)
+        ubyte bits = 0;
+        /// @brief Section was accessed for writing since the last compact()
+        bool used = false;
+
+        const voxel& get(uint index) const {
+            if (voxels) {
+                return voxels[index];
+            }
+            if (indices == nullptr) {
+                return palette[0];
+            }
+            uint bitIndex = index * bits;
+            uint value = indices[bitIndex >> 3] >> (bitIndex & 7);
+            return palette[value & ((1U << bits) - 1)];
+        }
+    };
+    Section sections[CHUNK_SECTIONS];
+    /// @brief Keep sections compact when possible
+    bool compactMode;
+
+    void expand(Section& section);
+    bool compact(Section& section, const voxel* src);
+public:
+    /// @param compactMode create sections compact (uniform air) and keep
+    /// written sections compact. If false all sections are always expanded
+    ChunkVoxels(bool compactMode = false);
+    ~ChunkVoxels();
+
+    ChunkVoxels(const ChunkVoxels&) = delete;
+    ChunkVoxels& operator=(const ChunkVoxels&) = delete;
+
+    /// @brief Get voxel without changing sections
+    /// @param index voxel index in chunk (see vox_index)
+    const voxel& get(uint index) const {
+        return sections[index / CHUNK_SECTION_VOL].get(
+            index % CHUNK_SECTION_VOL
+        );
+    }
+
+    /// @brief Get mutable voxel. Section gets expanded if compact
+    /// @param index voxel index in chunk (see vox_index)
+    voxel& at(uint index) {
+        auto& section = sections[index / CHUNK_SECTION_VOL];
+        if (section.voxels == nullptr) {
+            expand(section);
+        }
+        section.used = true;
+        return section.voxels[index % CHUNK_SECTION_VOL];
+    }
+
+    /// @brief Get section voxels
+    /// @param buffer buffer of CHUNK_SECTION_VOL voxels used to decode
+    /// the section if it is compact
+    /// @return section voxels (expanded section data or the buffer)
+    const voxel* getSection(int index, voxel* buffer) const;
+
+    /// @brief Get voxels of a chunk layer (CHUNK_W * CHUNK_D voxels)
+    /// @param buffer buffer of CHUNK_W * CHUNK_D voxels used to decode
+    /// the layer if its section is compact
+    /// @return layer voxels (expanded section data or the buffer)
+    const voxel* getLayer(int y, voxel* buffer) const;
+
+    /// @return pointer to the section value if the section is uniform
+    /// or nullptr
+    const voxel* getUniform(int index) const;
+
+    /// @brief Set section voxels
+    /// @param src CHUNK_SECTION_VOL voxels
+    void setSection(int index, const voxel* src);
+
+    /// @brief Copy all voxels to the buffer
+    /// @param dst CHUNK_VOL voxels
+    void copyTo(voxel* dst) const;
+
+    /// @brief Set all voxels
+    /// @param src CHUNK_VOL voxels
+    void set(const voxel* src);
+
+    /// @brief Compact expanded sections not used since the previous call
+    /// @return number of compacted sections
+    uint compact();
+
+    /// @return number of expanded sections
+    uint countExpanded() const;
+
+    /// @return approximate number of bytes used by voxels
+    size_t getMemoryUsage() const;
+
+    bool isCompactMode() const {
+        return compactMode;
+    }
+};
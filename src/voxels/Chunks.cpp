@@ -44,11 +44,11 @@ void Chunks::configure(int32_t x, int32_t z, uint32_t radius) {
     setCenter(x, z);
 }
 
-voxel* Chunks::get(int32_t x, int32_t y, int32_t z) const {
+const voxel* Chunks::get(int32_t x, int32_t y, int32_t z) const {
     return blocks_agent::get(*this, x, y, z);
 }
 
-voxel& Chunks::require(int32_t x, int32_t y, int32_t z) const {
+const voxel& Chunks::require(int32_t x, int32_t y, int32_t z) const {
     return blocks_agent::require(*this, x, y, z);
 }
 
@@ -56,7 +56,7 @@ const AABB* Chunks::isObstacleAt(float x, float y, float z) const {
     int ix = std::floor(x);
     int iy = std::floor(y);
     int iz = std::floor(z);
-    voxel* v = get(ix, iy, iz);
+    const voxel* v = get(ix, iy, iz);
     if (v == nullptr) {
         if (iy >= CHUNK_H) {
             return nullptr;
@@ -95,7 +95,7 @@ bool Chunks::isReplaceableBlock(int32_t x, int32_t y, int32_t z) {
 }
 
 bool Chunks::isObstacleBlock(int32_t x, int32_t y, int32_t z) {
-    voxel* v = get(x, y, z);
+    const voxel* v = get(x, y, z);
     if (v == nullptr) return false;
     return indices.blocks.require(v->id).obstacle;
 }
@@ -208,7 +208,7 @@ void Chunks::set(
     blocks_agent::set(*this, x, y, z, id, state);
 }
 
-voxel* Chunks::rayCast(
+const voxel* Chunks::rayCast(
     const glm::vec3& start,
     const glm::vec3& dir,
     float maxDist,
@@ -258,7 +258,7 @@ glm::vec3 Chunks::rayCastToObstacle(
     float tzMax = (tzDelta < infinity) ? tzDelta * zdist : infinity;
 
     while (t <= maxDist) {
-        voxel* voxel = get(ix, iy, iz);
+        const voxel* voxel = get(ix, iy, iz);
         if (voxel) {
             const auto& def = indices.blocks.require(voxel->id);
             if (def.obstacle) {
@@ -382,7 +382,7 @@ static inline void sample_chunk(
     int cz,
     bool backlight
 ) {
-    const auto cvoxels = chunk.voxels;
+    const auto& cvoxels = chunk.voxels;
     const auto clights = chunk.lightmap ? chunk.lightmap->getLights() : nullptr;
     for (int ly = pos.y; ly < pos.y + size.y; ly++) {
         for (int lz = std::max(pos.z, cz * CHUNK_D);
@@ -402,7 +402,7 @@ static inline void sample_chunk(
                     CHUNK_D
                 );
                 auto& vox = voxels[vidx];
-                vox = cvoxels[cidx];
+                vox = cvoxels.get(cidx);
                 light_t light = clights ? clights[cidx]
                                         : Lightmap::SUN_LIGHT_ONLY;
                 // todo: move to the BlocksRenderer
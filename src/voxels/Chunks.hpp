@@ -66,12 +66,8 @@ public:
         );
     }
 
-    voxel* get(int32_t x, int32_t y, int32_t z) const;
-    voxel& require(int32_t x, int32_t y, int32_t z) const;
-
-    inline voxel* get(const glm::ivec3& pos) {
-        return get(pos.x, pos.y, pos.z);
-    }
+    const voxel* get(int32_t x, int32_t y, int32_t z) const;
+    const voxel& require(int32_t x, int32_t y, int32_t z) const;
 
     inline const voxel* get(const glm::ivec3& pos) const {
         return get(pos.x, pos.y, pos.z);
@@ -105,7 +101,7 @@ public:
 
     void setRotation(int32_t x, int32_t y, int32_t z, uint8_t rotation);
 
-    voxel* rayCast(
+    const voxel* rayCast(
         const glm::vec3& start,
         const glm::vec3& dir,
         float maxLength,
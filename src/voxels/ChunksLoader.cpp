@@ -0,0 +1,111 @@
+#include "ChunksLoader.hpp"
+
+#include "debug/Logger.hpp"
+#include "world/files/WorldRegions.hpp"
+
+static debug::Logger logger("chunks-loader");
+
+/// @brief Max number of chunks being read per worker
+static inline constexpr size_t MAX_CHUNKS_PER_WORKER = 8;
+
+class ChunksLoaderWorker : public util::Worker<ChunkLoadJob, ChunkLoadResult> {
+    WorldRegions& regions;
+public:
+    ChunksLoaderWorker(WorldRegions& regions) : regions(regions) {
+    }
+
+    ChunkLoadResult operator()(const ChunkLoadJob& job) override {
+        ChunkLoadResult result {
+            job.pos,
+            job.id,
+            regions.getChunkVersion(job.pos.x, job.pos.y),
+            nullptr};
+        try {
+            result.data = std::make_shared<ChunkRegionsData>(
+                regions.readChunk(job.pos.x, job.pos.y, job.lights)
+            );
+        } catch (const std::exception& err) {
+            // will be read in the main thread
+            logger.error() << "chunk " << job.pos.x << "x" << job.pos.y
+                           << " reading failed: " << err.what();
+        }
+        return result;
+    }
+};
+
+ChunksLoader::ChunksLoader(WorldRegions& regions, int maxWorkers)
+    : regions(regions),
+      threadPool(
+          "chunks-load-pool",
+          [&]() { return std::make_unique<ChunksLoaderWorker>(regions); },
+          [this](ChunkLoadResult&& result) {
+              processResult(std::move(result));
+          },
+          maxWorkers
+      ) {
+    threadPool.setStopOnFail(false);
+    logger.info() << "created " << threadPool.getWorkersCount() << " workers";
+}
+
+ChunksLoader::~ChunksLoader() = default;
+
+void ChunksLoader::prefetch(int x, int z, bool lights) {
+    glm::ivec2 pos(x, z);
+    if (requests.find(pos) != requests.end() ||
+        ready.find(pos) != ready.end()) {
+        return;
+    }
+    uint64_t id = nextId++;
+    requests[pos] = id;
+    threadPool.enqueueJob(ChunkLoadJob {pos, id, lights});
+}
+
+bool ChunksLoader::isLoading(int x, int z) const {
+    return requests.find({x, z}) != requests.end();
+}
+
+bool ChunksLoader::isFull() const {
+    return requests.size() >=
+           threadPool.getWorkersCount() * MAX_CHUNKS_PER_WORKER;
+}
+
+std::shared_ptr<ChunkRegionsData> ChunksLoader::take(int x, int z) {
+    const auto& found = ready.find({x, z});
+    if (found == ready.end()) {
+        return nullptr;
+    }
+    auto [data, version] = std::move(found->second);
+    ready.erase(found);
+    if (version != regions.getChunkVersion(x, z)) {
+        return nullptr;
+    }
+    return data;
+}
+
+void ChunksLoader::cancel(int x, int z) {
+    requests.erase({x, z});
+    ready.erase({x, z});
+}
+
+void ChunksLoader::update(const std::function<bool(int, int)>& isRequired) {
+    threadPool.pullResults();
+    for (auto it = ready.begin(); it != ready.end();) {
+        if (!isRequired(it->first.x, it->first.y)) {
+            it = ready.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void ChunksLoader::processResult(ChunkLoadResult&& result) {
+    const auto& found = requests.find(result.pos);
+    if (found == requests.end() || found->second != result.id) {
+        // cancelled
+        return;
+    }
+    requests.erase(found);
+    if (result.data) {
+        ready[result.pos] = {std::move(result.data), result.version};
+    }
+}
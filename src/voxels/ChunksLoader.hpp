@@ -0,0 +1,86 @@
+#pragma once
+
+#include <memory>
+#include <functional>
+#include <unordered_map>
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/glm.hpp>
+#include <glm/gtx/hash.hpp>
+
+#include "typedefs.hpp"
+#include "util/ThreadPool.hpp"
+
+class WorldRegions;
+struct ChunkRegionsData;
+
+struct ChunkLoadJob {
+    glm::ivec2 pos;
+    /// @brief Request serial number used to discard outdated results
+    uint64_t id;
+    /// @brief Read lights cache
+    bool lights;
+};
+
+struct ChunkLoadResult {
+    glm::ivec2 pos;
+    uint64_t id;
+    /// @brief Chunk data version got before reading
+    /// (see WorldRegions::getChunkVersion)
+    uint32_t version;
+    /// @brief Read chunk data or nullptr if failed
+    std::shared_ptr<ChunkRegionsData> data;
+};
+
+/// @brief Reads and decodes saved chunks data from regions in background
+/// so only final chunk decoding is left for the main thread
+class ChunksLoader {
+    WorldRegions& regions;
+    uint64_t nextId = 1;
+    /// @brief Chunks being read (request serial numbers)
+    std::unordered_map<glm::ivec2, uint64_t> requests;
+    /// @brief Read chunks waiting to be taken (data and version)
+    std::unordered_map<
+        glm::ivec2,
+        std::pair<std::shared_ptr<ChunkRegionsData>, uint32_t>>
+        ready;
+    util::ThreadPool<ChunkLoadJob, ChunkLoadResult> threadPool;
+
+    void processResult(ChunkLoadResult&& result);
+public:
+    /// @param regions world regions used by workers
+    /// @param maxWorkers max number of workers (see util::ThreadPool)
+    ChunksLoader(WorldRegions& regions, int maxWorkers);
+    ~ChunksLoader();
+
+    /// @brief Start chunk data reading if not started yet
+    /// @param lights read lights cache
+    void prefetch(int x, int z, bool lights);
+
+    /// @return true if the chunk data is being read
+    bool isLoading(int x, int z) const;
+
+    /// @return true if no more chunks should be prefetched at the moment
+    bool isFull() const;
+
+    /// @brief Take read chunk data. Data outdated by a put to regions
+    /// while or after reading is discarded
+    /// @return nullptr if chunk data is not read or outdated
+    std::shared_ptr<ChunkRegionsData> take(int x, int z);
+
+    /// @brief Discard read or being read chunk data
+    void cancel(int x, int z);
+
+    /// @brief Process workers results and discard read chunks data
+    /// that is not required anymore
+    /// @param isRequired checks if the chunk is still required
+    void update(const std::function<bool(int, int)>& isRequired);
+
+    size_t getChunksInWork() const {
+        return requests.size();
+    }
+
+    uint getWorkersCount() const {
+        return threadPool.getWorkersCount();
+    }
+};
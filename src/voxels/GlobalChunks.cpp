@@ -4,6 +4,7 @@
 
 #include "Block.hpp"
 #include "Chunk.hpp"
+#include "ChunksLoader.hpp"
 #include "coders/json.hpp"
 #include "content/Content.hpp"
 #include "debug/Logger.hpp"
@@ -22,11 +23,18 @@
 
 static debug::Logger logger("chunks-storage");
 
-GlobalChunks::GlobalChunks(Level& level)
+GlobalChunks::GlobalChunks(Level& level, int loaderWorkers)
     : level(level), indices(*level.content.getIndices()) {
     chunksMap.max_load_factor(CHUNKS_MAP_MAX_LOAD_FACTOR);
+    if (loaderWorkers != 0) {
+        loader = std::make_unique<ChunksLoader>(
+            level.getWorld()->wfile->getRegions(), loaderWorkers
+        );
+    }
 }
 
+GlobalChunks::~GlobalChunks() = default;
+
 void GlobalChunks::setOnUnload(consumer<Chunk&> onUnload) {
     this->onUnload = std::move(onUnload);
 }
@@ -39,11 +47,12 @@ std::shared_ptr<Chunk> GlobalChunks::fetch(int x, int z) {
     return found->second;
 }
 
-static void check_voxels(const ContentIndices& indices, Chunk& chunk) {
+/// @return false if chunk has unknown blocks (replaced with air)
+static bool check_voxels(const ContentIndices& indices, Chunk& chunk) {
     bool corrupted = false;
     blockid_t defsCount = indices.blocks.count();
     for (size_t i = 0; i < CHUNK_VOL; i++) {
-        blockid_t id = chunk.voxels[i].id;
+        blockid_t id = chunk.voxels.get(i).id;
         if (id >= defsCount) {
             if (!corrupted) {
 #ifdef NDEBUG
@@ -52,31 +61,31 @@ static void check_voxels(const ContentIndices& indices, Chunk& chunk) {
                 logline << "corruped blocks detected at " << i << " of chunk ";
                 logline << chunk.x << "x" << chunk.z;
                 logline << " -> " << id;
-                corrupted = true;
 #else
                 // debug
                 abort();
 #endif
             }
-            chunk.voxels[i] = {};
+            chunk.voxels.at(i) = {};
+            corrupted = true;
         }
     }
+    return !corrupted;
 }
 
 void GlobalChunks::erase(int x, int z) {
     chunksMap.erase(keyfrom(x, z));
 }
 
-static inline auto load_inventories(
-    WorldRegions& regions,
+static void resize_inventories(
+    ChunkInventoriesMap& invs,
     const Chunk& chunk,
     const ContentUnitIndices<Block, blockid_t>& defs
 ) {
-    auto invs = regions.fetchInventories(chunk.x, chunk.z);
     auto iterator = invs.begin();
     while (iterator != invs.end()) {
         uint index = iterator->first;
-        const auto& def = defs.require(chunk.voxels[index].id);
+        const auto& def = defs.require(chunk.voxels.get(index).id);
         if (def.inventorySize == 0) {
             iterator = invs.erase(iterator);
             continue;
@@ -87,7 +96,6 @@ static inline auto load_inventories(
         }
         ++iterator;
     }
-    return invs;
 }
 
 static util::ObjectsPool<Chunk> chunks_pool(1'024);
@@ -98,31 +106,36 @@ std::shared_ptr<Chunk> GlobalChunks::create(int x, int z, bool lighting) {
     if (found != chunksMap.end()) {
         return found->second;
     }
-    static std::unique_ptr<ubyte[]> voxelDataBuffer = nullptr;
-    if (voxelDataBuffer == nullptr) {
-        voxelDataBuffer = std::make_unique<ubyte[]>(CHUNK_DATA_LEN);
+    std::shared_ptr<ChunkRegionsData> data;
+    if (loader) {
+        data = loader->take(x, z);
+        // still being read: discard and read in the main thread
+        loader->cancel(x, z);
+    }
+    if (data == nullptr) {
+        auto& regions = level.getWorld()->wfile->getRegions();
+        data = std::make_shared<ChunkRegionsData>(
+            regions.readChunk(x, z, lighting)
+        );
     }
 
-    auto chunk =
-        chunks_pool.create(x, z, lighting ? lightmaps_pool.create() : nullptr);
+    auto chunk = chunks_pool.create(
+        x, z, lighting ? lightmaps_pool.create() : nullptr, voxelsCompaction
+    );
     chunksMap[keyfrom(x, z)] = chunk;
 
-    World& world = *level.getWorld();
-    auto& regions = world.wfile.get()->getRegions();
-
-    if (regions.getVoxels(chunk->x, chunk->z, voxelDataBuffer.get())) {
+    bool voxelsValid = true;
+    if (data->voxels) {
         const auto& indices = *level.content.getIndices();
 
-        chunk->decode(voxelDataBuffer.get());
-        check_voxels(indices, *chunk);
+        chunk->decode(data->voxels.get());
+        voxelsValid = check_voxels(indices, *chunk);
 
-        chunk->setBlockInventories(
-            load_inventories(regions, *chunk, indices.blocks)
-        );
+        resize_inventories(data->inventories, *chunk, indices.blocks);
+        chunk->setBlockInventories(std::move(data->inventories));
 
-        auto entitiesData = regions.fetchEntities(chunk->x, chunk->z);
-        if (entitiesData.getType() == dv::value_type::object) {
-            level.entities->loadEntities(std::move(entitiesData));
+        if (data->entities.getType() == dv::value_type::object) {
+            level.entities->loadEntities(std::move(data->entities));
             chunk->flags.entities = true;
         }
 
@@ -131,13 +144,20 @@ std::shared_ptr<Chunk> GlobalChunks::create(int x, int z, bool lighting) {
             level.inventories->store(entry.second);
         }
     }
-    if (chunk->lightmap) {
-        if (regions.getLights(chunk->x, chunk->z, voxelDataBuffer.get())) {
-            chunk->lightmap->decode(voxelDataBuffer.get());
+    if (chunk->lightmap && data->lights) {
+        auto content =
+            chunk->lightmap->decode(data->lights.get(), data->lightsSize);
+        if (content == LightmapContent::NONE) {
+            logger.error() << "corrupted lights of chunk " << x << "x" << z;
+            chunk->lightmap->clear();
+        } else {
             chunk->flags.loadedLights = true;
+            // blocks light of replaced blocks is not valid
+            chunk->flags.loadedBlockLights =
+                content == LightmapContent::ALL && voxelsValid;
         }
     }
-    chunk->blocksMetadata = regions.getBlocksData(chunk->x, chunk->z);
+    chunk->blocksMetadata = std::move(data->blocksData);
     return chunk;
 }
 
@@ -186,30 +206,69 @@ void GlobalChunks::decref(Chunk* chunk) {
     }
 }
 
-void GlobalChunks::save(Chunk* chunk) {
-    if (chunk == nullptr) {
-        return;
-    }
-    AABB aabb = chunk->getAABB();
+std::unique_ptr<ChunkSnapshot> GlobalChunks::createSnapshot(Chunk& chunk) {
+    AABB aabb = chunk.getAABB();
     auto entities = level.entities->getAllInside(aabb);
     auto root = dv::object();
     root["data"] = level.entities->serialize(entities);
     if (!entities.empty()) {
-        chunk->flags.entities = true;
+        chunk.flags.entities = true;
     }
-    level.getWorld()->wfile->getRegions().put(
-        chunk,
-        chunk->flags.entities ? json::to_binary(root, true)
-                                : std::vector<ubyte>()
+    return level.getWorld()->wfile->getRegions().createSnapshot(
+        &chunk,
+        chunk.flags.entities ? json::to_binary(root, true)
+                             : std::vector<ubyte>()
     );
 }
 
+void GlobalChunks::save(Chunk* chunk) {
+    if (chunk == nullptr) {
+        return;
+    }
+    if (auto snapshot = createSnapshot(*chunk)) {
+        level.getWorld()->wfile->getRegions().put(*snapshot);
+    }
+}
+
 void GlobalChunks::saveAll() {
     for (const auto& [_, chunk] : chunksMap) {
         save(chunk.get());
     }
 }
 
+std::vector<std::unique_ptr<ChunkSnapshot>> GlobalChunks::snapshotAll() {
+    std::vector<std::unique_ptr<ChunkSnapshot>> snapshots;
+    for (const auto& [_, chunk] : chunksMap) {
+        if (auto snapshot = createSnapshot(*chunk)) {
+            snapshots.push_back(std::move(snapshot));
+        }
+    }
+    return snapshots;
+}
+
+void GlobalChunks::setVoxelsCompaction(bool enabled) {
+    voxelsCompaction = enabled;
+}
+
+size_t GlobalChunks::compactVoxels() {
+    if (!voxelsCompaction) {
+        return 0;
+    }
+    size_t count = 0;
+    for (const auto& [_, chunk] : chunksMap) {
+        count += chunk->voxels.compact();
+    }
+    return count;
+}
+
+size_t GlobalChunks::getVoxelsMemoryUsage() const {
+    size_t size = 0;
+    for (const auto& [_, chunk] : chunksMap) {
+        size += chunk->voxels.getMemoryUsage();
+    }
+    return size;
+}
+
 void GlobalChunks::putChunk(std::shared_ptr<Chunk> chunk) {
     chunksMap[keyfrom(chunk->x, chunk->z)] = std::move(chunk);
 }
@@ -217,3 +276,26 @@ void GlobalChunks::putChunk(std::shared_ptr<Chunk> chunk) {
 std::optional<AABB> GlobalChunks::isObstacleAt(float x, float y, float z, const AABB& aabb) const {
     return blocks_agent::is_obstacle_at(*this, x, y, z, aabb);
 }
+
+const voxel* GlobalChunks::get(int32_t x, int32_t y, int32_t z) const {
+    return blocks_agent::get(*this, x, y, z);
+}
+
+Chunk* GlobalChunks::getChunkByVoxel(int32_t x, int32_t y, int32_t z) const {
+    if (y < 0 || y >= CHUNK_H) {
+        return nullptr;
+    }
+    return getChunk(floordiv<CHUNK_W>(x), floordiv<CHUNK_D>(z));
+}
+
+ubyte GlobalChunks::getLight(
+    int32_t x, int32_t y, int32_t z, int channel
+) const {
+    Chunk* chunk = getChunkByVoxel(x, y, z);
+    if (chunk == nullptr || chunk->lightmap == nullptr) {
+        return 0;
+    }
+    int lx = x - chunk->x * CHUNK_W;
+    int lz = z - chunk->z * CHUNK_D;
+    return chunk->lightmap->get(lx, y, lz, channel);
+}
@@ -3,6 +3,7 @@
 #include <memory>
 #include <optional>
 #include <unordered_map>
+#include <vector>
 
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/glm.hpp>
@@ -15,6 +16,8 @@ class Chunk;
 class Level;
 struct AABB;
 class ContentIndices;
+class ChunksLoader;
+struct ChunkSnapshot;
 
 class GlobalChunks {
     static inline uint64_t keyfrom(int32_t x, int32_t z) {
@@ -32,11 +35,19 @@ class GlobalChunks {
     std::unordered_map<uint64_t, std::shared_ptr<Chunk>> chunksMap;
     std::unordered_map<glm::ivec2, std::shared_ptr<Chunk>> pinnedChunks;
     std::unordered_map<ptrdiff_t, int> refCounters;
+    /// @brief Background chunks reading service (nullptr if disabled)
+    std::unique_ptr<ChunksLoader> loader;
+    /// @brief Create chunks with compact voxels sections
+    bool voxelsCompaction = false;
 
     consumer<Chunk&> onUnload;
+
+    std::unique_ptr<ChunkSnapshot> createSnapshot(Chunk& chunk);
 public:
-    GlobalChunks(Level& level);
-    ~GlobalChunks() = default;
+    /// @param loaderWorkers max number of chunks loader workers
+    /// (see util::ThreadPool), 0 - read chunks in the main thread
+    GlobalChunks(Level& level, int loaderWorkers = 0);
+    ~GlobalChunks();
 
     void setOnUnload(consumer<Chunk&> onUnload);
 
@@ -56,10 +67,39 @@ public:
     void save(Chunk* chunk);
     void saveAll();
 
+    /// @brief Encode all unsaved chunks data to be saved later
+    std::vector<std::unique_ptr<ChunkSnapshot>> snapshotAll();
+
     void putChunk(std::shared_ptr<Chunk> chunk);
 
+    /// @brief Enable compact voxels storage for chunks created later.
+    /// Must not be enabled while chunks voxels are read by other threads
+    /// (chunks meshing)
+    void setVoxelsCompaction(bool enabled);
+
+    /// @brief Compact chunks voxels sections not modified since
+    /// the previous call (does nothing if compaction is disabled)
+    /// @return number of compacted sections
+    size_t compactVoxels();
+
+    /// @return approximate number of bytes used by loaded chunks voxels
+    size_t getVoxelsMemoryUsage() const;
+
+    /// @brief Find block hitbox intersecting the area at the position.
+    /// Does not change chunks, so may be called from multiple threads while
+    /// chunks are not modified
     std::optional<AABB> isObstacleAt(float x, float y, float z, const AABB& aabb) const;
 
+    /// @return voxel at the position or nullptr if chunk is not loaded
+    const voxel* get(int32_t x, int32_t y, int32_t z) const;
+
+    /// @return chunk containing the voxel position or nullptr
+    Chunk* getChunkByVoxel(int32_t x, int32_t y, int32_t z) const;
+
+    /// @return light channel value at the position (0 if chunk is not
+    /// loaded or has no lightmap)
+    ubyte getLight(int32_t x, int32_t y, int32_t z, int channel) const;
+
     inline Chunk* getChunk(int cx, int cz) const {
         const auto& found = chunksMap.find(keyfrom(cx, cz));
         if (found == chunksMap.end()) {
@@ -71,4 +111,8 @@ public:
     const ContentIndices& getContentIndices() const {
         return indices;
     }
+
+    ChunksLoader* getLoader() {
+        return loader.get();
+    }
 };
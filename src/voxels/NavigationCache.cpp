@@ -0,0 +1,125 @@
+#include "NavigationCache.hpp"
+
+#include <cstring>
+
+#include "content/Content.hpp"
+#include "voxels/Block.hpp"
+#include "voxels/Chunk.hpp"
+#include "voxels/GlobalChunks.hpp"
+#include "voxels/blocks_agent.hpp"
+
+using namespace voxels;
+
+NavigationCache::NavigationCache(
+    const GlobalChunks& chunks,
+    const ContentUnitIndices<Block, blockid_t>& blockDefs
+)
+    : chunks(chunks), blockDefs(blockDefs) {
+    obstacleRotations.resize(blockDefs.count());
+    for (size_t id = 0; id < blockDefs.count(); id++) {
+        const auto& def = blockDefs.require(id);
+        if (!def.obstacle) {
+            continue;
+        }
+        for (int rotation = 0; rotation < BlockRotProfile::MAX_COUNT;
+             rotation++) {
+            const auto& boxes =
+                def.rotatable ? def.rt.hitboxes[rotation] : def.hitboxes;
+            for (const auto& hitbox : boxes) {
+                if (hitbox.intersects(AABB())) {
+                    obstacleRotations[id] |= 1 << rotation;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+static inline bool is_full_obstacle(blockstate state, ubyte rotations) {
+    return !state.segment && ((rotations >> state.rotation) & 1);
+}
+
+std::shared_ptr<const NavChunk> NavigationCache::build(
+    const Chunk& chunk
+) const {
+    auto navChunk = std::make_shared<NavChunk>();
+    navChunk->x = chunk.x;
+    navChunk->z = chunk.z;
+    navChunk->ids = std::make_unique<blockid_t[]>(CHUNK_VOL);
+    navChunk->obstacles = std::make_unique<uint64_t[]>(CHUNK_VOL / 64);
+    std::memset(navChunk->obstacles.get(), 0, CHUNK_VOL / 8);
+
+    auto ids = navChunk->ids.get();
+    auto obstacles = navChunk->obstacles.get();
+    auto buffer = std::make_unique<voxel[]>(CHUNK_SECTION_VOL);
+    for (int section = 0; section < CHUNK_SECTIONS; section++) {
+        uint offset = section * CHUNK_SECTION_VOL;
+        if (auto uniform = chunk.voxels.getUniform(section)) {
+            std::fill(
+                ids + offset, ids + offset + CHUNK_SECTION_VOL, uniform->id
+            );
+            ubyte rotations = obstacleRotations[uniform->id];
+            if (is_full_obstacle(uniform->state, rotations)) {
+                std::memset(
+                    obstacles + offset / 64, 0xFF, CHUNK_SECTION_VOL / 8
+                );
+                continue;
+            }
+        }
+        const voxel* voxels = chunk.voxels.getSection(section, buffer.get());
+        for (uint i = 0; i < CHUNK_SECTION_VOL; i++) {
+            const auto& vox = voxels[i];
+            uint index = offset + i;
+            ids[index] = vox.id;
+            ubyte rotations = obstacleRotations[vox.id];
+            if (rotations == 0) {
+                continue;
+            }
+            // extended blocks segments hitboxes may be outside of the block
+            if (vox.state.segment) {
+                int y = index / (CHUNK_D * CHUNK_W);
+                int lz = index / CHUNK_W % CHUNK_D;
+                int lx = index % CHUNK_W;
+                if (!blocks_agent::is_obstacle_at(
+                        chunks,
+                        chunk.x * CHUNK_W + lx,
+                        y,
+                        chunk.z * CHUNK_D + lz
+                    )) {
+                    continue;
+                }
+            } else if (((rotations >> vox.state.rotation) & 1) == 0) {
+                continue;
+            }
+            obstacles[index >> 6] |= 1ULL << (index & 63);
+        }
+    }
+    return navChunk;
+}
+
+std::shared_ptr<const NavChunk> NavigationCache::get(int cx, int cz) {
+    auto chunk = chunks.getChunk(cx, cz);
+    if (chunk == nullptr) {
+        return nullptr;
+    }
+    auto& entry = entries[{cx, cz}];
+    if (entry.navChunk == nullptr || entry.chunk != chunk ||
+        entry.revision != chunk->revision) {
+        entry.navChunk = build(*chunk);
+        entry.chunk = chunk;
+        entry.revision = chunk->revision;
+    }
+    return entry.navChunk;
+}
+
+void NavigationCache::cleanup() {
+    for (auto it = entries.begin(); it != entries.end();) {
+        const auto& [pos, entry] = *it;
+        auto chunk = chunks.getChunk(pos.x, pos.y);
+        if (chunk != entry.chunk || chunk->revision != entry.revision) {
+            it = entries.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/hash.hpp>
+#include <glm/vec2.hpp>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "constants.hpp"
+#include "typedefs.hpp"
+
+class Block;
+class Chunk;
+class GlobalChunks;
+
+template <typename T, typename IdType>
+class ContentUnitIndices;
+
+namespace voxels {
+    /// @brief Immutable snapshot of chunk blocks used by pathfinding.
+    /// May be read from any thread
+    struct NavChunk {
+        int x, z;
+        /// @brief Block ids by voxel index (see vox_index)
+        std::unique_ptr<blockid_t[]> ids;
+        /// @brief Bit per voxel set if the block area intersects
+        /// the block hitboxes (see blocks_agent::is_obstacle_at)
+        std::unique_ptr<uint64_t[]> obstacles;
+
+        blockid_t getId(int lx, int y, int lz) const {
+            return ids[(y * CHUNK_D + lz) * CHUNK_W + lx];
+        }
+
+        bool isObstacleAt(int lx, int y, int lz) const {
+            uint index = (y * CHUNK_D + lz) * CHUNK_W + lx;
+            return (obstacles[index >> 6] >> (index & 63)) & 1;
+        }
+    };
+
+    /// @brief Pathfinding snapshots of loaded chunks shared by agents.
+    /// Snapshot is rebuilt when the chunk revision changes
+    class NavigationCache {
+        struct Entry {
+            std::shared_ptr<const NavChunk> navChunk;
+            const Chunk* chunk;
+            uint64_t revision;
+        };
+        const GlobalChunks& chunks;
+        const ContentUnitIndices<Block, blockid_t>& blockDefs;
+        /// @brief Per block id mask of rotations having hitboxes
+        /// intersecting the block area
+        std::vector<ubyte> obstacleRotations;
+        std::unordered_map<glm::ivec2, Entry> entries;
+
+        std::shared_ptr<const NavChunk> build(const Chunk& chunk) const;
+    public:
+        NavigationCache(
+            const GlobalChunks& chunks,
+            const ContentUnitIndices<Block, blockid_t>& blockDefs
+        );
+
+        /// @brief Get actual snapshot of the chunk. Must be called in the
+        /// chunks owner thread
+        /// @return snapshot or nullptr if chunk is not loaded
+        std::shared_ptr<const NavChunk> get(int cx, int cz);
+
+        /// @brief Remove snapshots of unloaded and modified chunks
+        void cleanup();
+
+        size_t size() const {
+            return entries.size();
+        }
+    };
+}
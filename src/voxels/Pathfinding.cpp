@@ -1,269 +1,536 @@
 #include "Pathfinding.hpp"
 
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/glm.hpp>
+#include <glm/gtx/hash.hpp>
+#include <algorithm>
+#include <cstdint>
+
 #include "content/Content.hpp"
-#include "voxels/Chunk.hpp"
-#include "voxels/GlobalChunks.hpp"
-#include "voxels/blocks_agent.hpp"
+#include "maths/voxmaths.hpp"
+#include "util/ThreadPool.hpp"
+#include "voxels/Block.hpp"
 #include "world/Level.hpp"
+#include "NavigationCache.hpp"
 
 inline constexpr float SQRT2 = 1.4142135623730951f;  // sqrt(2)
 
+/// @brief Number of cached chunks snapshots before cleanup
+inline constexpr size_t MAX_CACHED_CHUNKS = 256;
+
 using namespace voxels;
 
 static float heuristic(const glm::ivec3& a, const glm::ivec3& b) {
     return glm::distance(glm::vec3(a), glm::vec3(b));
 }
 
-Pathfinding::Pathfinding(const Level& level)
-    : level(level),
-      chunks(*level.chunks),
-      blockDefs(level.content.getIndices()->blocks) {
-}
+enum Passability {
+    NON_PASSABLE = -1,
+    OBSTACLE = 0,
+    PASSABLE = 1,
+};
 
-static bool check_passability(
-    const Agent& agent,
-    const GlobalChunks& chunks,
-    const Node& node,
-    const glm::ivec2& offset,
-    bool diagonal
-) {
-    if (!diagonal) {
-        return true;
-    }
-    auto a = node.pos + glm::ivec3(offset.x, 0, 0);
-    auto b = node.pos + glm::ivec3(0, 0, offset.y);
+enum class SearchStatus {
+    RUNNING,
+    /// @brief Waiting for chunks snapshots (see Search::missingChunks)
+    SUSPENDED,
+    FINISHED,
+};
 
-    for (int i = 0; i < agent.height; i++) {
-        if (blocks_agent::is_obstacle_at(chunks, a.x, a.y + i, a.z))
-            return false;
-        if (blocks_agent::is_obstacle_at(chunks, b.x, b.y + i, b.z))
-            return false;
-    }
-    return true;
-}
+static const glm::ivec2 NEIGHBORS[8] {
+    {0, 1},
+    {1, 0},
+    {0, -1},
+    {-1, 0},
+    {-1, -1},
+    {1, -1},
+    {1, 1},
+    {-1, 1},
+};
+
+namespace {
+    struct SearchNode {
+        glm::ivec3 pos;
+        /// @brief Parent node index or -1
+        int parent;
+        float gScore;
+        bool closed;
+    };
+
+    struct OpenNode {
+        float fScore;
+        int index;
 
-static void restore_route(
-    Route& route,
-    const glm::ivec3& lastPos,
-    const std::unordered_map<glm::ivec3, Node>& parents
-) {
-    auto pos = lastPos;
-    while (true) {
-        const auto& found = parents.find(pos);
-        if (found == parents.end()) {
-            route.nodes.push_back({pos});
-            break;
+        /// @brief Heap order: lower fScore first, then earlier added node
+        bool operator<(const OpenNode& other) const {
+            return fScore > other.fScore ||
+                   (fScore == other.fScore && index > other.index);
         }
-        route.nodes.push_back({pos});
-        pos = found->second.pos;
-    }
-}
+    };
 
-int Pathfinding::createAgent() {
-    int id = nextAgent++;
-    agents[id] = Agent();
-    return id;
-}
+    /// @brief Open addressing map of nodes positions to nodes indices
+    class NodesMap {
+        struct Slot {
+            glm::ivec3 pos;
+            int index;
+        };
+        std::vector<Slot> slots;
+        size_t count = 0;
 
-bool Pathfinding::removeAgent(int id) {
-    auto found = agents.find(id);
-    if (found != agents.end()) {
-        agents.erase(found);
-        return true;
-    }
-    return false;
-}
+        static size_t hash(const glm::ivec3& pos) {
+            uint64_t h = static_cast<uint32_t>(pos.x) * 0x9E3779B97F4A7C15ULL;
+            h ^= static_cast<uint32_t>(pos.y) * 0xC2B2AE3D27D4EB4FULL;
+            h ^= static_cast<uint32_t>(pos.z) * 0x165667B19E3779F9ULL;
+            return h ^ (h >> 29);
+        }
 
-void Pathfinding::performAllAsync(int stepsPerAgent) {
-    for (auto& [_, agent] : agents) {
-        if (agent.state.finished) {
-            continue;
+        void grow() {
+            auto prev = std::move(slots);
+            slots.assign(prev.size() * 2, Slot {{}, -1});
+            for (const auto& slot : prev) {
+                if (slot.index != -1) {
+                    emplace(slot.pos, slot.index);
+                }
+            }
         }
-        perform(agent, stepsPerAgent);
-    }
+
+        void emplace(const glm::ivec3& pos, int index) {
+            size_t mask = slots.size() - 1;
+            size_t i = hash(pos) & mask;
+            while (slots[i].index != -1) {
+                i = (i + 1) & mask;
+            }
+            slots[i] = Slot {pos, index};
+        }
+    public:
+        NodesMap() : slots(1024, Slot {{}, -1}) {
+        }
+
+        /// @return node index or -1
+        int find(const glm::ivec3& pos) const {
+            size_t mask = slots.size() - 1;
+            size_t i = hash(pos) & mask;
+            while (slots[i].index != -1) {
+                if (slots[i].pos == pos) {
+                    return slots[i].index;
+                }
+                i = (i + 1) & mask;
+            }
+            return -1;
+        }
+
+        void insert(const glm::ivec3& pos, int index) {
+            if ((count + 1) * 2 > slots.size()) {
+                grow();
+            }
+            emplace(pos, index);
+            count++;
+        }
+    };
 }
 
-static Route finish_route(Agent& agent, State&& state) {
+/// @brief Route search state. Uses only chunks snapshots, so it may be
+/// performed in any thread
+struct voxels::Search {
+    const ContentUnitIndices<Block, blockid_t>& blockDefs;
+    int agentId;
+    uint64_t id;
+
+    bool mayBeIncomplete;
+    int height;
+    int jumpHeight;
+    int maxVisitedBlocks;
+    glm::ivec3 start;
+    glm::ivec3 target;
+    std::vector<std::pair<int, int>> avoidTags;
+
+    std::unordered_map<glm::ivec2, std::shared_ptr<const NavChunk>> chunks;
+    /// @brief Chunks required to continue the search
+    std::vector<glm::ivec2> missingChunks;
+
+    std::vector<SearchNode> nodes;
+    std::vector<OpenNode> open;
+    NodesMap nodesMap;
+    int nearest = 0;
+    float minHScore;
+    int closedCount = 0;
+
+    /// @brief Max visited blocks by the next run. -1 - unlimited
+    int steps = -1;
+    SearchStatus status = SearchStatus::RUNNING;
     Route route {};
-    restore_route(route, state.nearest, state.parents);
-    route.totalVisited = state.blocked.size();
-    route.nodes.push_back({agent.start});
-    route.found = true;
-    state.finished = true;
-    agent.state = std::move(state);
-    agent.route = route;
-    return route;
-}
 
-enum Passability {
-    NON_PASSABLE = -1,
-    OBSTACLE = 0,
-    PASSABLE = 1,
-};
+    Search(
+        const ContentUnitIndices<Block, blockid_t>& blockDefs,
+        int agentId,
+        uint64_t id,
+        const Agent& agent
+    )
+        : blockDefs(blockDefs),
+          agentId(agentId),
+          id(id),
+          mayBeIncomplete(agent.mayBeIncomplete),
+          height(agent.height),
+          jumpHeight(agent.jumpHeight),
+          maxVisitedBlocks(agent.maxVisitedBlocks),
+          start(agent.start),
+          target(agent.target),
+          avoidTags(agent.avoidTags.begin(), agent.avoidTags.end()) {
+        minHScore = heuristic(start, target);
+        nodes.push_back(SearchNode {start, -1, 0.0f, false});
+        nodesMap.insert(start, 0);
+        open.push_back(OpenNode {minHScore, 0});
 
-Route Pathfinding::perform(Agent& agent, int maxVisited) {
-    using namespace blocks_agent;
+        int cx = floordiv<CHUNK_W>(start.x);
+        int cz = floordiv<CHUNK_D>(start.z);
+        for (int dz = -1; dz <= 1; dz++) {
+            for (int dx = -1; dx <= 1; dx++) {
+                missingChunks.emplace_back(cx + dx, cz + dz);
+            }
+        }
+    }
 
-    State state = std::move(agent.state);
-    if (state.queue.empty()) {
-        state.queue.push(
-            {agent.start, {}, 0, heuristic(agent.start, agent.target)}
-        );
+    void provide(const glm::ivec2& pos, std::shared_ptr<const NavChunk> chunk) {
+        chunks[pos] = std::move(chunk);
+        lastChunkPos = {INT32_MIN, INT32_MIN};
     }
 
-    const auto& chunks = *level.chunks;
-    int height = std::max(agent.height, 1);
+    /// @brief Continue the search
+    SearchStatus run() {
+        while (!open.empty()) {
+            if (closedCount == maxVisitedBlocks) {
+                // incomplete route is returned even if !mayBeIncomplete
+                return finish();
+            }
+            if (steps == 0) {
+                return status = SearchStatus::RUNNING;
+            }
+            int index = open.front().index;
+            if (!requireChunks(nodes[index].pos)) {
+                return status = SearchStatus::SUSPENDED;
+            }
+            if (steps > 0) {
+                steps--;
+            }
+            std::pop_heap(open.begin(), open.end());
+            open.pop_back();
 
-    if (state.nearest == glm::ivec3(0)) {
-        state.nearest = agent.start;
-        state.minHScore = heuristic(agent.start, agent.target);
+            SearchNode node = nodes[index];
+            if (node.pos.x == target.x &&
+                glm::abs((node.pos.y - target.y) / std::max(height, 1)) == 0 &&
+                node.pos.z == target.z) {
+                return finish();
+            }
+            nodes[index].closed = true;
+            closedCount++;
+            expand(node, index);
+        }
+        return finish();
     }
-    int visited = -1;
+private:
+    glm::ivec2 lastChunkPos {INT32_MIN, INT32_MIN};
+    const NavChunk* lastChunk = nullptr;
 
-    while (!state.queue.empty()) {
-        if (state.blocked.size() == agent.maxVisitedBlocks) {
-            if (agent.mayBeIncomplete) {
-                return finish_route(agent, std::move(state));
+    /// @brief Check if snapshots of chunks around the node are available
+    bool requireChunks(const glm::ivec3& pos) {
+        for (int dz = -1; dz <= 1; dz += 2) {
+            for (int dx = -1; dx <= 1; dx += 2) {
+                glm::ivec2 chunkPos(
+                    floordiv<CHUNK_W>(pos.x + dx),
+                    floordiv<CHUNK_D>(pos.z + dz)
+                );
+                if (chunks.find(chunkPos) == chunks.end() &&
+                    std::find(
+                        missingChunks.begin(), missingChunks.end(), chunkPos
+                    ) == missingChunks.end()) {
+                    missingChunks.push_back(chunkPos);
+                }
             }
-            break;
         }
-        visited++;
-        if (visited == maxVisited) {
-            state.finished = false;
-            agent.state = std::move(state);
-            return {};
+        return missingChunks.empty();
+    }
+
+    /// @return chunk snapshot or nullptr if chunk is not loaded
+    const NavChunk* getChunk(int x, int z) {
+        glm::ivec2 chunkPos(floordiv<CHUNK_W>(x), floordiv<CHUNK_D>(z));
+        if (chunkPos != lastChunkPos) {
+            const auto& found = chunks.find(chunkPos);
+            lastChunk = found == chunks.end() ? nullptr : found->second.get();
+            lastChunkPos = chunkPos;
         }
+        return lastChunk;
+    }
 
-        auto node = state.queue.top();
-        state.queue.pop();
+    /// @brief Same as blocks_agent::is_obstacle_at
+    bool isObstacleAt(int x, int y, int z) {
+        if (y >= CHUNK_H) {
+            return false;
+        }
+        auto chunk = getChunk(x, z);
+        if (y < 0 || chunk == nullptr) {
+            return true;
+        }
+        return chunk->isObstacleAt(
+            x - chunk->x * CHUNK_W, y, z - chunk->z * CHUNK_D
+        );
+    }
 
-        if (node.pos.x == agent.target.x &&
-            glm::abs((node.pos.y - agent.target.y) / height) == 0 &&
-            node.pos.z == agent.target.z) {
-            return finish_route(agent, std::move(state));
+    bool checkPassability(
+        const glm::ivec3& pos, const glm::ivec2& offset, bool diagonal
+    ) {
+        if (!diagonal) {
+            return true;
         }
+        auto a = pos + glm::ivec3(offset.x, 0, 0);
+        auto b = pos + glm::ivec3(0, 0, offset.y);
 
-        state.blocked.emplace(node.pos);
-        glm::ivec2 neighbors[8] {
-            {0, 1},
-            {1, 0},
-            {0, -1},
-            {-1, 0},
-            {-1, -1},
-            {1, -1},
-            {1, 1},
-            {-1, 1},
-        };
+        for (int i = 0; i < height; i++) {
+            if (isObstacleAt(a.x, a.y + i, a.z)) return false;
+            if (isObstacleAt(b.x, b.y + i, b.z)) return false;
+        }
+        return true;
+    }
 
-        for (int i = 0; i < sizeof(neighbors) / sizeof(glm::ivec2); i++) {
-            auto offset = neighbors[i];
+    int checkPoint(int x, int y, int z, int& cost) {
+        if (y < 0 || y >= CHUNK_H) {
+            return OBSTACLE;
+        }
+        auto chunk = getChunk(x, z);
+        if (chunk == nullptr) {
+            return OBSTACLE;
+        }
+        const auto& def = blockDefs.require(
+            chunk->getId(x - chunk->x * CHUNK_W, y, z - chunk->z * CHUNK_D)
+        );
+        if (def.obstacle) {
+            return OBSTACLE;
+        }
+        for (const auto& pair : avoidTags) {
+            if (def.rt.tags.find(pair.first) != def.rt.tags.end()) {
+                cost = pair.second;
+                return NON_PASSABLE;
+            }
+        }
+        return PASSABLE;
+    }
+
+    int getSurfaceAt(const glm::ivec3& pos, int maxDelta, float& cost) {
+        int status;
+        int surface = pos.y;
+        int ncost = 0;
+        if ((status = checkPoint(pos.x, surface, pos.z, ncost)) == OBSTACLE) {
+            if ((status = checkPoint(pos.x, surface + 1, pos.z, ncost)) == OBSTACLE) {
+                return NON_PASSABLE;
+            } else if (status == NON_PASSABLE) {
+                cost += 5;
+            }
+            cost += ncost;
+            return surface + 1;
+        } else {
+            if (status == NON_PASSABLE) {
+                cost += 5;
+            }
+            if ((status = checkPoint(pos.x, surface - 1, pos.z, ncost)) == OBSTACLE) {
+                cost += ncost;
+                return surface;
+            } else if (status == NON_PASSABLE) {
+                cost += 5;
+            }
+            if ((status = checkPoint(pos.x, surface - 2, pos.z, ncost)) == OBSTACLE) {
+                cost += ncost;
+                return surface - 1;
+            }
+            return NON_PASSABLE;
+        }
+        return NON_PASSABLE;
+    }
+
+    void expand(const SearchNode& node, int index) {
+        for (int i = 0; i < sizeof(NEIGHBORS) / sizeof(glm::ivec2); i++) {
+            auto offset = NEIGHBORS[i];
             auto pos = node.pos;
 
-            float cost = glm::abs(node.pos.y - pos.y) * 10;
-            int surface = getSurfaceAt(
-                agent, pos + glm::ivec3(offset.x, 0, offset.y), 1, cost
-            );
+            float cost = 0.0f;
+            int surface =
+                getSurfaceAt(pos + glm::ivec3(offset.x, 0, offset.y), 1, cost);
 
             if (surface == NON_PASSABLE) {
                 continue;
             }
             pos.y = surface;
             auto point = pos + glm::ivec3(offset.x, 0, offset.y);
-            if (state.blocked.find(point) != state.blocked.end()) {
+            int found = nodesMap.find(point);
+            if (found != -1 && nodes[found].closed) {
                 continue;
             }
-
-            if (is_obstacle_at(
-                    chunks, pos.x, pos.y + agent.jumpHeight, pos.z
-                )) {
+            if (isObstacleAt(pos.x, pos.y + jumpHeight, pos.z)) {
                 continue;
             }
-            if (!check_passability(agent, chunks, node, offset, i >= 4)) {
+            if (!checkPassability(node.pos, offset, i >= 4)) {
+                continue;
+            }
+            if (found != -1) {
                 continue;
             }
-
             float sum = glm::abs(offset.x) + glm::abs(offset.y);
             float gScore = node.gScore + sum + cost;
-            const auto& found = state.parents.find(point);
-            if (found == state.parents.end()) {
-                float hScore = heuristic(point, agent.target);
-                if (hScore < state.minHScore) {
-                    state.minHScore = hScore;
-                    state.nearest = point;
-                }
-                float fScore = gScore * 0.75f + hScore;
-                Node nNode {point, node.pos, gScore, fScore};
-                state.parents[point] = node;
-                state.queue.push(nNode);
+            float hScore = heuristic(point, target);
+            int pointIndex = nodes.size();
+            if (hScore < minHScore) {
+                minHScore = hScore;
+                nearest = pointIndex;
             }
+            nodes.push_back(SearchNode {point, index, gScore, false});
+            nodesMap.insert(point, pointIndex);
+            open.push_back(OpenNode {gScore * 0.75f + hScore, pointIndex});
+            std::push_heap(open.begin(), open.end());
+        }
+    }
+
+    SearchStatus finish() {
+        route.found = true;
+        for (int index = nearest; index != -1; index = nodes[index].parent) {
+            route.nodes.push_back({nodes[index].pos});
         }
+        route.nodes.push_back({start});
+        route.totalVisited = closedCount;
+        return status = SearchStatus::FINISHED;
     }
-    state.finished = true;
-    agent.state = std::move(state);
-    return finish_route(agent, std::move(agent.state));
+};
+
+class PathfindingWorker : public util::Worker<
+                              std::shared_ptr<Search>,
+                              std::shared_ptr<Search>> {
+public:
+    std::shared_ptr<Search> operator()(
+        const std::shared_ptr<Search>& search
+    ) override {
+        search->run();
+        return search;
+    }
+};
+
+Pathfinding::Pathfinding(const Level& level, int workers)
+    : level(level),
+      navigation(std::make_unique<NavigationCache>(
+          *level.chunks, level.content.getIndices()->blocks
+      )) {
+    if (workers == 0) {
+        return;
+    }
+    threadPool = std::make_unique<util::ThreadPool<SearchPtr, SearchPtr>>(
+        "pathfinding",
+        []() { return std::make_unique<PathfindingWorker>(); },
+        [this](SearchPtr&& search) { searches.push_back(std::move(search)); },
+        workers
+    );
 }
 
-Agent* Pathfinding::getAgent(int id) {
-    const auto& found = agents.find(id);
+Pathfinding::~Pathfinding() = default;
+
+int Pathfinding::createAgent() {
+    int id = nextAgent++;
+    agents[id] = Agent();
+    return id;
+}
+
+bool Pathfinding::removeAgent(int id) {
+    auto found = agents.find(id);
     if (found != agents.end()) {
-        return &found->second;
+        agents.erase(found);
+        return true;
     }
-    return nullptr;
+    return false;
 }
 
-const std::unordered_map<int, Agent>& Pathfinding::getAgents() const {
-    return agents;
+Pathfinding::SearchPtr Pathfinding::createSearch(int agentId, Agent& agent) {
+    agent.searchId = nextSearch++;
+    auto search = std::make_shared<Search>(
+        level.content.getIndices()->blocks, agentId, agent.searchId, agent
+    );
+    fulfil(*search);
+    return search;
 }
 
-int Pathfinding::checkPoint(const Agent& agent, int x, int y, int z, int& cost) {
-    auto vox = blocks_agent::get(chunks, x, y, z);
-    if (vox == nullptr) {
-        return OBSTACLE;
+void Pathfinding::fulfil(Search& search) {
+    for (const auto& pos : search.missingChunks) {
+        search.provide(pos, navigation->get(pos.x, pos.y));
     }
-    const auto& def = blockDefs.require(vox->id);
-    if (def.obstacle) {
-        return OBSTACLE;
-    }
-    for (const auto& pair : agent.avoidTags) {
-        if (def.rt.tags.find(pair.first) != def.rt.tags.end()) {
-            cost = pair.second;
-            return NON_PASSABLE;
-        }
+    search.missingChunks.clear();
+}
+
+void Pathfinding::finish(Search& search) {
+    auto agent = getAgent(search.agentId);
+    if (agent == nullptr || agent->searchId != search.id) {
+        return;
     }
-    return PASSABLE;
+    agent->route = std::move(search.route);
+    agent->finished = true;
 }
 
-int Pathfinding::getSurfaceAt(
-    const Agent& agent, const glm::ivec3& pos, int maxDelta, float& cost
-) {
-    using namespace blocks_agent;
+void Pathfinding::performAsync(int agentId) {
+    auto agent = getAgent(agentId);
+    if (agent == nullptr) {
+        return;
+    }
+    agent->finished = false;
+    searches.push_back(createSearch(agentId, *agent));
+}
 
-    int status;
-    int surface = pos.y;
-    int ncost = 0;
-    if ((status = checkPoint(agent, pos.x, surface, pos.z, ncost)) == OBSTACLE) {
-        if ((status = checkPoint(agent, pos.x, surface + 1, pos.z, ncost)) == OBSTACLE) {
-            return NON_PASSABLE;
-        } else if (status == NON_PASSABLE) {
-            cost += 5;
+void Pathfinding::update(int stepsPerAgent) {
+    if (threadPool) {
+        threadPool->pullResults();
+    }
+    auto current = std::move(searches);
+    searches.clear();
+    for (auto& search : current) {
+        auto agent = getAgent(search->agentId);
+        if (agent == nullptr || agent->searchId != search->id) {
+            // cancelled
+            continue;
         }
-        cost += ncost;
-        return surface + 1;
-    } else {
-        if (status == NON_PASSABLE) {
-            cost += 5;
+        if (search->status == SearchStatus::FINISHED) {
+            finish(*search);
+            continue;
         }
-        if ((status = checkPoint(agent, pos.x, surface - 1, pos.z, ncost)) == OBSTACLE) {
-            cost += ncost;
-            return surface;
-        } else if (status == NON_PASSABLE) {
-            cost += 5;
+        fulfil(*search);
+        search->steps = stepsPerAgent;
+        if (threadPool) {
+            threadPool->enqueueJob(std::move(search));
+            continue;
         }
-        if ((status = checkPoint(agent, pos.x, surface - 2, pos.z, ncost)) == OBSTACLE) {
-            cost += ncost;
-            return surface - 1;
+        while (search->run() == SearchStatus::SUSPENDED) {
+            fulfil(*search);
         }
-        return NON_PASSABLE;
+        if (search->status == SearchStatus::FINISHED) {
+            finish(*search);
+        } else {
+            searches.push_back(std::move(search));
+        }
+    }
+    if (navigation->size() > MAX_CACHED_CHUNKS) {
+        navigation->cleanup();
+    }
+}
+
+Route Pathfinding::perform(Agent& agent) {
+    auto search = createSearch(-1, agent);
+    while (search->run() == SearchStatus::SUSPENDED) {
+        fulfil(*search);
+    }
+    agent.route = std::move(search->route);
+    agent.finished = true;
+    return agent.route;
+}
+
+Agent* Pathfinding::getAgent(int id) {
+    const auto& found = agents.find(id);
+    if (found != agents.end()) {
+        return &found->second;
     }
-    return NON_PASSABLE;
+    return nullptr;
+}
+
+const std::unordered_map<int, Agent>& Pathfinding::getAgents() const {
+    return agents;
 }
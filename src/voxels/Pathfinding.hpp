@@ -1,26 +1,24 @@
 #pragma once
 
-#define GLM_ENABLE_EXPERIMENTAL
-#include <glm/gtx/hash.hpp>
-#include <glm/vec2.hpp>
 #include <glm/vec3.hpp>
 #include <memory>
-#include <queue>
 #include <set>
 #include <unordered_map>
-#include <unordered_set>
 #include <vector>
 
 #include "typedefs.hpp"
 
-class Block;
 class Level;
-class GlobalChunks;
 
-template <typename T, typename IdType>
-class ContentUnitIndices;
+namespace util {
+    template <class T, class R>
+    class ThreadPool;
+}
 
 namespace voxels {
+    class NavigationCache;
+    struct Search;
+
     struct RouteNode {
         glm::ivec3 pos;
     };
@@ -31,28 +29,6 @@ namespace voxels {
         int totalVisited;
     };
 
-    struct Node {
-        glm::ivec3 pos;
-        glm::ivec3 parent;
-        float gScore;
-        float fScore;
-    };
-
-    struct NodeLess {
-        bool operator()(const Node& l, const Node& r) const {
-            return l.fScore > r.fScore;
-        }
-    };
-
-    struct State {
-        std::priority_queue<Node, std::vector<Node>, NodeLess> queue;
-        std::unordered_set<glm::ivec3> blocked;
-        std::unordered_map<glm::ivec3, Node> parents;
-        glm::ivec3 nearest;
-        float minHScore;
-        bool finished = true;
-    };
-
     struct Agent {
         bool enabled = false;
         bool mayBeIncomplete = true;
@@ -62,36 +38,59 @@ namespace voxels {
         glm::ivec3 start;
         glm::ivec3 target;
         Route route;
-        State state {};
+        /// @brief Route search is finished, so the route may be pulled
+        bool finished = true;
+        /// @brief Id of the last started route search
+        uint64_t searchId = 0;
         std::set<std::pair<int, int>> avoidTags;
     };
 
+    /// @brief Agents routes search. Async searches are performed by worker
+    /// threads on chunks snapshots. Search is suspended until the main
+    /// thread provides snapshots of chunks it reached
     class Pathfinding {
     public:
-        Pathfinding(const Level& level);
+        /// @param workers max number of async search workers.
+        /// 0 - search in the main thread
+        Pathfinding(const Level& level, int workers);
+        ~Pathfinding();
 
         int createAgent();
 
         bool removeAgent(int id);
 
-        void performAllAsync(int stepsPerAgent);
+        /// @brief Start async route search. Previous agent search is
+        /// cancelled
+        void performAsync(int agentId);
 
-        Route perform(Agent& agent, int maxVisited = -1);
+        /// @brief Continue async searches and deliver finished routes
+        /// @param stepsPerAgent max visited blocks by an agent search
+        void update(int stepsPerAgent);
+
+        /// @brief Find route in the current thread
+        Route perform(Agent& agent);
 
         Agent* getAgent(int id);
 
         const std::unordered_map<int, Agent>& getAgents() const;
     private:
+        using SearchPtr = std::shared_ptr<Search>;
+
         const Level& level;
-        const GlobalChunks& chunks;
-        const ContentUnitIndices<Block, blockid_t>& blockDefs;
+        std::unique_ptr<NavigationCache> navigation;
+        std::unique_ptr<util::ThreadPool<SearchPtr, SearchPtr>> threadPool;
+        /// @brief Async searches not being processed by workers
+        std::vector<SearchPtr> searches;
         std::unordered_map<int, Agent> agents;
+        uint64_t nextSearch = 1;
         int nextAgent = 1;
 
-        int getSurfaceAt(
-            const Agent& agent, const glm::ivec3& pos, int maxDelta, float& cost
-        );
+        SearchPtr createSearch(int agentId, Agent& agent);
+
+        /// @brief Provide snapshots of chunks requested by the search
+        void fulfil(Search& search);
 
-        int checkPoint(const Agent& agent, int x, int y, int z, int& cost);
+        /// @brief Set agent route if the search is still actual
+        void finish(Search& search);
     };
 }
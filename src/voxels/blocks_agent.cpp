@@ -36,7 +36,7 @@ static void on_chunk_register_event(
     uint8_t flagsCache[1024] {};
 
     for (int i = totalBegin; i < totalEnd; i++) {
-        blockid_t id = voxels[i].id;
+        blockid_t id = voxels.get(i).id;
         uint8_t bits = id < sizeof(flagsCache) ? flagsCache[id] : 0;
         if ((bits & 0x80) == 0) {
             const auto& def = indices.blocks.require(id);
@@ -72,20 +72,20 @@ void blocks_agent::on_chunk_remove(
 
 template <class Storage>
 static void mark_neighboirs_modified(
-    Storage& chunks, int32_t cx, int32_t cz, int32_t lx, int32_t lz
+    Storage& chunks, int32_t cx, int32_t cz, int32_t lx, int32_t y, int32_t lz
 ) {
     Chunk* chunk;
     if (lx == 0 && (chunk = get_chunk(chunks, cx - 1, cz))) {
-        chunk->flags.modified = true;
+        chunk->setModified(y);
     }
     if (lz == 0 && (chunk = get_chunk(chunks, cx, cz - 1))) {
-        chunk->flags.modified = true;
+        chunk->setModified(y);
     }
     if (lx == CHUNK_W - 1 && (chunk = get_chunk(chunks, cx + 1, cz))) {
-        chunk->flags.modified = true;
+        chunk->setModified(y);
     }
     if (lz == CHUNK_D - 1 && (chunk = get_chunk(chunks, cx, cz + 1))) {
-        chunk->flags.modified = true;
+        chunk->setModified(y);
     }
 }
 
@@ -147,13 +147,13 @@ static void initialize_block(
     const auto& def = indices.blocks.require(id);
     vox.id = id;
     vox.state = state;
-    chunk.setModifiedAndUnsaved();
+    chunk.setModifiedAndUnsaved(y);
     if (!state.segment && def.rt.extended) {
         restore_segments(chunks, def, state, x, y, z);
     }
 
     refresh_chunk_heights(chunk, id == BLOCK_AIR, y);
-    mark_neighboirs_modified(chunks, cx, cz, lx, lz);
+    mark_neighboirs_modified(chunks, cx, cz, lx, y, lz);
 
     uint8_t bits = get_events_bits(def);
     if (bits == 0) {
@@ -185,7 +185,7 @@ static inline bool set_block(
     int lx = x - cx * CHUNK_W;
     int lz = z - cz * CHUNK_D;
 
-    voxel& vox = chunk->voxels[(y * CHUNK_D + lz) * CHUNK_W + lx];
+    voxel& vox = chunk->voxels.at((y * CHUNK_D + lz) * CHUNK_W + lx);
 
     finalize_block(chunks, *chunk, vox, x, y, z, lx, lz);
     initialize_block(chunks, *chunk, vox, id, state, x, y, z, lx, lz, cx, cz);
@@ -214,8 +214,122 @@ bool blocks_agent::set(
     return set_block(chunks, x, y, z, id, state);
 }
 
+/// @brief Mark neighbour chunks modified if the box of changed voxels
+/// touches the chunk borders
+/// @param min,max box of changed voxels in chunk local coordinates
 template <class Storage>
-static inline voxel* raycast_blocks(
+static void mark_box_neighbours_modified(
+    Storage& chunks,
+    const Chunk& chunk,
+    const glm::ivec3& min,
+    const glm::ivec3& max
+) {
+    int cx = chunk.x;
+    int cz = chunk.z;
+    Chunk* neighbour;
+    if (min.x == 0 && (neighbour = get_chunk(chunks, cx - 1, cz))) {
+        neighbour->setModified(min.y, max.y);
+    }
+    if (min.z == 0 && (neighbour = get_chunk(chunks, cx, cz - 1))) {
+        neighbour->setModified(min.y, max.y);
+    }
+    if (max.x == CHUNK_W - 1 && (neighbour = get_chunk(chunks, cx + 1, cz))) {
+        neighbour->setModified(min.y, max.y);
+    }
+    if (max.z == CHUNK_D - 1 && (neighbour = get_chunk(chunks, cx, cz + 1))) {
+        neighbour->setModified(min.y, max.y);
+    }
+}
+
+size_t blocks_agent::set_box(
+    GlobalChunks& chunks,
+    const glm::ivec3& pos,
+    const glm::ivec3& size,
+    const std::function<bool(size_t, voxel&)>& func
+) {
+    int y1 = std::max(pos.y, 0);
+    int y2 = std::min(pos.y + size.y, CHUNK_H);
+    if (y1 >= y2 || size.x <= 0 || size.z <= 0) {
+        return 0;
+    }
+    const auto& blocks = chunks.getContentIndices().blocks;
+    int cx1 = floordiv<CHUNK_W>(pos.x);
+    int cz1 = floordiv<CHUNK_D>(pos.z);
+    int cx2 = floordiv<CHUNK_W>(pos.x + size.x - 1);
+    int cz2 = floordiv<CHUNK_D>(pos.z + size.z - 1);
+    size_t count = 0;
+    for (int cz = cz1; cz <= cz2; cz++) {
+        for (int cx = cx1; cx <= cx2; cx++) {
+            Chunk* chunk = get_chunk(chunks, cx, cz);
+            if (chunk == nullptr) {
+                continue;
+            }
+            int x1 = std::max(pos.x, cx * CHUNK_W);
+            int x2 = std::min(pos.x + size.x, (cx + 1) * CHUNK_W);
+            int z1 = std::max(pos.z, cz * CHUNK_D);
+            int z2 = std::min(pos.z + size.z, (cz + 1) * CHUNK_D);
+            // bounds of voxels set in the chunk (local coordinates)
+            glm::ivec3 min(CHUNK_W, CHUNK_H, CHUNK_D);
+            glm::ivec3 max(-1);
+            bool anyAir = false;
+            for (int y = y1; y < y2; y++) {
+                for (int z = z1; z < z2; z++) {
+                    int lz = z - cz * CHUNK_D;
+                    size_t index =
+                        (static_cast<size_t>(y - pos.y) * size.z + z - pos.z) *
+                            size.x + x1 - pos.x;
+                    for (int x = x1; x < x2; x++, index++) {
+                        int lx = x - cx * CHUNK_W;
+                        uint voxIndex = vox_index(lx, y, lz);
+                        const voxel& current = chunk->voxels.get(voxIndex);
+                        voxel target = current;
+                        if (!func(index, target) ||
+                            (target.id == current.id &&
+                             blockstate2int(target.state) ==
+                                 blockstate2int(current.state))) {
+                            continue;
+                        }
+                        const auto& prevDef = blocks.require(current.id);
+                        const auto& def = blocks.require(target.id);
+                        count++;
+                        if (prevDef.rt.extended || def.rt.extended) {
+                            set_block(
+                                chunks, x, y, z, target.id, target.state
+                            );
+                            continue;
+                        }
+                        voxel& vox = chunk->voxels.at(voxIndex);
+                        finalize_block(chunks, *chunk, vox, x, y, z, lx, lz);
+                        vox = target;
+
+                        min = glm::min(min, glm::ivec3(lx, y, lz));
+                        max = glm::max(max, glm::ivec3(lx, y, lz));
+                        anyAir |= target.id == BLOCK_AIR;
+
+                        if (uint8_t bits = get_events_bits(def)) {
+                            block_register_events.push_back(BlockRegisterEvent {
+                                static_cast<uint8_t>(bits | 1),
+                                def.rt.id,
+                                {x, y, z}
+                            });
+                        }
+                    }
+                }
+            }
+            if (max.y < 0) {
+                continue;
+            }
+            chunk->setModifiedAndUnsaved(min.y, max.y);
+            refresh_chunk_heights(*chunk, anyAir, min.y);
+            refresh_chunk_heights(*chunk, anyAir, max.y);
+            mark_box_neighbours_modified(chunks, *chunk, min, max);
+        }
+    }
+    return count;
+}
+
+template <class Storage>
+static inline const voxel* raycast_blocks(
     const Storage& chunks,
     const glm::vec3& start,
     const glm::vec3& dir,
@@ -261,7 +375,7 @@ static inline voxel* raycast_blocks(
     int steppedIndex = -1;
 
     while (t <= maxDist) {
-        voxel* voxel = get(chunks, ix, iy, iz);
+        const voxel* voxel = get(chunks, ix, iy, iz);
         if (voxel == nullptr) {
             return nullptr;
         }
@@ -357,7 +471,7 @@ static inline voxel* raycast_blocks(
     return nullptr;
 }
 
-voxel* blocks_agent::raycast(
+const voxel* blocks_agent::raycast(
     const Chunks& chunks,
     const glm::vec3& start,
     const glm::vec3& dir,
@@ -371,7 +485,7 @@ voxel* blocks_agent::raycast(
     return raycast_blocks(chunks, start, dir, maxDist, end, norm, iend, filter, includeNonSelectable);
 }
 
-voxel* blocks_agent::raycast(
+const voxel* blocks_agent::raycast(
     const GlobalChunks& chunks,
     const glm::vec3& start,
     const glm::vec3& dir,
@@ -432,7 +546,7 @@ inline void get_voxels_impl(
                     }
                 }
             } else {
-                const voxel* cvoxels = chunk->voxels;
+                const auto& cvoxels = chunk->voxels;
                 const light_t* clights =
                     chunk->lightmap ? chunk->lightmap->getLights() : nullptr;
                 for (int ly = y; ly < y + h; ly++) {
@@ -450,7 +564,7 @@ inline void get_voxels_impl(
                                 CHUNK_W,
                                 CHUNK_D
                             );
-                            voxels[vidx] = cvoxels[cidx];
+                            voxels[vidx] = cvoxels.get(cidx);
                             light_t light = clights ? clights[cidx]
                                                     : Lightmap::SUN_LIGHT_ONLY;
                             if (backlight) {
@@ -14,6 +14,7 @@
 #include "VoxelsVolume.hpp"
 
 #include <algorithm>
+#include <functional>
 #include <glm/glm.hpp>
 #include <set>
 #include <stdexcept>
@@ -49,8 +50,37 @@ inline Chunk* get_chunk(const Storage& chunks, int cx, int cz) {
     return chunks.getChunk(cx, cz);
 }
 
-/// @brief Get voxel at specified position.
-/// Returns nullptr if voxel does not exists. 
+/// @brief Get voxel at specified position without expanding compact chunk
+/// sections. Safe to call from multiple threads while chunks are not modified.
+/// Returns nullptr if voxel does not exists.
+/// @tparam Storage chunks storage class
+/// @param chunks chunks storage
+/// @param x position X
+/// @param y position Y
+/// @param z position Z
+/// @return voxel pointer or nullptr
+template<class Storage>
+inline const voxel* get(
+    const Storage& chunks, int32_t x, int32_t y, int32_t z
+) {
+    if (y < 0 || y >= CHUNK_H) {
+        return nullptr;
+    }
+    int cx = floordiv<CHUNK_W>(x);
+    int cz = floordiv<CHUNK_D>(z);
+    const Chunk* chunk = get_chunk(chunks, cx, cz);
+    if (chunk == nullptr) {
+        return nullptr;
+    }
+    int lx = x - cx * CHUNK_W;
+    int lz = z - cz * CHUNK_D;
+    return &chunk->voxels.get((y * CHUNK_D + lz) * CHUNK_W + lx);
+}
+
+/// @brief Get mutable voxel at specified position. Compact chunk section
+/// gets expanded, so use it only to modify the voxel.
+/// Chunk is not marked modified.
+/// Returns nullptr if voxel does not exists.
 /// @tparam Storage chunks storage class
 /// @param chunks chunks storage
 /// @param x position X
@@ -58,7 +88,9 @@ inline Chunk* get_chunk(const Storage& chunks, int cx, int cz) {
 /// @param z position Z
 /// @return voxel pointer or nullptr
 template<class Storage>
-inline voxel* get(const Storage& chunks, int32_t x, int32_t y, int32_t z) {
+inline voxel* get_mutable(
+    const Storage& chunks, int32_t x, int32_t y, int32_t z
+) {
     if (y < 0 || y >= CHUNK_H) {
         return nullptr;
     }
@@ -70,7 +102,7 @@ inline voxel* get(const Storage& chunks, int32_t x, int32_t y, int32_t z) {
     }
     int lx = x - cx * CHUNK_W;
     int lz = z - cz * CHUNK_D;
-    return &chunk->voxels[(y * CHUNK_D + lz) * CHUNK_W + lx];
+    return &chunk->voxels.at((y * CHUNK_D + lz) * CHUNK_W + lx);
 }
 
 /// @brief Get voxel at specified position.
@@ -82,7 +114,7 @@ inline voxel* get(const Storage& chunks, int32_t x, int32_t y, int32_t z) {
 /// @param z position Z
 /// @return voxel reference
 template<class Storage>
-inline voxel& require(const Storage& chunks, int32_t x, int32_t y, int32_t z) {
+inline const voxel& require(const Storage& chunks, int32_t x, int32_t y, int32_t z) {
     auto vox = get(chunks, x, y, z);
     if (vox == nullptr) {
         throw std::runtime_error("voxel does not exist");
@@ -161,6 +193,72 @@ bool set(
     blockstate state
 );
 
+/// @brief Visit voxels in the box chunk by chunk without expanding compact
+/// chunk sections. Voxels of chunks not loaded are skipped.
+/// @tparam Storage chunks storage class
+/// @param chunks chunks storage
+/// @param pos box minimal position
+/// @param size box size
+/// @param func called with voxel index in the box
+/// ((y * size.z + z) * size.x + x) and the voxel
+template <class Storage, class Func>
+inline void visit_box(
+    const Storage& chunks,
+    const glm::ivec3& pos,
+    const glm::ivec3& size,
+    const Func& func
+) {
+    int y1 = std::max(pos.y, 0);
+    int y2 = std::min(pos.y + size.y, CHUNK_H);
+    if (y1 >= y2 || size.x <= 0 || size.z <= 0) {
+        return;
+    }
+    int cx1 = floordiv<CHUNK_W>(pos.x);
+    int cz1 = floordiv<CHUNK_D>(pos.z);
+    int cx2 = floordiv<CHUNK_W>(pos.x + size.x - 1);
+    int cz2 = floordiv<CHUNK_D>(pos.z + size.z - 1);
+    for (int cz = cz1; cz <= cz2; cz++) {
+        for (int cx = cx1; cx <= cx2; cx++) {
+            const Chunk* chunk = get_chunk(chunks, cx, cz);
+            if (chunk == nullptr) {
+                continue;
+            }
+            int x1 = std::max(pos.x, cx * CHUNK_W);
+            int x2 = std::min(pos.x + size.x, (cx + 1) * CHUNK_W);
+            int z1 = std::max(pos.z, cz * CHUNK_D);
+            int z2 = std::min(pos.z + size.z, (cz + 1) * CHUNK_D);
+            for (int y = y1; y < y2; y++) {
+                for (int z = z1; z < z2; z++) {
+                    size_t index =
+                        (static_cast<size_t>(y - pos.y) * size.z + z - pos.z) *
+                            size.x + x1 - pos.x;
+                    uint voxIndex =
+                        vox_index(x1 - cx * CHUNK_W, y, z - cz * CHUNK_D);
+                    for (int x = x1; x < x2; x++) {
+                        func(index++, chunk->voxels.get(voxIndex++));
+                    }
+                }
+            }
+        }
+    }
+}
+
+/// @brief Set blocks in the box. Chunks are marked modified and unsaved
+/// once per chunk. Extended blocks are set one by one.
+/// Voxels of chunks not loaded are skipped.
+/// @param chunks chunks storage
+/// @param pos box minimal position
+/// @param size box size
+/// @param func called with voxel index in the box (see visit_box) and
+/// copy of the voxel. Returns true if the modified voxel must be set
+/// @return number of blocks set
+size_t set_box(
+    GlobalChunks& chunks,
+    const glm::ivec3& pos,
+    const glm::ivec3& size,
+    const std::function<bool(size_t, voxel&)>& func
+);
+
 /// @brief Erase extended block segments
 /// @tparam Storage chunks storage class
 /// @param chunks chunks storage
@@ -342,7 +440,7 @@ inline void set_rotation_extended(
                 blockstate segState = newstate;
                 segState.segment = segment_to_int(sx, sy, sz);
 
-                auto vox = get(chunks, pos.x, pos.y, pos.z);
+                auto vox = get_mutable(chunks, pos.x, pos.y, pos.z);
                 // checked for nullptr by checkReplaceability
                 if (vox->id != def.rt.id) {
                     set(chunks, pos.x, pos.y, pos.z, def.rt.id, segState);
@@ -352,7 +450,7 @@ inline void set_rotation_extended(
                     int cz = floordiv<CHUNK_D>(pos.z);
                     auto chunk = get_chunk(chunks, cx, cz);
                     assert(chunk != nullptr);
-                    chunk->setModifiedAndUnsaved();
+                    chunk->setModifiedAndUnsaved(pos.y);
                     segmentBlocks.emplace_back(pos);
                 }
             }
@@ -403,12 +501,12 @@ inline void set_rotation(
         vox = get(chunks, origin.x, origin.y, origin.z);
         set_rotation_extended(chunks, def, vox->state, origin, index);
     } else {
-        vox->state.rotation = index;
+        get_mutable(chunks, x, y, z)->state.rotation = index;
         int cx = floordiv<CHUNK_W>(x);
         int cz = floordiv<CHUNK_D>(z);
         auto chunk = get_chunk(chunks, cx, cz);
         assert(chunk != nullptr);
-        chunk->setModifiedAndUnsaved();
+        chunk->setModifiedAndUnsaved(y);
     }
 }
 
@@ -423,7 +521,7 @@ inline void set_rotation(
 /// @param filter filtered ids
 /// @param includeNonSelectable will non-selectable blocks be included
 /// @return voxel pointer or nullptr
-voxel* raycast(
+const voxel* raycast(
     const Chunks& chunks,
     const glm::vec3& start,
     const glm::vec3& dir,
@@ -446,7 +544,7 @@ voxel* raycast(
 /// @param filter filtered ids
 /// @param includeNonSelectable will non-selectable blocks be included
 /// @return voxel pointer or nullptr
-voxel* raycast(
+const voxel* raycast(
     const GlobalChunks& chunks,
     const glm::vec3& start,
     const glm::vec3& dir,
@@ -473,7 +571,7 @@ inline std::optional<AABB> is_obstacle_at(
     int ix = std::floor(x);
     int iy = std::floor(y);
     int iz = std::floor(z);
-    voxel* v = get(chunks, ix, iy, iz);
+    const voxel* v = get(chunks, ix, iy, iz);
     if (v == nullptr) {
         if (iy >= CHUNK_H) {
             return std::nullopt;
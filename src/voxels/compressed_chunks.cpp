@@ -6,47 +6,139 @@
 #include "world/files/WorldFiles.hpp"
 #include "content/Content.hpp"
 
+#include <cstring>
+
 inline constexpr int HAS_VOXELS = 0x1;
 inline constexpr int HAS_METADATA = 0x2;
+/// @brief Voxels are extrle16 compressed only (region data passthrough)
+inline constexpr int VOXELS_RLE = 0x4;
+/// @brief Voxels data contains only sections listed in the sections mask
+inline constexpr int VOXELS_SECTIONS = 0x8;
 
-std::vector<ubyte> compressed_chunks::encode(
+static void put_voxel_data(
+    ByteBuilder& builder,
     const ubyte* data,
-    const BlocksMetadata& metadata,
+    size_t size,
     util::Buffer<ubyte>& rleBuffer
 ) {
-    size_t rleCompressedSize =
-        extrle::encode16(data, CHUNK_DATA_LEN, rleBuffer.data());
+    size_t rleCompressedSize = extrle::encode16(data, size, rleBuffer.data());
 
     const auto gzipCompressedData = gzip::compress(
         rleBuffer.data(), rleCompressedSize
     );
-    auto metadataBytes = metadata.serialize();
-
-    ByteBuilder builder(2 + 8 + gzipCompressedData.size() + metadataBytes.size());
-    builder.put(HAS_VOXELS | HAS_METADATA); // flags
-    builder.put(0); // reserved
     builder.putInt32(gzipCompressedData.size());
     builder.put(gzipCompressedData.data(), gzipCompressedData.size());
+}
+
+static void put_metadata(ByteBuilder& builder, const BlocksMetadata& metadata) {
+    auto metadataBytes = metadata.serialize();
     builder.putInt32(metadataBytes.size());
     builder.put(metadataBytes.data(), metadataBytes.size());
+}
+
+std::vector<ubyte> compressed_chunks::encode(
+    const ubyte* data,
+    const BlocksMetadata& metadata,
+    util::Buffer<ubyte>& rleBuffer
+) {
+    ByteBuilder builder;
+    builder.put(HAS_VOXELS | HAS_METADATA); // flags
+    builder.put(0); // reserved
+    put_voxel_data(builder, data, CHUNK_DATA_LEN, rleBuffer);
+    put_metadata(builder, metadata);
     return builder.build();
 }
 
 std::vector<ubyte> compressed_chunks::encode(const Chunk& chunk) {
-    auto data = chunk.encode();
+    return encode(chunk, 0);
+}
 
+std::vector<ubyte> compressed_chunks::encode(
+    const Chunk& chunk, uint64_t sinceRevision
+) {
     /// world.get_chunk_data is only available in the main Lua state
+    static util::Buffer<ubyte> voxelData(CHUNK_DATA_LEN);
     static util::Buffer<ubyte> rleBuffer(CHUNK_DATA_LEN * 2);
-    return encode(data.get(), chunk.blocksMetadata, rleBuffer);
+
+    uint16_t sections = chunk.getSectionsChangedSince(sinceRevision);
+
+    ByteBuilder builder;
+    if (sections == Chunk::ALL_SECTIONS) {
+        builder.put(HAS_VOXELS | HAS_METADATA);
+        builder.put(0);
+    } else if (sections) {
+        builder.put(HAS_VOXELS | HAS_METADATA | VOXELS_SECTIONS);
+        builder.put(0);
+        builder.putInt16(static_cast<int16_t>(sections));
+    } else {
+        builder.put(HAS_METADATA);
+        builder.put(0);
+    }
+    if (sections) {
+        size_t size = chunk.encode(sections, voxelData.data());
+        put_voxel_data(builder, voxelData.data(), size, rleBuffer);
+    }
+    put_metadata(builder, chunk.blocksMetadata);
+    return builder.build();
 }
 
-static void read_voxel_data(ByteReader& reader, util::Buffer<ubyte>& dst) {
-    size_t gzipCompressedSize = reader.getInt32();
-        
-    auto rleData = gzip::decompress(reader.pointer(), gzipCompressedSize);
-    reader.skip(gzipCompressedSize);
+std::vector<ubyte> compressed_chunks::encode(
+    int x, int z, WorldRegions& regions
+) {
+    if (regions.getCompression(REGION_LAYER_VOXELS) !=
+        compression::Method::EXTRLE16) {
+        auto voxelData = std::make_unique<ubyte[]>(CHUNK_DATA_LEN);
+        if (!regions.getVoxels(x, z, voxelData.get())) {
+            return {};
+        }
+        util::Buffer<ubyte> rleBuffer(CHUNK_DATA_LEN * 2);
+        return encode(voxelData.get(), regions.getBlocksData(x, z), rleBuffer);
+    }
+    ByteBuilder builder;
+    builder.put(HAS_VOXELS | HAS_METADATA | VOXELS_RLE);
+    builder.put(0);
+    auto passthrough = [&](auto data, auto) {
+        builder.putInt32(data.size());
+        builder.put(data.data(), data.size());
+    };
+    if (!regions.processData(x, z, REGION_LAYER_VOXELS, passthrough)) {
+        return {};
+    }
+    // blocks data layer is not compressed
+    if (!regions.processData(x, z, REGION_LAYER_BLOCKS_DATA, passthrough)) {
+        put_metadata(builder, BlocksMetadata());
+    }
+    return builder.build();
+}
+
+static void read_voxel_data(
+    ByteReader& reader, ubyte flags, ubyte* dst, size_t size
+) {
+    size_t compressedSize = reader.getInt32();
+    const ubyte* src = reader.pointer();
+    if (compressedSize > reader.remaining()) {
+        throw std::runtime_error("voxels data is out of bounds");
+    }
+    reader.skip(compressedSize);
 
-    extrle::decode16(rleData.data(), rleData.size(), dst.data(), dst.size());
+    size_t decodedSize;
+    if (flags & VOXELS_RLE) {
+        decodedSize = extrle::decode16(src, compressedSize, dst, size);
+    } else {
+        auto rleData = gzip::decompress(src, compressedSize);
+        decodedSize =
+            extrle::decode16(rleData.data(), rleData.size(), dst, size);
+    }
+    if (decodedSize != size) {
+        throw std::runtime_error("invalid voxels data size");
+    }
+}
+
+static uint16_t read_sections(ByteReader& reader, ubyte flags) {
+    if (flags & VOXELS_SECTIONS) {
+        return static_cast<uint16_t>(reader.getInt16());
+    }
+    return Chunk::ALL_SECTIONS;
 }
 
 void compressed_chunks::decode(
@@ -60,11 +152,13 @@ void compressed_chunks::decode(
     if (flags & HAS_VOXELS) {
         /// world.get_chunk_data is only available in the main Lua state
         static util::Buffer<ubyte> voxelData (CHUNK_DATA_LEN);
-        read_voxel_data(reader, voxelData);
-        // TODO: move somewhere in Chunk
+        uint16_t sections = read_sections(reader, flags);
+        size_t volume = Chunk::countSections(sections) * CHUNK_SECTION_VOL;
+        read_voxel_data(reader, flags, voxelData.data(), volume * 4);
+
         auto src = reinterpret_cast<const uint16_t*>(voxelData.data());
-        for (size_t i = 0; i < CHUNK_VOL; i++) {
-            blockid_t id = dataio::le2h(src[i]);;
+        for (size_t i = 0; i < volume; i++) {
+            blockid_t id = dataio::le2h(src[i]);
             if (indices.blocks.get(id) == nullptr) {
                 throw std::runtime_error(
                     "block data corruption (chunk: " + std::to_string(chunk.x) +
@@ -73,7 +167,7 @@ void compressed_chunks::decode(
                 );
             }
         }
-        chunk.decode(voxelData.data());
+        chunk.decode(voxelData.data(), sections);
         chunk.updateHeights();
     }
     if (flags & HAS_METADATA) {
@@ -84,6 +178,28 @@ void compressed_chunks::decode(
     chunk.setModifiedAndUnsaved();
 }
 
+/// @brief Copy sections encoded with Chunk::encode(sections, dst) to
+/// the full chunk data
+static void merge_sections(ubyte* dst, const ubyte* src, uint16_t sections) {
+    size_t volume = Chunk::countSections(sections) * CHUNK_SECTION_VOL;
+    size_t offset = 0;
+    for (uint s = 0; s < CHUNK_SECTIONS; s++) {
+        if (!(sections & (1U << s))) {
+            continue;
+        }
+        size_t index = s * CHUNK_SECTION_VOL;
+        std::memcpy(
+            dst + index * 2, src + offset * 2, CHUNK_SECTION_VOL * 2
+        );
+        std::memcpy(
+            dst + (CHUNK_VOL + index) * 2,
+            src + (volume + offset) * 2,
+            CHUNK_SECTION_VOL * 2
+        );
+        offset += CHUNK_SECTION_VOL;
+    }
+}
+
 void compressed_chunks::save(
     int x, int z, std::vector<ubyte> bytes, WorldRegions& regions
 ) {
@@ -93,7 +209,22 @@ void compressed_chunks::save(
     reader.skip(1); // reserved byte
     if (flags & HAS_VOXELS) {
         util::Buffer<ubyte> voxelData (CHUNK_DATA_LEN);
-        read_voxel_data(reader, voxelData);
+        uint16_t sections = read_sections(reader, flags);
+        if (sections == Chunk::ALL_SECTIONS) {
+            read_voxel_data(reader, flags, voxelData.data(), CHUNK_DATA_LEN);
+        } else {
+            if (!regions.getVoxels(x, z, voxelData.data())) {
+                throw std::runtime_error(
+                    "chunk delta requires saved chunk (" + std::to_string(x) +
+                    ", " + std::to_string(z) + ")"
+                );
+            }
+            size_t size =
+                Chunk::countSections(sections) * CHUNK_SECTION_VOL * 4;
+            util::Buffer<ubyte> sectionsData (size);
+            read_voxel_data(reader, flags, sectionsData.data(), size);
+            merge_sections(voxelData.data(), sectionsData.data(), sections);
+        }
         regions.put(
             x, z, REGION_LAYER_VOXELS, voxelData.release(), CHUNK_DATA_LEN
         );
@@ -16,11 +16,25 @@ namespace compressed_chunks {
         util::Buffer<ubyte>& rleBuffer
     );
     std::vector<ubyte> encode(const Chunk& chunk);
+
+    /// @brief Encode chunk sections changed after the given revision
+    /// (see Chunk::sectionRevisions) and all blocks metadata
+    std::vector<ubyte> encode(const Chunk& chunk, uint64_t sinceRevision);
+
+    /// @brief Encode saved chunk passing voxels and blocks metadata stored
+    /// in regions through without decompression (voxels are not gzipped)
+    /// @return empty vector if chunk voxels are not saved
+    std::vector<ubyte> encode(int x, int z, WorldRegions& regions);
+
+    /// @brief Apply full or delta chunk data
     void decode(
         Chunk& chunk,
         const ubyte* src,
         size_t size,
         const ContentIndices& indices
     );
+
+    /// @brief Put full or delta chunk data to regions (delta is applied
+    /// to the saved voxels)
     void save(int x, int z, std::vector<ubyte> bytes, WorldRegions& regions);
 }
@@ -25,12 +25,18 @@ Level::Level(
 )
     : world(std::move(worldPtr)),
       content(content),
-      chunks(std::make_unique<GlobalChunks>(*this)),
-      physics(std::make_unique<PhysicsSolver>(*chunks, glm::vec3(0, -22.6f, 0))),
+      chunks(std::make_unique<GlobalChunks>(
+          *this, settings.chunks.loaderWorkers.get()
+      )),
+      physics(std::make_unique<PhysicsSolver>(
+          *chunks, glm::vec3(0, -22.6f, 0), settings.physics.workers.get()
+      )),
       events(std::make_unique<LevelEvents>()),
       entities(std::make_unique<Entities>(*this)),
       players(std::make_unique<Players>(*this)),
-      pathfinding(std::make_unique<voxels::Pathfinding>(*this)) {
+      pathfinding(std::make_unique<voxels::Pathfinding>(
+          *this, settings.pathfinding.workers.get()
+      )) {
     const auto& worldInfo = world->getInfo();
     auto& cameraIndices = content.getIndices(ResourceType::CAMERA);
     for (size_t i = 0; i < cameraIndices.size(); i++) {
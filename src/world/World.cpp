@@ -8,6 +8,7 @@
 #include "content/Content.hpp"
 #include "content/ContentReport.hpp"
 #include "debug/Logger.hpp"
+#include "world/files/RegionsSaver.hpp"
 #include "world/files/WorldFiles.hpp"
 #include "items/Inventories.hpp"
 #include "objects/Entities.hpp"
@@ -76,6 +77,23 @@ void World::write(Level* level) {
     writeResources(content);
 }
 
+bool World::writeAsync(
+    Level* level, RegionsSaver& saver, consumer<bool> onFinish
+) {
+    if (saver.isSaving()) {
+        return false;
+    }
+    auto snapshots = level->chunks->snapshotAll();
+    info.nextEntityId = level->entities->peekNextID();
+    wfile->write(this, &content, false);
+
+    auto playerFile = level->players->serialize();
+    io::write_json(wfile->getPlayerFile(), playerFile);
+
+    writeResources(content);
+    return saver.save(std::move(snapshots), std::move(onFinish));
+}
+
 std::unique_ptr<Level> World::create(
     const std::string& name,
     const std::string& generator,
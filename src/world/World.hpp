@@ -5,6 +5,7 @@
 #include <vector>
 
 #include "content/ContentPack.hpp"
+#include "delegates.hpp"
 #include "interfaces/Serializable.hpp"
 #include "io/fwd.hpp"
 #include "typedefs.hpp"
@@ -14,6 +15,7 @@ class Content;
 class WorldFiles;
 class Level;
 class ContentReport;
+class RegionsSaver;
 struct EngineSettings;
 
 class world_load_error : public std::runtime_error {
@@ -78,6 +80,15 @@ public:
     /// @brief Write all unsaved level data to the world directory
     void write(Level* level);
 
+    /// @brief Write world data taking chunks snapshots. Snapshots and
+    /// regions are written in background
+    /// @param saver regions saver
+    /// @param onFinish called in the main thread when regions are written
+    /// @return false if previous saving is not finished yet
+    bool writeAsync(
+        Level* level, RegionsSaver& saver, consumer<bool> onFinish
+    );
+
     /// @brief Check world indices and generate ContentReport if convert required
     /// @param directory world directory
     /// @param content current Content instance
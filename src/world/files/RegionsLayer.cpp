@@ -1,4 +1,8 @@
+#include <algorithm>
 #include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
 
 #include "WorldRegions.hpp"
 #include "debug/Logger.hpp"
@@ -8,33 +12,45 @@ static debug::Logger logger("regions-layer");
 
 #define REGION_FORMAT_MAGIC ".VOXREG"
 
+/// @brief Min free sectors count to start region file compaction
+static inline constexpr uint COMPACTION_MIN_FREE_SECTORS = 64;
+/// @brief Region file gets compacted when free sectors take more than
+/// 1 / COMPACTION_FREE_RATIO of chunks data sectors
+static inline constexpr uint COMPACTION_FREE_RATIO = 4;
+
+namespace {
+    /// @brief Chunk data (compressed) with sizes pair
+    struct RegionChunk {
+        std::unique_ptr<ubyte[]> data;
+        glm::u32vec2 size {};
+    };
+
+    /// @brief Chunks table entry: first sector and sectors count
+    using SectorsRange = glm::u32vec2;
+    using ChunksTable = std::array<SectorsRange, REGION_CHUNKS_COUNT>;
+}
+
 static io::path get_region_filename(int x, int z) {
     return std::to_string(x) + "_" + std::to_string(z) + ".bin";
 }
 
-/// @brief Read missing chunks data (null pointers) from region file
-static void fetch_chunks(WorldRegion* region, int x, int z, regfile* file) {
-    auto* chunks = region->getChunks();
-    auto sizes = region->getSizes();
+static uint32_t calc_sectors(uint32_t size) {
+    return (size + 8 + REGION_SECTOR_SIZE - 1) / REGION_SECTOR_SIZE;
+}
 
-    for (size_t i = 0; i < REGION_CHUNKS_COUNT; i++) {
-        int chunk_x = (i % REGION_SIZE) + x * REGION_SIZE;
-        int chunk_z = (i / REGION_SIZE) + z * REGION_SIZE;
-        if (chunks[i] == nullptr) {
-            chunks[i] = RegionsLayer::readChunkData(
-                chunk_x, chunk_z, sizes[i][0], sizes[i][1], file
-            );
-        }
-    }
+static uint32_t read_uint32(const ubyte* src) {
+    uint32_t value;
+    std::memcpy(&value, src, sizeof(uint32_t));
+    return dataio::le2h(value);
 }
 
 regfile::regfile(io::path filename) : file(filename), filename(filename) {
-    if (file.length() < REGION_HEADER_SIZE)
+    size_t file_size = file.size();
+    if (file_size < REGION_HEADER_SIZE)
         throw std::runtime_error(
             "incomplete region file header in " + filename.string()
         );
-    char header[REGION_HEADER_SIZE];
-    file.read(header, REGION_HEADER_SIZE);
+    const auto header = reinterpret_cast<const char*>(file.data());
 
     // avoid of use strcmp_s
     if (std::string(header, std::strlen(REGION_FORMAT_MAGIC)) !=
@@ -51,77 +67,361 @@ regfile::regfile(io::path filename) : file(filename), filename(filename) {
         );
     }
 
-    size_t file_size = file.length();
-    size_t table_offset = file_size - REGION_CHUNKS_COUNT * 4;
-
-    file.seekg(table_offset);
-    file.read(
-        reinterpret_cast<char*>(offsets.data()),
-        sizeof(uint32_t) * REGION_CHUNKS_COUNT
-    );
-    if (dataio::is_big_endian()) {
-        for (size_t i = 0; i < offsets.size(); i++) {
-            offsets[i] = dataio::le2h(i);
+    if (version >= 4) {
+        if (file_size < REGION_HEADER_SIZE + REGION_TABLE_SIZE) {
+            throw std::runtime_error(
+                "incomplete region chunks table in " + filename.string()
+            );
+        }
+        const ubyte* table = file.data() + REGION_HEADER_SIZE;
+        for (size_t i = 0; i < REGION_CHUNKS_COUNT; i++) {
+            offsets[i] = static_cast<size_t>(read_uint32(table + i * 8)) *
+                         REGION_SECTOR_SIZE;
         }
+        return;
+    }
+    if (file_size < REGION_HEADER_SIZE + REGION_CHUNKS_COUNT * 4) {
+        throw std::runtime_error(
+            "incomplete region offsets table in " + filename.string()
+        );
+    }
+    const ubyte* table = file.data() + file_size - REGION_CHUNKS_COUNT * 4;
+    for (size_t i = 0; i < REGION_CHUNKS_COUNT; i++) {
+        offsets[i] = read_uint32(table + i * 4);
+    }
+}
+
+util::span<ubyte> regfile::getChunk(int index, uint32_t& srcSize) const {
+    size_t offset = offsets.at(index);
+    if (offset == 0) {
+        return {nullptr, 0};
+    }
+    size_t file_size = file.size();
+    if (offset + 8 > file_size) {
+        logger.error() << "corrupted region " << filename.string()
+                       << " chunk offset detected for chunk " << index;
+        return {nullptr, 0};
+    }
+    uint32_t size = read_uint32(file.data() + offset);
+    srcSize = read_uint32(file.data() + offset + 4);
+    if (size > file_size - offset - 8) {
+        logger.error() << "corrupted region " << filename.string()
+                       << " chunk size detected for chunk " << index;
+        return {nullptr, 0};
     }
+    return file.span(offset + 8, size);
 }
 
 std::unique_ptr<ubyte[]> regfile::read(
     int index, uint32_t& size, uint32_t& srcSize
+) const {
+    auto chunk = getChunk(index, srcSize);
+    if (chunk.data() == nullptr) {
+        return nullptr;
+    }
+    size = chunk.size();
+    auto data = std::make_unique<ubyte[]>(size);
+    std::memcpy(data.get(), chunk.data(), size);
+    return data;
+}
+
+static void write_header(std::ostream& file, compression::Method compression) {
+    char header[REGION_HEADER_SIZE] = REGION_FORMAT_MAGIC;
+    header[8] = REGION_FORMAT_VERSION;
+    header[9] = static_cast<ubyte>(compression);  // FIXME
+    file.seekp(0);
+    file.write(header, REGION_HEADER_SIZE);
+}
+
+static void write_table(std::ostream& file, const ChunksTable& table) {
+    uint32_t buffer[REGION_CHUNKS_COUNT * 2];
+    for (size_t i = 0; i < REGION_CHUNKS_COUNT; i++) {
+        buffer[i * 2] = dataio::h2le(table[i][0]);
+        buffer[i * 2 + 1] = dataio::h2le(table[i][1]);
+    }
+    file.seekp(REGION_HEADER_SIZE);
+    file.write(reinterpret_cast<const char*>(buffer), REGION_TABLE_SIZE);
+}
+
+/// @return false if file is not a region file of the current format version
+static bool read_table(std::istream& file, ChunksTable& table) {
+    char header[REGION_HEADER_SIZE];
+    if (!file.read(header, REGION_HEADER_SIZE) ||
+        static_cast<uint>(header[8]) != REGION_FORMAT_VERSION) {
+        return false;
+    }
+    uint32_t buffer[REGION_CHUNKS_COUNT * 2];
+    if (!file.read(reinterpret_cast<char*>(buffer), REGION_TABLE_SIZE)) {
+        return false;
+    }
+    for (size_t i = 0; i < REGION_CHUNKS_COUNT; i++) {
+        table[i] = SectorsRange(
+            dataio::le2h(buffer[i * 2]), dataio::le2h(buffer[i * 2 + 1])
+        );
+    }
+    return true;
+}
+
+/// @brief Write chunk data (with sizes prefix) padded to sectors
+static void write_chunk(
+    std::ostream& file, uint32_t sector, const RegionChunk& chunk
 ) {
-    size_t file_size = file.length();
-    size_t table_offset = file_size - REGION_CHUNKS_COUNT * 4;
+    file.seekp(static_cast<std::streamoff>(sector) * REGION_SECTOR_SIZE);
+    uint32_t intbuf = dataio::h2le(chunk.size[0]);
+    file.write(reinterpret_cast<const char*>(&intbuf), 4);
+    intbuf = dataio::h2le(chunk.size[1]);
+    file.write(reinterpret_cast<const char*>(&intbuf), 4);
+    file.write(reinterpret_cast<const char*>(chunk.data.get()), chunk.size[0]);
+
+    size_t padding = calc_sectors(chunk.size[0]) * REGION_SECTOR_SIZE -
+                     (chunk.size[0] + 8);
+    static const char zeros[REGION_SECTOR_SIZE] {};
+    file.write(zeros, padding);
+}
 
-    uint32_t offset = offsets.at(index);
-    if (offset == 0) {
-        return nullptr;
+static RegionChunk read_chunk(std::istream& file, uint32_t sector) {
+    RegionChunk chunk;
+    uint32_t intbuf;
+    file.seekg(static_cast<std::streamoff>(sector) * REGION_SECTOR_SIZE);
+    file.read(reinterpret_cast<char*>(&intbuf), 4);
+    chunk.size[0] = dataio::le2h(intbuf);
+    file.read(reinterpret_cast<char*>(&intbuf), 4);
+    chunk.size[1] = dataio::le2h(intbuf);
+    chunk.data = std::make_unique<ubyte[]>(chunk.size[0]);
+    file.read(reinterpret_cast<char*>(chunk.data.get()), chunk.size[0]);
+    if (!file) {
+        throw std::runtime_error("could not read region chunk");
     }
+    return chunk;
+}
 
-    uint32_t buff32;
-    file.seekg(offset);
-    file.read(reinterpret_cast<char*>(&buff32), 4);
-    size = dataio::le2h(buff32);
-    file.read(reinterpret_cast<char*>(&buff32), 4);
-    srcSize = dataio::le2h(buff32);
+/// @brief Write new region file with chunks data placed contiguously
+static void write_compact_region(
+    const std::filesystem::path& path,
+    compression::Method compression,
+    const std::vector<RegionChunk>& chunks
+) {
+    std::ofstream file(path, std::ios::out | std::ios::binary);
+    write_header(file, compression);
 
-    if (offset + size > file_size) {
-        logger.error() << "corrupted region " << filename.string()
-                       << " chunk offset detected at "
-                       << (table_offset + index * 4);
-        return nullptr;
+    ChunksTable table {};
+    uint32_t sector = REGION_DATA_SECTOR;
+    for (size_t i = 0; i < REGION_CHUNKS_COUNT; i++) {
+        const auto& chunk = chunks[i];
+        if (chunk.data == nullptr) {
+            continue;
+        }
+        uint32_t count = calc_sectors(chunk.size[0]);
+        write_chunk(file, sector, chunk);
+        table[i] = SectorsRange(sector, count);
+        sector += count;
+    }
+    write_table(file, table);
+    if (!file) {
+        throw std::runtime_error("could not write region file");
+    }
+}
+
+/// @brief Rewrite region file without free sectors
+static void compact_region(
+    const std::filesystem::path& path,
+    compression::Method compression,
+    std::fstream& file,
+    const ChunksTable& table
+) {
+    std::vector<RegionChunk> chunks(REGION_CHUNKS_COUNT);
+    for (size_t i = 0; i < REGION_CHUNKS_COUNT; i++) {
+        if (table[i][0]) {
+            chunks[i] = read_chunk(file, table[i][0]);
+        }
+    }
+    file.close();
+
+    auto tmpPath = path;
+    tmpPath += ".tmp";
+    write_compact_region(tmpPath, compression, chunks);
+    std::filesystem::rename(tmpPath, path);
+}
+
+/// @brief Find first free sectors range of the required length
+/// @return index of the first sector of the range
+static uint32_t allocate_sectors(std::vector<bool>& used, uint32_t count) {
+    uint32_t start = REGION_DATA_SECTOR;
+    uint32_t length = 0;
+    for (uint32_t i = REGION_DATA_SECTOR; i < used.size(); i++) {
+        if (used[i]) {
+            start = i + 1;
+            length = 0;
+        } else if (++length == count) {
+            break;
+        }
+    }
+    if (used.size() < start + count) {
+        used.resize(start + count, false);
+    }
+    for (uint32_t i = start; i < start + count; i++) {
+        used[i] = true;
+    }
+    return start;
+}
+
+/// @brief Write changed chunks to the region file
+/// @param chunks changed chunks (data is nullptr for removed ones)
+/// @param filename region file name used to read old format files
+static void write_region_chunks(
+    const std::filesystem::path& path,
+    compression::Method compression,
+    std::vector<std::pair<uint, RegionChunk>>& chunks,
+    const io::path& filename
+) {
+    ChunksTable table {};
+    std::fstream file;
+    bool exists = std::filesystem::exists(path);
+    if (exists) {
+        file.open(path, std::ios::in | std::ios::out | std::ios::binary);
+    }
+    if (!exists || !read_table(file, table)) {
+        // new file or old format file
+        std::vector<RegionChunk> allChunks(REGION_CHUNKS_COUNT);
+        if (exists) {
+            file.close();
+            regfile oldFile(filename);
+            for (uint i = 0; i < REGION_CHUNKS_COUNT; i++) {
+                auto& chunk = allChunks[i];
+                chunk.data = oldFile.read(i, chunk.size[0], chunk.size[1]);
+            }
+        }
+        for (auto& [index, chunk] : chunks) {
+            allChunks[index] = std::move(chunk);
+        }
+        write_compact_region(path, compression, allChunks);
+        return;
+    }
+    file.clear();
+
+    uintmax_t fileSectors =
+        (std::filesystem::file_size(path) + REGION_SECTOR_SIZE - 1) /
+        REGION_SECTOR_SIZE;
+    std::vector<bool> used(REGION_DATA_SECTOR, true);
+    for (const auto& range : table) {
+        if (range[0] == 0) {
+            continue;
+        }
+        if (range[0] < REGION_DATA_SECTOR ||
+            range[0] + static_cast<uintmax_t>(range[1]) > fileSectors) {
+            throw std::runtime_error(
+                "corrupted region chunks table in " + filename.string()
+            );
+        }
+        if (used.size() < range[0] + range[1]) {
+            used.resize(range[0] + range[1], false);
+        }
+        for (uint32_t i = range[0]; i < range[0] + range[1]; i++) {
+            used[i] = true;
+        }
+    }
+    for (const auto& [index, chunk] : chunks) {
+        auto& range = table[index];
+        for (uint32_t i = range[0]; i < range[0] + range[1]; i++) {
+            used[i] = false;
+        }
+        if (chunk.data == nullptr) {
+            range = {};
+            continue;
+        }
+        uint32_t count = calc_sectors(chunk.size[0]);
+        uint32_t sector;
+        if (range[0] && count <= range[1]) {
+            // written in place
+            sector = range[0];
+            for (uint32_t i = sector; i < sector + count; i++) {
+                used[i] = true;
+            }
+        } else {
+            sector = allocate_sectors(used, count);
+        }
+        write_chunk(file, sector, chunk);
+        range = SectorsRange(sector, count);
+    }
+    write_table(file, table);
+    file.flush();
+    if (!file) {
+        throw std::runtime_error("could not write region file");
+    }
+
+    uint32_t end = used.size();
+    while (end > REGION_DATA_SECTOR && !used[end - 1]) {
+        end--;
+    }
+    uint32_t freeSectors = 0;
+    for (uint32_t i = REGION_DATA_SECTOR; i < end; i++) {
+        freeSectors += !used[i];
+    }
+    if (freeSectors >= COMPACTION_MIN_FREE_SECTORS &&
+        freeSectors * COMPACTION_FREE_RATIO > end - REGION_DATA_SECTOR) {
+        logger.info() << "compacting region file " << filename.string();
+        compact_region(path, compression, file, table);
+        return;
+    }
+    file.close();
+    if (std::filesystem::file_size(path) >
+        static_cast<uintmax_t>(end) * REGION_SECTOR_SIZE) {
+        std::filesystem::resize_file(
+            path, static_cast<uintmax_t>(end) * REGION_SECTOR_SIZE
+        );
     }
-    auto data = std::make_unique<ubyte[]>(size);
-    file.read(reinterpret_cast<char*>(data.get()), size);
-    return data;
 }
 
 void RegionsLayer::closeRegFile(glm::ivec2 coord) {
-    openRegFiles.erase(coord);
-    regFilesCv.notify_one();
+    const auto& found = openRegFiles.find(coord);
+    if (found == openRegFiles.end()) {
+        return;
+    }
+    regFilesLru.erase(found->second->lruEntry);
+    openRegFiles.erase(found);
+    regFilesCv.notify_all();
+}
+
+bool RegionsLayer::closeUnusedRegFile() {
+    for (auto it = regFilesLru.rbegin(); it != regFilesLru.rend(); ++it) {
+        if (openRegFiles[*it]->users == 0) {
+            closeRegFile(*it);
+            return true;
+        }
+    }
+    return false;
 }
 
 regfile_ptr RegionsLayer::useRegFile(glm::ivec2 coord) {
     auto* file = openRegFiles[coord].get();
-    file->inUse = true;
-    return regfile_ptr(file, &regFilesCv);
+    file->users++;
+    regFilesLru.splice(regFilesLru.begin(), regFilesLru, file->lruEntry);
+    return regfile_ptr(file, &regFilesMutex, &regFilesCv);
 }
 
-// Marks regfile as used and unmarks when shared_ptr dies
+// Marks regfile as used and unmarks when regfile_ptr dies
 regfile_ptr RegionsLayer::getRegFile(glm::ivec2 coord, bool create) {
-    {
-        std::lock_guard lock(regFilesMutex);
+    std::unique_lock lock(regFilesMutex);
+    while (true) {
+        // notified when any regfile gets out of use, closed or written
+        if (writingRegFiles.find(coord) != writingRegFiles.end()) {
+            regFilesCv.wait(lock);
+            continue;
+        }
         const auto found = openRegFiles.find(coord);
         if (found != openRegFiles.end()) {
-            if (found->second->inUse) {
-                throw std::runtime_error("regfile is currently in use");
-            }
             return useRegFile(found->first);
         }
-    }
-    if (create) {
+        if (!create) {
+            return nullptr;
+        }
+        if (openRegFiles.size() >= MAX_OPEN_REGION_FILES &&
+            !closeUnusedRegFile()) {
+            regFilesCv.wait(lock);
+            continue;
+        }
         return createRegFile(coord);
     }
-    return nullptr;
 }
 
 regfile_ptr RegionsLayer::createRegFile(glm::ivec2 coord) {
@@ -129,133 +429,208 @@ regfile_ptr RegionsLayer::createRegFile(glm::ivec2 coord) {
     if (!io::exists(file)) {
         return nullptr;
     }
-    if (openRegFiles.size() == MAX_OPEN_REGION_FILES) {
-        std::unique_lock lock(regFilesMutex);
-        while (true) {
-            bool closed = false;
-            // FIXME: bad choosing algorithm
-            for (auto& entry : openRegFiles) {
-                if (!entry.second->inUse) {
-                    closeRegFile(entry.first);
-                    closed = true;
-                    break;
-                }
-            }
-            if (closed) {
-                break;
-            }
-            // notified when any regfile gets out of use or closed
-            regFilesCv.wait(lock);
-        }
-        openRegFiles[coord] = std::make_unique<regfile>(file);
-        return useRegFile(coord);
-    } else {
-        std::lock_guard lock(regFilesMutex);
-        openRegFiles[coord] = std::make_unique<regfile>(file);
-        return useRegFile(coord);
+    auto& entry = openRegFiles[coord];
+    try {
+        entry = std::make_unique<regfile>(file);
+    } catch (...) {
+        openRegFiles.erase(coord);
+        throw;
     }
+    entry->lruEntry = regFilesLru.insert(regFilesLru.begin(), coord);
+    return useRegFile(coord);
 }
 
-WorldRegion* RegionsLayer::getRegion(int x, int z) {
+std::shared_ptr<WorldRegion> RegionsLayer::getRegion(int x, int z) {
     std::lock_guard lock(mapMutex);
     auto found = regions.find({x, z});
     if (found == regions.end()) {
         return nullptr;
     }
-    return found->second.get();
+    return found->second;
 }
 
 io::path RegionsLayer::getRegionFilePath(int x, int z) const {
     return folder / get_region_filename(x, z);
 }
 
-WorldRegion* RegionsLayer::getOrCreateRegion(int x, int z) {
-    if (auto region = getRegion(x, z)) {
-        return region;
+void RegionsLayer::putData(
+    int x,
+    int z,
+    std::unique_ptr<ubyte[]> data,
+    uint32_t size,
+    uint32_t srcSize
+) {
+    int regionX, regionZ, localX, localZ;
+    calc_reg_coords(x, z, regionX, regionZ, localX, localZ);
+    glm::ivec2 key(regionX, regionZ);
+
+    std::lock_guard lock(mapMutex);
+    auto& region = regions[key];
+    size_t prevUsage = 0;
+    if (region == nullptr) {
+        region = std::make_shared<WorldRegion>();
+        region->lruEntry = regionsLru.insert(regionsLru.begin(), key);
+    } else {
+        prevUsage = region->getMemoryUsage();
+        regionsLru.splice(regionsLru.begin(), regionsLru, region->lruEntry);
     }
+    region->setUnsaved(true);
+    region->put(localX, localZ, std::move(data), size, srcSize);
+    cacheStats->residentBytes += region->getMemoryUsage();
+    cacheStats->residentBytes -= prevUsage;
+}
+
+size_t RegionsLayer::evictClean(size_t budget) {
+    size_t count = 0;
     std::lock_guard lock(mapMutex);
-    auto region_ptr = std::make_unique<WorldRegion>();
-    auto region = region_ptr.get();
-    regions[{x, z}] = std::move(region_ptr);
-    return region;
+    auto it = regionsLru.end();
+    while (it != regionsLru.begin() && cacheStats->residentBytes > budget) {
+        --it;
+        auto found = regions.find(*it);
+        const auto& region = found->second;
+        // region referenced outside of the map is being written
+        if (!region->isClean() || region.use_count() > 1) {
+            continue;
+        }
+        cacheStats->residentBytes -= region->getMemoryUsage();
+        it = regionsLru.erase(it);
+        regions.erase(found);
+        count++;
+    }
+    cacheStats->evictions += count;
+    return count;
 }
 
-ubyte* RegionsLayer::getData(int x, int z, uint32_t& size, uint32_t& srcSize) {
+bool RegionsLayer::processData(int x, int z, const ChunkDataProc& func) {
     int regionX, regionZ, localX, localZ;
     calc_reg_coords(x, z, regionX, regionZ, localX, localZ);
+    {
+        std::unique_lock lock(mapMutex);
+        const auto& found = regions.find({regionX, regionZ});
+        if (found != regions.end()) {
+            auto& region = *found->second;
+            regionsLru.splice(regionsLru.begin(), regionsLru, region.lruEntry);
+            if (const ubyte* data = region.getChunkData(localX, localZ)) {
+                cacheStats->hits++;
+                // copy to not hold the lock while processing
+                auto sizevec = region.getChunkDataSize(localX, localZ);
+                auto copy = std::make_unique<ubyte[]>(sizevec[0]);
+                std::memcpy(copy.get(), data, sizevec[0]);
+                lock.unlock();
+                func({copy.get(), sizevec[0]}, sizevec[1]);
+                return true;
+            }
+            if (region.isChunkUnsaved(localX, localZ)) {
+                cacheStats->hits++;
+                return false;
+            }
+        }
+    }
+    cacheStats->misses++;
+    auto regfile = getRegFile({regionX, regionZ});
+    if (regfile == nullptr) {
+        return false;
+    }
+    uint32_t srcSize;
+    auto data = regfile.get()->getChunk(localZ * REGION_SIZE + localX, srcSize);
+    if (data.data() == nullptr) {
+        return false;
+    }
+    func(data, srcSize);
+    return true;
+}
 
-    WorldRegion* region = getOrCreateRegion(regionX, regionZ);
-    ubyte* data = region->getChunkData(localX, localZ);
-    if (data == nullptr) {
-        auto regfile = getRegFile({regionX, regionZ});
-        if (regfile != nullptr) {
-            auto dataptr = readChunkData(x, z, size, srcSize, regfile.get());
-            if (dataptr) {
-                data = dataptr.get();
-                region->put(localX, localZ, std::move(dataptr), size, srcSize);
+bool RegionsLayer::hasData(int x, int z) {
+    int regionX, regionZ, localX, localZ;
+    calc_reg_coords(x, z, regionX, regionZ, localX, localZ);
+    {
+        std::lock_guard lock(mapMutex);
+        const auto& found = regions.find({regionX, regionZ});
+        if (found != regions.end()) {
+            auto& region = *found->second;
+            if (region.getChunkData(localX, localZ)) {
+                return true;
+            }
+            if (region.isChunkUnsaved(localX, localZ)) {
+                return false;
             }
         }
     }
-    if (data != nullptr) {
-        auto sizevec = region->getChunkDataSize(localX, localZ);
-        size = sizevec[0];
-        srcSize = sizevec[1];
-        return data;
+    auto regfile = getRegFile({regionX, regionZ});
+    if (regfile == nullptr) {
+        return false;
     }
-    return nullptr;
+    return regfile.get()->offsets[localZ * REGION_SIZE + localX] != 0;
 }
 
 void RegionsLayer::writeRegion(int x, int z, WorldRegion* entry) {
     io::path filename = folder / get_region_filename(x, z);
-
     glm::ivec2 regcoord(x, z);
-    if (auto regfile = getRegFile(regcoord, false)) {
-        fetch_chunks(entry, x, z, regfile.get());
 
-        std::lock_guard lock(regFilesMutex);
-        regfile.reset();
-        closeRegFile(regcoord);
+    // region data may be modified in other thread while writing
+    std::bitset<REGION_CHUNKS_COUNT> unsaved;
+    std::vector<std::pair<uint, RegionChunk>> chunks;
+    {
+        std::lock_guard lock(mapMutex);
+        unsaved = entry->takeUnsavedChunks();
+        auto data = entry->getChunks();
+        auto sizes = entry->getSizes();
+        for (uint i = 0; i < REGION_CHUNKS_COUNT; i++) {
+            if (!unsaved.test(i)) {
+                continue;
+            }
+            RegionChunk chunk;
+            if (data[i] != nullptr) {
+                chunk.size = sizes[i];
+                chunk.data = std::make_unique<ubyte[]>(chunk.size[0]);
+                std::memcpy(chunk.data.get(), data[i].get(), chunk.size[0]);
+            }
+            chunks.emplace_back(i, std::move(chunk));
+        }
     }
-
-    char header[REGION_HEADER_SIZE] = REGION_FORMAT_MAGIC;
-    header[8] = REGION_FORMAT_VERSION;
-    header[9] = static_cast<ubyte>(compression);  // FIXME
-    std::ofstream file(io::resolve(filename), std::ios::out | std::ios::binary);
-    file.write(header, REGION_HEADER_SIZE);
-
-    size_t offset = REGION_HEADER_SIZE;
-    uint32_t intbuf;
-    uint offsets[REGION_CHUNKS_COUNT] {};
-
-    auto region = entry->getChunks();
-    auto sizes = entry->getSizes();
-
-    for (size_t i = 0; i < REGION_CHUNKS_COUNT; i++) {
-        ubyte* chunk = region[i].get();
-        if (chunk == nullptr) {
-            continue;
+    if (chunks.empty()) {
+        return;
+    }
+    {
+        std::unique_lock lock(regFilesMutex);
+        // region may be written by the background saver and by a synchronous
+        // save at once
+        while (writingRegFiles.find(regcoord) != writingRegFiles.end()) {
+            regFilesCv.wait(lock);
+        }
+        writingRegFiles.insert(regcoord);
+        while (true) {
+            const auto found = openRegFiles.find(regcoord);
+            if (found == openRegFiles.end()) {
+                break;
+            }
+            if (found->second->users == 0) {
+                closeRegFile(regcoord);
+                break;
+            }
+            regFilesCv.wait(lock);
         }
-        offsets[i] = offset;
-
-        auto sizevec = sizes[i];
-        uint32_t compressedSize = sizevec[0];
-        uint32_t srcSize = sizevec[1];
-
-        intbuf = dataio::h2le(compressedSize);
-        file.write(reinterpret_cast<const char*>(&intbuf), 4);
-        offset += 4;
-
-        intbuf = dataio::h2le(srcSize);
-        file.write(reinterpret_cast<const char*>(&intbuf), 4);
-        offset += 4;
-
-        file.write(reinterpret_cast<const char*>(chunk), compressedSize);
-        offset += compressedSize;
     }
-    for (size_t i = 0; i < REGION_CHUNKS_COUNT; i++) {
-        intbuf = dataio::h2le(offsets[i]);
-        file.write(reinterpret_cast<const char*>(&intbuf), 4);
+    auto finishWriting = [this, regcoord]() {
+        {
+            std::lock_guard lock(regFilesMutex);
+            writingRegFiles.erase(regcoord);
+        }
+        regFilesCv.notify_all();
+    };
+    try {
+        write_region_chunks(
+            io::resolve(filename), compression, chunks, filename
+        );
+    } catch (...) {
+        {
+            std::lock_guard lock(mapMutex);
+            entry->restoreUnsavedChunks(unsaved);
+        }
+        finishWriting();
+        throw;
     }
+    finishWriting();
 }
 
 std::unique_ptr<ubyte[]> RegionsLayer::readChunkData(
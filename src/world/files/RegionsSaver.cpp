@@ -0,0 +1,142 @@
+#include "RegionsSaver.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "debug/Logger.hpp"
+#include "WorldRegions.hpp"
+
+static debug::Logger logger("regions-saver");
+
+struct RegionsSaveTask {
+    std::vector<std::unique_ptr<ChunkSnapshot>> snapshots;
+    consumer<bool> onFinish;
+    size_t chunksTotal = 0;
+    std::atomic<size_t> chunksDone = 0;
+    std::atomic<size_t> regionsDone = 0;
+    std::atomic<size_t> regionsTotal = 0;
+    std::atomic<bool> finished = false;
+    bool success = false;
+};
+
+using SaveTaskPtr = std::shared_ptr<RegionsSaveTask>;
+
+class RegionsSaveWorker : public util::Worker<SaveTaskPtr, SaveTaskPtr> {
+    WorldRegions& regions;
+public:
+    RegionsSaveWorker(WorldRegions& regions) : regions(regions) {
+    }
+
+    SaveTaskPtr operator()(const SaveTaskPtr& task) override {
+        auto& snapshots = task->snapshots;
+        size_t index = 0;
+        try {
+            for (; index < snapshots.size(); index++) {
+                regions.putPending(*snapshots[index]);
+                // free memory as soon as possible
+                snapshots[index].reset();
+                task->chunksDone++;
+            }
+            regions.writeAll([&task](size_t done, size_t total) {
+                task->regionsTotal = total;
+                task->regionsDone = done;
+            });
+            task->success = true;
+        } catch (const std::exception& err) {
+            logger.error() << "world saving failed: " << err.what();
+            for (; index < snapshots.size(); index++) {
+                if (snapshots[index]) {
+                    regions.cancelPending(*snapshots[index]);
+                }
+            }
+        }
+        snapshots.clear();
+        task->finished = true;
+        return task;
+    }
+};
+
+RegionsSaver::RegionsSaver(WorldRegions& regions)
+    : regions(regions),
+      threadPool(
+          "regions-saver",
+          [&]() { return std::make_unique<RegionsSaveWorker>(regions); },
+          [this](SaveTaskPtr&& task) { processResult(std::move(task)); },
+          1
+      ) {
+    threadPool.setStopOnFail(false);
+}
+
+RegionsSaver::~RegionsSaver() {
+    // finish saving without calling the callback
+    while (current && !current->finished) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+bool RegionsSaver::save(
+    std::vector<std::unique_ptr<ChunkSnapshot>> snapshots,
+    consumer<bool> onFinish
+) {
+    if (current) {
+        return false;
+    }
+    for (const auto& snapshot : snapshots) {
+        regions.addPending(*snapshot);
+    }
+    current = std::make_shared<RegionsSaveTask>();
+    current->chunksTotal = snapshots.size();
+    current->snapshots = std::move(snapshots);
+    current->onFinish = std::move(onFinish);
+    logger.info() << "saving " << current->chunksTotal << " chunks";
+
+    auto task = current;
+    threadPool.enqueueJob(std::move(task));
+    return true;
+}
+
+bool RegionsSaver::isSaving() const {
+    return current != nullptr;
+}
+
+float RegionsSaver::getProgress() const {
+    if (current == nullptr || current->finished) {
+        return 1.0f;
+    }
+    size_t chunksTotal = current->chunksTotal;
+    size_t regionsTotal = current->regionsTotal;
+    float chunksProgress =
+        chunksTotal ? current->chunksDone / static_cast<float>(chunksTotal)
+                    : 1.0f;
+    float regionsProgress =
+        regionsTotal ? current->regionsDone / static_cast<float>(regionsTotal)
+                     : 0.0f;
+    return (chunksProgress + regionsProgress) * 0.5f;
+}
+
+void RegionsSaver::update() {
+    threadPool.pullResults();
+}
+
+void RegionsSaver::wait() {
+    while (current) {
+        if (!current->finished) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        threadPool.pullResults();
+    }
+}
+
+void RegionsSaver::processResult(SaveTaskPtr&& task) {
+    if (task != current) {
+        return;
+    }
+    auto onFinish = std::move(current->onFinish);
+    bool success = current->success;
+    current = nullptr;
+    logger.info() << "saving " << (success ? "finished" : "failed");
+    if (onFinish) {
+        onFinish(success);
+    }
+}
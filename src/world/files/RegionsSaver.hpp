@@ -0,0 +1,51 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "delegates.hpp"
+#include "util/ThreadPool.hpp"
+
+class WorldRegions;
+struct ChunkSnapshot;
+struct RegionsSaveTask;
+
+/// @brief Puts chunks snapshots to regions and writes unsaved regions
+/// in background
+class RegionsSaver {
+    WorldRegions& regions;
+    /// @brief Current save task or nullptr
+    std::shared_ptr<RegionsSaveTask> current;
+    util::ThreadPool<
+        std::shared_ptr<RegionsSaveTask>,
+        std::shared_ptr<RegionsSaveTask>>
+        threadPool;
+
+    void processResult(std::shared_ptr<RegionsSaveTask>&& task);
+public:
+    RegionsSaver(WorldRegions& regions);
+    ~RegionsSaver();
+
+    /// @brief Start saving. Snapshots are marked pending so chunks put
+    /// in the main thread while saving will not be overwritten
+    /// @param snapshots chunks snapshots taken at the current tick
+    /// @param onFinish called in the main thread when saving finished
+    /// (argument is false if saving failed)
+    /// @return false if previous saving is not finished yet
+    bool save(
+        std::vector<std::unique_ptr<ChunkSnapshot>> snapshots,
+        consumer<bool> onFinish
+    );
+
+    /// @return true if saving is not finished yet
+    bool isSaving() const;
+
+    /// @return current saving progress in range [0.0, 1.0]
+    float getProgress() const;
+
+    /// @brief Process finished saving
+    void update();
+
+    /// @brief Block until current saving finished
+    void wait();
+};
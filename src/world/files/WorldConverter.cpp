@@ -184,7 +184,19 @@ void WorldConverter::upgradeRegion(
 ) const {
     auto path = wfile->getRegions().getRegionFilePath(layer, x, z);
     auto bytes = io::read_bytes_buffer(path);
-    auto buffer = compatibility::convert_region_2to3(bytes, layer);
+    if (bytes.size() < REGION_HEADER_SIZE) {
+        throw std::runtime_error("invalid region file " + path.string());
+    }
+    uint version = bytes[8];
+    if (version >= REGION_FORMAT_VERSION) {
+        return;
+    }
+    logger.info() << "upgrading region " << path.string() << " (version "
+                  << version << ")";
+    if (version < 3) {
+        bytes = compatibility::convert_region_2to3(bytes, layer);
+    }
+    auto buffer = compatibility::convert_region_3to4(bytes);
     io::write_bytes(path, buffer.data(), buffer.size());
 }
 
@@ -223,7 +235,7 @@ void WorldConverter::convertBlocksData(int x, int z, const ContentReport& report
         BlocksMetadata newHeap;
         for (const auto& entry : *heap) {
             size_t index = entry.index;
-            const auto& def = indices.require(chunk.voxels[index].id);
+            const auto& def = indices.require(chunk.voxels.get(index).id);
             const auto& newStruct = *def.dataStruct;
             const auto& found = report.blocksDataLayouts.find(def.name);
             if (found == report.blocksDataLayouts.end()) {
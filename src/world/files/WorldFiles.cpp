@@ -77,7 +77,7 @@ io::path WorldFiles::getPacksFile() const {
 }
 
 void WorldFiles::write(
-    const World* world, const Content* content
+    const World* world, const Content* content, bool writeRegions
 ) {
     if (world) {
         writeWorldInfo(world->getInfo());
@@ -91,7 +91,9 @@ void WorldFiles::write(
     if (content) {
         writeIndices(content->getIndices());
     }
-    regions.writeAll();
+    if (writeRegions) {
+        regions.writeAll();
+    }
 }
 
 void WorldFiles::writePacks(const std::vector<ContentPack>& packs) {
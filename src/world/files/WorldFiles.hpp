@@ -60,7 +60,10 @@ public:
     /// @brief Write all unsaved data to world files
     /// @param world target world
     /// @param content world content
-    void write(const World* world, const Content* content);
+    /// @param writeRegions write unsaved regions
+    void write(
+        const World* world, const Content* content, bool writeRegions = true
+    );
 
     void writePacks(const std::vector<ContentPack>& packs);
 
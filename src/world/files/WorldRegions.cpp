@@ -33,6 +33,17 @@ bool WorldRegion::isUnsaved() const {
     return unsaved;
 }
 
+bool WorldRegion::isClean() const {
+    return !unsaved && unsavedChunks.none();
+}
+
+size_t WorldRegion::getMemoryUsage() const {
+    return sizeof(WorldRegion) +
+           REGION_CHUNKS_COUNT *
+               (sizeof(std::unique_ptr<ubyte[]>) + sizeof(glm::u32vec2)) +
+           dataSize;
+}
+
 std::unique_ptr<ubyte[]>* WorldRegion::getChunks() const {
     return chunksData.get();
 }
@@ -42,11 +53,41 @@ glm::u32vec2* WorldRegion::getSizes() const {
 }
 
 void WorldRegion::put(
-    uint x, uint z, std::unique_ptr<ubyte[]> data, uint32_t size, uint32_t srcSize
+    uint x,
+    uint z,
+    std::unique_ptr<ubyte[]> data,
+    uint32_t size,
+    uint32_t srcSize,
+    bool unsaved
 ) {
     size_t chunk_index = z * REGION_SIZE + x;
+    if (chunksData[chunk_index]) {
+        dataSize -= sizes[chunk_index][0];
+    }
+    if (data) {
+        dataSize += size;
+    }
     chunksData[chunk_index] = std::move(data);
     sizes[chunk_index] = glm::u32vec2(size, srcSize);
+    if (unsaved) {
+        unsavedChunks.set(chunk_index);
+    }
+}
+
+bool WorldRegion::isChunkUnsaved(uint x, uint z) const {
+    return unsavedChunks.test(z * REGION_SIZE + x);
+}
+
+std::bitset<REGION_CHUNKS_COUNT> WorldRegion::takeUnsavedChunks() {
+    auto chunks = unsavedChunks;
+    unsavedChunks.reset();
+    return chunks;
+}
+
+void WorldRegion::restoreUnsavedChunks(
+    const std::bitset<REGION_CHUNKS_COUNT>& chunks
+) {
+    unsavedChunks |= chunks;
 }
 
 ubyte* WorldRegion::getChunkData(uint x, uint z) {
@@ -57,9 +98,23 @@ glm::u32vec2 WorldRegion::getChunkDataSize(uint x, uint z) {
     return sizes[z * REGION_SIZE + x];
 }
 
-WorldRegions::WorldRegions(const io::path& directory) : directory(directory) {
+/// @brief Number of chunk data write counters (power of two)
+static inline constexpr uint32_t CHUNK_VERSIONS_COUNT = 4096;
+
+static uint32_t chunk_version_index(int x, int z) {
+    uint32_t hash = static_cast<uint32_t>(x) * 73856093U ^
+                    static_cast<uint32_t>(z) * 19349663U;
+    return hash & (CHUNK_VERSIONS_COUNT - 1);
+}
+
+WorldRegions::WorldRegions(const io::path& directory)
+    : directory(directory),
+      chunkVersions(
+          std::make_unique<std::atomic<uint32_t>[]>(CHUNK_VERSIONS_COUNT)
+      ) {
     for (size_t i = 0; i < REGION_LAYERS_COUNT; i++) {
         layers[i].layer = static_cast<RegionLayerIndex>(i);
+        layers[i].cacheStats = &cacheStats;
     }
     auto& voxels = layers[REGION_LAYER_VOXELS];
     voxels.folder = directory / "regions";
@@ -79,18 +134,27 @@ WorldRegions::WorldRegions(const io::path& directory) : directory(directory) {
 
 WorldRegions::~WorldRegions() = default;
 
-void RegionsLayer::writeAll() {
-    for (auto& it : regions) {
-        WorldRegion* region = it.second.get();
+std::vector<std::pair<glm::ivec2, std::shared_ptr<WorldRegion>>>
+RegionsLayer::takeUnsaved() {
+    std::vector<std::pair<glm::ivec2, std::shared_ptr<WorldRegion>>> unsaved;
+    std::lock_guard lock(mapMutex);
+    for (auto& [key, region] : regions) {
         if (region->getChunks() == nullptr || !region->isUnsaved()) {
             continue;
         }
-        const auto& key = it.first;
-        writeRegion(key[0], key[1], region);
+        region->setUnsaved(false);
+        unsaved.emplace_back(key, region);
     }
+    return unsaved;
 }
 
-void WorldRegions::put(
+void RegionsLayer::writeAll() {
+    for (const auto& [key, region] : takeUnsaved()) {
+        writeRegion(key[0], key[1], region.get());
+    }
+}
+
+void WorldRegions::putLayer(
     int x,
     int z,
     RegionLayerIndex layerid,
@@ -99,22 +163,38 @@ void WorldRegions::put(
 ) {
     size_t size = srcSize;
     auto& layer = layers[layerid];
-    int regionX, regionZ, localX, localZ;
-    calc_reg_coords(x, z, regionX, regionZ, localX, localZ);
-
-    WorldRegion* region = layer.getOrCreateRegion(regionX, regionZ);
-    region->setUnsaved(true);
-    
     if (data == nullptr) {
-        region->put(localX, localZ, nullptr, 0, 0);
+        layer.putData(x, z, nullptr, 0, 0);
+        chunkVersions[chunk_version_index(x, z)]++;
         return;
     }
-
     if (layer.compression != compression::Method::NONE) {
         data = compression::compress(
             data.get(), size, size, layer.compression);
     }
-    region->put(localX, localZ, std::move(data), size, srcSize);
+    layer.putData(x, z, std::move(data), size, srcSize);
+    // incremented after putting so the version read before reading data
+    // can not be the new one while the data is old
+    chunkVersions[chunk_version_index(x, z)]++;
+}
+
+uint32_t WorldRegions::getChunkVersion(int x, int z) const {
+    return chunkVersions[chunk_version_index(x, z)];
+}
+
+void WorldRegions::put(
+    int x,
+    int z,
+    RegionLayerIndex layerid,
+    std::unique_ptr<ubyte[]> data,
+    size_t srcSize
+) {
+    {
+        std::lock_guard lock(snapshotsMutex);
+        pendingSnapshots.erase({x, z});
+    }
+    putLayer(x, z, layerid, std::move(data), srcSize);
+    trimCache();
 }
 
 static std::unique_ptr<ubyte[]> write_inventories(
@@ -152,45 +232,47 @@ static ChunkInventoriesMap load_inventories(const ubyte* src, uint32_t size) {
     return inventories;
 }
 
-void WorldRegions::put(Chunk* chunk, std::vector<ubyte> entitiesData) {
+std::unique_ptr<ChunkSnapshot> WorldRegions::createSnapshot(
+    Chunk* chunk, std::vector<ubyte> entitiesData
+) {
     if (generatorTestMode) {
-        return;
+        return nullptr;
     }
     assert(chunk != nullptr);
     if (!chunk->flags.ready) {
-        return;
+        return nullptr;
     }
-    bool lightsUnsaved = !chunk->flags.loadedLights && doWriteLights;
+    // lights loaded in the legacy format or changed since loading
+    // are rewritten
+    bool lightsUnsaved = doWriteLights && (!chunk->flags.loadedBlockLights ||
+                                           chunk->flags.lightsUnsaved);
     if (!chunk->flags.unsaved && !lightsUnsaved && !chunk->flags.entities) {
-        return;
+        return nullptr;
     }
+    auto snapshot = std::make_unique<ChunkSnapshot>();
+    snapshot->x = chunk->x;
+    snapshot->z = chunk->z;
 
-    int regionX, regionZ, localX, localZ;
-    calc_reg_coords(chunk->x, chunk->z, regionX, regionZ, localX, localZ);
-
-    put(chunk->x,
-        chunk->z,
-        REGION_LAYER_VOXELS,
-        chunk->encode(),
-        CHUNK_DATA_LEN);
+    auto set = [&snapshot](
+        RegionLayerIndex layer, std::unique_ptr<ubyte[]> data, size_t size
+    ) {
+        snapshot->layers[layer] = true;
+        snapshot->data[layer] = std::move(data);
+        snapshot->sizes[layer] = size;
+    };
+    set(REGION_LAYER_VOXELS, chunk->encode(), CHUNK_DATA_LEN);
 
     // Writing lights cache
     if (doWriteLights && chunk->flags.lighted && chunk->lightmap) {
-        put(chunk->x,
-            chunk->z,
-            REGION_LAYER_LIGHTS,
-            chunk->lightmap->encode(),
-            LIGHTMAP_DATA_LEN);
+        size_t size;
+        auto data = chunk->lightmap->encode(size);
+        set(REGION_LAYER_LIGHTS, std::move(data), size);
     }
     // Writing block inventories
     if (!chunk->inventories.empty() || chunk->flags.inventoriesRemoved) {
         uint datasize;
         auto data = write_inventories(chunk->inventories, datasize);
-        put(chunk->x,
-            chunk->z,
-            REGION_LAYER_INVENTORIES,
-            std::move(data),
-            datasize);
+        set(REGION_LAYER_INVENTORIES, std::move(data), datasize);
     }
     // Writing entities
     if (!entitiesData.empty()) {
@@ -198,67 +280,105 @@ void WorldRegions::put(Chunk* chunk, std::vector<ubyte> entitiesData) {
         for (size_t i = 0; i < entitiesData.size(); i++) {
             data[i] = entitiesData[i];
         }
-        put(chunk->x,
-            chunk->z,
-            REGION_LAYER_ENTITIES,
-            std::move(data),
-            entitiesData.size());
+        set(REGION_LAYER_ENTITIES, std::move(data), entitiesData.size());
     }
     // Writing blocks data
     if (chunk->flags.blocksData) {
         auto bytes = chunk->blocksMetadata.serialize();
-        put(chunk->x,
-            chunk->z,
-            REGION_LAYER_BLOCKS_DATA,
-            bytes.release(),
-            bytes.size());
+        size_t size = bytes.size();
+        set(REGION_LAYER_BLOCKS_DATA, bytes.release(), size);
     }
+    return snapshot;
 }
 
-bool WorldRegions::getVoxels(int x, int z, ubyte* dst) {
-    uint32_t size;
-    uint32_t srcSize;
-    auto& layer = layers[REGION_LAYER_VOXELS];
-    auto* data = layer.getData(x, z, size, srcSize);
-    if (data == nullptr) {
-        return false;
+void WorldRegions::putLayers(ChunkSnapshot& snapshot) {
+    for (size_t i = 0; i < REGION_LAYERS_COUNT; i++) {
+        if (!snapshot.layers[i]) {
+            continue;
+        }
+        putLayer(
+            snapshot.x,
+            snapshot.z,
+            static_cast<RegionLayerIndex>(i),
+            std::move(snapshot.data[i]),
+            snapshot.sizes[i]
+        );
     }
-    assert(srcSize == CHUNK_DATA_LEN);
-    compression::decompress({data, size}, dst, CHUNK_DATA_LEN, layer.compression);
-    return true;
 }
 
-bool WorldRegions::getLights(int x, int z, ubyte* dst) {
-    uint32_t size;
-    uint32_t srcSize;
-    auto& layer = layers[REGION_LAYER_LIGHTS];
-    auto* bytes = layer.getData(x, z, size, srcSize);
-    if (bytes == nullptr) {
+void WorldRegions::put(ChunkSnapshot& snapshot) {
+    {
+        std::lock_guard lock(snapshotsMutex);
+        pendingSnapshots.erase({snapshot.x, snapshot.z});
+    }
+    putLayers(snapshot);
+    trimCache();
+}
+
+void WorldRegions::put(Chunk* chunk, std::vector<ubyte> entitiesData) {
+    if (auto snapshot = createSnapshot(chunk, std::move(entitiesData))) {
+        put(*snapshot);
+    }
+}
+
+void WorldRegions::addPending(const ChunkSnapshot& snapshot) {
+    std::lock_guard lock(snapshotsMutex);
+    pendingSnapshots.insert({snapshot.x, snapshot.z});
+}
+
+bool WorldRegions::putPending(ChunkSnapshot& snapshot) {
+    // lock is held while putting so the chunk put in the main thread
+    // at the same time will not be overwritten with outdated data
+    std::lock_guard lock(snapshotsMutex);
+    if (pendingSnapshots.erase({snapshot.x, snapshot.z}) == 0) {
         return false;
     }
-    compression::decompress({bytes, size}, dst, srcSize, layer.compression);
+    putLayers(snapshot);
     return true;
 }
 
+void WorldRegions::cancelPending(const ChunkSnapshot& snapshot) {
+    std::lock_guard lock(snapshotsMutex);
+    pendingSnapshots.erase({snapshot.x, snapshot.z});
+}
+
+bool WorldRegions::getVoxels(int x, int z, ubyte* dst) {
+    auto& layer = layers[REGION_LAYER_VOXELS];
+    return layer.processData(x, z, [&](auto data, uint32_t srcSize) {
+        assert(srcSize == CHUNK_DATA_LEN);
+        compression::decompress(data, dst, CHUNK_DATA_LEN, layer.compression);
+    });
+}
+
+bool WorldRegions::hasVoxels(int x, int z) {
+    return layers[REGION_LAYER_VOXELS].hasData(x, z);
+}
+
+bool WorldRegions::processData(
+    int x, int z, RegionLayerIndex layerid, const ChunkDataProc& func
+) {
+    return layers[layerid].processData(x, z, func);
+}
+
+compression::Method WorldRegions::getCompression(
+    RegionLayerIndex layerid
+) const {
+    return layers[layerid].compression;
+}
+
 ChunkInventoriesMap WorldRegions::fetchInventories(int x, int z) {
-    uint32_t bytesSize;
-    uint32_t srcSize;
-    auto bytes = layers[REGION_LAYER_INVENTORIES].getData(x, z, bytesSize, srcSize);
-    if (bytes == nullptr) {
-        return {};
-    }
-    return load_inventories(bytes, bytesSize);
+    ChunkInventoriesMap inventories;
+    layers[REGION_LAYER_INVENTORIES].processData(x, z, [&](auto data, auto) {
+        inventories = load_inventories(data.data(), data.size());
+    });
+    return inventories;
 }
 
 BlocksMetadata WorldRegions::getBlocksData(int x, int z) {
-    uint32_t bytesSize;
-    uint32_t srcSize;
-    auto bytes = layers[REGION_LAYER_BLOCKS_DATA].getData(x, z, bytesSize, srcSize);
-    if (bytes == nullptr) {
-        return {};
-    }
     BlocksMetadata heap;
-    heap.deserialize(bytes, bytesSize);
+    layers[REGION_LAYER_BLOCKS_DATA].processData(x, z, [&](auto data, auto) {
+        heap.deserialize(data.data(), data.size());
+    });
     return heap;
 }
 
@@ -337,19 +457,56 @@ dv::value WorldRegions::fetchEntities(int x, int z) {
     if (generatorTestMode) {
         return nullptr;
     }
-    uint32_t bytesSize;
-    uint32_t srcSize;
-    const ubyte* data = layers[REGION_LAYER_ENTITIES].getData(x, z, bytesSize, srcSize);
-    if (data == nullptr) {
-        return nullptr;
-    }
-    auto map = json::from_binary(data, bytesSize);
+    dv::value map = nullptr;
+    layers[REGION_LAYER_ENTITIES].processData(x, z, [&](auto data, auto) {
+        map = json::from_binary(data.data(), data.size());
+    });
     if (map.empty()) {
         return nullptr;
     }
     return map;
 }
 
+ChunkRegionsData WorldRegions::readChunk(int x, int z, bool lights) {
+    ChunkRegionsData chunk;
+
+    // chunks data is decompressed directly from mapped region files
+    auto& voxLayer = layers[REGION_LAYER_VOXELS];
+    if (!voxLayer.processData(x, z, [&](auto data, uint32_t) {
+            chunk.voxels = std::make_unique<ubyte[]>(CHUNK_DATA_LEN);
+            compression::decompress(
+                data, chunk.voxels.get(), CHUNK_DATA_LEN, voxLayer.compression
+            );
+        })) {
+        return chunk;
+    }
+    if (lights) {
+        auto& layer = layers[REGION_LAYER_LIGHTS];
+        layer.processData(x, z, [&](auto data, uint32_t srcSize) {
+            chunk.lights = std::make_unique<ubyte[]>(srcSize);
+            chunk.lightsSize = srcSize;
+            compression::decompress(
+                data, chunk.lights.get(), srcSize, layer.compression
+            );
+        });
+    }
+    layers[REGION_LAYER_INVENTORIES].processData(x, z, [&](auto data, auto) {
+        chunk.inventories = load_inventories(data.data(), data.size());
+    });
+    if (!generatorTestMode) {
+        layers[REGION_LAYER_ENTITIES].processData(x, z, [&](auto data, auto) {
+            auto map = json::from_binary(data.data(), data.size());
+            if (!map.empty()) {
+                chunk.entities = std::move(map);
+            }
+        });
+    }
+    layers[REGION_LAYER_BLOCKS_DATA].processData(x, z, [&](auto data, auto) {
+        chunk.blocksData.deserialize(data.data(), data.size());
+    });
+    return chunk;
+}
+
 void WorldRegions::processRegion(
     int x, int z, RegionLayerIndex layerid, const RegionProc& func
 ) {
@@ -394,11 +551,71 @@ io::path WorldRegions::getRegionFilePath(RegionLayerIndex layerid, int x, int z)
     return layers[layerid].getRegionFilePath(x, z);
 }
 
-void WorldRegions::writeAll() {
+void WorldRegions::writeAll(const SaveProgressCallback& onProgress) {
+    std::vector<std::pair<glm::ivec2, std::shared_ptr<WorldRegion>>>
+        unsaved[REGION_LAYERS_COUNT];
+    size_t total = 0;
+    for (size_t i = 0; i < REGION_LAYERS_COUNT; i++) {
+        io::create_directories(layers[i].folder);
+        unsaved[i] = layers[i].takeUnsaved();
+        total += unsaved[i].size();
+    }
+    size_t done = 0;
+    for (size_t i = 0; i < REGION_LAYERS_COUNT; i++) {
+        auto& layer = layers[i];
+        const auto& regions = unsaved[i];
+        for (size_t j = 0; j < regions.size(); j++) {
+            const auto& [key, region] = regions[j];
+            try {
+                layer.writeRegion(key[0], key[1], region.get());
+            } catch (const std::exception&) {
+                // will be written next time
+                for (size_t k = i; k < REGION_LAYERS_COUNT; k++) {
+                    std::lock_guard lock(layers[k].mapMutex);
+                    for (size_t n = (k == i ? j : 0); n < unsaved[k].size(); n++) {
+                        unsaved[k][n].second->setUnsaved(true);
+                    }
+                }
+                throw;
+            }
+            if (onProgress) {
+                onProgress(++done, total);
+            }
+        }
+    }
+    for (auto& regions : unsaved) {
+        regions.clear();
+    }
+    trimCache();
+}
+
+void WorldRegions::setCacheBudget(size_t bytes) {
+    cacheBudget = bytes;
+    trimCache();
+}
+
+size_t WorldRegions::getCacheBudget() const {
+    return cacheBudget;
+}
+
+const RegionsCacheStats& WorldRegions::getCacheStats() const {
+    return cacheStats;
+}
+
+void WorldRegions::trimCache() {
+    size_t budget = cacheBudget;
+    if (budget == 0 || cacheStats.residentBytes <= budget) {
+        return;
+    }
     for (auto& layer : layers) {
-        io::create_directories(layer.folder);
-        layer.writeAll();
+        layer.evictClean(budget);
+        if (cacheStats.residentBytes <= budget) {
+            return;
+        }
     }
+    // unsaved regions are written by the next save
+    logger.debug() << "regions cache exceeds the budget: "
+                   << cacheStats.residentBytes / 1024 << " KiB used";
 }
 
 void WorldRegions::deleteRegion(RegionLayerIndex layerid, int x, int z) {
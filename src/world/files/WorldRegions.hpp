@@ -1,18 +1,25 @@
 #pragma once
 
 #include <array>
+#include <atomic>
+#include <bitset>
 #include <condition_variable>
 #include <functional>
 #include <glm/glm.hpp>
+#include <list>
 #include <memory>
 #include <mutex>
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include "coders/compression.hpp"
 #include "io/io.hpp"
+#include "io/mapped_file.hpp"
 #include "maths/voxmaths.hpp"
 #include "typedefs.hpp"
 #include "util/BufferPool.hpp"
+#include "util/span.hpp"
 #include "voxels/Chunk.hpp"
 #include "world_regions_fwd.hpp"
 
@@ -25,6 +32,15 @@ inline constexpr uint REGION_SIZE_BIT = 5;
 inline constexpr uint REGION_SIZE = (1 << (REGION_SIZE_BIT));
 inline constexpr uint REGION_CHUNKS_COUNT = ((REGION_SIZE) * (REGION_SIZE));
 
+/// @brief Region file allocation unit (since format version 4)
+inline constexpr uint REGION_SECTOR_SIZE = 512;
+/// @brief Chunks table (sector index and sectors count pairs) size
+inline constexpr uint REGION_TABLE_SIZE = REGION_CHUNKS_COUNT * 8;
+/// @brief First sector available for chunks data
+inline constexpr uint REGION_DATA_SECTOR =
+    (REGION_HEADER_SIZE + REGION_TABLE_SIZE + REGION_SECTOR_SIZE - 1) /
+    REGION_SECTOR_SIZE;
+
 class illegal_region_format : public std::runtime_error {
 public:
     illegal_region_format(const std::string& message)
@@ -35,52 +51,101 @@ public:
 class WorldRegion {
     std::unique_ptr<std::unique_ptr<ubyte[]>[]> chunksData;
     std::unique_ptr<glm::u32vec2[]> sizes;
+    /// @brief Chunks changed since last region write
+    std::bitset<REGION_CHUNKS_COUNT> unsavedChunks;
     bool unsaved = false;
+    /// @brief Stored chunks data size in bytes
+    size_t dataSize = 0;
 public:
+    /// @brief Position in the layer regions LRU list
+    std::list<glm::ivec2>::iterator lruEntry;
+
     WorldRegion();
     ~WorldRegion();
 
-    void put(uint x, uint z, std::unique_ptr<ubyte[]> data, uint32_t size, uint32_t srcSize);
+    /// @param unsaved false if data is read from region file
+    void put(
+        uint x,
+        uint z,
+        std::unique_ptr<ubyte[]> data,
+        uint32_t size,
+        uint32_t srcSize,
+        bool unsaved = true
+    );
     ubyte* getChunkData(uint x, uint z);
     glm::u32vec2 getChunkDataSize(uint x, uint z);
 
+    /// @return true if chunk data was put (or removed) since last write
+    bool isChunkUnsaved(uint x, uint z) const;
+
+    /// @brief Get changed chunks and reset them
+    std::bitset<REGION_CHUNKS_COUNT> takeUnsavedChunks();
+
+    /// @brief Mark chunks unsaved again (if writing failed)
+    void restoreUnsavedChunks(const std::bitset<REGION_CHUNKS_COUNT>& chunks);
+
     void setUnsaved(bool unsaved);
     bool isUnsaved() const;
 
+    /// @return true if region has no changes to be written
+    bool isClean() const;
+
+    /// @return approximate number of bytes used by the region
+    size_t getMemoryUsage() const;
+
     std::unique_ptr<ubyte[]>* getChunks() const;
     glm::u32vec2* getSizes() const;
 };
 
+/// @brief Memory-mapped region file. May be read by multiple threads
+/// simultaneously
 struct regfile {
-    io::rafile file;
+    io::mapped_file file;
     io::path filename;
     int version;
-    bool inUse = false;
-    std::array<uint32_t, REGION_CHUNKS_COUNT> offsets;
+    /// @brief Number of regfile_ptr using the file
+    uint users = 0;
+    /// @brief Position in the open region files LRU list
+    std::list<glm::ivec2>::iterator lruEntry;
+    /// @brief Chunks data offsets in bytes (0 if chunk is not present)
+    std::array<size_t, REGION_CHUNKS_COUNT> offsets;
 
     regfile(io::path filename);
     regfile(const regfile&) = delete;
 
-    std::unique_ptr<ubyte[]> read(int index, uint32_t& size, uint32_t& srcSize);
+    /// @brief Get chunk data without copying
+    /// @param index chunk index in region
+    /// @param srcSize [out] source chunk data length
+    /// @return span of the mapped file or empty span (nullptr data)
+    /// if chunk is not present
+    util::span<ubyte> getChunk(int index, uint32_t& srcSize) const;
+
+    std::unique_ptr<ubyte[]> read(
+        int index, uint32_t& size, uint32_t& srcSize
+    ) const;
 };
 
-using RegionsMap = std::unordered_map<glm::ivec2, std::unique_ptr<WorldRegion>>;
+using RegionsMap = std::unordered_map<glm::ivec2, std::shared_ptr<WorldRegion>>;
 using RegionProc = std::function<std::unique_ptr<ubyte[]>(std::unique_ptr<ubyte[]>,uint32_t*)>;
 using InventoryProc = std::function<void(Inventory*)>;
+using ChunkDataProc = std::function<void(util::span<ubyte>, uint32_t)>;
 using BlockDataProc = std::function<void(BlocksMetadata*, std::unique_ptr<ubyte[]>)>;
 
-/// @brief Region file pointer keeping inUse flag on until destroyed
+/// @brief Region file pointer keeping the file in use until destroyed
 class regfile_ptr {
     regfile* file;
+    std::mutex* mutex;
     std::condition_variable* cv;
 public:
-    regfile_ptr(regfile* file, std::condition_variable* cv)
-        : file(file), cv(cv) {
+    regfile_ptr(
+        regfile* file, std::mutex* mutex, std::condition_variable* cv
+    )
+        : file(file), mutex(mutex), cv(cv) {
     }
 
     regfile_ptr(const regfile_ptr&) = delete;
 
-    regfile_ptr(std::nullptr_t) : file(nullptr), cv(nullptr) {
+    regfile_ptr(std::nullptr_t) : file(nullptr), mutex(nullptr), cv(nullptr) {
     }
 
     bool operator==(std::nullptr_t) const {
@@ -100,8 +165,11 @@ public:
     }
     void reset() {
         if (file) {
-            file->inUse = false;
-            cv->notify_one();
+            {
+                std::lock_guard lock(*mutex);
+                file->users--;
+            }
+            cv->notify_all();
             file = nullptr;
         }
     }
@@ -116,6 +184,18 @@ inline void calc_reg_coords(
     localZ = z - (regionZ * REGION_SIZE);
 }
 
+/// @brief In-memory regions cache counters shared by all regions layers
+struct RegionsCacheStats {
+    /// @brief Chunk data found in memory
+    std::atomic<size_t> hits = 0;
+    /// @brief Chunk data read from region file
+    std::atomic<size_t> misses = 0;
+    /// @brief Regions removed from memory
+    std::atomic<size_t> evictions = 0;
+    /// @brief Bytes used by in-memory regions
+    std::atomic<size_t> residentBytes = 0;
+};
+
 struct RegionsLayer {
     /// @brief Layer index
     RegionLayerIndex layer;
@@ -125,42 +205,95 @@ struct RegionsLayer {
 
     compression::Method compression = compression::Method::NONE;
 
-    /// @brief In-memory regions data
+    /// @brief In-memory regions data. Region that is not referenced
+    /// outside of the map and has no unsaved changes may be evicted
     RegionsMap regions;
 
+    /// @brief In-memory regions ordered from the most recently used
+    std::list<glm::ivec2> regionsLru;
+
+    /// @brief Regions cache counters (owned by WorldRegions)
+    RegionsCacheStats* cacheStats = nullptr;
+
     /// @brief In-memory regions map mutex
     std::mutex mapMutex;
 
     /// @brief Open region files map
     std::unordered_map<glm::ivec2, std::unique_ptr<regfile>> openRegFiles;
 
+    /// @brief Open region files ordered from the most recently used
+    std::list<glm::ivec2> regFilesLru;
+
+    /// @brief Region files being rewritten at the moment
+    std::unordered_set<glm::ivec2> writingRegFiles;
+
     /// @brief Open region files map mutex
     std::mutex regFilesMutex;
     std::condition_variable regFilesCv;
 
+    /// @brief Get open region file or open it. Waits if the file is being
+    /// rewritten
+    /// @param create open region file if it is not open yet
+    /// @return nullptr if region file does not exist or is not open
+    /// while create is false
     [[nodiscard]] regfile_ptr getRegFile(glm::ivec2 coord, bool create = true);
+    /// @attention regFilesMutex must be locked
     [[nodiscard]] regfile_ptr useRegFile(glm::ivec2 coord);
+    /// @attention regFilesMutex must be locked
     regfile_ptr createRegFile(glm::ivec2 coord);
+    /// @attention regFilesMutex must be locked
     void closeRegFile(glm::ivec2 coord);
+    /// @brief Close least recently used region file that is not in use
+    /// @attention regFilesMutex must be locked
+    /// @return false if all open region files are in use
+    bool closeUnusedRegFile();
 
-    WorldRegion* getRegion(int x, int z);
-    WorldRegion* getOrCreateRegion(int x, int z);
+    std::shared_ptr<WorldRegion> getRegion(int x, int z);
 
     io::path getRegionFilePath(int x, int z) const;
 
-    /// @brief Get chunk data. Read from file if not loaded yet.
+    /// @brief Put chunk data to in-memory region (created if not exists)
+    /// marking it unsaved. Thread-safe
     /// @param x chunk x coord
     /// @param z chunk z coord
-    /// @param size [out] compressed chunk data length
-    /// @param size [out] source chunk data length
-    /// @return nullptr if no saved chunk data found
-    [[nodiscard]] ubyte* getData(int x, int z, uint32_t& size, uint32_t& srcSize);
+    /// @param data compressed chunk data or nullptr to remove chunk
+    void putData(
+        int x,
+        int z,
+        std::unique_ptr<ubyte[]> data,
+        uint32_t size,
+        uint32_t srcSize
+    );
+
+    /// @brief Remove least recently used clean regions from memory until
+    /// the regions cache size is not greater than the budget. Thread-safe
+    /// @return number of evicted regions
+    size_t evictClean(size_t budget);
+
+    /// @brief Process chunk data without copying it (region file is
+    /// memory-mapped). Thread-safe
+    /// @param x chunk x coord
+    /// @param z chunk z coord
+    /// @param func called with compressed chunk data and source chunk data
+    /// length. Must not keep the span after return
+    /// @return false if no saved chunk data found
+    bool processData(int x, int z, const ChunkDataProc& func);
+
+    /// @brief Check if chunk data is saved without reading it. Thread-safe
+    /// @param x chunk x coord
+    /// @param z chunk z coord
+    bool hasData(int x, int z);
 
-    /// @brief Write or rewrite region file
+    /// @brief Write changed region chunks to the region file in place
+    /// (old format files are rewritten). Thread-safe
     /// @param x region X
     /// @param z region Z
     void writeRegion(int x, int y, WorldRegion* entry);
 
+    /// @brief Get unsaved regions and mark them saved. Thread-safe
+    std::vector<std::pair<glm::ivec2, std::shared_ptr<WorldRegion>>>
+    takeUnsaved();
+
     /// @brief Write all unsaved regions to files
     void writeAll();
 
@@ -176,11 +309,62 @@ struct RegionsLayer {
     );
 };
 
+/// @brief Chunk data read from all regions layers and decoded
+struct ChunkRegionsData {
+    /// @brief Decompressed voxels data or nullptr if chunk is not saved
+    std::unique_ptr<ubyte[]> voxels;
+    /// @brief Decompressed lights data or nullptr if not saved or not
+    /// requested
+    std::unique_ptr<ubyte[]> lights;
+    /// @brief Decompressed lights data length
+    size_t lightsSize = 0;
+    /// @brief Block inventories (not resized to actual blocks inventory
+    /// sizes and not registered)
+    ChunkInventoriesMap inventories;
+    /// @brief Saved entities data (see WorldRegions::fetchEntities)
+    dv::value entities = nullptr;
+    BlocksMetadata blocksData;
+};
+
+/// @brief Encoded chunk data ready to be put to regions
+struct ChunkSnapshot {
+    int x;
+    int z;
+    /// @brief Layers to be put
+    bool layers[REGION_LAYERS_COUNT] {};
+    /// @brief Not compressed layers data (nullptr to remove chunk data)
+    std::unique_ptr<ubyte[]> data[REGION_LAYERS_COUNT];
+    size_t sizes[REGION_LAYERS_COUNT] {};
+};
+
+using SaveProgressCallback = std::function<void(size_t done, size_t total)>;
+
 class WorldRegions {
     /// @brief World directory
     io::path directory;
 
     RegionsLayer layers[REGION_LAYERS_COUNT] {};
+
+    /// @brief Chunks snapshots waiting to be put in background
+    std::unordered_set<glm::ivec2> pendingSnapshots;
+    std::mutex snapshotsMutex;
+
+    RegionsCacheStats cacheStats;
+    /// @brief In-memory regions size limit in bytes (0 - not limited)
+    std::atomic<size_t> cacheBudget = 0;
+
+    /// @brief Chunks data write counters. Chunks share counters by
+    /// position hash, so a collision only makes data look outdated
+    std::unique_ptr<std::atomic<uint32_t>[]> chunkVersions;
+
+    void putLayer(
+        int x,
+        int z,
+        RegionLayerIndex layer,
+        std::unique_ptr<ubyte[]> data,
+        size_t size
+    );
+    void putLayers(ChunkSnapshot& snapshot);
 public:
     bool generatorTestMode = false;
     bool doWriteLights = true;
@@ -192,7 +376,29 @@ public:
     /// @brief Put all chunk data to regions
     void put(Chunk* chunk, std::vector<ubyte> entitiesData);
 
-    /// @brief Store data in specified region
+    /// @brief Encode unsaved chunk data
+    /// @param chunk target chunk
+    /// @param entitiesData chunk entities data
+    /// @return nullptr if there is nothing to save
+    std::unique_ptr<ChunkSnapshot> createSnapshot(
+        Chunk* chunk, std::vector<ubyte> entitiesData
+    );
+
+    /// @brief Put chunk snapshot to regions
+    void put(ChunkSnapshot& snapshot);
+
+    /// @brief Mark chunk snapshot as waiting to be put by putPending
+    void addPending(const ChunkSnapshot& snapshot);
+
+    /// @brief Put chunk snapshot if the chunk was not put after the snapshot
+    /// was marked pending. Thread-safe
+    /// @return false if the snapshot is outdated
+    bool putPending(ChunkSnapshot& snapshot);
+
+    /// @brief Unmark pending chunk snapshot without putting it. Thread-safe
+    void cancelPending(const ChunkSnapshot& snapshot);
+
+    /// @brief Store data in specified region. Outdates pending chunk snapshot
     /// @param x chunk.x
     /// @param z chunk.z
     /// @param layer regions layer
@@ -206,16 +412,38 @@ public:
         size_t size
     );
 
+    /// @brief Get chunk data version incremented after every put of the
+    /// chunk data. Data read after getting the version is outdated if
+    /// the version has changed. Thread-safe
+    /// @param x chunk.x
+    /// @param z chunk.z
+    uint32_t getChunkVersion(int x, int z) const;
+
     /// @brief Get chunk voxels data
     /// @param x chunk.x
     /// @param z chunk.z
     /// @return true if data read
     bool getVoxels(int x, int z, ubyte* dst);
 
-    /// @brief Get cached lights for chunk at x,z
-    /// @return true if data read
-    bool getLights(int x, int z, ubyte* dst);
-    
+    /// @brief Check if chunk voxels data is saved. Thread-safe
+    /// @param x chunk.x
+    /// @param z chunk.z
+    bool hasVoxels(int x, int z);
+
+    /// @brief Process chunk layer data as stored in regions (compressed
+    /// with the layer compression method) without copying it. Thread-safe
+    /// @param x chunk.x
+    /// @param z chunk.z
+    /// @param func called with stored chunk data and source chunk data
+    /// length. Must not keep the span after return
+    /// @return false if no saved chunk data found
+    bool processData(
+        int x, int z, RegionLayerIndex layerid, const ChunkDataProc& func
+    );
+
+    /// @brief Get compression method used to store layer data
+    compression::Method getCompression(RegionLayerIndex layerid) const;
+
     ChunkInventoriesMap fetchInventories(int x, int z);
 
     BlocksMetadata getBlocksData(int x, int z);
@@ -226,6 +454,12 @@ public:
     /// @return map with entities list as "data"
     dv::value fetchEntities(int x, int z);
 
+    /// @brief Read and decode all saved chunk data. Thread-safe
+    /// @param x chunk.x
+    /// @param z chunk.z
+    /// @param lights read lights cache
+    ChunkRegionsData readChunk(int x, int z, bool lights);
+
     /// @brief Load, process and save processed region chunks data
     /// @param x region X
     /// @param z region Z
@@ -245,8 +479,22 @@ public:
 
     io::path getRegionFilePath(RegionLayerIndex layerid, int x, int z) const;
 
-    /// @brief Write all region layers
-    void writeAll();
+    /// @brief Write all region layers. Thread-safe
+    /// @param onProgress called after each region file written
+    void writeAll(const SaveProgressCallback& onProgress = nullptr);
+
+    /// @brief Set in-memory regions size limit
+    /// @param bytes limit in bytes (0 - not limited)
+    void setCacheBudget(size_t bytes);
+
+    size_t getCacheBudget() const;
+
+    const RegionsCacheStats& getCacheStats() const;
+
+    /// @brief Evict clean regions to fit the cache budget. Unsaved regions
+    /// are never written here, so the budget may be exceeded until the
+    /// next save. Thread-safe
+    void trimCache();
 
     void deleteRegion(RegionLayerIndex layerid, int x, int z);
 
@@ -1,6 +1,7 @@
 #include "compatibility.hpp"
 
 #include <stdexcept>
+#include <vector>
 
 #include "constants.hpp"
 #include "voxels/voxel.hpp"
@@ -107,3 +108,64 @@ util::Buffer<ubyte> compatibility::convert_region_2to3(
     }
     return util::Buffer<ubyte>(builder.build().data(), builder.size());
 }
+
+util::Buffer<ubyte> compatibility::convert_region_3to4(
+    const util::Buffer<ubyte>& src
+) {
+    const size_t REGION_CHUNKS = 1024;
+    const size_t HEADER_SIZE = 10;
+    const size_t OFFSET_TABLE_SIZE = REGION_CHUNKS * sizeof(uint32_t);
+    const size_t SECTOR_SIZE = 512;
+    const size_t CHUNKS_TABLE_SIZE = REGION_CHUNKS * sizeof(uint32_t) * 2;
+    const size_t DATA_SECTOR =
+        (HEADER_SIZE + CHUNKS_TABLE_SIZE + SECTOR_SIZE - 1) / SECTOR_SIZE;
+
+    const ubyte* const ptr = src.data();
+    if (src.size() < HEADER_SIZE + OFFSET_TABLE_SIZE) {
+        throw std::runtime_error("invalid region file");
+    }
+    size_t tableOffset = src.size() - OFFSET_TABLE_SIZE;
+    auto tablePtr = reinterpret_cast<const uint32_t*>(ptr + tableOffset);
+
+    uint32_t sectors[REGION_CHUNKS] {};
+    uint32_t counts[REGION_CHUNKS] {};
+
+    ByteBuilder builder;
+    builder.putCStr(".VOXREG");
+    builder.put(4);
+    builder.put(ptr[9]);  // compression method
+    std::vector<ubyte> zeros(DATA_SECTOR * SECTOR_SIZE - builder.size());
+    builder.put(zeros.data(), zeros.size());
+
+    for (size_t i = 0; i < REGION_CHUNKS; i++) {
+        uint32_t srcOffset = dataio::le2h(tablePtr[i]);
+        if (srcOffset == 0) {
+            continue;
+        }
+        if (srcOffset + sizeof(uint32_t) * 2 > tableOffset) {
+            throw std::runtime_error("invalid region chunk offset");
+        }
+        const ubyte* chunkPtr = ptr + srcOffset;
+        uint32_t size = dataio::le2h(
+            *reinterpret_cast<const uint32_t*>(chunkPtr)
+        );
+        size_t length = size + sizeof(uint32_t) * 2;
+        if (srcOffset + length > tableOffset) {
+            throw std::runtime_error("invalid region chunk size");
+        }
+        sectors[i] = builder.size() / SECTOR_SIZE;
+        counts[i] = (length + SECTOR_SIZE - 1) / SECTOR_SIZE;
+        builder.put(chunkPtr, length);
+
+        size_t padding = counts[i] * SECTOR_SIZE - length;
+        zeros.assign(padding, 0);
+        builder.put(zeros.data(), padding);
+    }
+    auto bytes = builder.build();
+    auto dstTable = reinterpret_cast<uint32_t*>(bytes.data() + HEADER_SIZE);
+    for (size_t i = 0; i < REGION_CHUNKS; i++) {
+        dstTable[i * 2] = dataio::h2le(sectors[i]);
+        dstTable[i * 2 + 1] = dataio::h2le(counts[i]);
+    }
+    return util::Buffer<ubyte>(bytes.data(), bytes.size());
+}
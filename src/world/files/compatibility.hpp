@@ -6,9 +6,16 @@
 
 namespace compatibility {
     /// @brief Convert region file from version 2 to 3
-    /// @see /doc/specs/region_file_spec.md
+    /// @see /doc/specs/outdated/region_file_spec_v3.md
     /// @param src region file source content
     /// @return new region file content
     util::Buffer<ubyte> convert_region_2to3(
         const util::Buffer<ubyte>& src, RegionLayerIndex layer);
+
+    /// @brief Convert region file from version 3 to 4
+    /// (chunks are aligned to sectors, table is placed after header)
+    /// @see /doc/specs/region_file_spec.md
+    /// @param src region file source content
+    /// @return new region file content
+    util::Buffer<ubyte> convert_region_3to4(const util::Buffer<ubyte>& src);
 }
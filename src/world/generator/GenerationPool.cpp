@@ -0,0 +1,154 @@
+#include "GenerationPool.hpp"
+
+#include <stdexcept>
+
+#include "constants.hpp"
+#include "debug/Logger.hpp"
+#include "GeneratorDef.hpp"
+#include "WorldGenerator.hpp"
+
+static debug::Logger logger("generation-pool");
+
+/// @brief Max number of chunks in work per worker
+static inline constexpr size_t MAX_CHUNKS_PER_WORKER = 4;
+
+class GeneratorWorker : public util::Worker<GenerationJob, GenerationResult> {
+    const WorldGenerator& generator;
+    util::BufferPool<voxel>& buffers;
+    std::unique_ptr<GeneratorScript> script;
+public:
+    GeneratorWorker(
+        const WorldGenerator& generator, util::BufferPool<voxel>& buffers
+    )
+        : generator(generator),
+          buffers(buffers),
+          script(generator.getDef().script->createInstance()) {
+        script->initialize(generator.getSeed());
+    }
+
+    GenerationResult operator()(const GenerationJob& job) override {
+        GenerationResult result {
+            job.type, job.pos, job.prototype, nullptr, nullptr};
+        try {
+            switch (job.type) {
+                case GenerationJob::Type::MAPS:
+                    result.maps =
+                        generator.generateMaps(*script, job.pos.x, job.pos.y);
+                    break;
+                case GenerationJob::Type::VOXELS: {
+                    auto voxels = buffers.get();
+                    generator.generateVoxels(
+                        *job.prototype, voxels.get(), job.pos.x, job.pos.y
+                    );
+                    result.voxels = std::move(voxels);
+                    break;
+                }
+            }
+        } catch (const std::exception& err) {
+            // will be generated in the main thread
+            logger.error() << "chunk " << job.pos.x << "x" << job.pos.y
+                           << " generation failed: " << err.what();
+        }
+        return result;
+    }
+};
+
+GenerationPool::GenerationPool(
+    WorldGenerator& generator, int maxWorkers, VoxelsConsumer consumer
+)
+    : generator(generator),
+      consumer(std::move(consumer)),
+      buffers(CHUNK_VOL),
+      threadPool(
+          "generation-pool",
+          [&]() {
+              return std::make_unique<GeneratorWorker>(
+                  generator, buffers
+              );
+          },
+          [this](GenerationResult&& result) {
+              processResult(std::move(result));
+          },
+          maxWorkers
+      ) {
+    threadPool.setStopOnFail(false);
+    logger.info() << "created " << threadPool.getWorkersCount() << " workers";
+}
+
+GenerationPool::~GenerationPool() = default;
+
+void GenerationPool::enqueue(int x, int z) {
+    chunks.try_emplace({x, z}, Stage::MAPS);
+}
+
+bool GenerationPool::isInWork(int x, int z) const {
+    return chunks.find({x, z}) != chunks.end();
+}
+
+bool GenerationPool::isFull() const {
+    return chunks.size() >=
+           threadPool.getWorkersCount() * MAX_CHUNKS_PER_WORKER;
+}
+
+void GenerationPool::update(const std::function<bool(int, int)>& isRequired) {
+    for (auto it = chunks.begin(); it != chunks.end();) {
+        const auto& pos = it->first;
+        if (it->second != Stage::MAPS) {
+            ++it;
+            continue;
+        }
+        if (!isRequired(pos.x, pos.y)) {
+            it = chunks.erase(it);
+            continue;
+        }
+        for (const auto& mapsPos : generator.requestMaps(pos.x, pos.y)) {
+            threadPool.enqueueJob(
+                GenerationJob {GenerationJob::Type::MAPS, mapsPos, nullptr}
+            );
+        }
+        if (!generator.isMapsReady(pos.x, pos.y)) {
+            ++it;
+            continue;
+        }
+        std::shared_ptr<const ChunkPrototype> prototype;
+        try {
+            prototype = generator.completePrototype(pos.x, pos.y);
+        } catch (const std::invalid_argument&) {
+            // out of the current generator area
+            ++it;
+            continue;
+        } catch (const std::runtime_error& err) {
+            // dropped to be enqueued again by the chunks controller
+            logger.error() << "chunk " << pos.x << "x" << pos.y
+                           << " prototype completion failed: " << err.what();
+            it = chunks.erase(it);
+            continue;
+        }
+        threadPool.enqueueJob(GenerationJob {
+            GenerationJob::Type::VOXELS, pos, std::move(prototype)});
+        it->second = Stage::VOXELS;
+        ++it;
+    }
+    threadPool.pullResults();
+}
+
+void GenerationPool::processResult(GenerationResult&& result) {
+    const auto& pos = result.pos;
+    switch (result.type) {
+        case GenerationJob::Type::MAPS:
+            generator.putMaps(pos.x, pos.y, std::move(result.maps));
+            break;
+        case GenerationJob::Type::VOXELS: {
+            chunks.erase(pos);
+            auto voxels = std::move(result.voxels);
+            if (voxels == nullptr) {
+                voxels = buffers.get();
+                generator.generateVoxels(
+                    *result.prototype, voxels.get(), pos.x, pos.y
+                );
+            }
+            consumer(pos.x, pos.y, voxels.get());
+            break;
+        }
+    }
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <memory>
+#include <functional>
+#include <unordered_map>
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/glm.hpp>
+#include <glm/gtx/hash.hpp>
+
+#include "typedefs.hpp"
+#include "voxels/voxel.hpp"
+#include "util/BufferPool.hpp"
+#include "util/ThreadPool.hpp"
+
+class WorldGenerator;
+struct ChunkPrototype;
+
+struct GenerationJob {
+    enum class Type {
+        /// @brief Generate chunk biomes and heightmap
+        MAPS,
+        /// @brief Generate chunk voxels using completed prototype
+        VOXELS
+    };
+
+    Type type;
+    glm::ivec2 pos;
+    /// @brief Completed chunk prototype (VOXELS jobs only)
+    std::shared_ptr<const ChunkPrototype> prototype;
+};
+
+struct GenerationResult {
+    GenerationJob::Type type;
+    glm::ivec2 pos;
+    std::shared_ptr<const ChunkPrototype> prototype;
+    /// @brief Generated biomes and heightmap or nullptr if failed
+    std::shared_ptr<ChunkPrototype> maps;
+    /// @brief Generated chunk voxels or nullptr if failed
+    std::shared_ptr<voxel[]> voxels;
+};
+
+/// @brief Multi-threaded chunks generation pipeline. Chunk passes stages:
+/// 1. biomes and heightmaps required to complete the chunk prototype are
+/// generated by workers, each one using its own generator script instance;
+/// 2. the prototype is completed in the main thread (structures placement);
+/// 3. chunk voxels are generated by workers;
+/// 4. generated voxels are passed to the consumer in the main thread.
+/// @attention Generator script functions used for biomes and heightmaps
+/// generation must not depend on state shared between calls
+class GenerationPool {
+public:
+    /// @brief Generated chunk voxels consumer
+    using VoxelsConsumer =
+        std::function<void(int x, int z, const voxel* voxels)>;
+private:
+    enum class Stage {
+        MAPS, VOXELS
+    };
+
+    WorldGenerator& generator;
+    VoxelsConsumer consumer;
+    util::BufferPool<voxel> buffers;
+    std::unordered_map<glm::ivec2, Stage> chunks;
+    util::ThreadPool<GenerationJob, GenerationResult> threadPool;
+
+    void processResult(GenerationResult&& result);
+public:
+    /// @param generator world generator used in main and worker threads
+    /// @param maxWorkers max number of workers (see util::ThreadPool)
+    /// @param consumer generated chunk voxels consumer
+    GenerationPool(
+        WorldGenerator& generator, int maxWorkers, VoxelsConsumer consumer
+    );
+    ~GenerationPool();
+
+    /// @brief Enqueue chunk generation
+    void enqueue(int x, int z);
+
+    /// @return true if the chunk is being generated
+    bool isInWork(int x, int z) const;
+
+    /// @return true if no more chunks should be enqueued at the moment
+    bool isFull() const;
+
+    /// @brief Complete prototypes of chunks with generated maps and process
+    /// workers results. Must be called after WorldGenerator::update(...)
+    /// @param isRequired checks if the chunk waiting for maps is still required
+    void update(const std::function<bool(int, int)>& isRequired);
+
+    size_t getChunksInWork() const {
+        return chunks.size();
+    }
+
+    uint getWorkersCount() const {
+        return threadPool.getWorkersCount();
+    }
+};
@@ -129,6 +129,11 @@ public:
 
     virtual void initialize(uint64_t seed) = 0;
 
+    /// @brief Create an independent not initialized script instance with its
+    /// own state to use in a generator worker thread.
+    /// Must be called from the main thread
+    virtual std::unique_ptr<GeneratorScript> createInstance() const = 0;
+
     /// @brief Generate a heightmap with values in range 0..1
     /// @param offset position of the heightmap in the world
     /// @param size size of the heightmap
@@ -23,6 +23,10 @@ static inline constexpr uint MAX_PARAMETERS = 4;
 /// @brief Initial + wide_structs + biomes + heightmaps + complete
 static inline constexpr uint BASIC_PROTOTYPE_LAYERS = 5;
 
+/// @brief Biomes are generated at (levels - 3) level, so prototype completion
+/// requires biomes and heightmaps in this radius
+static inline constexpr int MAPS_RADIUS = 3;
+
 WorldGenerator::WorldGenerator(
     const GeneratorDef& def, const Content& content, uint64_t seed
 )
@@ -43,7 +47,7 @@ WorldGenerator::WorldGenerator(
             logger.warning() << "unable to remove non-existing chunk prototype";
             return;
         }
-        prototypes.erase({x, z});
+        prototypes.erase(found);
     });
     surroundMap.setLevelCallback(1, [this](int const x, int const z) {
         if (prototypes.find({x, z}) != prototypes.end()) {
@@ -336,14 +340,15 @@ void WorldGenerator::generateStructures(
     prototype.level = ChunkPrototypeLevel::STRUCTURES;
 }
 
-void WorldGenerator::generateBiomes(
-    ChunkPrototype& prototype, int chunkX, int chunkZ
+static void generate_biomes(
+    const GeneratorDef& def,
+    GeneratorScript& script,
+    ChunkPrototype& prototype,
+    int chunkX,
+    int chunkZ
 ) {
-    if (prototype.level >= ChunkPrototypeLevel::BIOMES) {
-        return;
-    }
     uint bpd = def.biomesBPD;
-    auto biomeParams = def.script->generateParameterMaps(
+    auto biomeParams = script.generateParameterMaps(
         {floordiv(chunkX * CHUNK_W, bpd), floordiv(chunkZ * CHUNK_D, bpd)},
         {floordiv(CHUNK_W, bpd)+1, floordiv(CHUNK_D, bpd)+1},
         bpd
@@ -377,14 +382,15 @@ void WorldGenerator::generateBiomes(
     prototype.level = ChunkPrototypeLevel::BIOMES;
 }
 
-void WorldGenerator::generateHeightmap(
-    ChunkPrototype& prototype, int chunkX, int chunkZ
+static void generate_heightmap(
+    const GeneratorDef& def,
+    GeneratorScript& script,
+    ChunkPrototype& prototype,
+    int chunkX,
+    int chunkZ
 ) {
-    if (prototype.level >= ChunkPrototypeLevel::HEIGHTMAP) {
-        return;
-    }
     uint bpd = def.heightsBPD;
-    prototype.heightmap = def.script->generateHeightmap(
+    prototype.heightmap = script.generateHeightmap(
         {floordiv(chunkX * CHUNK_W, bpd), floordiv(chunkZ * CHUNK_D, bpd)},
         {floordiv(CHUNK_W, bpd)+1, floordiv(CHUNK_D, bpd)+1},
         bpd,
@@ -395,23 +401,135 @@ void WorldGenerator::generateHeightmap(
         CHUNK_W + bpd, CHUNK_D + bpd, def.heightsInterpolation
     );
     prototype.heightmap->crop(0, 0, CHUNK_W, CHUNK_D);
+    prototype.heightmapInputs.clear();
     prototype.level = ChunkPrototypeLevel::HEIGHTMAP;
 }
 
+void WorldGenerator::generateBiomes(
+    ChunkPrototype& prototype, int chunkX, int chunkZ
+) {
+    if (prototype.level >= ChunkPrototypeLevel::BIOMES) {
+        return;
+    }
+    const auto& found = prebuiltMaps.find({chunkX, chunkZ});
+    if (found != prebuiltMaps.end()) {
+        auto maps = std::move(found->second);
+        prebuiltMaps.erase(found);
+        if (maps) {
+            prototype.biomes = std::move(maps->biomes);
+            // heightmap is applied in generateHeightmap
+            prototype.heightmap = std::move(maps->heightmap);
+            prototype.level = ChunkPrototypeLevel::BIOMES;
+            return;
+        }
+    }
+    generate_biomes(def, *def.script, prototype, chunkX, chunkZ);
+}
+
+void WorldGenerator::generateHeightmap(
+    ChunkPrototype& prototype, int chunkX, int chunkZ
+) {
+    if (prototype.level >= ChunkPrototypeLevel::HEIGHTMAP) {
+        return;
+    }
+    if (prototype.heightmap) {
+        // prebuilt heightmap
+        prototype.level = ChunkPrototypeLevel::HEIGHTMAP;
+        return;
+    }
+    generate_heightmap(def, *def.script, prototype, chunkX, chunkZ);
+}
+
+std::shared_ptr<ChunkPrototype> WorldGenerator::generateMaps(
+    GeneratorScript& script, int chunkX, int chunkZ
+) const {
+    auto maps = std::make_shared<ChunkPrototype>();
+    generate_biomes(def, script, *maps, chunkX, chunkZ);
+    generate_heightmap(def, script, *maps, chunkX, chunkZ);
+    return maps;
+}
+
+std::vector<glm::ivec2> WorldGenerator::requestMaps(int chunkX, int chunkZ) {
+    std::vector<glm::ivec2> positions;
+    const auto& area = surroundMap.getArea();
+    for (int lz = -MAPS_RADIUS; lz <= MAPS_RADIUS; lz++) {
+        for (int lx = -MAPS_RADIUS; lx <= MAPS_RADIUS; lx++) {
+            glm::ivec2 pos(chunkX + lx, chunkZ + lz);
+            if (!area.isInside(pos.x, pos.y) ||
+                requestedMaps.find(pos) != requestedMaps.end() ||
+                prebuiltMaps.find(pos) != prebuiltMaps.end()) {
+                continue;
+            }
+            const auto& found = prototypes.find(pos);
+            if (found != prototypes.end() &&
+                found->second->level >= ChunkPrototypeLevel::BIOMES) {
+                continue;
+            }
+            requestedMaps.insert(pos);
+            positions.push_back(pos);
+        }
+    }
+    return positions;
+}
+
+bool WorldGenerator::isMapsReady(int chunkX, int chunkZ) const {
+    for (int lz = -MAPS_RADIUS; lz <= MAPS_RADIUS; lz++) {
+        for (int lx = -MAPS_RADIUS; lx <= MAPS_RADIUS; lx++) {
+            glm::ivec2 pos(chunkX + lx, chunkZ + lz);
+            if (requestedMaps.find(pos) != requestedMaps.end()) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void WorldGenerator::putMaps(
+    int chunkX, int chunkZ, std::shared_ptr<ChunkPrototype> maps
+) {
+    glm::ivec2 pos(chunkX, chunkZ);
+    if (requestedMaps.erase(pos) == 0) {
+        // out of area already
+        return;
+    }
+    const auto& found = prototypes.find(pos);
+    if (found != prototypes.end() &&
+        found->second->level >= ChunkPrototypeLevel::BIOMES) {
+        return;
+    }
+    prebuiltMaps[pos] = std::move(maps);
+}
+
 void WorldGenerator::update(int centerX, int centerY, int loadDistance) {
     surroundMap.setCenter(centerX, centerY);
     surroundMap.resize(loadDistance);
     surroundMap.setCenter(centerX, centerY);
+
+    const auto& area = surroundMap.getArea();
+    for (auto it = prebuiltMaps.begin(); it != prebuiltMaps.end();) {
+        if (area.isInside(it->first.x, it->first.y)) {
+            ++it;
+        } else {
+            it = prebuiltMaps.erase(it);
+        }
+    }
+    for (auto it = requestedMaps.begin(); it != requestedMaps.end();) {
+        if (area.isInside(it->x, it->y)) {
+            ++it;
+        } else {
+            it = requestedMaps.erase(it);
+        }
+    }
 }
 
 void WorldGenerator::generatePlants(
     const ChunkPrototype& prototype,
-    float* heights,
+    const float* heights,
     voxel* voxels,
     int chunkX,
     int chunkZ,
-    const Biome** biomes
-) {
+    const Biome* const* biomes
+) const {
     const auto& indices = content.getIndices()->blocks;
     util::PseudoRandom plantsRand;
     plantsRand.setSeed(chunkX, chunkZ);
@@ -448,12 +566,12 @@ void WorldGenerator::generatePlants(
 
 void WorldGenerator::generateLand(
     const ChunkPrototype& prototype,
-    float* values,
+    const float* values,
     voxel* voxels,
     int chunkX,
     int chunkZ,
-    const Biome** biomes
-) {
+    const Biome* const* biomes
+) const {
     uint seaLevel = def.seaLevel;
     for (uint z = 0; z < CHUNK_D; z++) {
         for (uint x = 0; x < CHUNK_W; x++) {
@@ -472,10 +590,25 @@ void WorldGenerator::generateLand(
 }
 
 void WorldGenerator::generate(voxel* voxels, int chunkX, int chunkZ) {
+    generateVoxels(*completePrototype(chunkX, chunkZ), voxels, chunkX, chunkZ);
+}
+
+std::shared_ptr<const ChunkPrototype> WorldGenerator::completePrototype(
+    int chunkX, int chunkZ
+) {
     surroundMap.completeAt(chunkX, chunkZ);
 
-    const auto& prototype = requirePrototype(chunkX, chunkZ);
-    const auto values = prototype.heightmap->getValues();
+    const auto& found = prototypes.find({chunkX, chunkZ});
+    if (found == prototypes.end()) {
+        throw std::runtime_error("prototype not found");
+    }
+    return found->second;
+}
+
+void WorldGenerator::generateVoxels(
+    const ChunkPrototype& prototype, voxel* voxels, int chunkX, int chunkZ
+) const {
+    const float* values = prototype.heightmap->getValues();
 
     uint seaLevel = def.seaLevel;
 
@@ -515,7 +648,7 @@ void WorldGenerator::generate(voxel* voxels, int chunkX, int chunkZ) {
 
 void WorldGenerator::generatePlacements(
     const ChunkPrototype& prototype, voxel* voxels, int chunkX, int chunkZ
-) {
+) const {
     auto placements = prototype.placements;
     std::stable_sort(
         placements.begin(),
@@ -540,7 +673,7 @@ void WorldGenerator::generateStructure(
     const StructurePlacement& placement,
     voxel* voxels, 
     int chunkX, int chunkZ
-) {
+) const {
     if (placement.structure < 0 || placement.structure >= def.structures.size()) {
         logger.error() << "invalid structure index " << placement.structure;
         return;
@@ -581,7 +714,7 @@ void WorldGenerator::generateLine(
     const LinePlacement& line,
     voxel* voxels, 
     int chunkX, int chunkZ
-) {
+) const {
     const auto& indices = content.getIndices()->blocks;
 
     int cgx = chunkX * CHUNK_W;
@@ -642,7 +775,7 @@ void WorldGenerator::generateBlock(
     const BlockPlacement& placement,
     voxel* voxels,
     int chunkX, int chunkZ
-) {
+) const {
     const auto& indices = content.getIndices()->blocks;
     const auto& def = indices.require(placement.block);
 
@@ -5,6 +5,7 @@
 #include <memory>
 #include <vector>
 #include <unordered_map>
+#include <unordered_set>
 
 #include "constants.hpp"
 #include "typedefs.hpp"
@@ -17,6 +18,7 @@ struct GeneratorDef;
 class Heightmap;
 struct Biome;
 class VoxelFragment;
+class GeneratorScript;
 
 enum class ChunkPrototypeLevel {
     VOID=0, WIDE_STRUCTS, BIOMES, HEIGHTMAP, STRUCTURES
@@ -54,7 +56,12 @@ class WorldGenerator {
     /// @param seed world seed
     uint64_t seed;
     /// @brief Chunk prototypes main storage
-    std::unordered_map<glm::ivec2, std::unique_ptr<ChunkPrototype>> prototypes;
+    std::unordered_map<glm::ivec2, std::shared_ptr<ChunkPrototype>> prototypes;
+    /// @brief Biomes and heightmaps generated ahead (see generateMaps).
+    /// nullptr value means that maps must be generated in the main thread
+    std::unordered_map<glm::ivec2, std::shared_ptr<ChunkPrototype>> prebuiltMaps;
+    /// @brief Positions of requested but not received prebuilt maps
+    std::unordered_set<glm::ivec2> requestedMaps;
     /// @brief Chunk prototypes loading surround map
     SurroundMap surroundMap;
 
@@ -83,41 +90,41 @@ class WorldGenerator {
 
     void generatePlacements(
         const ChunkPrototype& prototype, voxel* voxels, int x, int z
-    );
+    ) const;
     void generateLine(
         const ChunkPrototype& prototype, 
         const LinePlacement& placement,
         voxel* voxels, 
         int x, int z
-    );
+    ) const;
     void generateBlock(
         const ChunkPrototype& prototype,
         const BlockPlacement& placement,
         voxel* voxels,
         int x, int z
-    );
+    ) const;
     void generateStructure(
         const ChunkPrototype& prototype, 
         const StructurePlacement& placement,
         voxel* voxels, 
         int x, int z
-    );
+    ) const;
     void generatePlants(
         const ChunkPrototype& prototype,
-        float* values,
+        const float* values,
         voxel* voxels,
         int x,
         int z,
-        const Biome** biomes
-    );
+        const Biome* const* biomes
+    ) const;
     void generateLand(
         const ChunkPrototype& prototype,
-        float* values,
+        const float* values,
         voxel* voxels,
         int x,
         int z,
-        const Biome** biomes
-    );
+        const Biome* const* biomes
+    ) const;
 
     void placeStructures(
         const std::vector<Placement>& placements,
@@ -140,6 +147,51 @@ public:
     /// @param z chunk position Y divided by CHUNK_D
     void generate(voxel* voxels, int x, int z);
 
+    /// @brief Complete chunk prototype generation (main thread only).
+    /// Completed prototype is not modified anymore
+    /// @param x chunk position X divided by CHUNK_W
+    /// @param z chunk position Y divided by CHUNK_D
+    /// @throws std::invalid_argument - chunk is out of generator area
+    /// @throws std::runtime_error - prototype was not generated
+    std::shared_ptr<const ChunkPrototype> completePrototype(int x, int z);
+
+    /// @brief Generate chunk voxels using completed prototype.
+    /// Thread-safe
+    /// @param prototype completed chunk prototype
+    /// @param voxels destinatiopn chunk voxels buffer
+    /// @param x chunk position X divided by CHUNK_W
+    /// @param z chunk position Y divided by CHUNK_D
+    void generateVoxels(
+        const ChunkPrototype& prototype, voxel* voxels, int x, int z
+    ) const;
+
+    /// @brief Generate chunk biomes and heightmap independently from the
+    /// prototypes storage. Thread-safe if every thread uses its own script
+    /// instance (see GeneratorScript::createInstance)
+    /// @param script generator script instance
+    /// @param x chunk position X divided by CHUNK_W
+    /// @param z chunk position Y divided by CHUNK_D
+    /// @return prototype with biomes and heightmap only
+    std::shared_ptr<ChunkPrototype> generateMaps(
+        GeneratorScript& script, int x, int z
+    ) const;
+
+    /// @brief Mark maps required to complete the chunk prototype as requested
+    /// @return positions of maps not generated nor requested yet
+    std::vector<glm::ivec2> requestMaps(int x, int z);
+
+    /// @brief Check if no maps required to complete the chunk prototype
+    /// are still being generated
+    bool isMapsReady(int x, int z) const;
+
+    /// @brief Store biomes and heightmap generated ahead
+    /// @param maps generateMaps result or nullptr if generation failed
+    void putMaps(int x, int z, std::shared_ptr<ChunkPrototype> maps);
+
+    const GeneratorDef& getDef() const {
+        return def;
+    }
+
     WorldGenDebugInfo createDebugInfo() const;
 
     uint64_t getSeed() const;
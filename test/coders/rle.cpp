@@ -48,3 +48,18 @@ TEST(ExtRLE16, EncodeDecode) {
     test_encode_decode(extrle::encode16, extrle::decode16, 13);
     test_encode_decode(extrle::encode16, extrle::decode16, 90123);
 }
+
+TEST(ExtRLE16, DecodeOverflow) {
+    uint16_t initial[64] {};
+    ubyte encoded[sizeof(initial) * 2];
+    size_t encoded_size = extrle::encode16(
+        reinterpret_cast<const ubyte*>(initial), sizeof(initial), encoded
+    );
+    uint16_t decoded[64];
+    EXPECT_THROW(
+        extrle::decode16(
+            encoded, encoded_size, reinterpret_cast<ubyte*>(decoded), 64
+        ),
+        std::runtime_error
+    );
+}
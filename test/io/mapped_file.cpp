@@ -0,0 +1,31 @@
+#include <gtest/gtest.h>
+
+#include <cstring>
+
+#include "io/io.hpp"
+#include "io/mapped_file.hpp"
+#include "io/devices/StdfsDevice.hpp"
+
+TEST(io, mapped_file) {
+    auto root = std::filesystem::temp_directory_path() / "mapped_file_test";
+    io::set_device("test", std::make_shared<io::StdfsDevice>(root));
+
+    const char data[] = "Hello, world!";
+    const int n = std::strlen(data);
+    io::write_bytes(
+        "test:file.bin", reinterpret_cast<const ubyte*>(data), n
+    );
+    {
+        io::mapped_file file("test:file.bin");
+        ASSERT_EQ(file.size(), n);
+        EXPECT_EQ(std::memcmp(file.data(), data, n), 0);
+
+        auto span = file.span(7, 5);
+        EXPECT_EQ(std::string(span.begin(), span.end()), "world");
+        EXPECT_THROW(file.span(10, 4), std::out_of_range);
+    }
+    EXPECT_THROW(io::mapped_file("test:missing.bin"), std::runtime_error);
+
+    io::remove_device("test");
+    std::filesystem::remove_all(root);
+}
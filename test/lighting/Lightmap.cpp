@@ -0,0 +1,78 @@
+#include <gtest/gtest.h>
+
+#include <random>
+
+#include "lighting/Lightmap.hpp"
+#include "voxels/ChunkVoxels.hpp"
+
+static void fill_random(Lightmap& lightmap, int seed) {
+    std::mt19937 random(seed);
+    for (uint i = 0; i < CHUNK_VOL; i++) {
+        lightmap.map[i] = Lightmap::combine(0, 0, 0, 15);
+    }
+    // torches light spots
+    for (int n = 0; n < 32; n++) {
+        int cx = random() % CHUNK_W;
+        int cy = random() % CHUNK_H;
+        int cz = random() % CHUNK_D;
+        for (int y = std::max(cy - 4, 0); y < std::min(cy + 4, CHUNK_H); y++) {
+            for (int z = 0; z < CHUNK_D; z++) {
+                for (int x = 0; x < CHUNK_W; x++) {
+                    int d = std::abs(x - cx) + std::abs(y - cy) +
+                            std::abs(z - cz);
+                    if (d < 14) {
+                        lightmap.setR(x, y, z, 14 - d);
+                        lightmap.setG(x, y, z, (14 - d) / 2);
+                    }
+                }
+            }
+        }
+    }
+}
+
+TEST(Lightmap, EncodeDecode) {
+    auto lightmap = std::make_unique<Lightmap>();
+    fill_random(*lightmap, 7);
+
+    size_t size;
+    auto data = lightmap->encode(size);
+    EXPECT_NE(size, LIGHTMAP_DATA_LEN);
+
+    auto decoded = std::make_unique<Lightmap>();
+    EXPECT_EQ(decoded->decode(data.get(), size), LightmapContent::ALL);
+    for (uint i = 0; i < CHUNK_VOL; i++) {
+        ASSERT_EQ(lightmap->map[i], decoded->map[i]) << "at " << i;
+    }
+}
+
+TEST(Lightmap, UniformSections) {
+    auto lightmap = std::make_unique<Lightmap>();
+    for (uint i = CHUNK_VOL / 2; i < CHUNK_VOL; i++) {
+        lightmap->map[i] = Lightmap::SUN_LIGHT_ONLY;
+    }
+    size_t size;
+    auto data = lightmap->encode(size);
+    EXPECT_EQ(size, 1 + CHUNK_SECTIONS * 3);
+
+    auto decoded = std::make_unique<Lightmap>();
+    EXPECT_EQ(decoded->decode(data.get(), size), LightmapContent::ALL);
+    EXPECT_EQ(decoded->map[0], 0);
+    EXPECT_EQ(decoded->map[CHUNK_VOL - 1], Lightmap::SUN_LIGHT_ONLY);
+}
+
+TEST(Lightmap, LegacyAndCorrupted) {
+    auto legacy = std::make_unique<ubyte[]>(LIGHTMAP_DATA_LEN);
+    std::fill(legacy.get(), legacy.get() + LIGHTMAP_DATA_LEN, 0xFF);
+    auto lightmap = std::make_unique<Lightmap>();
+    EXPECT_EQ(
+        lightmap->decode(legacy.get(), LIGHTMAP_DATA_LEN), LightmapContent::SKY
+    );
+    EXPECT_EQ(lightmap->map[1], Lightmap::SUN_LIGHT_ONLY);
+
+    fill_random(*lightmap, 3);
+    size_t size;
+    auto data = lightmap->encode(size);
+    EXPECT_EQ(lightmap->decode(data.get(), size / 2), LightmapContent::NONE);
+    data[0] = LIGHTMAP_FORMAT_VERSION + 1;
+    EXPECT_EQ(lightmap->decode(data.get(), size), LightmapContent::NONE);
+}
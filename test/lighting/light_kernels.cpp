@@ -0,0 +1,164 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <string>
+#include <random>
+#include <vector>
+
+#include "lighting/light_kernels.hpp"
+#include "voxels/ChunkVoxels.hpp"
+#include "voxels/voxel.hpp"
+
+using namespace light_kernels;
+
+static constexpr int BENCHMARK_ITERATIONS = 200;
+
+/// @brief Previous per-column implementation used as a reference
+static int prebuild_sky_light_scalar(
+    const voxel* voxels, light_t* lights, const ubyte* flags
+) {
+    int highestPoint = 0;
+    for (int z = 0; z < CHUNK_D; z++) {
+        for (int x = 0; x < CHUNK_W; x++) {
+            for (int y = CHUNK_H - 1; y >= 0; y--) {
+                int index = vox_index(x, y, z);
+                if (!(flags[voxels[index].id] & SKY_LIGHT_PASSING)) {
+                    if (highestPoint < y) {
+                        highestPoint = y;
+                    }
+                    break;
+                }
+                lights[index] = (lights[index] & 0x0FFF) | 0xF000;
+            }
+        }
+    }
+    if (highestPoint < CHUNK_H - 1) {
+        highestPoint++;
+    }
+    return highestPoint;
+}
+
+/// @brief Generate chunk with air above random ground level
+/// @param sparse place sparse opaque blocks in the air
+static std::vector<voxel> generate_chunk(
+    std::mt19937& random, int maxHeight, bool sparse
+) {
+    std::vector<voxel> voxels(CHUNK_VOL);
+    std::uniform_int_distribution<int> heights(0, maxHeight);
+    std::uniform_int_distribution<int> chance(0, 99);
+    for (int z = 0; z < CHUNK_D; z++) {
+        for (int x = 0; x < CHUNK_W; x++) {
+            int height = heights(random);
+            for (int y = 0; y < CHUNK_H; y++) {
+                blockid_t id = 0;
+                if (y < height) {
+                    id = 1 + chance(random) % 3;
+                } else if (sparse && chance(random) == 0) {
+                    id = 1;
+                }
+                voxels[vox_index(x, y, z)] = voxel {id, {}};
+            }
+        }
+    }
+    return voxels;
+}
+
+// 0 - air, 1 - opaque, 2 - glass (passes everything), 3 - leaves
+// (passes light but not sky light)
+static const ubyte FLAGS[] {
+    LIGHT_PASSING | SKY_LIGHT_PASSING,
+    0,
+    LIGHT_PASSING | SKY_LIGHT_PASSING,
+    LIGHT_PASSING | EMISSIVE,
+};
+
+TEST(lighting, prebuild_sky_light) {
+    std::mt19937 random(42);
+    for (int maxHeight : {0, 1, 64, CHUNK_H - 1, CHUNK_H}) {
+        auto voxels = generate_chunk(random, maxHeight, maxHeight % 2 == 0);
+        std::vector<light_t> expected(CHUNK_VOL, 0x0123);
+
+        int expectedHighest =
+            prebuild_sky_light_scalar(voxels.data(), expected.data(), FLAGS);
+        for (bool compact : {false, true}) {
+            ChunkVoxels chunkVoxels(compact);
+            chunkVoxels.set(voxels.data());
+            std::vector<light_t> actual(CHUNK_VOL, 0x0123);
+            int actualHighest =
+                prebuild_sky_light(chunkVoxels, actual.data(), FLAGS);
+            EXPECT_EQ(actualHighest, expectedHighest);
+            EXPECT_EQ(actual, expected);
+        }
+    }
+}
+
+TEST(lighting, extract_border) {
+    std::mt19937 random(42);
+    std::uniform_int_distribution<int> values(0, 3);
+    std::vector<light_t> lights(CHUNK_VOL);
+    for (auto& light : lights) {
+        light = values(random) ? 0 : random() & 0xFFFF;
+    }
+    std::vector<BorderLight> border;
+    extract_border(lights.data(), border);
+
+    std::vector<bool> visited(CHUNK_VOL);
+    for (const auto& [index, light] : border) {
+        ASSERT_LT(index, CHUNK_VOL);
+        EXPECT_FALSE(visited[index]);
+        visited[index] = true;
+        EXPECT_EQ(light, lights[index]);
+    }
+    for (int y = 0; y < CHUNK_H; y++) {
+        for (int z = 0; z < CHUNK_D; z++) {
+            for (int x = 0; x < CHUNK_W; x++) {
+                int index = vox_index(x, y, z);
+                bool isBorder = x == 0 || z == 0 || x == CHUNK_W - 1 ||
+                                z == CHUNK_D - 1;
+                EXPECT_EQ(visited[index], isBorder && lights[index] != 0);
+            }
+        }
+    }
+}
+
+static void run_benchmark(const char* name, const std::vector<voxel>& voxels) {
+    using namespace std::chrono;
+
+    std::vector<light_t> lights(CHUNK_VOL);
+    ChunkVoxels chunkVoxels;
+    chunkVoxels.set(voxels.data());
+
+    int checksum = 0;
+    auto start = high_resolution_clock::now();
+    for (int i = 0; i < BENCHMARK_ITERATIONS; i++) {
+        checksum +=
+            prebuild_sky_light_scalar(voxels.data(), lights.data(), FLAGS);
+    }
+    auto scalarTime = duration_cast<microseconds>(
+        high_resolution_clock::now() - start
+    ).count();
+
+    start = high_resolution_clock::now();
+    for (int i = 0; i < BENCHMARK_ITERATIONS; i++) {
+        checksum -= prebuild_sky_light(chunkVoxels, lights.data(), FLAGS);
+    }
+    auto kernelTime = duration_cast<microseconds>(
+        high_resolution_clock::now() - start
+    ).count();
+
+    EXPECT_EQ(checksum, 0);
+    // written to the test report (--gtest_output) instead of stdout
+    ::testing::Test::RecordProperty(
+        std::string(name) + "_scalar_us", std::to_string(scalarTime)
+    );
+    ::testing::Test::RecordProperty(
+        std::string(name) + "_kernel_us", std::to_string(kernelTime)
+    );
+}
+
+/// Timing only, run with --gtest_also_run_disabled_tests
+TEST(lighting, DISABLED_prebuild_sky_light_benchmark) {
+    std::mt19937 random(42);
+    run_benchmark("terrain", generate_chunk(random, 64, false));
+    run_benchmark("sparse", generate_chunk(random, 64, true));
+}
@@ -0,0 +1,69 @@
+#include <gtest/gtest.h>
+
+#include <random>
+
+#include "physics/Broadphase.hpp"
+
+static std::vector<AABB> generate_boxes(int count, float range, int seed) {
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<float> coord(-range, range);
+    std::uniform_real_distribution<float> size(0.1f, 3.0f);
+
+    std::vector<AABB> boxes;
+    for (int i = 0; i < count; i++) {
+        glm::vec3 pos(coord(random), coord(random), coord(random));
+        glm::vec3 half(size(random), size(random), size(random));
+        boxes.emplace_back(pos - half, pos + half);
+    }
+    return boxes;
+}
+
+TEST(Broadphase, FindsAllIntersecting) {
+    auto boxes = generate_boxes(2000, 60.0f, 1);
+    // huge box
+    boxes.emplace_back(glm::vec3(-500.0f), glm::vec3(500.0f));
+
+    Broadphase grid(2.0f);
+    for (const auto& box : boxes) {
+        grid.add(box);
+    }
+    grid.build();
+    EXPECT_EQ(grid.size(), boxes.size());
+
+    std::vector<uint> indices;
+    for (const auto& area : generate_boxes(200, 60.0f, 2)) {
+        grid.query(area, indices);
+        EXPECT_TRUE(std::is_sorted(indices.begin(), indices.end()));
+        EXPECT_EQ(
+            std::adjacent_find(indices.begin(), indices.end()), indices.end()
+        );
+        size_t expected = 0;
+        for (uint i = 0; i < boxes.size(); i++) {
+            if (!boxes[i].intersects(area)) {
+                continue;
+            }
+            expected++;
+            EXPECT_TRUE(
+                std::binary_search(indices.begin(), indices.end(), i)
+            );
+        }
+        EXPECT_LT(indices.size(), boxes.size() / 4 + expected);
+    }
+}
+
+TEST(Broadphase, LargeArea) {
+    Broadphase grid(2.0f);
+    for (const auto& box : generate_boxes(100, 10.0f, 3)) {
+        grid.add(box);
+    }
+    grid.build();
+
+    std::vector<uint> indices;
+    grid.query(AABB(glm::vec3(-1000.0f), glm::vec3(1000.0f)), indices);
+    EXPECT_EQ(indices.size(), 100);
+
+    grid.clear();
+    grid.build();
+    grid.query(AABB(glm::vec3(-1.0f), glm::vec3(1.0f)), indices);
+    EXPECT_TRUE(indices.empty());
+}
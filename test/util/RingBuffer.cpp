@@ -0,0 +1,69 @@
+#include <gtest/gtest.h>
+#include <string>
+
+#include "util/RingBuffer.hpp"
+
+using namespace util;
+
+TEST(util, RingBufferWrapAround) {
+    RingBuffer<char> ring(16);
+    char out[32] {};
+    for (int i = 0; i < 100; i++) {
+        ring.write("hello, ", 7);
+        ring.write("world", 5);
+        ASSERT_EQ(12, ring.size());
+        ASSERT_EQ(12, ring.read(out, sizeof(out)));
+        ASSERT_EQ("hello, world", std::string(out, 12));
+        ASSERT_TRUE(ring.empty());
+    }
+}
+
+TEST(util, RingBufferGrow) {
+    RingBuffer<int> ring;
+    for (int i = 0; i < 10; i++) {
+        ring.write(&i, 1);
+    }
+    int value;
+    ring.read(&value, 1);
+    ASSERT_EQ(0, value);
+    for (int i = 10; i < 1000; i++) {
+        ring.write(&i, 1);
+    }
+    ASSERT_EQ(999, ring.size());
+    for (int i = 1; i < 1000; i++) {
+        ASSERT_EQ(1, ring.read(&value, 1));
+        ASSERT_EQ(i, value);
+    }
+    ASSERT_EQ(0, ring.read(&value, 1));
+}
+
+TEST(util, RingBufferFront) {
+    RingBuffer<char> ring(16);
+    ring.write("0123456789", 10);
+    ring.pop(8);
+    ring.write("abcdefghij", 10);
+    std::string result;
+    while (!ring.empty()) {
+        size_t size = ring.frontSize();
+        result.append(ring.frontData(), size);
+        ring.pop(size);
+    }
+    ASSERT_EQ("89abcdefghij", result);
+}
+
+TEST(util, RingBufferParts) {
+    RingBuffer<char> ring(16);
+    const char* parts[2] = {};
+    size_t sizes[2] = {};
+    ASSERT_EQ(0, ring.getParts(parts, sizes));
+    ring.write("0123456789", 10);
+    ASSERT_EQ(1, ring.getParts(parts, sizes));
+    ASSERT_EQ("0123456789", std::string(parts[0], sizes[0]));
+    ring.pop(8);
+    ring.write("abcdefghij", 10);
+    ASSERT_EQ(2, ring.getParts(parts, sizes));
+    ASSERT_EQ(
+        "89abcdefghij",
+        std::string(parts[0], sizes[0]) + std::string(parts[1], sizes[1])
+    );
+}
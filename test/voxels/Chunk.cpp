@@ -5,10 +5,11 @@
 TEST(Chunk, EncodeDecode) {
     Chunk chunk1(0, 0);
     for (uint i = 0; i < CHUNK_VOL; i++) {
-        chunk1.voxels[i].id = rand();
-        chunk1.voxels[i].state.rotation = rand();
-        chunk1.voxels[i].state.segment = rand();
-        chunk1.voxels[i].state.userbits = rand();
+        auto& vox = chunk1.voxels.at(i);
+        vox.id = rand();
+        vox.state.rotation = rand();
+        vox.state.segment = rand();
+        vox.state.userbits = rand();
     }
     auto bytes = chunk1.encode();
 
@@ -16,10 +17,38 @@ TEST(Chunk, EncodeDecode) {
     chunk2.decode(bytes.get());
 
     for (uint i = 0; i < CHUNK_VOL; i++) {
-        EXPECT_EQ(chunk1.voxels[i].id, chunk2.voxels[i].id);
+        EXPECT_EQ(chunk1.voxels.get(i).id, chunk2.voxels.get(i).id);
         EXPECT_EQ(
-            blockstate2int(chunk1.voxels[i].state), 
-            blockstate2int(chunk2.voxels[i].state)
+            blockstate2int(chunk1.voxels.get(i).state), 
+            blockstate2int(chunk2.voxels.get(i).state)
         );
     }
 }
+
+TEST(Chunk, ModifiedSections) {
+    Chunk chunk(0, 0);
+    EXPECT_FALSE(chunk.flags.modified);
+    EXPECT_EQ(chunk.modifiedSections, 0);
+
+    chunk.setModified(20);
+    EXPECT_TRUE(chunk.flags.modified);
+    EXPECT_EQ(chunk.modifiedSections, 0b10);
+
+    // section borders mark neighbour sections too
+    chunk.modifiedSections = 0;
+    chunk.setModified(31);
+    EXPECT_EQ(chunk.modifiedSections, 0b110);
+    chunk.modifiedSections = 0;
+    chunk.setModified(16);
+    EXPECT_EQ(chunk.modifiedSections, 0b11);
+
+    chunk.modifiedSections = 0;
+    chunk.setModified(0);
+    EXPECT_EQ(chunk.modifiedSections, 0b1);
+    chunk.setModified(CHUNK_H - 1);
+    EXPECT_EQ(chunk.modifiedSections, 0b1 | (1 << (CHUNK_SECTIONS - 1)));
+
+    chunk.setModifiedAndUnsaved();
+    EXPECT_TRUE(chunk.flags.unsaved);
+    EXPECT_EQ(chunk.modifiedSections, Chunk::ALL_SECTIONS);
+}
@@ -0,0 +1,94 @@
+#include <gtest/gtest.h>
+
+#include <random>
+#include <vector>
+
+#include "voxels/ChunkVoxels.hpp"
+
+static std::vector<voxel> generate_voxels(int paletteSize) {
+    std::mt19937 random(42);
+    std::vector<voxel> voxels(CHUNK_VOL);
+    for (uint i = 0; i < CHUNK_VOL; i++) {
+        int section = i / CHUNK_SECTION_VOL;
+        auto& vox = voxels[i];
+        if (section % 2 == 0) {
+            // uniform section
+            vox.id = section;
+        } else {
+            vox.id = random() % paletteSize;
+            vox.state = int2blockstate(random() % 2);
+        }
+    }
+    return voxels;
+}
+
+static void expect_equal(
+    const ChunkVoxels& chunkVoxels, const std::vector<voxel>& voxels
+) {
+    for (uint i = 0; i < CHUNK_VOL; i++) {
+        ASSERT_EQ(chunkVoxels.get(i).id, voxels[i].id);
+        ASSERT_EQ(
+            blockstate2int(chunkVoxels.get(i).state),
+            blockstate2int(voxels[i].state)
+        );
+    }
+}
+
+TEST(ChunkVoxels, SetGet) {
+    for (int paletteSize : {1, 2, 3, 16, 100, 1000}) {
+        auto voxels = generate_voxels(paletteSize);
+        for (bool compact : {false, true}) {
+            ChunkVoxels chunkVoxels(compact);
+            chunkVoxels.set(voxels.data());
+            expect_equal(chunkVoxels, voxels);
+
+            std::vector<voxel> copy(CHUNK_VOL);
+            chunkVoxels.copyTo(copy.data());
+            for (uint i = 0; i < CHUNK_VOL; i++) {
+                ASSERT_EQ(copy[i].id, voxels[i].id);
+            }
+            voxel buffer[CHUNK_W * CHUNK_D];
+            for (int y = 0; y < CHUNK_H; y++) {
+                const voxel* layer = chunkVoxels.getLayer(y, buffer);
+                for (int i = 0; i < CHUNK_W * CHUNK_D; i++) {
+                    ASSERT_EQ(layer[i].id, voxels[y * CHUNK_W * CHUNK_D + i].id);
+                }
+            }
+        }
+    }
+}
+
+TEST(ChunkVoxels, Compaction) {
+    auto voxels = generate_voxels(16);
+    ChunkVoxels chunkVoxels(true);
+    EXPECT_EQ(chunkVoxels.countExpanded(), 0);
+    EXPECT_EQ(chunkVoxels.get(0).id, BLOCK_AIR);
+    size_t emptySize = chunkVoxels.getMemoryUsage();
+
+    chunkVoxels.set(voxels.data());
+    EXPECT_EQ(chunkVoxels.countExpanded(), 0);
+    ASSERT_NE(chunkVoxels.getUniform(0), nullptr);
+    EXPECT_EQ(chunkVoxels.getUniform(0)->id, 0);
+    EXPECT_EQ(chunkVoxels.getUniform(1), nullptr);
+    EXPECT_LT(chunkVoxels.getMemoryUsage(), CHUNK_VOL * sizeof(voxel) / 4);
+    EXPECT_GT(chunkVoxels.getMemoryUsage(), emptySize);
+
+    // writing expands the section
+    uint index = CHUNK_SECTION_VOL * 3 + 10;
+    chunkVoxels.at(index).id = 500;
+    voxels[index].id = 500;
+    EXPECT_EQ(chunkVoxels.countExpanded(), 1);
+    expect_equal(chunkVoxels, voxels);
+
+    // used section survives the first compaction
+    EXPECT_EQ(chunkVoxels.compact(), 0);
+    EXPECT_EQ(chunkVoxels.countExpanded(), 1);
+    EXPECT_EQ(chunkVoxels.compact(), 1);
+    EXPECT_EQ(chunkVoxels.countExpanded(), 0);
+    expect_equal(chunkVoxels, voxels);
+
+    ChunkVoxels expanded(false);
+    expanded.set(voxels.data());
+    EXPECT_EQ(expanded.compact(), 0);
+    EXPECT_EQ(expanded.countExpanded(), CHUNK_SECTIONS);
+}
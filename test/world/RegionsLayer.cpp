@@ -0,0 +1,258 @@
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#include "io/io.hpp"
+#include "io/devices/StdfsDevice.hpp"
+#include "util/data_io.hpp"
+#include "world/files/WorldRegions.hpp"
+
+namespace fs = std::filesystem;
+
+class RegionsLayerTest : public ::testing::Test {
+protected:
+    fs::path root;
+    RegionsCacheStats stats;
+    RegionsLayer layer;
+
+    void SetUp() override {
+        root = fs::temp_directory_path() / "regions_layer_test";
+        fs::remove_all(root);
+        fs::create_directories(root / "regions");
+        io::set_device("test", std::make_shared<io::StdfsDevice>(root));
+
+        layer.layer = REGION_LAYER_VOXELS;
+        layer.folder = "test:regions";
+        layer.cacheStats = &stats;
+    }
+
+    void TearDown() override {
+        io::remove_device("test");
+        fs::remove_all(root);
+    }
+
+    /// @brief Put chunk data filled with the value (region 0_0 chunks
+    /// are placed along X axis)
+    void put(int index, uint32_t size, ubyte value) {
+        auto data = std::make_unique<ubyte[]>(size);
+        std::memset(data.get(), value, size);
+        layer.putData(index, 0, std::move(data), size, size * 2);
+    }
+
+    void remove(int index) {
+        layer.putData(index, 0, nullptr, 0, 0);
+    }
+
+    void write() {
+        auto region = layer.getRegion(0, 0);
+        ASSERT_NE(region, nullptr);
+        layer.writeRegion(0, 0, region.get());
+    }
+
+    fs::path getFilePath(int x, int z) {
+        return io::resolve(layer.getRegionFilePath(x, z));
+    }
+
+    /// @return chunks table entry: first sector and sectors count
+    glm::u32vec2 readTableEntry(int index) {
+        std::ifstream file(getFilePath(0, 0), std::ios::binary);
+        file.seekg(REGION_HEADER_SIZE + index * 8);
+        uint32_t buffer[2] {};
+        file.read(reinterpret_cast<char*>(buffer), sizeof(buffer));
+        return {dataio::le2h(buffer[0]), dataio::le2h(buffer[1])};
+    }
+
+    void writeTableEntry(int index, glm::u32vec2 entry) {
+        std::fstream file(
+            getFilePath(0, 0), std::ios::in | std::ios::out | std::ios::binary
+        );
+        file.seekp(REGION_HEADER_SIZE + index * 8);
+        uint32_t buffer[2] {dataio::h2le(entry[0]), dataio::h2le(entry[1])};
+        file.write(reinterpret_cast<const char*>(buffer), sizeof(buffer));
+    }
+
+    uint readVersion(int x, int z) {
+        regfile file(layer.getRegionFilePath(x, z));
+        return file.version;
+    }
+
+    /// @brief Check chunk data stored in the region file
+    void expectChunk(
+        int x, int z, int index, uint32_t size, ubyte value
+    ) {
+        regfile file(layer.getRegionFilePath(x, z));
+        uint32_t readSize = 0;
+        uint32_t srcSize = 0;
+        auto data = file.read(index, readSize, srcSize);
+        ASSERT_NE(data, nullptr) << "chunk " << index;
+        ASSERT_EQ(readSize, size) << "chunk " << index;
+        EXPECT_EQ(srcSize, size * 2) << "chunk " << index;
+        for (uint32_t i = 0; i < size; i++) {
+            ASSERT_EQ(data[i], value) << "chunk " << index << " byte " << i;
+        }
+    }
+
+    void expectNoChunk(int index) {
+        regfile file(layer.getRegionFilePath(0, 0));
+        uint32_t size, srcSize;
+        EXPECT_EQ(file.read(index, size, srcSize), nullptr);
+    }
+
+    uintmax_t fileSectors() {
+        return fs::file_size(getFilePath(0, 0)) / REGION_SECTOR_SIZE;
+    }
+};
+
+TEST_F(RegionsLayerTest, WriteInPlaceAndCompact) {
+    // new file
+    put(0, 100, 1);
+    put(1, 1000, 2);
+    write();
+    EXPECT_EQ(readVersion(0, 0), REGION_FORMAT_VERSION);
+    EXPECT_EQ(readTableEntry(0), glm::u32vec2(REGION_DATA_SECTOR, 1));
+    EXPECT_EQ(readTableEntry(1), glm::u32vec2(REGION_DATA_SECTOR + 1, 2));
+    EXPECT_EQ(fileSectors(), REGION_DATA_SECTOR + 3);
+    expectChunk(0, 0, 0, 100, 1);
+    expectChunk(0, 0, 1, 1000, 2);
+
+    // rewritten in place
+    put(0, 200, 3);
+    write();
+    EXPECT_EQ(readTableEntry(0), glm::u32vec2(REGION_DATA_SECTOR, 1));
+    EXPECT_EQ(readTableEntry(1), glm::u32vec2(REGION_DATA_SECTOR + 1, 2));
+    EXPECT_EQ(fileSectors(), REGION_DATA_SECTOR + 3);
+    expectChunk(0, 0, 0, 200, 3);
+    expectChunk(0, 0, 1, 1000, 2);
+
+    // grown chunk is moved to new sectors
+    put(0, 2000, 4);
+    write();
+    EXPECT_EQ(readTableEntry(0), glm::u32vec2(REGION_DATA_SECTOR + 3, 4));
+    EXPECT_EQ(readTableEntry(1), glm::u32vec2(REGION_DATA_SECTOR + 1, 2));
+    EXPECT_EQ(fileSectors(), REGION_DATA_SECTOR + 7);
+    expectChunk(0, 0, 0, 2000, 4);
+    expectChunk(0, 0, 1, 1000, 2);
+
+    // freed sector gets reused
+    put(2, 100, 5);
+    write();
+    EXPECT_EQ(readTableEntry(2), glm::u32vec2(REGION_DATA_SECTOR, 1));
+    expectChunk(0, 0, 2, 100, 5);
+
+    // big chunk followed by a small one
+    put(3, 80 * REGION_SECTOR_SIZE - 8, 6);
+    write();
+    put(4, 100, 7);
+    write();
+    EXPECT_EQ(readTableEntry(3), glm::u32vec2(REGION_DATA_SECTOR + 7, 80));
+    EXPECT_EQ(readTableEntry(4), glm::u32vec2(REGION_DATA_SECTOR + 87, 1));
+    expectChunk(0, 0, 3, 80 * REGION_SECTOR_SIZE - 8, 6);
+
+    // removing the big chunk leaves enough free sectors to compact the file
+    remove(3);
+    write();
+    expectNoChunk(3);
+    EXPECT_EQ(readTableEntry(3), glm::u32vec2(0, 0));
+    EXPECT_EQ(readTableEntry(0), glm::u32vec2(REGION_DATA_SECTOR, 4));
+    EXPECT_EQ(readTableEntry(1), glm::u32vec2(REGION_DATA_SECTOR + 4, 2));
+    EXPECT_EQ(readTableEntry(2), glm::u32vec2(REGION_DATA_SECTOR + 6, 1));
+    EXPECT_EQ(readTableEntry(4), glm::u32vec2(REGION_DATA_SECTOR + 7, 1));
+    EXPECT_EQ(fileSectors(), REGION_DATA_SECTOR + 8);
+    expectChunk(0, 0, 0, 2000, 4);
+    expectChunk(0, 0, 1, 1000, 2);
+    expectChunk(0, 0, 2, 100, 5);
+    expectChunk(0, 0, 4, 100, 7);
+}
+
+TEST_F(RegionsLayerTest, TrailingFreeSectorsTruncated) {
+    put(0, 100, 1);
+    put(1, 3000, 2);
+    write();
+    EXPECT_EQ(fileSectors(), REGION_DATA_SECTOR + 7);
+
+    remove(1);
+    write();
+    expectNoChunk(1);
+    EXPECT_EQ(fileSectors(), REGION_DATA_SECTOR + 1);
+    expectChunk(0, 0, 0, 100, 1);
+}
+
+TEST_F(RegionsLayerTest, ChunkPastEndRejected) {
+    put(0, 100, 1);
+    put(1, 1000, 2);
+    write();
+    ASSERT_EQ(fileSectors(), REGION_DATA_SECTOR + 3);
+
+    // ends one sector past the end of file
+    writeTableEntry(1, glm::u32vec2(REGION_DATA_SECTOR + 1, 3));
+    put(0, 200, 3);
+    auto region = layer.getRegion(0, 0);
+    EXPECT_THROW(layer.writeRegion(0, 0, region.get()), std::runtime_error);
+    // chunk is kept unsaved to be written later
+    EXPECT_TRUE(region->isChunkUnsaved(0, 0));
+}
+
+TEST_F(RegionsLayerTest, UpgradeFromV3) {
+    // version 3 layout: header, chunks with sizes prefix, offsets table
+    // at the end of file
+    std::vector<ubyte> bytes(REGION_HEADER_SIZE);
+    std::memcpy(bytes.data(), ".VOXREG", 8);
+    bytes[8] = 3;
+    bytes[9] = static_cast<ubyte>(compression::Method::NONE);
+
+    uint32_t offsets[REGION_CHUNKS_COUNT] {};
+    auto putChunk = [&](int index, uint32_t size, ubyte value) {
+        offsets[index] = dataio::h2le(static_cast<uint32_t>(bytes.size()));
+        uint32_t sizes[2] {dataio::h2le(size), dataio::h2le(size * 2)};
+        auto src = reinterpret_cast<const ubyte*>(sizes);
+        bytes.insert(bytes.end(), src, src + sizeof(sizes));
+        bytes.insert(bytes.end(), size, value);
+    };
+    putChunk(0, 300, 1);
+    putChunk(5, 700, 2);
+    auto src = reinterpret_cast<const ubyte*>(offsets);
+    bytes.insert(bytes.end(), src, src + sizeof(offsets));
+    io::write_bytes(
+        layer.getRegionFilePath(0, 0), bytes.data(), bytes.size()
+    );
+    ASSERT_EQ(readVersion(0, 0), 3u);
+    expectChunk(0, 0, 0, 300, 1);
+    expectChunk(0, 0, 5, 700, 2);
+
+    put(1, 100, 3);
+    put(5, 50, 4);
+    write();
+
+    EXPECT_EQ(readVersion(0, 0), REGION_FORMAT_VERSION);
+    EXPECT_EQ(readTableEntry(0), glm::u32vec2(REGION_DATA_SECTOR, 1));
+    EXPECT_EQ(readTableEntry(1), glm::u32vec2(REGION_DATA_SECTOR + 1, 1));
+    EXPECT_EQ(readTableEntry(5), glm::u32vec2(REGION_DATA_SECTOR + 2, 1));
+    expectChunk(0, 0, 0, 300, 1);
+    expectChunk(0, 0, 1, 100, 3);
+    expectChunk(0, 0, 5, 50, 4);
+
+    // upgraded file is written in place then
+    put(0, 400, 5);
+    write();
+    EXPECT_EQ(readTableEntry(0), glm::u32vec2(REGION_DATA_SECTOR, 1));
+    expectChunk(0, 0, 0, 400, 5);
+    expectChunk(0, 0, 5, 50, 4);
+}
+
+TEST_F(RegionsLayerTest, HasData) {
+    EXPECT_FALSE(layer.hasData(0, 0));
+
+    put(0, 100, 1);
+    EXPECT_TRUE(layer.hasData(0, 0));
+    EXPECT_FALSE(layer.hasData(1, 0));
+    write();
+    EXPECT_TRUE(layer.hasData(0, 0));
+
+    // saved chunk removed in memory
+    remove(0);
+    EXPECT_FALSE(layer.hasData(0, 0));
+    write();
+    EXPECT_FALSE(layer.hasData(0, 0));
+}